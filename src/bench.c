@@ -0,0 +1,1215 @@
+/*
+ * bench - time the kernels of the NIST Statistical Test Suite
+ *
+ * For a range of bitcounts, test parameters and thread counts, sts_bench times:
+ *
+ *      the iterate function of each test
+ *      the ASCII and raw binary input parsers
+ *      the FFT used by the Discrete Fourier Transform test
+ *      the matrix fill and rank computation used by the Rank test
+ *      the cephes igamc() and normal() functions
+ *
+ * on reproducible synthetic data, and reports the cost per processed bit (ns/bit).
+ *
+ * Each measurement is calibrated so that a repetition lasts at least a minimum time,
+ * is preceded by warmup repetitions, and reports the median, min and max of the repetitions.
+ * The output is a text table or, with -R json, a JSON document, written to stdout.
+ */
+
+/*
+ * This code has been heavily modified by the following people:
+ *
+ *      Landon Curt Noll
+ *      Tom Gilgan
+ *      Riccardo Paccagnella
+ *
+ * See the README.md and the initial comment in sts.c for more information.
+ *
+ * WE (THOSE LISTED ABOVE WHO HEAVILY MODIFIED THIS CODE) DISCLAIM ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL WE (THOSE LISTED ABOVE
+ * WHO HEAVILY MODIFIED THIS CODE) BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF
+ * USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ * chongo (Landon Curt Noll, http://www.isthe.com/chongo/index.html) /\oo/\
+ *
+ * Share and enjoy! :-)
+ */
+
+
+// Exit codes: 90 thru 99
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <math.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "utils/defs.h"
+#include "utils/utilities.h"
+#include "utils/externs.h"
+#include "utils/debug.h"
+#include "utils/timing.h"
+#include "utils/cephes.h"
+#include "utils/matrix.h"
+#if defined(LEGACY_FFT)
+#   include "utils/dfft.h"
+#   include "utils/rfft.h"
+#else /* LEGACY_FFT */
+#   include <fftw3.h>
+#endif /* LEGACY_FFT */
+
+
+// STS version
+const char *const version = "3.2.7";
+
+// Program name
+char *program = "sts_bench";
+
+// Do not debug by default
+long int debuglevel = DBG_NONE;
+
+
+/*
+ * Kernels to time
+ *
+ * Kernels 1 thru NUMOFTESTS are the iterate functions of the tests (enum test).
+ * The parsers are timed last because they overwrite epsilon with the parsed data.
+ */
+enum kernel {
+	KERNEL_FFT = NUMOFTESTS + 1,	// FFT of the DFT test, including the +1/-1 conversion
+	KERNEL_RANK,			// Matrix fill and rank computation of all the matrices of a bitstream
+	KERNEL_IGAMC,			// cephes_igamc() over a grid of chi-squared arguments
+	KERNEL_NORMAL,			// cephes_normal() over a grid of arguments
+	KERNEL_PARSE_ASCII,		// Read and convert ASCII '0'/'1' input into epsilon
+	KERNEL_PARSE_BINARY,		// Read and convert raw binary input into epsilon
+	KERNEL_END			// Must be last
+};
+
+#   define DEFAULT_BENCH_BITCOUNTS	"1048576,4194304"	// -S bitcount[,bitcount]..
+#   define DEFAULT_BENCH_REPEAT		(5)			// -r repeat
+#   define DEFAULT_BENCH_WARMUP		(1)			// -W warmup
+#   define DEFAULT_BENCH_MIN_TIME	(0.05)			// -M seconds
+#   define DEFAULT_BENCH_SEED		(1)			// -s seed
+#   define CEPHES_EVALUATIONS		(4096)			// Evaluations per call of the cephes kernels
+
+/*
+ * Name of the kernels that are not tests, as used by -k and by the report
+ */
+static const char *const kernelName[KERNEL_END - KERNEL_FFT] = {
+	"fft",
+	"rank",
+	"igamc",
+	"normal",
+	"ascii",
+	"binary",
+};
+
+/*
+ * Benchmark options and current configuration
+ */
+struct bench {
+	bool kernel[KERNEL_END];	// Kernels to time
+	long int *bitcount;		// -S bitcount[,bitcount]..: bitcounts to time
+	long int bitcountCount;		// Number of bitcounts
+	long int *threads;		// -T threads[,threads]..: thread counts to time
+	long int threadsCount;		// Number of thread counts
+	char **params;			// -P num=value[,num=value]..: parameter sets to time, NULL ==> defaults
+	long int paramsCount;		// Number of parameter sets
+	long int repeat;		// -r repeat: timed repetitions of each measurement
+	long int warmup;		// -W warmup: untimed repetitions before the timed ones
+	double minTime;			// -M seconds: minimum duration of a repetition
+	unsigned long int seed;		// -s seed: seed of the synthetic data
+	enum timing_format format;	// -R text|json: output format
+	long int results;		// Number of results reported so far
+
+	FILE *ascii;			// Synthetic ASCII input of one iteration
+	FILE *binary;			// Synthetic raw binary input of one iteration
+	double *cephes_a;		// First arguments of the cephes kernels
+	double *cephes_x;		// Second arguments of the cephes kernels
+};
+
+/*
+ * Per thread state of a repetition
+ */
+struct bench_thread {
+	struct thread_state thread_state;	// What the kernel is given
+	long int kernel;			// Kernel to call
+	long int calls;				// Number of calls to do
+	struct bench *bench;			// Benchmark options
+	BitSequence *batch;			// Input parser buffer
+	volatile double sink;			// Keeps the result of the kernels alive
+	pthread_t thread;			// Thread running the calls
+};
+
+
+/*
+ * Command line usage information
+ */
+/* *INDENT-OFF* */
+static const char * const usage =
+"[-v level] [-t test1[,test2]..] [-k kernel[,kernel]..] [-S bitcount[,bitcount]..]\n"
+"             [-P num=value[,num=value]..].. [-T threads[,threads]..] [-r repeat] [-W warmup] [-M seconds]\n"
+"             [-s seed] [-R format] [-h]\n"
+"\n"
+"    -v  debuglevel     debug level (def: 0 -> no debug messages)\n"
+"    -t test1[,test2].. time the iterate function of these tests, 0-15 (def: 0 -> all tests)\n"
+"    -k kernel[,kernel].. time these kernels (def: all kernels)\n"
+"\n"
+"        fft: FFT of the DFT test          rank: matrix fill and rank of the Rank test\n"
+"        igamc: cephes_igamc()             normal: cephes_normal()\n"
+"        ascii: ASCII input parser         binary: raw binary input parser\n"
+"        none: no kernel\n"
+"\n"
+"                       When only -t is given, no kernel is timed.  When only -k is given, no test is timed.\n"
+"\n"
+"    -S bitcount[,bitcount].. bits per iteration (def: " DEFAULT_BENCH_BITCOUNTS ")\n"
+"    -P num=value[,num=value].. time with this parameter set, as in sts -P (def: default parameters)\n"
+"                       Repeat -P to time each parameter set, e.g.: -P 2=9 -P 2=10\n"
+"    -T threads[,threads].. concurrent threads (def: 1 and the number of online CPUs)\n"
+"\n"
+"    -r repeat          timed repetitions of each measurement (def: 5)\n"
+"    -W warmup          untimed repetitions before the timed ones (def: 1)\n"
+"    -M seconds         minimum duration of a repetition (def: 0.05)\n"
+"    -s seed            seed of the synthetic data (def: 1)\n"
+"    -R format          text --> report a table (default)\n"
+"                       json --> report a JSON document\n"
+"\n"
+"    -h                 print this message and exit\n"
+"\n"
+"    ns/bit is the median wall clock time of a repetition divided by the number of bits processed by all threads.\n"
+"    For the cephes kernels, ns/eval is reported instead.\n";
+/* *INDENT-ON* */
+
+
+/*
+ * Forward static function declarations
+ */
+static void parseBenchArgs(struct bench *bench, int argc, char **argv);
+static long int *parseList(char *arg, char const *option, long int min, long int *count);
+static void setupState(struct bench *bench, struct state *state, long int n, long int threads, char *params);
+static void makeSyntheticData(struct bench *bench, struct state *state);
+static void benchKernel(struct bench *bench, struct state *state, struct bench_thread *bt, long int kernel);
+static double runRepetition(struct state *state, struct bench_thread *bt, long int kernel, long int calls);
+static void *runCalls(void *thread_args);
+static void runKernel(struct bench_thread *bt);
+static long int kernelParam(struct state *state, long int kernel);
+static void reportResult(struct bench *bench, struct state *state, long int kernel, double *wall, long int calls,
+			 long int ops);
+static int compareDouble(const void *a, const void *b);
+static unsigned long int nextRandom(unsigned long long int *x);
+
+
+int
+main(int argc, char *argv[])
+{
+	struct bench bench;		// Benchmark options
+	struct state state;		// State of the current configuration
+	struct bench_thread *bt;	// Per thread state
+	pthread_mutex_t mutex;		// Mutex shared by the threads
+	long int p;
+	long int b;
+	long int t;
+	long int k;
+	long int i;
+
+	/*
+	 * Parse command line
+	 */
+	parseBenchArgs(&bench, argc, argv);
+
+	/*
+	 * Setup the arguments of the cephes kernels
+	 *
+	 * The arguments cover the range that the tests use: igamc(K/2, chi^2/2) of a chi-squared
+	 * statistic with K degrees of freedom, and normal() of a standardized statistic.
+	 */
+	bench.cephes_a = malloc(CEPHES_EVALUATIONS * sizeof(bench.cephes_a[0]));
+	bench.cephes_x = malloc(CEPHES_EVALUATIONS * sizeof(bench.cephes_x[0]));
+	if (bench.cephes_a == NULL || bench.cephes_x == NULL) {
+		errp(90, __func__, "cannot malloc for cephes arguments: %d elements of %lu bytes each",
+		     CEPHES_EVALUATIONS, sizeof(double));
+	}
+	for (i = 0; i < CEPHES_EVALUATIONS; i++) {
+		bench.cephes_a[i] = (double) (1 + i % 64) / 2.0;
+		bench.cephes_x[i] = bench.cephes_a[i] * (0.25 + 4.0 * (double) (i / 64) / (CEPHES_EVALUATIONS / 64));
+	}
+
+	/*
+	 * Report header
+	 */
+	if (bench.format == TIMING_JSON) {
+		printf("{\n  \"version\": \"%s\",\n", version);
+#if defined(LEGACY_FFT)
+		printf("  \"fft\": \"legacy\",\n");
+#else /* LEGACY_FFT */
+		printf("  \"fft\": \"fftw\",\n");
+#endif /* LEGACY_FFT */
+		printf("  \"seed\": %lu,\n  \"repeat\": %ld,\n  \"warmup\": %ld,\n  \"results\": [", bench.seed, bench.repeat,
+		       bench.warmup);
+	} else {
+		printf("%-24s %10s %6s %7s %7s %11s %11s %11s %7s %10s\n", "# kernel", "bitcount", "param", "threads",
+		       "calls", "median_s", "min_s", "max_s", "spread%", "ns/bit");
+	}
+	fflush(stdout);
+
+	/*
+	 * Time each kernel for each parameter set, bitcount and thread count
+	 */
+	for (p = 0; p < bench.paramsCount; p++) {
+		for (b = 0; b < bench.bitcountCount; b++) {
+			for (t = 0; t < bench.threadsCount; t++) {
+
+				/*
+				 * Setup the state and the synthetic data of this configuration
+				 */
+				setupState(&bench, &state, bench.bitcount[b], bench.threads[t], bench.params[p]);
+				makeSyntheticData(&bench, &state);
+
+				/*
+				 * Setup the threads
+				 */
+				if (pthread_mutex_init(&mutex, NULL) != 0) {
+					err(90, __func__, "cannot initialize mutex");
+				}
+				bt = calloc((size_t) state.numberOfThreads, sizeof(*bt));
+				if (bt == NULL) {
+					errp(90, __func__, "cannot calloc for bench_thread: %ld elements of %lu bytes each",
+					     state.numberOfThreads, sizeof(*bt));
+				}
+				for (i = 0; i < state.numberOfThreads; i++) {
+					bt[i].thread_state.thread_id = i;
+					bt[i].thread_state.global_state = &state;
+					bt[i].thread_state.iteration_being_done = 0;
+					bt[i].thread_state.mutex = &mutex;
+					bt[i].bench = &bench;
+					bt[i].batch = malloc((size_t) state.tp.n * sizeof(bt[i].batch[0]));
+					if (bt[i].batch == NULL) {
+						errp(90, __func__, "cannot malloc for batch: %ld elements of %lu bytes each",
+						     state.tp.n, sizeof(bt[i].batch[0]));
+					}
+				}
+
+				/*
+				 * Time each kernel
+				 */
+				for (k = 1; k < KERNEL_END; k++) {
+					if (bench.kernel[k] == true) {
+						benchKernel(&bench, &state, bt, k);
+					}
+				}
+
+				/*
+				 * Cleanup this configuration
+				 */
+				for (i = 0; i < state.numberOfThreads; i++) {
+					free(bt[i].batch);
+				}
+				free(bt);
+				pthread_mutex_destroy(&mutex);
+				fclose(bench.ascii);
+				fclose(bench.binary);
+				if (state.streamFile != NULL) {
+					fclose(state.streamFile);
+					state.streamFile = NULL;
+				}
+				destroy(&state);
+			}
+		}
+	}
+
+	/*
+	 * Report trailer
+	 */
+	if (bench.format == TIMING_JSON) {
+		printf("\n  ]\n}\n");
+	}
+	fflush(stdout);
+
+	/*
+	 * Free memory no longer needed
+	 */
+	free(bench.bitcount);
+	free(bench.threads);
+	free(bench.params);
+	free(bench.cephes_a);
+	free(bench.cephes_x);
+	exit(0);
+}
+
+
+/*
+ * parseBenchArgs - parse the sts_bench command line
+ *
+ * given:
+ *      bench           // where to store the benchmark options
+ *      argc            // argument count
+ *      argv            // argument values
+ */
+static void
+parseBenchArgs(struct bench *bench, int argc, char **argv)
+{
+	int option;		// getopt() parsed option
+	extern char *optarg;	// Parsed option argument
+	extern int optind;	// Index to the next argv element to parse
+	extern int opterr;	// 0 ==> disable internal getopt() error messages
+	extern int optopt;	// Last known option character returned by getopt()
+	char *testArg = NULL;	// -t test1[,test2]..
+	char *kernelArg = NULL;	// -k kernel[,kernel]..
+	char *bitcountArg = NULL;	// -S bitcount[,bitcount]..
+	char *threadsArg = NULL;	// -T threads[,threads]..
+	char *phrase;		// String without separator as parsed by strtok_r()
+	char *brkt;		// Last state of strtok_r()
+	long int *list;		// Parsed -t list
+	long int count;		// Number of elements in list
+	bool success;		// true if str2longint was successful
+	long int i;
+	long int j;
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (bench == NULL || argc <= 0 || argv == NULL) {
+		err(91, __func__, "called with bogus args");
+	}
+	if (argv[0] != NULL && argv[0][0] != '\0') {
+		program = argv[0];
+	}
+
+	/*
+	 * Set default options
+	 */
+	memset(bench, 0, sizeof(*bench));
+	bench->params = calloc((size_t) argc + 1, sizeof(bench->params[0]));
+	if (bench->params == NULL) {
+		errp(91, __func__, "cannot calloc for params: %d elements of %lu bytes each", argc + 1,
+		     sizeof(bench->params[0]));
+	}
+	bench->repeat = DEFAULT_BENCH_REPEAT;
+	bench->warmup = DEFAULT_BENCH_WARMUP;
+	bench->minTime = DEFAULT_BENCH_MIN_TIME;
+	bench->seed = DEFAULT_BENCH_SEED;
+	bench->format = TIMING_TEXT;
+
+	/*
+	 * Parse the command line arguments
+	 */
+	opterr = 0;
+	while ((option = getopt(argc, argv, "v:t:k:S:P:T:r:W:M:s:R:h")) != -1) {
+		switch (option) {
+
+		case 'v':	// -v debuglevel
+			debuglevel = str2longint(&success, optarg);
+			if (success == false || debuglevel < 0) {
+				usage_err(91, __func__, "-v debuglevel must be an integer >= 0: %s", optarg);
+			}
+			break;
+
+		case 't':	// -t test1[,test2]..
+			testArg = optarg;
+			break;
+
+		case 'k':	// -k kernel[,kernel]..
+			kernelArg = optarg;
+			break;
+
+		case 'S':	// -S bitcount[,bitcount]..
+			bitcountArg = optarg;
+			break;
+
+		case 'P':	// -P num=value[,num=value].. (one more parameter set)
+			bench->params[bench->paramsCount++] = optarg;
+			break;
+
+		case 'T':	// -T threads[,threads]..
+			threadsArg = optarg;
+			break;
+
+		case 'r':	// -r repeat
+			bench->repeat = str2longint(&success, optarg);
+			if (success == false || bench->repeat <= 0) {
+				usage_err(91, __func__, "-r repeat must be an integer > 0: %s", optarg);
+			}
+			break;
+
+		case 'W':	// -W warmup
+			bench->warmup = str2longint(&success, optarg);
+			if (success == false || bench->warmup < 0) {
+				usage_err(91, __func__, "-W warmup must be an integer >= 0: %s", optarg);
+			}
+			break;
+
+		case 'M':	// -M seconds
+			errno = 0;	// paranoia
+			bench->minTime = strtod(optarg, NULL);
+			if (errno != 0 || bench->minTime < 0.0) {
+				usage_err(91, __func__, "-M seconds must be a number >= 0: %s", optarg);
+			}
+			break;
+
+		case 's':	// -s seed
+			bench->seed = (unsigned long int) str2longint(&success, optarg);
+			if (success == false) {
+				usage_err(91, __func__, "-s seed must be an integer: %s", optarg);
+			}
+			break;
+
+		case 'R':	// -R format
+			if (strcmp(optarg, "text") == 0) {
+				bench->format = TIMING_TEXT;
+			} else if (strcmp(optarg, "json") == 0) {
+				bench->format = TIMING_JSON;
+			} else {
+				usage_err(91, __func__, "-R format must be one of text or json: %s", optarg);
+			}
+			break;
+
+		case 'h':	// -h (print out help)
+			fprintf(stderr, "usage: %s %s", program, usage);
+			fprintf(stderr, "\nVersion: %s\n", version);
+			exit(0);
+			break;
+
+		case '?':
+			usage_err(91, __func__, "unknown option: -%c", (char) optopt);
+			break;
+
+		default:
+			usage_err(91, __func__, "getopt returned an unexpected error");
+			break;
+		}
+	}
+	if (optind != argc) {
+		usage_err(91, __func__, "unexpected arguments");
+	}
+
+	/*
+	 * Select the tests
+	 */
+	if (testArg != NULL || kernelArg == NULL) {
+		if (testArg == NULL) {
+			list = NULL;
+			count = 0;
+		} else {
+			list = parseList(testArg, "-t test1[,test2]..", 0, &count);
+		}
+		for (i = 0; i < count; i++) {
+			if (list[i] > NUMOFTESTS) {
+				usage_err(91, __func__, "-t test: %ld must be 0 thru %d", list[i], NUMOFTESTS);
+			}
+			bench->kernel[list[i]] = true;
+		}
+		if (count == 0 || bench->kernel[0] == true) {
+			for (i = 1; i <= NUMOFTESTS; i++) {
+				bench->kernel[i] = true;
+			}
+		}
+		bench->kernel[0] = false;
+		free(list);
+	}
+
+	/*
+	 * Select the kernels
+	 */
+	if (kernelArg != NULL) {
+		brkt = NULL;
+		for (phrase = strtok_r(kernelArg, ",", &brkt); phrase != NULL; phrase = strtok_r(NULL, ",", &brkt)) {
+			if (strcmp(phrase, "none") == 0) {
+				continue;
+			}
+			for (j = KERNEL_FFT; j < KERNEL_END; j++) {
+				if (strcmp(phrase, kernelName[j - KERNEL_FFT]) == 0) {
+					bench->kernel[j] = true;
+					break;
+				}
+			}
+			if (j == KERNEL_END) {
+				usage_err(91, __func__, "-k kernel: unknown kernel: %s", phrase);
+			}
+		}
+	} else if (testArg == NULL) {
+		for (j = KERNEL_FFT; j < KERNEL_END; j++) {
+			bench->kernel[j] = true;
+		}
+	}
+
+	/*
+	 * Parse the bitcounts, thread counts and parameter sets
+	 */
+	if (bitcountArg == NULL) {
+		bitcountArg = strdup(DEFAULT_BENCH_BITCOUNTS);
+		if (bitcountArg == NULL) {
+			errp(91, __func__, "strdup of %lu bytes for default bitcounts failed", strlen(DEFAULT_BENCH_BITCOUNTS));
+		}
+	}
+	bench->bitcount = parseList(bitcountArg, "-S bitcount[,bitcount]..", GLOBAL_MIN_BITCOUNT, &bench->bitcountCount);
+	for (i = 0; i < bench->bitcountCount; i++) {
+		if ((bench->bitcount[i] % BITS_N_BYTE) != 0) {
+			usage_err(91, __func__, "-S bitcount: %ld must be a multiple of %d", bench->bitcount[i], BITS_N_BYTE);
+		}
+	}
+	if (threadsArg == NULL) {
+		bench->threads = malloc(2 * sizeof(bench->threads[0]));
+		if (bench->threads == NULL) {
+			errp(91, __func__, "cannot malloc for threads: 2 elements of %lu bytes each", sizeof(bench->threads[0]));
+		}
+		bench->threads[0] = 1;
+		bench->threadsCount = 1;
+#ifndef _WIN32
+		if (sysconf(_SC_NPROCESSORS_ONLN) > 1) {
+			bench->threads[bench->threadsCount++] = sysconf(_SC_NPROCESSORS_ONLN);
+		}
+#endif
+	} else {
+		bench->threads = parseList(threadsArg, "-T threads[,threads]..", 1, &bench->threadsCount);
+	}
+	if (bench->paramsCount == 0) {
+		bench->params[bench->paramsCount++] = NULL;
+	}
+	return;
+}
+
+
+/*
+ * parseList - parse a comma separated list of integers
+ *
+ * given:
+ *      arg             // comma separated list, modified by strtok_r()
+ *      option          // option being parsed, for error messages
+ *      min             // minimum value of each element
+ *      count           // where to store the number of elements
+ *
+ * returns:
+ *      malloced array of count elements
+ */
+static long int *
+parseList(char *arg, char const *option, long int min, long int *count)
+{
+	long int *list;		// Parsed elements
+	char *phrase;		// String without separator as parsed by strtok_r()
+	char *brkt;		// Last state of strtok_r()
+	bool success;		// true if str2longint was successful
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (arg == NULL || option == NULL || count == NULL) {
+		err(92, __func__, "called with NULL arg(s)");
+	}
+
+	/*
+	 * Parse each comma separated element
+	 */
+	list = malloc((strlen(arg) / 2 + 1) * sizeof(list[0]));
+	if (list == NULL) {
+		errp(92, __func__, "cannot malloc for %s", option);
+	}
+	*count = 0;
+	brkt = NULL;
+	for (phrase = strtok_r(arg, ",", &brkt); phrase != NULL; phrase = strtok_r(NULL, ",", &brkt)) {
+		list[*count] = str2longint(&success, phrase);
+		if (success == false) {
+			usage_errp(92, __func__, "%s must only have comma separated integers: %s", option, phrase);
+		}
+		if (list[*count] < min) {
+			usage_err(92, __func__, "%s: %ld must be >= %ld", option, list[*count], min);
+		}
+		(*count)++;
+	}
+	if (*count == 0) {
+		usage_err(92, __func__, "%s is empty", option);
+	}
+	return list;
+}
+
+
+/*
+ * setupState - parse and initialize the sts state of a configuration
+ *
+ * given:
+ *      bench           // benchmark options
+ *      state           // state to setup
+ *      n               // bitcount
+ *      threads         // number of threads
+ *      params          // -P num=value[,num=value].. or NULL
+ *
+ * The state is setup as if sts was invoked in iterate only mode on /dev/null.
+ * The Frequency test is always enabled so that init() does not abort when all the timed
+ * tests disable themselves because of the bitcount.  Tests needed by the fft and rank
+ * kernels are enabled as well.
+ */
+static void
+setupState(struct bench *bench, struct state *state, long int n, long int threads, char *params)
+{
+	extern int optind;		// Index to the next argv element to parse
+	char testArg[BUFSIZ + 1];	// -t argument
+	char bitcountArg[BUFSIZ + 1];	// -S argument
+	char threadsArg[BUFSIZ + 1];	// -T and -i argument
+	char iterationsArg[BUFSIZ + 1];	// -i argument
+	char *paramsArg = NULL;		// -P argument
+	char *argv[16];			// Arguments of parse_args()
+	int argc;			// Number of arguments
+	long int i;
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (bench == NULL || state == NULL) {
+		err(93, __func__, "called with NULL arg(s)");
+	}
+
+	/*
+	 * Form the test list
+	 */
+	snprintf(testArg, BUFSIZ, "%d", TEST_FREQUENCY);
+	for (i = TEST_FREQUENCY + 1; i <= NUMOFTESTS; i++) {
+		if (bench->kernel[i] == true || (i == TEST_DFT && bench->kernel[KERNEL_FFT] == true) ||
+		    (i == TEST_RANK && bench->kernel[KERNEL_RANK] == true)) {
+			snprintf(testArg + strlen(testArg), BUFSIZ - strlen(testArg), ",%ld", i);
+		}
+	}
+	testArg[BUFSIZ] = '\0';	// paranoia
+
+	/*
+	 * Form the command line
+	 */
+	snprintf(bitcountArg, BUFSIZ, "%ld", n);
+	snprintf(threadsArg, BUFSIZ, "%ld", threads);
+	snprintf(iterationsArg, BUFSIZ, "%ld", threads);
+	argc = 0;
+	argv[argc++] = program;
+	argv[argc++] = "-t";
+	argv[argc++] = testArg;
+	argv[argc++] = "-S";
+	argv[argc++] = bitcountArg;
+	argv[argc++] = "-T";
+	argv[argc++] = threadsArg;
+	argv[argc++] = "-i";
+	argv[argc++] = iterationsArg;
+	argv[argc++] = "-m";
+	argv[argc++] = "i";
+	if (params != NULL) {
+		paramsArg = strdup(params);
+		if (paramsArg == NULL) {
+			errp(93, __func__, "strdup of %lu bytes for -P params failed", strlen(params));
+		}
+		argv[argc++] = "-P";
+		argv[argc++] = paramsArg;
+	}
+	argv[argc++] = "/dev/null";
+	argv[argc] = NULL;
+
+	/*
+	 * Parse and initialize as sts would do
+	 */
+	optind = 1;
+	parse_args(state, argc, argv);
+	init(state);
+	free(paramsArg);
+	return;
+}
+
+
+/*
+ * makeSyntheticData - fill epsilon and the synthetic input files with seeded pseudo-random bits
+ *
+ * given:
+ *      bench           // benchmark options
+ *      state           // initialized state
+ *
+ * Each thread gets its own bitstream.  The input files hold the bitstream of thread 0.
+ */
+static void
+makeSyntheticData(struct bench *bench, struct state *state)
+{
+	unsigned long long int x;	// State of the pseudo-random generator
+	unsigned long int r;	// Random bits
+	BitSequence *epsilon;	// Bitstream being filled
+	BYTE byte;		// Raw binary byte being formed
+	long int t;
+	long int i;
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (bench == NULL || state == NULL) {
+		err(94, __func__, "called with NULL arg(s)");
+	}
+	if (state->epsilon == NULL) {
+		err(94, __func__, "state->epsilon is NULL");
+	}
+
+	/*
+	 * Fill the bitstream of each thread
+	 */
+	for (t = 0; t < state->numberOfThreads; t++) {
+		epsilon = state->epsilon[t];
+		x = (unsigned long long int) bench->seed * 0x9e3779b97f4a7c15ULL + (unsigned long long int) t + 1;
+		r = 0;
+		for (i = 0; i < state->tp.n; i++) {
+			if ((i % 32) == 0) {
+				r = nextRandom(&x);
+			}
+			epsilon[i] = (BitSequence) (r & 1);
+			r >>= 1;
+		}
+	}
+
+	/*
+	 * Write the bitstream of thread 0 as ASCII and as raw binary input
+	 */
+	errno = 0;	// paranoia
+	bench->ascii = tmpfile();
+	if (bench->ascii == NULL) {
+		errp(94, __func__, "cannot create temporary ASCII input file");
+	}
+	errno = 0;	// paranoia
+	bench->binary = tmpfile();
+	if (bench->binary == NULL) {
+		errp(94, __func__, "cannot create temporary binary input file");
+	}
+	epsilon = state->epsilon[0];
+	byte = 0;
+	for (i = 0; i < state->tp.n; i++) {
+		fputc(epsilon[i] ? '1' : '0', bench->ascii);
+		byte = (BYTE) ((byte << 1) | epsilon[i]);
+		if ((i % BITS_N_BYTE) == BITS_N_BYTE - 1) {
+			fputc(byte, bench->binary);
+			byte = 0;
+		}
+	}
+	errno = 0;	// paranoia
+	if (fflush(bench->ascii) != 0 || fflush(bench->binary) != 0) {
+		errp(94, __func__, "error writing temporary input files");
+	}
+	return;
+}
+
+
+/*
+ * benchKernel - calibrate, warmup, time and report a kernel
+ *
+ * given:
+ *      bench           // benchmark options
+ *      state           // initialized state
+ *      bt              // per thread state
+ *      kernel          // kernel to time
+ */
+static void
+benchKernel(struct bench *bench, struct state *state, struct bench_thread *bt, long int kernel)
+{
+	bool testVector[NUMOFTESTS + 1];	// Tests enabled after init
+	FILE *streamFile;	// Input stream opened by init()
+	double *wall;		// Wall clock time of each timed repetition
+	double once;		// Wall clock time of a single call
+	long int calls;		// Calls per thread per repetition
+	long int ops;		// Bits (or evaluations) processed per call
+	long int i;
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (bench == NULL || state == NULL || bt == NULL) {
+		err(95, __func__, "called with NULL arg(s)");
+	}
+	if (kernel <= 0 || kernel >= KERNEL_END) {
+		err(95, __func__, "bogus kernel: %ld", kernel);
+	}
+
+	/*
+	 * Skip the tests that disabled themselves in init()
+	 */
+	if (kernel <= NUMOFTESTS && state->testVector[kernel] == false) {
+		warn(__func__, "skipping %s[%ld]: test disabled itself for bitcount %ld and these parameters",
+		     state->testNames[kernel], kernel, state->tp.n);
+		return;
+	}
+
+	/*
+	 * Setup the kernel
+	 *
+	 * When timing a test, only enable that test so that iterate() only calls it.
+	 */
+	memcpy(testVector, state->testVector, sizeof(testVector));
+	streamFile = state->streamFile;
+	if (kernel <= NUMOFTESTS) {
+		memset(state->testVector, 0, sizeof(state->testVector));
+		state->testVector[kernel] = true;
+	} else if (kernel == KERNEL_PARSE_ASCII) {
+		state->dataFormat = FORMAT_ASCII_01;
+		state->streamFile = bench->ascii;
+	} else if (kernel == KERNEL_PARSE_BINARY) {
+		state->dataFormat = FORMAT_RAW_BINARY;
+		state->streamFile = bench->binary;
+	}
+	ops = (kernel == KERNEL_IGAMC || kernel == KERNEL_NORMAL) ? CEPHES_EVALUATIONS : state->tp.n;
+
+	/*
+	 * Calibrate the number of calls so that a repetition lasts at least minTime
+	 */
+	once = runRepetition(state, bt, kernel, 1);
+	if (once <= 0.0) {
+		calls = 1;
+	} else {
+		calls = MAX(1, (long int) ceil(bench->minTime / once));
+	}
+
+	/*
+	 * Warmup
+	 */
+	for (i = 0; i < bench->warmup; i++) {
+		(void) runRepetition(state, bt, kernel, calls);
+	}
+
+	/*
+	 * Time the repetitions
+	 */
+	wall = malloc((size_t) bench->repeat * sizeof(wall[0]));
+	if (wall == NULL) {
+		errp(95, __func__, "cannot malloc for wall: %ld elements of %lu bytes each", bench->repeat, sizeof(wall[0]));
+	}
+	for (i = 0; i < bench->repeat; i++) {
+		wall[i] = runRepetition(state, bt, kernel, calls);
+	}
+	reportResult(bench, state, kernel, wall, calls, ops);
+	free(wall);
+
+	/*
+	 * Restore the state
+	 */
+	memcpy(state->testVector, testVector, sizeof(testVector));
+	state->streamFile = streamFile;
+	return;
+}
+
+
+/*
+ * runRepetition - run calls of a kernel in each thread
+ *
+ * given:
+ *      state           // initialized state
+ *      bt              // per thread state
+ *      kernel          // kernel to run
+ *      calls           // number of calls in each thread
+ *
+ * returns:
+ *      wall clock time in seconds from the start of the first thread to the end of the last one
+ */
+static double
+runRepetition(struct state *state, struct bench_thread *bt, long int kernel, long int calls)
+{
+	struct timestamp start;		// Start of the repetition
+	struct phase_time spent;	// Time spent by the repetition
+	long int i;
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (state == NULL || bt == NULL) {
+		err(96, __func__, "called with NULL arg(s)");
+	}
+
+	/*
+	 * Run the calls in each thread
+	 */
+	memset(&spent, 0, sizeof(spent));
+	for (i = 0; i < state->numberOfThreads; i++) {
+		bt[i].kernel = kernel;
+		bt[i].calls = calls;
+	}
+	startTimer(&start);
+	if (state->numberOfThreads == 1) {
+		(void) runCalls(&bt[0]);
+	} else {
+		for (i = 0; i < state->numberOfThreads; i++) {
+			if (pthread_create(&bt[i].thread, NULL, runCalls, &bt[i]) != 0) {
+				err(96, __func__, "cannot create thread %ld", i);
+			}
+		}
+		for (i = 0; i < state->numberOfThreads; i++) {
+			if (pthread_join(bt[i].thread, NULL) != 0) {
+				err(96, __func__, "cannot join thread %ld", i);
+			}
+		}
+	}
+	stopTimer(&start, &spent, 0);
+	return spent.wall;
+}
+
+
+/*
+ * runCalls - thread body that calls a kernel repeatedly
+ *
+ * given:
+ *      thread_args     // pointer to the struct bench_thread of this thread
+ */
+static void *
+runCalls(void *thread_args)
+{
+	struct bench_thread *bt = (struct bench_thread *) thread_args;
+	long int i;
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (bt == NULL) {
+		err(97, __func__, "thread_args is NULL");
+	}
+
+	for (i = 0; i < bt->calls; i++) {
+		bt->thread_state.iteration_being_done = i;
+		runKernel(bt);
+	}
+	return NULL;
+}
+
+
+/*
+ * runKernel - perform a single call of a kernel
+ *
+ * given:
+ *      bt              // per thread state
+ */
+static void
+runKernel(struct bench_thread *bt)
+{
+	struct thread_state *thread_state;	// State of this thread
+	struct state *state;			// Initialized state
+	BitSequence **matrix;			// Rank matrix of this thread
+	BitSequence *epsilon;			// Bitstream of this thread
+	double *X;				// FFT input and output of this thread
+	double sum;				// Sum of the cephes results
+	long int n;
+	long int i;
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (bt == NULL) {
+		err(98, __func__, "bt arg is NULL");
+	}
+	thread_state = &bt->thread_state;
+	state = thread_state->global_state;
+	if (state == NULL) {
+		err(98, __func__, "state is NULL");
+	}
+	n = state->tp.n;
+	epsilon = state->epsilon[thread_state->thread_id];
+
+	switch (bt->kernel) {
+	case KERNEL_FFT:
+		/*
+		 * Same as steps 1 and 2 of the DFT test, which the in-tree real FFT fuses with the count of step 3
+		 */
+#if defined(LEGACY_FFT)
+		if (state->fft_plan != NULL) {
+			bt->sink = (double) rfft_count_below(state->fft_plan, epsilon, state->fft_wsave[thread_state->thread_id],
+							     log(20.0) * (double) n);
+			break;
+		}
+#endif /* LEGACY_FFT */
+		X = state->fft_X[thread_state->thread_id];
+		for (i = 0; i < n; i++) {
+			X[i] = 2 * (int) epsilon[i] - 1;
+		}
+#if defined(LEGACY_FFT)
+		__ogg_fdrfftf_shared(n, X, state->fft_wsave[thread_state->thread_id], state->fft_wa, state->fft_ifac);
+#else /* LEGACY_FFT */
+		fftw_execute_dft_r2c(state->fftw_p, X, (fftw_complex *) X);
+#endif /* LEGACY_FFT */
+		break;
+
+	case KERNEL_RANK:
+		/*
+		 * Same as the matrix loop of the Rank test
+		 */
+		matrix = state->rank_matrix[thread_state->thread_id];
+		sum = 0.0;
+		for (i = 0; i < n / (NUMBER_OF_ROWS_RANK * NUMBER_OF_COLS_RANK); i++) {
+			def_matrix(thread_state, NUMBER_OF_ROWS_RANK, NUMBER_OF_COLS_RANK, matrix, i);
+			sum += computeRank(NUMBER_OF_ROWS_RANK, NUMBER_OF_COLS_RANK, matrix);
+		}
+		bt->sink = sum;
+		break;
+
+	case KERNEL_IGAMC:
+		sum = 0.0;
+		for (i = 0; i < CEPHES_EVALUATIONS; i++) {
+			sum += cephes_igamc(bt->bench->cephes_a[i], bt->bench->cephes_x[i]);
+		}
+		bt->sink = sum;
+		break;
+
+	case KERNEL_NORMAL:
+		sum = 0.0;
+		for (i = 0; i < CEPHES_EVALUATIONS; i++) {
+			sum += cephes_normal(bt->bench->cephes_x[i] - bt->bench->cephes_a[i]);
+		}
+		bt->sink = sum;
+		break;
+
+	case KERNEL_PARSE_ASCII:
+		/*
+		 * FALLTHRU
+		 */
+	case KERNEL_PARSE_BINARY:
+		/*
+		 * Same as the input path of a worker thread: read under the mutex, convert outside of it
+		 */
+		pthread_mutex_lock(thread_state->mutex);
+		if (bt->kernel == KERNEL_PARSE_ASCII) {
+			parseBitsASCIIInput(thread_state, bt->batch, 0, 1);
+		} else {
+			parseBitsBinaryInput(thread_state, bt->batch, 0, 1);
+		}
+		pthread_mutex_unlock(thread_state->mutex);
+		loadEpsilonFromBatch(thread_state, bt->batch);
+		break;
+
+	default:
+		/*
+		 * The iterate function of a test, only that test is enabled
+		 */
+		iterate(thread_state);
+		break;
+	}
+	return;
+}
+
+
+/*
+ * kernelParam - the test parameter used by a kernel
+ *
+ * given:
+ *      state           // initialized state
+ *      kernel          // kernel
+ *
+ * returns:
+ *      block length or sequence length used by the kernel, or 0 if the kernel has no parameter
+ */
+static long int
+kernelParam(struct state *state, long int kernel)
+{
+	switch (kernel) {
+	case TEST_BLOCK_FREQUENCY:
+		return state->tp.blockFrequencyBlockLength;
+	case TEST_NON_OVERLAPPING:
+		return state->tp.nonOverlappingTemplateLength;
+	case TEST_OVERLAPPING:
+		return state->tp.overlappingTemplateLength;
+	case TEST_APEN:
+		return state->tp.approximateEntropyBlockLength;
+	case TEST_SERIAL:
+		return state->tp.serialBlockLength;
+	case TEST_LINEARCOMPLEXITY:
+		return state->tp.linearComplexitySequenceLength;
+	default:
+		return 0;
+	}
+}
+
+
+/*
+ * reportResult - report the timing of a kernel
+ *
+ * given:
+ *      bench           // benchmark options
+ *      state           // initialized state
+ *      kernel          // kernel timed
+ *      wall            // wall clock time of each timed repetition, sorted by this function
+ *      calls           // calls per thread per repetition
+ *      ops             // bits (or evaluations) processed per call
+ */
+static void
+reportResult(struct bench *bench, struct state *state, long int kernel, double *wall, long int calls, long int ops)
+{
+	char const *name;	// Name of the kernel
+	char const *unit;	// Unit of ops
+	double median;		// Median wall clock time of a repetition
+	double spread;		// Relative difference between the slowest and the fastest repetition
+	double nsPerOp;		// Nanoseconds per bit (or evaluation), over all threads
+	long int param;		// Test parameter used by the kernel
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (bench == NULL || state == NULL || wall == NULL) {
+		err(99, __func__, "called with NULL arg(s)");
+	}
+
+	/*
+	 * Compute the statistics of the repetitions
+	 */
+	qsort(wall, (size_t) bench->repeat, sizeof(wall[0]), compareDouble);
+	if ((bench->repeat % 2) == 1) {
+		median = wall[bench->repeat / 2];
+	} else {
+		median = (wall[bench->repeat / 2 - 1] + wall[bench->repeat / 2]) / 2.0;
+	}
+	spread = (median > 0.0) ? 100.0 * (wall[bench->repeat - 1] - wall[0]) / median : 0.0;
+	nsPerOp = 1e9 * median / ((double) calls * (double) ops * (double) state->numberOfThreads);
+	name = (kernel <= NUMOFTESTS) ? state->testNames[kernel] : kernelName[kernel - KERNEL_FFT];
+	unit = (kernel == KERNEL_IGAMC || kernel == KERNEL_NORMAL) ? "eval" : "bit";
+	param = kernelParam(state, kernel);
+
+	/*
+	 * Report
+	 */
+	if (bench->format == TIMING_JSON) {
+		printf("%s\n    {\"kernel\": \"%s\", \"bitcount\": %ld, \"param\": %ld, \"threads\": %ld, \"calls\": %ld, "
+		       "\"median_s\": %.9f, \"min_s\": %.9f, \"max_s\": %.9f, \"spread_pct\": %.2f, \"ns_per_op\": %.4f, "
+		       "\"unit\": \"%s\"}", (bench->results > 0) ? "," : "", name, state->tp.n, param, state->numberOfThreads,
+		       calls, median, wall[0], wall[bench->repeat - 1], spread, nsPerOp, unit);
+	} else {
+		printf("%-24s %10ld %6ld %7ld %7ld %11.6f %11.6f %11.6f %7.2f %10.4f%s\n", name, state->tp.n, param,
+		       state->numberOfThreads, calls, median, wall[0], wall[bench->repeat - 1], spread, nsPerOp,
+		       (kernel == KERNEL_IGAMC || kernel == KERNEL_NORMAL) ? " (ns/eval)" : "");
+	}
+	fflush(stdout);
+	bench->results++;
+	return;
+}
+
+
+/*
+ * compareDouble - qsort() comparison of two doubles
+ */
+static int
+compareDouble(const void *a, const void *b)
+{
+	double x = *(const double *) a;
+	double y = *(const double *) b;
+
+	return (x > y) - (x < y);
+}
+
+
+/*
+ * nextRandom - xorshift64* pseudo-random generator
+ *
+ * given:
+ *      x               // generator state, must not be 0
+ *
+ * returns:
+ *      the upper 32 bits of the next pseudo-random value
+ */
+static unsigned long int
+nextRandom(unsigned long long int *x)
+{
+	unsigned long long int v = *x;
+
+	if (v == 0) {
+		v = 0x9e3779b97f4a7c15ULL;
+	}
+	v ^= v >> 12;
+	v ^= v << 25;
+	v ^= v >> 27;
+	*x = v;
+	return (unsigned long int) ((v * 0x2545f4914f6cdd1dULL) >> 32);
+}
@@ -302,6 +302,9 @@
 #include "utils/utilities.h"
 #include "utils/externs.h"
 #include "utils/debug.h"
+#include "utils/timing.h"
+#include "utils/pvalues.h"
+#include "utils/coordinator.h"
 
 
 // STS version
@@ -324,6 +327,14 @@ main(int argc, char *argv[])
 	 */
 	parse_args(&run_state, argc, argv);
 
+	/*
+	 * Print the plan of the jobs of randdata if -L shards, and exit
+	 */
+	if (run_state.planShards > 0) {
+		plan_shards(&run_state);
+		exit(0);
+	}
+
 	/*
 	 * Initialize all active tests
 	 */
@@ -340,7 +351,11 @@ main(int argc, char *argv[])
 	 * Run test suite iterations if needed
 	 */
 	if (run_state.runMode != MODE_ASSESS_ONLY) {
-		invokeTestSuite(&run_state);
+		if (run_state.workerCount > 0) {
+			coordinate(&run_state);
+		} else {
+			invokeTestSuite(&run_state);
+		}
 
 		/*
 		 * Print p-values and stats of each test in separate files (if needed)
@@ -354,7 +369,11 @@ main(int argc, char *argv[])
 	 * If only iterations were to be done, save the p-values to file
 	 */
 	if (run_state.runMode == MODE_ITERATE_ONLY) {
-		write_p_val_to_file(&run_state);
+		if (run_state.sketchFlag == true) {
+			write_sketch_to_file(&run_state);
+		} else {
+			write_p_val_to_file(&run_state);
+		}
 	}
 
 	/*
@@ -371,6 +390,18 @@ main(int argc, char *argv[])
 		metrics(&run_state);
 	}
 
+	/*
+	 * The results are complete, the checkpoint is no longer needed (if -C or -r)
+	 */
+	if (run_state.checkpointCycle > 0 || run_state.resumeFlag == true) {
+		remove_checkpoint(&run_state);
+	}
+
+	/*
+	 * Report time spent by each test, phase and thread (if requested)
+	 */
+	reportTiming(&run_state);
+
 	/*
 	 * Free memory no longer needed
 	 */
@@ -389,9 +420,11 @@ main(int argc, char *argv[])
 	}
 
 	else if (run_state.runMode == MODE_ITERATE_ONLY) {
-		msg("A binary file (with extension .pvalues) containing the p-values of the tests has been generated.\n"
+		msg("A binary file (with extension %s) containing the %s of the tests has been generated.\n"
 				    "You can later assess the results of this and other runs by executing "
-				    "sts in '-m a' mode and passing that file's directory as an argument with the '-d' flag.");
+				    "sts in '-m a' mode and passing that file's directory as an argument with the '-d' flag.",
+		    run_state.sketchFlag == true ? ".sketch" : ".pvalues",
+		    run_state.sketchFlag == true ? "p-value tallies" : "p-values");
 	}
 
 	// All Done!!! -- Jessica Noll, Age 2
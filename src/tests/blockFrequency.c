@@ -36,6 +36,7 @@
 #include "../utils/externs.h"
 #include "../utils/cephes.h"
 #include "../utils/utilities.h"
+#include "../utils/stat_fncs.h"
 #include "../utils/debug.h"
 
 
@@ -48,6 +49,15 @@ struct BlockFrequency_private_stats {
 };
 
 
+/*
+ * Carry - partial results of a bit stream kept between its chunks by each thread
+ */
+struct BlockFrequency_carry {
+	long int blockSum;	// Number of ones in the block being streamed
+	double sum;		// Term of the chi squared formula, over the blocks streamed so far
+};
+
+
 /*
  * Static const variables declarations
  */
@@ -141,10 +151,12 @@ BlockFrequency_init(struct state *state)
 	 */
 	if (state->resultstxtFlag == true) {
 		state->stats[test_num] = create_dyn_array(sizeof(struct BlockFrequency_private_stats),
-							  DEFAULT_CHUNK, state->tp.numOfBitStreams, false);	// stats.txt
+							  DEFAULT_CHUNK, retainedIterations(state), false);	// stats.txt
+	}
+	if (state->p_valTally == false) {
+		state->p_val[test_num] = create_dyn_array(sizeof(double),
+							  DEFAULT_CHUNK, retainedIterations(state), false);	// results.txt
 	}
-	state->p_val[test_num] = create_dyn_array(sizeof(double),
-						  DEFAULT_CHUNK, state->tp.numOfBitStreams, false);	// results.txt
 
 	/*
 	 * Determine format of data*.txt filenames based on state->partitionCount[test_num]
@@ -154,6 +166,15 @@ BlockFrequency_init(struct state *state)
 	dbg(DBG_HIGH, "%s[%d] will form data*.txt filenames with the following format: %s",
 	    state->testNames[test_num], test_num, state->datatxt_fmt[test_num]);
 
+	/*
+	 * Allocate the partial results kept by each thread between the chunks of a bit stream
+	 */
+	state->streamCarry[test_num] = calloc((size_t) state->numberOfThreads, sizeof(struct BlockFrequency_carry));
+	if (state->streamCarry[test_num] == NULL) {
+		errp(20, __func__, "cannot calloc for streamCarry: %ld elements of %lu bytes each", state->numberOfThreads,
+		     sizeof(struct BlockFrequency_carry));
+	}
+
 	return;
 }
 
@@ -170,6 +191,41 @@ BlockFrequency_init(struct state *state)
  */
 void
 BlockFrequency_iterate(struct thread_state *thread_state)
+{
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (thread_state == NULL) {
+		err(21, __func__, "thread_state arg is NULL");
+	}
+	if (thread_state->global_state == NULL) {
+		err(21, __func__, "state arg is NULL");
+	}
+
+	/*
+	 * Stream the whole bit stream as a single chunk
+	 */
+	BlockFrequency_stream(thread_state, 0, thread_state->global_state->tp.n);
+
+	return;
+}
+
+
+/*
+ * BlockFrequency_stream - stream a chunk of a bit stream to the Block Frequency test
+ *
+ * given:
+ *      thread_state    // current thread state
+ *      first           // index in the bit stream of the first bit of the chunk, 0 starts a new bit stream
+ *      count           // number of bits in the chunk, held by epsilon
+ *
+ * The chunks of a bit stream are streamed in order.  The iteration is recorded with the chunk
+ * that ends the bit stream.
+ *
+ * NOTE: The initialize function must be called before this function is called.
+ */
+void
+BlockFrequency_stream(struct thread_state *thread_state, long int first, long int count)
 {
 	struct BlockFrequency_private_stats stat;	// Stats for this iteration
 	long int M;		// Length of each block to be tested
@@ -180,6 +236,9 @@ BlockFrequency_iterate(struct thread_state *thread_state)
 	double sum;             // Term of the chi squared formula
 	double pi;              // Proportion of ones in a block
 	double v;               // Value used in chi squared formula
+	struct BlockFrequency_carry *carry;	// Partial results of the bit stream of this thread
+	BitSequence *epsilon;	// Chunk of the bit stream
+	long int end;		// Number of bits of the chunk that are in one of the N blocks
 	long int i;
 	long int j;
 
@@ -203,6 +262,9 @@ BlockFrequency_iterate(struct thread_state *thread_state)
 	if (state->epsilon[thread_state->thread_id] == NULL) {
 		err(21, __func__, "state->epsilon[%ld] is NULL", thread_state->thread_id);
 	}
+	if (state->streamCarry[test_num] == NULL) {
+		err(21, __func__, "state->streamCarry[%d] is NULL", test_num);
+	}
 
 	/*
 	 * Collect parameters from state
@@ -210,23 +272,35 @@ BlockFrequency_iterate(struct thread_state *thread_state)
 	M = state->tp.blockFrequencyBlockLength;
 	n = state->tp.n;
 	N = n / M;
+	epsilon = state->epsilon[thread_state->thread_id];
+	carry = (struct BlockFrequency_carry *) state->streamCarry[test_num] + thread_state->thread_id;
+	if (first == 0) {
+		carry->blockSum = 0;
+		carry->sum = 0.0;
+	}
 
 	/*
-	 * Step 1: partition the sequence into N independent blocks
+	 * Step 1: partition the sequence into N independent blocks, ignoring the bits after the last block
 	 */
-	sum = 0.0;
-	for (i = 0; i < N; i++) {
+	blockSum = carry->blockSum;
+	sum = carry->sum;
+	end = MIN(count, N * M - first);
+	for (i = 0; i < end;) {
 
 		/*
 		 * Step 2: determine the proportion of ones in each M-bit block
 		 */
-		blockSum = 0;
-		for (j = 0; j < M; j++) {
-			if (state->epsilon[thread_state->thread_id][j + i * M]) {
+		j = MIN(end, i + M - (first + i) % M);
+		for (; i < j; i++) {
+			if (epsilon[i]) {
 				blockSum++;
 			}
 		}
+		if ((first + i) % M != 0) {
+			break;	// The block goes on in the next chunk
+		}
 		pi = (double) blockSum / (double) M;
+		blockSum = 0;
 
 		/*
         	 * Step 3a: prepare values required for computing the test statistic
@@ -234,6 +308,15 @@ BlockFrequency_iterate(struct thread_state *thread_state)
 		v = pi - 0.5;
 		sum += v * v;
 	}
+	carry->blockSum = blockSum;
+	carry->sum = sum;
+
+	/*
+	 * Wait for the rest of the bit stream
+	 */
+	if (first + count < n) {
+		return;
+	}
 
 	/*
 	 * Step 3b: compute the test statistic
@@ -283,7 +366,7 @@ BlockFrequency_iterate(struct thread_state *thread_state)
 	if (state->resultstxtFlag == true) {
 		append_value(state->stats[test_num], &stat);
 	}
-	append_value(state->p_val[test_num], &p_value);
+	record_p_value(state, test_num, 0, p_value);
 
 	/*
 	 * Unlock mutex after making changes to the shared state
@@ -532,14 +615,14 @@ BlockFrequency_print(struct state *state)
 	 */
 	stats_txt = filePathName(state->subDir[test_num], "stats.txt");
 	dbg(DBG_HIGH, "about to open/truncate: %s", stats_txt);
-	stats = openTruncate(stats_txt);
+	stats = openPrintFile(state, stats_txt);
 
 	/*
 	 * Open results.txt file
 	 */
 	results_txt = filePathName(state->subDir[test_num], "results.txt");
 	dbg(DBG_HIGH, "about to open/truncate: %s", results_txt);
-	results = openTruncate(results_txt);
+	results = openPrintFile(state, results_txt);
 
 	/*
 	 * Write results.txt and stats.txt files
@@ -633,7 +716,7 @@ BlockFrequency_print(struct state *state)
 			 */
 			data_txt = filePathName(state->subDir[test_num], data_filename);
 			dbg(DBG_HIGH, "about to open/truncate: %s", data_txt);
-			data = openTruncate(data_txt);
+			data = openPrintFile(state, data_txt);
 
 			/*
 			 * Write this particular data*.txt filename
@@ -847,11 +930,8 @@ BlockFrequency_metric_print(struct state *state, long int sampleCount, long int
 void
 BlockFrequency_metrics(struct state *state)
 {
-	long int sampleCount;	// Number of bitstreams in which we will count p_values
-	long int toolow;	// p_values that were below alpha
-	double p_value;		// p_value iteration test result(s)
-	long int *freqPerBin;	// Uniformity frequency bins
-	long int i;
+	struct p_val_tally *tally;	// Uniformity and proportion counts of the p_values
+	long int sampleCount;	// Number of bitstreams in which we counted p_values
 	long int j;
 
 	/*
@@ -870,20 +950,16 @@ BlockFrequency_metrics(struct state *state)
 		    "metrics driver interface for %s[%d] called with state.partitionCount: %d < 0",
 		    state->testNames[test_num], test_num, state->partitionCount[test_num]);
 	}
-	if (state->p_val[test_num]->count != (state->tp.numOfBitStreams * state->partitionCount[test_num])) {
-		warn(__func__,
-		     "metrics driver interface for %s[%d] called with p_val length: %ld != bit streams: %ld",
-		     state->testNames[test_num], test_num, state->p_val[test_num]->count,
-		     state->tp.numOfBitStreams * state->partitionCount[test_num]);
-	}
 
 	/*
-	 * Allocate uniformity frequency bins
+	 * Tally the p_values, unless they were tallied as iterations completed
 	 */
-	freqPerBin = malloc(state->tp.uniformity_bins * sizeof(freqPerBin[0]));
-	if (freqPerBin == NULL) {
-		errp(26, __func__, "cannot malloc of %ld elements of %ld bytes each for freqPerBin",
-		     state->tp.uniformity_bins, sizeof(long int));
+	tally = get_p_val_tally(state, test_num);
+	if (tally->count != (state->tp.numOfBitStreams * state->partitionCount[test_num])) {
+		warn(__func__,
+		     "metrics driver interface for %s[%d] called with p_val length: %ld != bit streams: %ld",
+		     state->testNames[test_num], test_num, tally->count,
+		     state->tp.numOfBitStreams * state->partitionCount[test_num]);
 	}
 
 	/*
@@ -891,57 +967,11 @@ BlockFrequency_metrics(struct state *state)
 	 */
 	for (j = 0; j < state->partitionCount[test_num]; ++j) {
 
-		/*
-		 * Set counters to zero
-		 */
-		toolow = 0;
-		sampleCount = 0;
-		memset(freqPerBin, 0, state->tp.uniformity_bins * sizeof(freqPerBin[0]));
-
-		/*
-		 * Tally p_value
-		 */
-		for (i = j; i < state->p_val[test_num]->count; i += state->partitionCount[test_num]) {
-
-			// Get the iteration p_value
-			p_value = get_value(state->p_val[test_num], double, i);
-			if (p_value == NON_P_VALUE) {
-				continue;	// the test was not possible for this iteration
-			}
-			// Case: random excursion test
-			if (state->is_excursion[test_num] == true) {
-				// Random excursion tests only sample > 0 p_values
-				if (p_value > 0.0) {
-					++sampleCount;
-				} else {
-					// Ignore p_value of 0 for random excursion tests
-					continue;
-				}
-			}
-			// Case: general (non-random excursion) test
-			else {
-				// All other tests count all p_values
-				++sampleCount;
-			}
-
-			// Count the number of p_values below alpha
-			if (p_value < state->tp.alpha) {
-				++toolow;
-			}
-			// Tally the p_value in a uniformity bin
-			if (p_value >= 1.0) {
-				++freqPerBin[state->tp.uniformity_bins - 1];
-			} else if (p_value >= 0.0) {
-				++freqPerBin[(int) floor(p_value * (double) state->tp.uniformity_bins)];
-			} else {
-				++freqPerBin[0];
-			}
-		}
-
 		/*
 		 * Print uniformity and proportional information for a tallied count
 		 */
-		BlockFrequency_metric_print(state, sampleCount, toolow, freqPerBin);
+		sampleCount = tally->sampleCount[j];
+		BlockFrequency_metric_print(state, sampleCount, tally->toolow[j], &tally->freqPerBin[j * tally->bins]);
 
 		/*
 		 * Track maximum samples
@@ -957,12 +987,6 @@ BlockFrequency_metrics(struct state *state)
 		}
 	}
 
-	/*
-	 * Free allocated storage
-	 */
-	free(freqPerBin);
-	freqPerBin = NULL;
-
 	return;
 }
 
@@ -1003,10 +1027,18 @@ BlockFrequency_destroy(struct state *state)
 		free(state->p_val[test_num]);
 		state->p_val[test_num] = NULL;
 	}
+	if (state->tally[test_num] != NULL) {
+		free_p_val_tally(state->tally[test_num]);
+		state->tally[test_num] = NULL;
+	}
 
 	/*
 	 * Free other test storage
 	 */
+	if (state->streamCarry[test_num] != NULL) {
+		free(state->streamCarry[test_num]);
+		state->streamCarry[test_num] = NULL;
+	}
 	if (state->datatxt_fmt[test_num] != NULL) {
 		free(state->datatxt_fmt[test_num]);
 		state->datatxt_fmt[test_num] = NULL;
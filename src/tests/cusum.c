@@ -36,6 +36,7 @@
 #include "../utils/externs.h"
 #include "../utils/cephes.h"
 #include "../utils/utilities.h"
+#include "../utils/stat_fncs.h"
 #include "../utils/debug.h"
 
 
@@ -50,6 +51,16 @@ struct CumulativeSums_private_stats {
 };
 
 
+/*
+ * Carry - partial results of a bit stream kept between its chunks by each thread
+ */
+struct CumulativeSums_carry {
+	long int S;		// Forward partial sum of the bits streamed so far
+	long int S_max;		// Maximum forward partial sum so far
+	long int S_min;		// Minimum forward partial sum so far
+};
+
+
 /*
  * Static const variables declarations
  */
@@ -126,10 +137,12 @@ CumulativeSums_init(struct state *state)
 	 */
 	if (state->resultstxtFlag == true) {
 		state->stats[test_num] = create_dyn_array(sizeof(struct CumulativeSums_private_stats),
-							  DEFAULT_CHUNK, state->tp.numOfBitStreams, false);	// stats.txt
+							  DEFAULT_CHUNK, retainedIterations(state), false);	// stats.txt
+	}
+	if (state->p_valTally == false) {
+		state->p_val[test_num] = create_dyn_array(sizeof(double),
+							  DEFAULT_CHUNK, 2 * retainedIterations(state), false);	// results.txt
 	}
-	state->p_val[test_num] = create_dyn_array(sizeof(double),
-						  DEFAULT_CHUNK, 2 * state->tp.numOfBitStreams, false);	// results.txt
 
 	/*
 	 * Determine format of data*.txt filenames based on state->partitionCount[test_num]
@@ -144,6 +157,15 @@ CumulativeSums_init(struct state *state)
 		dbg(DBG_HIGH, "%s[%d] not partitioning, no data*.txt filename format", state->testNames[test_num], test_num);
 	}
 
+	/*
+	 * Allocate the partial results kept by each thread between the chunks of a bit stream
+	 */
+	state->streamCarry[test_num] = calloc((size_t) state->numberOfThreads, sizeof(struct CumulativeSums_carry));
+	if (state->streamCarry[test_num] == NULL) {
+		errp(30, __func__, "cannot calloc for streamCarry: %ld elements of %lu bytes each", state->numberOfThreads,
+		     sizeof(struct CumulativeSums_carry));
+	}
+
 	return;
 }
 
@@ -160,6 +182,41 @@ CumulativeSums_init(struct state *state)
  */
 void
 CumulativeSums_iterate(struct thread_state *thread_state)
+{
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (thread_state == NULL) {
+		err(31, __func__, "thread_state arg is NULL");
+	}
+	if (thread_state->global_state == NULL) {
+		err(31, __func__, "state arg is NULL");
+	}
+
+	/*
+	 * Stream the whole bit stream as a single chunk
+	 */
+	CumulativeSums_stream(thread_state, 0, thread_state->global_state->tp.n);
+
+	return;
+}
+
+
+/*
+ * CumulativeSums_stream - stream a chunk of a bit stream to the Cumulative Sums test
+ *
+ * given:
+ *      thread_state    // current thread state
+ *      first           // index in the bit stream of the first bit of the chunk, 0 starts a new bit stream
+ *      count           // number of bits in the chunk, held by epsilon
+ *
+ * The chunks of a bit stream are streamed in order.  The iteration is recorded with the chunk
+ * that ends the bit stream.
+ *
+ * NOTE: The initialize function must be called before this function is called.
+ */
+void
+CumulativeSums_stream(struct thread_state *thread_state, long int first, long int count)
 {
 	struct CumulativeSums_private_stats stat;	// Stats for this iteration
 	long int n;			// Length of a single bit stream
@@ -169,6 +226,8 @@ CumulativeSums_iterate(struct thread_state *thread_state)
 	double p_value_forward;		// p_value for forward test
 	double p_value_backward;	// p_value for backward test
 	long int k;
+	struct CumulativeSums_carry *carry;	// Partial results of the bit stream of this thread
+	BitSequence *epsilon;		// Chunk of the bit stream
 
 	/*
 	 * Check preconditions (firewall)
@@ -190,6 +249,9 @@ CumulativeSums_iterate(struct thread_state *thread_state)
 	if (state->epsilon[thread_state->thread_id] == NULL) {
 		err(31, __func__, "state->epsilon[%ld] is NULL", thread_state->thread_id);
 	}
+	if (state->streamCarry[test_num] == NULL) {
+		err(31, __func__, "state->streamCarry[%d] is NULL", test_num);
+	}
 	if (state->cSetup != true) {
 		err(31, __func__, "test constants not setup prior to calling %s for %s[%d]",
 		    __func__, state->testNames[test_num], test_num);
@@ -199,11 +261,13 @@ CumulativeSums_iterate(struct thread_state *thread_state)
 	 * Collect parameters from state
 	 */
 	n = state->tp.n;
-
-	/*
-	 * Zeroize stats before performing the test
-	 */
-	memset(&stat, 0, sizeof(stat));
+	epsilon = state->epsilon[thread_state->thread_id];
+	carry = (struct CumulativeSums_carry *) state->streamCarry[test_num] + thread_state->thread_id;
+	if (first == 0) {
+		carry->S = 0;
+		carry->S_max = 0;
+		carry->S_min = 0;
+	}
 
 	/*
 	 * Step 2a: find the maximum and the minimum values of the forward partial sums.
@@ -217,14 +281,29 @@ CumulativeSums_iterate(struct thread_state *thread_state)
 	 * the maximum and the minimum backwards partial sums will be respectively
 	 * (S - S_min) and (S - S_max).
 	 */
-	S = 0;
-	S_max = 0;
-	S_min = 0;
-	for (k = 0; k < n; k++) {
-		(state->epsilon[thread_state->thread_id][k] != 0) ? S++ : S--;
+	S = carry->S;
+	S_max = carry->S_max;
+	S_min = carry->S_min;
+	for (k = 0; k < count; k++) {
+		(epsilon[k] != 0) ? S++ : S--;
 		S_max = MAX(S, S_max);
 		S_min = MIN(S, S_min);
 	}
+	carry->S = S;
+	carry->S_max = S_max;
+	carry->S_min = S_min;
+
+	/*
+	 * Wait for the rest of the bit stream
+	 */
+	if (first + count < n) {
+		return;
+	}
+
+	/*
+	 * Zeroize stats before performing the test
+	 */
+	memset(&stat, 0, sizeof(stat));
 
 	/*
 	 * Step 3: compute the test statistics
@@ -303,8 +382,8 @@ CumulativeSums_iterate(struct thread_state *thread_state)
 	if (state->resultstxtFlag == true) {
 		append_value(state->stats[test_num], &stat);
 	}
-	append_value(state->p_val[test_num], &p_value_forward);
-	append_value(state->p_val[test_num], &p_value_backward);
+	record_p_value(state, test_num, 0, p_value_forward);
+	record_p_value(state, test_num, 1, p_value_backward);
 
 	/*
 	 * Unlock mutex after making changes to the shared state
@@ -630,14 +709,14 @@ CumulativeSums_print(struct state *state)
 	 */
 	stats_txt = filePathName(state->subDir[test_num], "stats.txt");
 	dbg(DBG_HIGH, "about to open/truncate: %s", stats_txt);
-	stats = openTruncate(stats_txt);
+	stats = openPrintFile(state, stats_txt);
 
 	/*
 	 * Open results.txt file
 	 */
 	results_txt = filePathName(state->subDir[test_num], "results.txt");
 	dbg(DBG_HIGH, "about to open/truncate: %s", results_txt);
-	results = openTruncate(results_txt);
+	results = openPrintFile(state, results_txt);
 
 	/*
 	 * Write results.txt and stats.txt files
@@ -733,7 +812,7 @@ CumulativeSums_print(struct state *state)
 			 */
 			data_txt = filePathName(state->subDir[test_num], data_filename);
 			dbg(DBG_HIGH, "about to open/truncate: %s", data_txt);
-			data = openTruncate(data_txt);
+			data = openPrintFile(state, data_txt);
 
 			/*
 			 * Write this particular data*.txt filename
@@ -946,11 +1025,8 @@ CumulativeSums_metric_print(struct state *state, long int sampleCount, long int
 void
 CumulativeSums_metrics(struct state *state)
 {
-	long int sampleCount;	// Number of bitstreams in which we will count p_values
-	long int toolow;	// p_values that were below alpha
-	double p_value;		// p_value iteration test result(s)
-	long int *freqPerBin;	// Uniformity frequency bins
-	long int i;
+	struct p_val_tally *tally;	// Uniformity and proportion counts of the p_values
+	long int sampleCount;	// Number of bitstreams in which we counted p_values
 	long int j;
 
 	/*
@@ -969,20 +1045,16 @@ CumulativeSums_metrics(struct state *state)
 		    "metrics driver interface for %s[%d] called with state.partitionCount: %d < 0",
 		    state->testNames[test_num], test_num, state->partitionCount[test_num]);
 	}
-	if (state->p_val[test_num]->count != (state->tp.numOfBitStreams * state->partitionCount[test_num])) {
-		warn(__func__,
-		     "metrics driver interface for %s[%d] called with p_val length: %ld != bit streams: %ld",
-		     state->testNames[test_num], test_num, state->p_val[test_num]->count,
-		     state->tp.numOfBitStreams * state->partitionCount[test_num]);
-	}
 
 	/*
-	 * Allocate uniformity frequency bins
+	 * Tally the p_values, unless they were tallied as iterations completed
 	 */
-	freqPerBin = malloc(state->tp.uniformity_bins * sizeof(freqPerBin[0]));
-	if (freqPerBin == NULL) {
-		errp(36, __func__, "cannot malloc of %ld elements of %ld bytes each for freqPerBin",
-		     state->tp.uniformity_bins, sizeof(long int));
+	tally = get_p_val_tally(state, test_num);
+	if (tally->count != (state->tp.numOfBitStreams * state->partitionCount[test_num])) {
+		warn(__func__,
+		     "metrics driver interface for %s[%d] called with p_val length: %ld != bit streams: %ld",
+		     state->testNames[test_num], test_num, tally->count,
+		     state->tp.numOfBitStreams * state->partitionCount[test_num]);
 	}
 
 	/*
@@ -990,57 +1062,11 @@ CumulativeSums_metrics(struct state *state)
 	 */
 	for (j = 0; j < state->partitionCount[test_num]; ++j) {
 
-		/*
-		 * Set counters to zero
-		 */
-		toolow = 0;
-		sampleCount = 0;
-		memset(freqPerBin, 0, state->tp.uniformity_bins * sizeof(freqPerBin[0]));
-
-		/*
-		 * Tally p_value
-		 */
-		for (i = j; i < state->p_val[test_num]->count; i += state->partitionCount[test_num]) {
-
-			// Get the iteration p_value
-			p_value = get_value(state->p_val[test_num], double, i);
-			if (p_value == NON_P_VALUE) {
-				continue;	// the test was not possible for this iteration
-			}
-			// Case: random excursion test
-			if (state->is_excursion[test_num] == true) {
-				// Random excursion tests only sample > 0 p_values
-				if (p_value > 0.0) {
-					++sampleCount;
-				} else {
-					// Ignore p_value of 0 for random excursion tests
-					continue;
-				}
-			}
-			// Case: general (non-random excursion) test
-			else {
-				// All other tests count all p_values
-				++sampleCount;
-			}
-
-			// Count the number of p_values below alpha
-			if (p_value < state->tp.alpha) {
-				++toolow;
-			}
-			// Tally the p_value in a uniformity bin
-			if (p_value >= 1.0) {
-				++freqPerBin[state->tp.uniformity_bins - 1];
-			} else if (p_value >= 0.0) {
-				++freqPerBin[(int) floor(p_value * (double) state->tp.uniformity_bins)];
-			} else {
-				++freqPerBin[0];
-			}
-		}
-
 		/*
 		 * Print uniformity and proportional information for a tallied count
 		 */
-		CumulativeSums_metric_print(state, sampleCount, toolow, freqPerBin, j);
+		sampleCount = tally->sampleCount[j];
+		CumulativeSums_metric_print(state, sampleCount, tally->toolow[j], &tally->freqPerBin[j * tally->bins], j);
 
 		/*
 		 * Track maximum samples
@@ -1056,12 +1082,6 @@ CumulativeSums_metrics(struct state *state)
 		}
 	}
 
-	/*
-	 * Free allocated storage
-	 */
-	free(freqPerBin);
-	freqPerBin = NULL;
-
 	return;
 }
 
@@ -1102,10 +1122,18 @@ CumulativeSums_destroy(struct state *state)
 		free(state->p_val[test_num]);
 		state->p_val[test_num] = NULL;
 	}
+	if (state->tally[test_num] != NULL) {
+		free_p_val_tally(state->tally[test_num]);
+		state->tally[test_num] = NULL;
+	}
 
 	/*
 	 * Free other test storage
 	 */
+	if (state->streamCarry[test_num] != NULL) {
+		free(state->streamCarry[test_num]);
+		state->streamCarry[test_num] = NULL;
+	}
 	if (state->datatxt_fmt[test_num] != NULL) {
 		free(state->datatxt_fmt[test_num]);
 		state->datatxt_fmt[test_num] = NULL;
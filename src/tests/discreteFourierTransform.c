@@ -30,6 +30,7 @@
 
 #include <stdio.h>
 #include <math.h>
+#include <float.h>
 #include <string.h>
 #include <stdlib.h>
 #include <errno.h>
@@ -38,11 +39,20 @@
 #include "../utils/utilities.h"
 #include "../utils/cephes.h"
 #include "../utils/debug.h"
+#include "../utils/arena.h"
+#include "../utils/rfft.h"
 
 #if defined(LEGACY_FFT)
 #include "../utils/dfft.h"
 #else /* LEGACY_FFT */
 #include <fftw3.h>
+
+/*
+ * fftw does not tell how much memory a plan takes: these are the bytes per bit that
+ * fftw 3.3 allocates for the plan of a real DFT, measured at lengths from 2^16 to 2^26
+ */
+#define FFTW_PLAN_BYTES_POW2 (9)	// Bytes per bit of a plan of power of 2 length
+#define FFTW_PLAN_BYTES (20)		// Bytes per bit of a plan of any other length, up to a prime
 #endif /* LEGACY_FFT */
 
 
@@ -69,6 +79,10 @@ static const enum test test_num = TEST_DFT;	// This test number
  */
 static double sqrtn4_095_005;			// Square root of (n / 4.0 * 0.95 * 0.05)
 static double sqrt_log20_n;			// Square root of ln(20) * n
+static double max_sq_below_T;			// Largest squared modulus whose square root is < sqrt_log20_n
+#if !defined(LEGACY_FFT)
+static double near_sq_T;			// Half width of the band around max_sq_below_T rechecked with cabs()
+#endif /* LEGACY_FFT */
 
 
 /*
@@ -78,6 +92,10 @@ static bool DiscreteFourierTransform_print_stat(FILE * stream, struct state *sta
 						struct DiscreteFourierTransform_private_stats *stat, double p_value);
 static bool DiscreteFourierTransform_print_p_value(FILE * stream, double p_value);
 static void DiscreteFourierTransform_metric_print(struct state *state, long int sampleCount, long int toolow, long int *freqPerBin);
+static void DiscreteFourierTransform_report_memory(struct state *state, long int per_thread, const char *what,
+						   long int shared);
+static void DiscreteFourierTransform_alloc_fft(struct state *state);
+static long int DiscreteFourierTransform_count(struct thread_state *thread_state);
 
 
 /*
@@ -142,62 +160,51 @@ DiscreteFourierTransform_init(struct state *state)
 	sqrt_log20_n = sqrt(log(20.0) * (double) state->tp.n);	// 2.995732274 * n
 
 	/*
-	 * Allocate arrays that will be used by the DFT libraries, for each thread
+	 * Find the squared modulus threshold that gives the same comparisons as the square root of it would.
+	 *
+	 * As sqrt() is correctly rounded, it is monotonic: the squared moduli x with sqrt(x) < sqrt_log20_n
+	 * are exactly those with x <= max_sq_below_T, which is within a few ulps of sqrt_log20_n squared.
 	 */
-	state->fft_X = malloc((size_t) state->numberOfThreads * sizeof(*state->fft_X));
-	if (state->fft_X == NULL) {
-		errp(40, __func__, "cannot malloc for fft_X: %ld elements of %ld bytes each", state->numberOfThreads,
-		     sizeof(*state->fft_X));
+	max_sq_below_T = sqrt_log20_n * sqrt_log20_n;
+	while (sqrt(max_sq_below_T) >= sqrt_log20_n) {
+		max_sq_below_T = nextafter(max_sq_below_T, 0.0);
 	}
-#if defined(LEGACY_FFT)
-	state->fft_wsave = malloc((size_t) state->numberOfThreads * sizeof(*state->fft_wsave));
-	if (state->fft_wsave == NULL) {
-		errp(40, __func__, "cannot malloc for fft_wsave: %ld elements of %ld bytes each", state->numberOfThreads,
-		     sizeof(*state->fft_wsave));
-	}
-#else /* LEGACY_FFT */
-	state->fftw_out = malloc((size_t) state->numberOfThreads * sizeof(*state->fftw_out));
-	if (state->fftw_out == NULL) {
-		errp(40, __func__, "cannot malloc for fftw_out: %ld elements of %ld bytes each", state->numberOfThreads,
-		     sizeof(*state->fftw_out));
-	}
-	state->fftw_p = malloc((size_t) state->numberOfThreads * sizeof(*state->fftw_p));
-	if (state->fftw_p == NULL) {
-		errp(40, __func__, "cannot malloc for fftw_p: %ld elements of %ld bytes each", state->numberOfThreads,
-		     sizeof(*state->fftw_p));
+	while (sqrt(nextafter(max_sq_below_T, HUGE_VAL)) < sqrt_log20_n) {
+		max_sq_below_T = nextafter(max_sq_below_T, HUGE_VAL);
 	}
+#if !defined(LEGACY_FFT)
+	/*
+	 * The fftw moduli are compared to T by cabs(), which is hypot() and not the square root of the
+	 * squared modulus: both are within a few ulps of each other, far less than this band.
+	 */
+	near_sq_T = 16.0 * DBL_EPSILON * max_sq_below_T;
 #endif /* LEGACY_FFT */
-	state->fft_m = malloc((size_t) state->numberOfThreads * sizeof(*state->fft_m));
-	if (state->fft_m == NULL) {
-		errp(40, __func__, "cannot malloc for fft_m: %ld elements of %ld bytes each", state->numberOfThreads,
-		     sizeof(*state->fft_m));
-	}
 
-	for (i = 0; i < state->numberOfThreads; i++) {
-		state->fft_X[i] = calloc((size_t) state->tp.n, sizeof(state->fft_X[i][0]));
-		if (state->fft_X[i] == NULL) {
-			errp(40, __func__, "cannot calloc of %ld elements of %ld bytes each for state->fft_X[%ld]",
-			     n, sizeof(state->fft_X[i][0]), i);
-		}
-#if defined(LEGACY_FFT)
-		state->fft_wsave[i] = calloc((size_t) 2 * state->tp.n, sizeof(state->fft_wsave[i][0]));
-		if (state->fft_wsave[i] == NULL) {
-			errp(40, __func__, "cannot calloc of %ld elements of %ld bytes each for state->fft_wsave[%ld]",
-			     2 * n, sizeof(state->fft_wsave[i][0]), i);
+	/*
+	 * Allocate the single precision tables and work arrays of each thread if -D float,
+	 * otherwise the arrays that will be used by the DFT libraries
+	 */
+	if (state->dftFloat == true) {
+		state->fftf_plan = rfftf_plan(n);
+		if (state->fftf_plan == NULL) {
+			err(40, __func__, "-D float requires a bitcount(n) that is a power of 2: %ld", n);
 		}
-#else /* LEGACY_FFT */
-		state->fftw_out[i] = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * (n / 2 + 1));
-		if (state->fftw_out[i] == NULL) {
-			errp(40, __func__, "cannot fftw_malloc of %ld elements of %ld bytes each for state->fftw_out[%ld]",
-			     n / 2 + 1, sizeof(fftw_complex), i);
+		DiscreteFourierTransform_report_memory(state, 2 * n * (long int) sizeof(float), "fftf_plan",
+						       2 * n * (long int) sizeof(float) +
+						       2 * ((n >> state->fftf_plan->fine_bits) + (1L << state->fftf_plan->fine_bits)) *
+						       (long int) sizeof(double));
+		state->fftf_work = malloc((size_t) state->numberOfThreads * sizeof(*state->fftf_work));
+		if (state->fftf_work == NULL) {
+			errp(40, __func__, "cannot malloc for fftf_work: %ld elements of %ld bytes each", state->numberOfThreads,
+			     sizeof(*state->fftf_work));
 		}
-		state->fftw_p[i] = fftw_plan_dft_r2c_1d((int) n, state->fft_X[i], state->fftw_out[i], FFTW_ESTIMATE);
-#endif /* LEGACY_FFT */
-		state->fft_m[i] = calloc((size_t) (n / 2 + 1), sizeof(state->fft_m[i][0]));
-		if (state->fft_m[i] == NULL) {
-			errp(40, __func__, "cannot calloc of %ld elements of %ld bytes each for state->fft_m[%ld]",
-			     n / 2 + 1, sizeof(state->fft_m[i][0]), i);
+		for (i = 0; i < state->numberOfThreads; i++) {
+			arenaAlloc(state, i, test_num, "fftf_work", (size_t) (2 * n) * sizeof(state->fftf_work[i][0]),
+				   &state->fftf_work[i]);
 		}
+		dbg(DBG_LOW, "DFT uses the in-tree real FFT in single precision for length %ld", n);
+	} else {
+		DiscreteFourierTransform_alloc_fft(state);
 	}
 
 	/*
@@ -205,10 +212,12 @@ DiscreteFourierTransform_init(struct state *state)
 	 */
 	if (state->resultstxtFlag == true) {
 		state->stats[test_num] = create_dyn_array(sizeof(struct DiscreteFourierTransform_private_stats),
-							  DEFAULT_CHUNK, state->tp.numOfBitStreams, false);        // stats.txt
+							  DEFAULT_CHUNK, retainedIterations(state), false);        // stats.txt
+	}
+	if (state->p_valTally == false) {
+		state->p_val[test_num] = create_dyn_array(sizeof(double),
+							  DEFAULT_CHUNK, retainedIterations(state), false);	// results.txt
 	}
-	state->p_val[test_num] = create_dyn_array(sizeof(double),
-						  DEFAULT_CHUNK, state->tp.numOfBitStreams, false);	// results.txt
 
 	/*
 	 * Determine format of data*.txt filenames based on state->partitionCount[test_num]
@@ -223,30 +232,160 @@ DiscreteFourierTransform_init(struct state *state)
 
 
 /*
- * DiscreteFourierTransform_iterate - iterate one bit stream for Discrete Fourier Transform test
+ * DiscreteFourierTransform_report_memory - report the memory of the DFT arrays before they are allocated
  *
  * given:
  *      state           // run state to test under
+ *      per_thread      // bytes of the work arrays of each thread
+ *      what            // name of the tables shared by all threads, must be a string constant
+ *      shared          // bytes of the tables shared by all threads
  *
- * This function is called for each and every iteration noted in state->tp.numOfBitStreams.
+ * With bitcounts of billions of bits, the work arrays of the threads are the bulk of the memory of the run,
+ * followed by the shared tables, which are listed in the memory budget so that they count against -M memlimit.
+ */
+static void
+DiscreteFourierTransform_report_memory(struct state *state, long int per_thread, const char *what, long int shared)
+{
+	dbg(DBG_LOW, "DFT of bitcount(n): %ld will use %.1f MiB per thread, %.1f MiB for %ld threads, "
+	    "and %.1f MiB of shared tables", state->tp.n, (double) per_thread / 1048576.0,
+	    (double) per_thread * (double) state->numberOfThreads / 1048576.0, state->numberOfThreads,
+	    (double) shared / 1048576.0);
+	arenaShared(state, test_num, what, (size_t) shared);
+
+	return;
+}
+
+
+/*
+ * DiscreteFourierTransform_alloc_fft - allocate the arrays that will be used by the DFT libraries, for each thread
  *
- * NOTE: The initialize function must be called first.
+ * given:
+ *      state           // run state to test under
  */
-void
-DiscreteFourierTransform_iterate(struct thread_state *thread_state)
+static void
+DiscreteFourierTransform_alloc_fft(struct state *state)
+{
+	long int n;		// Length of a single bit stream
+	long int len;		// Length of the fft_X array of each thread, 0 if not used
+	long int i;
+#if !defined(LEGACY_FFT)
+	fftw_iodim64 dim;	// Dimension of the transform, of 64 bit length
+	double *plan_X;		// Array the plan is made on
+#endif /* LEGACY_FFT */
+
+	n = state->tp.n;
+	state->fft_X = malloc((size_t) state->numberOfThreads * sizeof(*state->fft_X));
+	if (state->fft_X == NULL) {
+		errp(40, __func__, "cannot malloc for fft_X: %ld elements of %ld bytes each", state->numberOfThreads,
+		     sizeof(*state->fft_X));
+	}
+#if defined(LEGACY_FFT)
+	state->fft_wsave = malloc((size_t) state->numberOfThreads * sizeof(*state->fft_wsave));
+	if (state->fft_wsave == NULL) {
+		errp(40, __func__, "cannot malloc for fft_wsave: %ld elements of %ld bytes each", state->numberOfThreads,
+		     sizeof(*state->fft_wsave));
+	}
+
+	/*
+	 * Use the in-tree real FFT when n is a power of 2, otherwise the legacy dfft library.
+	 *
+	 * Either way, the twiddle factors are computed once, for all iterations of all threads.
+	 * The in-tree real FFT reads the bits of epsilon itself, so it needs no fft_X array.
+	 */
+	state->fft_plan = rfft_plan(n);
+	if (state->fft_plan != NULL) {
+		dbg(DBG_LOW, "DFT uses the in-tree real FFT of power of 2 length %ld", n);
+		len = 0;
+		DiscreteFourierTransform_report_memory(state, 2 * n * (long int) sizeof(double), "fft_plan",
+						       2 * n * (long int) sizeof(double));
+	} else {
+		dbg(DBG_LOW, "DFT uses the legacy dfft library for length %ld", n);
+		len = n;
+		DiscreteFourierTransform_report_memory(state, 2 * n * (long int) sizeof(double), "fft_wa",
+						       n * (long int) sizeof(double) + (WORK_ARRAY_LEN + 1) *
+						       (long int) sizeof(state->fft_ifac[0]));
+		state->fft_wa = calloc((size_t) n, sizeof(state->fft_wa[0]));
+		if (state->fft_wa == NULL) {
+			errp(40, __func__, "cannot calloc of %ld elements of %ld bytes each for fft_wa", n,
+			     sizeof(state->fft_wa[0]));
+		}
+		state->fft_ifac = calloc((size_t) WORK_ARRAY_LEN + 1, sizeof(state->fft_ifac[0]));
+		if (state->fft_ifac == NULL) {
+			errp(40, __func__, "cannot calloc of %d elements of %ld bytes each for fft_ifac", WORK_ARRAY_LEN + 1,
+			     sizeof(state->fft_ifac[0]));
+		}
+		__ogg_fdrffti_shared(n, state->fft_wa, state->fft_ifac);
+	}
+#else /* LEGACY_FFT */
+	/*
+	 * The transform is done in-place, so fft_X has room for the n / 2 + 1 complex outputs.
+	 *
+	 * The guru64 interface takes the length as a ptrdiff_t, so that n may be beyond 2^31.
+	 * The arena aligns fft_X on a cache line, which is at least the SIMD alignment of fftw_malloc().
+	 */
+	len = 2 * (n / 2 + 1);
+	DiscreteFourierTransform_report_memory(state, len * (long int) sizeof(double), "fftw plan",
+					       n * (((n & (n - 1)) == 0) ? FFTW_PLAN_BYTES_POW2 : FFTW_PLAN_BYTES));
+	dim.n = n;
+	dim.is = 1;
+	dim.os = 1;
+
+	/*
+	 * The arrays of the threads are only mapped once every test is initialized, so that one plan is made
+	 * on an array of the same length and alignment, which FFTW_ESTIMATE does not touch, and each thread
+	 * executes it on its own fft_X with fftw_execute_dft_r2c()
+	 */
+	plan_X = fftw_malloc((size_t) len * sizeof(plan_X[0]));
+	if (plan_X == NULL) {
+		err(40, __func__, "cannot fftw_malloc %ld doubles to plan the DFT", len);
+	}
+	state->fftw_p = fftw_plan_guru64_dft_r2c(1, &dim, 0, NULL, plan_X, (fftw_complex *) plan_X, FFTW_ESTIMATE);
+	if (state->fftw_p == NULL) {
+		err(40, __func__, "fftw cannot plan a real DFT of length %ld", n);
+	}
+	fftw_free(plan_X);
+#endif /* LEGACY_FFT */
+
+	for (i = 0; i < state->numberOfThreads; i++) {
+#if defined(LEGACY_FFT)
+		if (len > 0) {
+			arenaAlloc(state, i, test_num, "fft_X", (size_t) len * sizeof(state->fft_X[i][0]), &state->fft_X[i]);
+		} else {
+			state->fft_X[i] = NULL;
+		}
+		arenaAlloc(state, i, test_num, "fft_wsave",
+			   (size_t) (state->fft_plan != NULL ? 2 * n : n) * sizeof(state->fft_wsave[i][0]), &state->fft_wsave[i]);
+#else /* LEGACY_FFT */
+		arenaAlloc(state, i, test_num, "fft_X", (size_t) len * sizeof(state->fft_X[i][0]), &state->fft_X[i]);
+#endif /* LEGACY_FFT */
+	}
+
+	return;
+}
+
+
+/*
+ * DiscreteFourierTransform_count - count the moduli of the DFT of a bitstream less than T, in double precision
+ *
+ * given:
+ *      thread_state    // pointer to thread state
+ *
+ * returns:
+ *      N1, the number of the first n / 2 moduli of the DFT that are less than T
+ */
+static long int
+DiscreteFourierTransform_count(struct thread_state *thread_state)
 {
-	struct DiscreteFourierTransform_private_stats stat;	// Stats for this iteration
 	long int n;			// Length of a single bit stream
-	double p_value;			// p_value iteration test result(s)
 	double *X = NULL;		// Adjusted sequence with +1 and -1 bits
-	double *m = NULL;		// Magnitude of the DFT
+	long int N_1;			// Number of moduli of the DFT less than T
 	long int i;
 #if defined(LEGACY_FFT)
-	double *wsave = NULL;		// Work array used by __ogg_fdrffti() and __ogg_fdrfftf()
-	long ifac[WORK_ARRAY_LEN + 1];	// work array used by __ogg_fdrffti() and __ogg_fdrfftf()
+	double *wsave = NULL;		// Work array used by __ogg_fdrfftf_shared() or rfft_count_below()
 #else /* LEGACY_FFT */
-	fftw_complex *out;		// Output of the DFT
-	fftw_plan p;			// Information on the fastest way to compute the DFT on this machine
+	fftw_complex *out;		// Output of the DFT, in-place in X
+	double sq;			// Squared modulus of an element of out
+	long int near;			// Number of squared moduli within near_sq_T of max_sq_below_T
 #endif /* LEGACY_FFT */
 
 	/*
@@ -259,32 +398,9 @@ DiscreteFourierTransform_iterate(struct thread_state *thread_state)
 	if (state == NULL) {
 		err(41, __func__, "state arg is NULL");
 	}
-	if (state->testVector[test_num] != true) {
-		dbg(DBG_LOW, "iterate function[%d] %s called when test vector was false", test_num, __func__);
-		return;
-	}
-	if (state->epsilon == NULL) {
-		err(41, __func__, "state->epsilon is NULL");
-	}
-	if (state->epsilon[thread_state->thread_id] == NULL) {
-		err(41, __func__, "state->epsilon[%ld] is NULL", thread_state->thread_id);
-	}
 	if (state->fft_X == NULL) {
 		err(41, __func__, "state->fft_X is NULL");
 	}
-	if (state->fft_X[thread_state->thread_id] == NULL) {
-		err(41, __func__, "state->fft_X[%ld] is NULL", thread_state->thread_id);
-	}
-	if (state->fft_m == NULL) {
-		err(41, __func__, "state->fft_m is NULL");
-	}
-	if (state->fft_m[thread_state->thread_id] == NULL) {
-		err(41, __func__, "state->fft_m[%ld] is NULL", thread_state->thread_id);
-	}
-	if (state->cSetup != true) {
-		err(41, __func__, "test constants not setup prior to calling %s for %s[%d]",
-		    __func__, state->testNames[test_num], test_num);
-	}
 #if defined(LEGACY_FFT)
 	if (state->fft_wsave == NULL) {
 		err(41, __func__, "state->fft_wsave is NULL");
@@ -292,19 +408,19 @@ DiscreteFourierTransform_iterate(struct thread_state *thread_state)
 	if (state->fft_wsave[thread_state->thread_id] == NULL) {
 		err(41, __func__, "state->fft_wsave[%ld] is NULL", thread_state->thread_id);
 	}
-#else
-	if (state->fftw_out == NULL) {
-		err(41, __func__, "state->fftw_out is NULL");
+	if (state->fft_plan == NULL && (state->fft_wa == NULL || state->fft_ifac == NULL)) {
+		err(41, __func__, "state->fft_plan, state->fft_wa or state->fft_ifac is NULL");
+	}
+	if (state->fft_plan == NULL && state->fft_X[thread_state->thread_id] == NULL) {
+		err(41, __func__, "state->fft_X[%ld] is NULL", thread_state->thread_id);
 	}
-	if (state->fftw_out[thread_state->thread_id] == NULL) {
-		err(41, __func__, "state->fftw_out[%ld] is NULL", thread_state->thread_id);
+#else
+	if (state->fft_X[thread_state->thread_id] == NULL) {
+		err(41, __func__, "state->fft_X[%ld] is NULL", thread_state->thread_id);
 	}
 	if (state->fftw_p == NULL) {
 		err(41, __func__, "state->fftw_p is NULL");
 	}
-	if (state->fftw_p[thread_state->thread_id] == NULL) {
-		err(41, __func__, "state->fftw_p[%ld] is NULL", thread_state->thread_id);
-	}
 #endif /* LEGACY_FFT */
 
 	/*
@@ -314,11 +430,20 @@ DiscreteFourierTransform_iterate(struct thread_state *thread_state)
 	X = state->fft_X[thread_state->thread_id];
 #if defined(LEGACY_FFT)
 	wsave = state->fft_wsave[thread_state->thread_id];
+
+	/*
+	 * Steps 1 to 3 and 6 are fused by the in-tree real FFT, used when n is a power of 2.
+	 *
+	 * It counts the first term of the DFT by its squared modulus as well, which gives the
+	 * same result as its absolute value: that term is an integer, so it is squared exactly
+	 * whenever it is anywhere near T.
+	 */
+	if (state->fft_plan != NULL) {
+		return rfft_count_below(state->fft_plan, state->epsilon[thread_state->thread_id], wsave, max_sq_below_T);
+	}
 #else /* LEGACY_FFT */
-	out = state->fftw_out[thread_state->thread_id];
-	p = state->fftw_p[thread_state->thread_id];
+	out = (fftw_complex *) X;
 #endif /* LEGACY_FFT */
-	m = state->fft_m[thread_state->thread_id];
 
 	/*
 	 * Step 1: initialize X for this iteration
@@ -349,67 +474,141 @@ DiscreteFourierTransform_iterate(struct thread_state *thread_state)
 	 * After the function returns, X will look like (saying that values followed by I are the imaginary parts):
 	 * 	[a, b, bI, c, cI, ..., l, lI] when n is odd
 	 *	[a, b, bI, c, cI, ..., l, lI, m] when n is even
+	 *
+	 * Its tables were computed once by DiscreteFourierTransform_init().
 	 */
-	__ogg_fdrffti(n, wsave, ifac);
-	__ogg_fdrfftf(n, X, wsave, ifac);
+	__ogg_fdrfftf_shared(n, X, wsave, state->fft_wa, state->fft_ifac);
 #else /* LEGACY_FFT */
 	/*
-	 * The fftw library does the transform out-of-place.
-	 * As a consequence, the computed complex frequencies will be saved in the out array
-	 * of size n / 2 + 1.
+	 * The fftw library does the transform in-place as well.
+	 * As a consequence, X will hold the n / 2 + 1 computed complex frequencies, as the out array.
 	 */
-	fftw_execute(p);
+	fftw_execute_dft_r2c(state->fftw_p, X, out);
 #endif /* LEGACY_FFT */
 
-#if defined(LEGACY_FFT)
 	/*
-	 * Step 3a: compute modulus (absolute value) of the first element of the DFT output.
-	 * This first element is always real, and has no imaginary part.
+	 * Step 3 and 6: count the moduli (absolute values) of the first n / 2 elements of the DFT output
+	 * that are less than T, as N1.
+	 *
+	 * The moduli are not stored: each squared modulus is compared to the squared threshold that
+	 * gives the same result as comparing its square root to T, so that the compiler may vectorize
+	 * the count.  The legacy moduli were square roots, so that N1 is exactly the same.  The fftw
+	 * moduli were computed by cabs(), which may round differently near T: the squared moduli that
+	 * are that close to the threshold are compared again with cabs(), so that N1 does not change.
+	 *
+	 * NOTE: Step 4 is skipped because T has already been computed
 	 */
-	m[0] = fabs(X[0]);
-
+#if defined(LEGACY_FFT)
 	/*
-	 * Step 3b: compute the modulus of the following n/2 elements of the DFT output.
-	 * These elements are always complex, so we have to consider both real and imaginary value.
+	 * The first element of the DFT output is always real, and has no imaginary part.
+	 * The following elements are always complex, so we have to consider both real and imaginary value.
 	 */
-	long int j;
-	for (i = 0, j = 1; i < n - 1; i += 2, j++) {
-		m[j] = sqrt((X[i] * X[i]) + (X[i + 1] * X[i + 1]));
+	N_1 = 0;
+	if (fabs(X[0]) < sqrt_log20_n) {
+		N_1++;
+	}
+	for (i = 1; i < n / 2; i++) {
+		if (X[2 * i - 1] * X[2 * i - 1] + X[2 * i] * X[2 * i] <= max_sq_below_T) {
+			N_1++;
+		}
+	}
+#else /* LEGACY_FFT */
+	N_1 = 0;
+	near = 0;
+	for (i = 0; i < n / 2; i++) {
+		sq = creal(out[i]) * creal(out[i]) + cimag(out[i]) * cimag(out[i]);
+		N_1 += (sq <= max_sq_below_T);
+		near += (fabs(sq - max_sq_below_T) <= near_sq_T);
 	}
 
 	/*
-	 * Step 3c: if n is even, consider the remaining additional element at the end of the DFT output.
-	 * This last element is always real, and has no imaginary part.
+	 * Count again with cabs() the rare moduli that are close to T
 	 */
-	if ((n % 2) == 0) {
-		m[i+1] = fabs(X[n-1]);
+	for (i = 0; near > 0 && i < n / 2; i++) {
+		sq = creal(out[i]) * creal(out[i]) + cimag(out[i]) * cimag(out[i]);
+		if (fabs(sq - max_sq_below_T) <= near_sq_T) {
+			N_1 += (cabs(out[i]) < sqrt_log20_n) - (sq <= max_sq_below_T);
+			near--;
+		}
 	}
-#else /* LEGACY_FFT */
+#endif /* LEGACY_FFT */
+
+	return N_1;
+}
+
+
+/*
+ * DiscreteFourierTransform_iterate - iterate one bit stream for Discrete Fourier Transform test
+ *
+ * given:
+ *      state           // run state to test under
+ *
+ * This function is called for each and every iteration noted in state->tp.numOfBitStreams.
+ *
+ * NOTE: The initialize function must be called first.
+ */
+void
+DiscreteFourierTransform_iterate(struct thread_state *thread_state)
+{
+	struct DiscreteFourierTransform_private_stats stat;	// Stats for this iteration
+	long int n;			// Length of a single bit stream
+	double p_value;			// p_value iteration test result(s)
+
 	/*
-	 * Step 3: compute modulus (absolute value) of the first (n / 2 + 1) elements (in our case
-	 * all the ones that we have) of the DFT output.
+	 * Check preconditions (firewall)
 	 */
-	for (i = 0; i < n / 2 + 1; i++) {
-		m[i] = cabs(out[i]);
+	if (thread_state == NULL) {
+		err(41, __func__, "thread_state arg is NULL");
+	}
+	struct state *state = thread_state->global_state;
+	if (state == NULL) {
+		err(41, __func__, "state arg is NULL");
+	}
+	if (state->testVector[test_num] != true) {
+		dbg(DBG_LOW, "iterate function[%d] %s called when test vector was false", test_num, __func__);
+		return;
+	}
+	if (state->epsilon == NULL) {
+		err(41, __func__, "state->epsilon is NULL");
+	}
+	if (state->epsilon[thread_state->thread_id] == NULL) {
+		err(41, __func__, "state->epsilon[%ld] is NULL", thread_state->thread_id);
+	}
+	if (state->cSetup != true) {
+		err(41, __func__, "test constants not setup prior to calling %s for %s[%d]",
+		    __func__, state->testNames[test_num], test_num);
 	}
-#endif /* LEGACY_FFT */
 
 	/*
-	 * Step 5: compute N0
-	 * NOTE: Step 4 is skipped because T has already been computed
+	 * Collect parameters from state
 	 */
-	stat.N_0 = (double) 0.95 * n / 2.0;
+	n = state->tp.n;
 
 	/*
-	 * Step 6: compute N1
+	 * Steps 1 to 6: count the moduli of the DFT of the bitstream that are less than T, as N1
+	 *
+	 * With -D float, the conversion of the bits to +1 and -1, the FFT and the count are fused in single
+	 * precision by rfftf_count_below(), which counts the moduli close to T again in double precision,
+	 * so that N1 is the one of the double precision test.
 	 */
-	stat.N_1 = 0;
-	for (i = 0; i < n / 2; i++) {
-		if (m[i] < sqrt_log20_n) {
-			stat.N_1++;
+	if (state->dftFloat == true) {
+		if (state->fftf_work == NULL) {
+			err(41, __func__, "state->fftf_work is NULL");
+		}
+		if (state->fftf_work[thread_state->thread_id] == NULL) {
+			err(41, __func__, "state->fftf_work[%ld] is NULL", thread_state->thread_id);
 		}
+		stat.N_1 = rfftf_count_below(state->fftf_plan, state->epsilon[thread_state->thread_id],
+					     state->fftf_work[thread_state->thread_id], max_sq_below_T);
+	} else {
+		stat.N_1 = DiscreteFourierTransform_count(thread_state);
 	}
 
+	/*
+	 * Step 5: compute N0
+	 */
+	stat.N_0 = (double) 0.95 * n / 2.0;
+
 	/*
 	 * Step 7: compute the test statistic
 	 */
@@ -458,7 +657,7 @@ DiscreteFourierTransform_iterate(struct thread_state *thread_state)
 	if (state->resultstxtFlag == true) {
 		append_value(state->stats[test_num], &stat);
 	}
-	append_value(state->p_val[test_num], &p_value);
+	record_p_value(state, test_num, 0, p_value);
 
 	/*
 	 * Unlock mutex after making changes to the shared state
@@ -687,14 +886,14 @@ DiscreteFourierTransform_print(struct state *state)
 	 */
 	stats_txt = filePathName(state->subDir[test_num], "stats.txt");
 	dbg(DBG_HIGH, "about to open/truncate: %s", stats_txt);
-	stats = openTruncate(stats_txt);
+	stats = openPrintFile(state, stats_txt);
 
 	/*
 	 * Open results.txt file
 	 */
 	results_txt = filePathName(state->subDir[test_num], "results.txt");
 	dbg(DBG_HIGH, "about to open/truncate: %s", results_txt);
-	results = openTruncate(results_txt);
+	results = openPrintFile(state, results_txt);
 
 	/*
 	 * Write results.txt and stats.txt files
@@ -788,7 +987,7 @@ DiscreteFourierTransform_print(struct state *state)
 			 */
 			data_txt = filePathName(state->subDir[test_num], data_filename);
 			dbg(DBG_HIGH, "about to open/truncate: %s", data_txt);
-			data = openTruncate(data_txt);
+			data = openPrintFile(state, data_txt);
 
 			/*
 			 * Write this particular data*.txt filename
@@ -1002,11 +1201,8 @@ DiscreteFourierTransform_metric_print(struct state *state, long int sampleCount,
 void
 DiscreteFourierTransform_metrics(struct state *state)
 {
-	long int sampleCount;	// Number of bitstreams in which we will count p_values
-	long int toolow;	// p_values that were below alpha
-	double p_value;		// p_value iteration test result(s)
-	long int *freqPerBin;	// Uniformity frequency bins
-	long int i;
+	struct p_val_tally *tally;	// Uniformity and proportion counts of the p_values
+	long int sampleCount;	// Number of bitstreams in which we counted p_values
 	long int j;
 
 	/*
@@ -1025,20 +1221,16 @@ DiscreteFourierTransform_metrics(struct state *state)
 		    "metrics driver interface for %s[%d] called with state.partitionCount: %d < 0",
 		    state->testNames[test_num], test_num, state->partitionCount[test_num]);
 	}
-	if (state->p_val[test_num]->count != (state->tp.numOfBitStreams * state->partitionCount[test_num])) {
-		warn(__func__,
-		     "metrics driver interface for %s[%d] called with p_val length: %ld != bit streams: %ld",
-		     state->testNames[test_num], test_num, state->p_val[test_num]->count,
-		     state->tp.numOfBitStreams * state->partitionCount[test_num]);
-	}
 
 	/*
-	 * Allocate uniformity frequency bins
+	 * Tally the p_values, unless they were tallied as iterations completed
 	 */
-	freqPerBin = malloc(state->tp.uniformity_bins * sizeof(freqPerBin[0]));
-	if (freqPerBin == NULL) {
-		errp(46, __func__, "cannot malloc of %ld elements of %ld bytes each for freqPerBin",
-		     state->tp.uniformity_bins, sizeof(long int));
+	tally = get_p_val_tally(state, test_num);
+	if (tally->count != (state->tp.numOfBitStreams * state->partitionCount[test_num])) {
+		warn(__func__,
+		     "metrics driver interface for %s[%d] called with p_val length: %ld != bit streams: %ld",
+		     state->testNames[test_num], test_num, tally->count,
+		     state->tp.numOfBitStreams * state->partitionCount[test_num]);
 	}
 
 	/*
@@ -1046,57 +1238,11 @@ DiscreteFourierTransform_metrics(struct state *state)
 	 */
 	for (j = 0; j < state->partitionCount[test_num]; ++j) {
 
-		/*
-		 * Set counters to zero
-		 */
-		toolow = 0;
-		sampleCount = 0;
-		memset(freqPerBin, 0, state->tp.uniformity_bins * sizeof(freqPerBin[0]));
-
-		/*
-		 * Tally p_value
-		 */
-		for (i = j; i < state->p_val[test_num]->count; i += state->partitionCount[test_num]) {
-
-			// Get the iteration p_value
-			p_value = get_value(state->p_val[test_num], double, i);
-			if (p_value == NON_P_VALUE) {
-				continue;	// the test was not possible for this iteration
-			}
-			// Case: random excursion test
-			if (state->is_excursion[test_num] == true) {
-				// Random excursion tests only sample > 0 p_values
-				if (p_value > 0.0) {
-					++sampleCount;
-				} else {
-					// Ignore p_value of 0 for random excursion tests
-					continue;
-				}
-			}
-			// Case: general (non-random excursion) test
-			else {
-				// All other tests count all p_values
-				++sampleCount;
-			}
-
-			// Count the number of p_values below alpha
-			if (p_value < state->tp.alpha) {
-				++toolow;
-			}
-			// Tally the p_value in a uniformity bin
-			if (p_value >= 1.0) {
-				++freqPerBin[state->tp.uniformity_bins - 1];
-			} else if (p_value >= 0.0) {
-				++freqPerBin[(int) floor(p_value * (double) state->tp.uniformity_bins)];
-			} else {
-				++freqPerBin[0];
-			}
-		}
-
 		/*
 		 * Print uniformity and proportional information for a tallied count
 		 */
-		DiscreteFourierTransform_metric_print(state, sampleCount, toolow, freqPerBin);
+		sampleCount = tally->sampleCount[j];
+		DiscreteFourierTransform_metric_print(state, sampleCount, tally->toolow[j], &tally->freqPerBin[j * tally->bins]);
 
 		/*
 		 * Track maximum samples
@@ -1112,12 +1258,6 @@ DiscreteFourierTransform_metrics(struct state *state)
 		}
 	}
 
-	/*
-	 * Free allocated storage
-	 */
-	free(freqPerBin);
-	freqPerBin = NULL;
-
 	return;
 }
 
@@ -1134,8 +1274,6 @@ DiscreteFourierTransform_metrics(struct state *state)
 void
 DiscreteFourierTransform_destroy(struct state *state)
 {
-	long int i;
-
 	/*
 	 * Check preconditions (firewall)
 	 */
@@ -1160,6 +1298,10 @@ DiscreteFourierTransform_destroy(struct state *state)
 		free(state->p_val[test_num]);
 		state->p_val[test_num] = NULL;
 	}
+	if (state->tally[test_num] != NULL) {
+		free_p_val_tally(state->tally[test_num]);
+		state->tally[test_num] = NULL;
+	}
 
 	/*
 	 * Free other test storage
@@ -1174,31 +1316,19 @@ DiscreteFourierTransform_destroy(struct state *state)
 	}
 
 
-	for (i = 0; i < state->numberOfThreads; i++) {
-		if (state->fft_X[i] != NULL) {
-			free(state->fft_X[i]);
-			state->fft_X[i] = NULL;
-		}
-#if defined(LEGACY_FFT)
-		if (state->fft_wsave[i] != NULL) {
-			free(state->fft_wsave[i]);
-			state->fft_wsave[i] = NULL;
-		}
-#else /* LEGACY_FFT */
-		if (state->fftw_out[i] != NULL) {
-			fftw_free(state->fftw_out[i]);
-			state->fftw_out[i] = NULL;
-		}
-		if (state->fftw_p[i] != NULL) {
-			fftw_destroy_plan(state->fftw_p[i]);
-			state->fftw_p[i] = NULL;
-		}
-#endif /* LEGACY_FFT */
-		if (state->fft_m[i] != NULL) {
-			free(state->fft_m[i]);
-			state->fft_m[i] = NULL;
-		}
+	if (state->fftf_work != NULL) {
+		free(state->fftf_work);
+		state->fftf_work = NULL;
+	}
+	rfftf_destroy(state->fftf_plan);
+	state->fftf_plan = NULL;
+
+#if !defined(LEGACY_FFT)
+	if (state->fftw_p != NULL) {
+		fftw_destroy_plan(state->fftw_p);
+		state->fftw_p = NULL;
 	}
+#endif /* LEGACY_FFT */
 
 	if (state->fft_X != NULL) {
 		free(state->fft_X);
@@ -1209,20 +1339,17 @@ DiscreteFourierTransform_destroy(struct state *state)
 		free(state->fft_wsave);
 		state->fft_wsave = NULL;
 	}
-#else /* LEGACY_FFT */
-	if (state->fftw_out != NULL) {
-		free(state->fftw_out);
-		state->fftw_out = NULL;
+	if (state->fft_wa != NULL) {
+		free(state->fft_wa);
+		state->fft_wa = NULL;
 	}
-	if (state->fftw_p != NULL) {
-		free(state->fftw_p);
-		state->fftw_p = NULL;
+	if (state->fft_ifac != NULL) {
+		free(state->fft_ifac);
+		state->fft_ifac = NULL;
 	}
+	rfft_destroy(state->fft_plan);
+	state->fft_plan = NULL;
 #endif /* LEGACY_FFT */
-	if (state->fft_m != NULL) {
-		free(state->fft_m);
-		state->fft_m = NULL;
-	}
 
 	return;
 }
@@ -36,7 +36,9 @@
 #include "../utils/externs.h"
 #include "../utils/cephes.h"
 #include "../utils/utilities.h"
+#include "../utils/stat_fncs.h"
 #include "../utils/debug.h"
+#include "../utils/arena.h"
 
 
 /*
@@ -49,6 +51,16 @@ struct LinearComplexity_private_stats {
 };
 
 
+/*
+ * Carry - partial results of a bit stream kept between its chunks by each thread
+ */
+struct LinearComplexity_carry {
+	long int v[K_LINEARCOMPLEXITY + 1];	// T range count of the blocks streamed so far
+	BitSequence *block;	// Bits streamed so far of a block that spans two chunks
+	long int bits;		// Number of bits in block
+};
+
+
 /*
  * Static const variables declarations
  */
@@ -65,6 +77,7 @@ static const double pi_term[K_LINEARCOMPLEXITY + 1] = { 0.01047, 0.03125, 0.1250
 /*
  * Forward static function declarations
  */
+static void count_block(struct thread_state *thread_state, const BitSequence *block, long int *v);
 static bool LinearComplexity_print_stat(FILE * stream, struct state *state, struct LinearComplexity_private_stats *stat,
 					double p_value);
 static bool LinearComplexity_print_p_value(FILE * stream, double p_value);
@@ -87,6 +100,7 @@ LinearComplexity_init(struct state *state)
 	long int n;		// Length of a single bit stream
 	long int M;		// Length of each block to be tested
 	long int N;		// Number of independent M-bit blocks the bit stream is partitioned into
+	struct LinearComplexity_carry *carry;	// Partial results of the bit streams of each thread
 	long int i;
 
 	/*
@@ -164,32 +178,39 @@ LinearComplexity_init(struct state *state)
 		     sizeof(*state->linear_t));
 	}
 	for (i = 0; i < state->numberOfThreads; i++) {
-		state->linear_b[i] = malloc(state->tp.linearComplexitySequenceLength * sizeof(state->linear_b[i][0]));
-		if (state->linear_b[i] == NULL) {
-			errp(100, __func__, "cannot malloc of %ld elements of %ld bytes each for state->linear_b[%ld]",
-			     state->tp.linearComplexitySequenceLength, sizeof(state->linear_b[i][0]), i);
-		}
-		state->linear_c[i] = malloc(state->tp.linearComplexitySequenceLength * sizeof(state->linear_c[i][0]));
-		if (state->linear_c[i] == NULL) {
-			errp(100, __func__, "cannot malloc of %ld elements of %ld bytes each for state->linear_c[%ld]",
-			     state->tp.linearComplexitySequenceLength, sizeof(state->linear_c[i][0]), i);
-		}
-		state->linear_t[i] = malloc(state->tp.linearComplexitySequenceLength * sizeof(state->linear_t[i][0]));
-		if (state->linear_t[i] == NULL) {
-			errp(100, __func__, "cannot malloc of %ld elements of %ld bytes each for state->linear_t[%ld]",
-			     state->tp.linearComplexitySequenceLength, sizeof(state->linear_t[i][0]), i);
-		}
+		arenaAlloc(state, i, test_num, "linear_b", state->tp.linearComplexitySequenceLength * sizeof(state->linear_b[i][0]),
+			   &state->linear_b[i]);
+		arenaAlloc(state, i, test_num, "linear_c", state->tp.linearComplexitySequenceLength * sizeof(state->linear_c[i][0]),
+			   &state->linear_c[i]);
+		arenaAlloc(state, i, test_num, "linear_t", state->tp.linearComplexitySequenceLength * sizeof(state->linear_t[i][0]),
+			   &state->linear_t[i]);
+	}
+
+	/*
+	 * Allocate the partial results kept by each thread between the chunks of a bit stream
+	 */
+	carry = calloc((size_t) state->numberOfThreads, sizeof(*carry));
+	if (carry == NULL) {
+		errp(100, __func__, "cannot calloc for streamCarry: %ld elements of %lu bytes each", state->numberOfThreads,
+		     sizeof(*carry));
 	}
+	for (i = 0; i < state->numberOfThreads; i++) {
+		arenaAlloc(state, i, test_num, "carry block", state->tp.linearComplexitySequenceLength * sizeof(carry[i].block[0]),
+			   &carry[i].block);
+	}
+	state->streamCarry[test_num] = carry;
 
 	/*
 	 * Allocate dynamic arrays
 	 */
 	if (state->resultstxtFlag == true) {
 		state->stats[test_num] = create_dyn_array(sizeof(struct LinearComplexity_private_stats),
-							  DEFAULT_CHUNK, state->tp.numOfBitStreams, false);        // stats.txt
+							  DEFAULT_CHUNK, retainedIterations(state), false);        // stats.txt
+	}
+	if (state->p_valTally == false) {
+		state->p_val[test_num] = create_dyn_array(sizeof(double),
+							  DEFAULT_CHUNK, retainedIterations(state), false);	// results.txt
 	}
-	state->p_val[test_num] = create_dyn_array(sizeof(double),
-						  DEFAULT_CHUNK, state->tp.numOfBitStreams, false);	// results.txt
 
 	/*
 	 * Determine format of data*.txt filenames based on state->partitionCount[test_num]
@@ -215,21 +236,51 @@ LinearComplexity_init(struct state *state)
  */
 void
 LinearComplexity_iterate(struct thread_state *thread_state)
+{
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (thread_state == NULL) {
+		err(101, __func__, "thread_state arg is NULL");
+	}
+	if (thread_state->global_state == NULL) {
+		err(101, __func__, "state arg is NULL");
+	}
+
+	/*
+	 * Stream the whole bit stream as a single chunk
+	 */
+	LinearComplexity_stream(thread_state, 0, thread_state->global_state->tp.n);
+
+	return;
+}
+
+
+/*
+ * LinearComplexity_stream - stream a chunk of a bit stream to the Linear Complexity test
+ *
+ * given:
+ *      thread_state    // current thread state
+ *      first           // index in the bit stream of the first bit of the chunk, 0 starts a new bit stream
+ *      count           // number of bits in the chunk, held by epsilon
+ *
+ * The chunks of a bit stream are streamed in order.  The iteration is recorded with the chunk
+ * that ends the bit stream.
+ *
+ * NOTE: The initialize function must be called before this function is called.
+ */
+void
+LinearComplexity_stream(struct thread_state *thread_state, long int first, long int count)
 {
 	struct LinearComplexity_private_stats stat;	// Stats for this iteration
 	long int M;		// Length of each block to be tested
 	long int n;		// Length of a single bit stream
 	long int N;		// Number of independent M-bit blocks the bit stream is partitioned into
-	long int d;		// Discrepancy for LFSR algorithm
-	long int L;		// Length of the minimal LFSR for the stream
-	long int m;		// Number of iterations since L was updated to 1 for the LFSR algorithm
-	double mean;		// Theoretical mean under an assumption of randomness
-	double T;		// Value used to identify the class v to increment
 	double p_value;		// p_value iteration test result(s)
-	double class;		// Boundary of the lowest v[i] given T[i]
+	struct LinearComplexity_carry *carry;	// Partial results of the bit stream of this thread
+	BitSequence *epsilon;	// Chunk of the bit stream
+	long int end;		// Number of bits of the chunk that are in one of the N blocks
 	long int i;
-	long int j;
-	long int k;
 
 	/*
 	 * Check preconditions (firewall)
@@ -269,6 +320,9 @@ LinearComplexity_iterate(struct thread_state *thread_state)
 	if (state->linear_t[thread_state->thread_id] == NULL) {
 		err(101, __func__, "state->linear_t[%ld] is NULL", thread_state->thread_id);
 	}
+	if (state->streamCarry[test_num] == NULL) {
+		err(101, __func__, "state->streamCarry[%d] is NULL", test_num);
+	}
 
 	/*
 	 * Collect parameters from state
@@ -276,106 +330,51 @@ LinearComplexity_iterate(struct thread_state *thread_state)
 	M = state->tp.linearComplexitySequenceLength;
 	n = state->tp.n;
 	N = n / M;
+	epsilon = state->epsilon[thread_state->thread_id];
+	carry = (struct LinearComplexity_carry *) state->streamCarry[test_num] + thread_state->thread_id;
 
 	/*
-	 * Zeroize the v counters
+	 * Zeroize the v counters when a new bit stream starts
 	 */
-	memset(stat.v, 0, sizeof(stat.v));
+	if (first == 0) {
+		memset(carry->v, 0, sizeof(carry->v));
+		carry->bits = 0;
+	}
 
 	/*
 	 * Step 1: partition the sequence into N independent blocks
 	 *
-	 * Step 2: for each block, we will determine the linear complexity using the version of the Berlekamp-Massey
-	 * algorithm specialized for the binary finite field F2. Explanation of the sub-steps: https://goo.gl/Um0YUr
+	 * Step 2: for each block, we will determine the linear complexity (see count_block)
+	 *
+	 * The blocks that are whole in the chunk are tested where they are, while the bits
+	 * of a block that spans two chunks are kept aside until the block is complete.
 	 */
-	for (i = 0; i < N; i++) {
-
-		/*
-		 * Sub-step 2: Zeroize the two arrays b and c and set b[0] and c[0] to 1
-		 */
-		memset(state->linear_b[thread_state->thread_id], 0, M * sizeof(state->linear_b[thread_state->thread_id][0]));
-		memset(state->linear_c[thread_state->thread_id], 0, M * sizeof(state->linear_c[thread_state->thread_id][0]));
-		state->linear_c[thread_state->thread_id][0] = 1;
-		state->linear_b[thread_state->thread_id][0] = 1;
-
-		/*
-		 * Sub-step 3: initialize L and m to their initial values
-		 */
-		L = 0;
-		m = -1;
-
-		/*
-		 * NOTE: j is the N of the algorithm instructions
-		 * 	 M is the n of the algorithm instructions
-		 */
-		for (j = 0; j < M; j++) {
-
-			/*
-			 * Sub-step 4a: set the discrepancy
-			 */
-			d = (int) state->epsilon[thread_state->thread_id][i * M + j];
-			for (k = 1; k <= L; k++) {
-				d += state->linear_c[thread_state->thread_id][k] *
-						state->epsilon[thread_state->thread_id][i * M + j - k];
-			}
-
-			d = d % 2;
-			if (d == 1) {
-
-				/*
-				 * Sub-step 4b: let t be a copy of c
-				 */
-				memcpy(state->linear_t[thread_state->thread_id], state->linear_c[thread_state->thread_id],
-				       M * sizeof(state->linear_t[thread_state->thread_id][0]));
-
-				/*
-				 * Sub-step 4c: update c array
-				 */
-				for (k = j - m; k < M; k++) {
-					state->linear_c[thread_state->thread_id][k] =
-							(BitSequence) ((state->linear_c[thread_state->thread_id][k] +
-									state->linear_b[thread_state->thread_id][k - j + m]) % 2);
-				}
-
-				/*
-				 * Sub-step 4d: update L, M and b
-				 */
-				if (L <= j / 2) {
-					L = j + 1 - L;
-					m = j;
-					memcpy(state->linear_b[thread_state->thread_id], state->linear_t[thread_state->thread_id],
-					       M * sizeof(state->linear_b[thread_state->thread_id][0]));
-				}
-			}
+	end = MIN(count, N * M - first);
+	i = 0;
+	if (carry->bits > 0 && end > 0) {
+		i = MIN(M - carry->bits, end);
+		memcpy(carry->block + carry->bits, epsilon, i * sizeof(epsilon[0]));
+		carry->bits += i;
+		if (carry->bits == M) {
+			count_block(thread_state, carry->block, carry->v);
+			carry->bits = 0;
 		}
+	}
+	for (; i + M <= end; i += M) {
+		count_block(thread_state, epsilon + i, carry->v);
+	}
+	if (i < end) {
+		memcpy(carry->block, epsilon + i, (end - i) * sizeof(epsilon[0]));
+		carry->bits = end - i;
+	}
 
-		/*
-		 * Step 3: calculate the theoretical mean
-		 * NOTE: the conditional operator is checking if (M + 1) is even or odd
-		 */
-		mean = (M / 2.0)
-		       + (((M + 1) % 2) ? 10 : 8) / 36.0
-		       - (M / 3.0 + 2.0 / 9.0) / (double ) (1 << M);
-
-		/*
-		 * Step 4: calculate a value of T
-		 * NOTE: the conditional operator is checking if M is even or odd
-		 */
-		T = ((M % 2) ? (mean - L) : (L - mean)) + 2.0 / 9.0;
-
-		/*
-		 * Step 5: record the T value in v
-		 * This code computes the classes dynamically, depending on K.
-		 */
-		class = (double) (K_LINEARCOMPLEXITY - 1) / 2.0;
-		if (T <= - class) {
-			stat.v[0]++;
-		} else if (T > class) {
-			stat.v[K_LINEARCOMPLEXITY]++;
-		} else {
-			stat.v[(int) ceil(T + class)]++;
-		}
+	/*
+	 * Wait for the rest of the bit stream
+	 */
+	if (first + count < n) {
+		return;
 	}
+	memcpy(stat.v, carry->v, sizeof(stat.v));
 
 	/*
 	 * Step 6: compute the test statistic
@@ -428,7 +427,7 @@ LinearComplexity_iterate(struct thread_state *thread_state)
 	if (state->resultstxtFlag == true) {
 		append_value(state->stats[test_num], &stat);
 	}
-	append_value(state->p_val[test_num], &p_value);
+	record_p_value(state, test_num, 0, p_value);
 
 	/*
 	 * Unlock mutex after making changes to the shared state
@@ -441,6 +440,126 @@ LinearComplexity_iterate(struct thread_state *thread_state)
 }
 
 
+/*
+ * count_block - determine the linear complexity of a block and count its T range
+ *
+ * given:
+ *      thread_state    // current thread state
+ *      block           // block of M bits
+ *      v               // T range count to update
+ *
+ * This auxiliary function uses the version of the Berlekamp-Massey algorithm
+ * specialized for the binary finite field F2. Explanation of the sub-steps: https://goo.gl/Um0YUr
+ */
+static void
+count_block(struct thread_state *thread_state, const BitSequence *block, long int *v)
+{
+	struct state *state;	// Run state to test under
+	long int M;		// Length of each block to be tested
+	long int d;		// Discrepancy for LFSR algorithm
+	long int L;		// Length of the minimal LFSR for the stream
+	long int m;		// Number of iterations since L was updated to 1 for the LFSR algorithm
+	double mean;		// Theoretical mean under an assumption of randomness
+	double T;		// Value used to identify the class v to increment
+	double class;		// Boundary of the lowest v[i] given T[i]
+	long int j;
+	long int k;
+
+	/*
+	 * Collect parameters from state
+	 */
+	state = thread_state->global_state;
+	M = state->tp.linearComplexitySequenceLength;
+
+	/*
+	 * Sub-step 2: Zeroize the two arrays b and c and set b[0] and c[0] to 1
+	 */
+	memset(state->linear_b[thread_state->thread_id], 0, M * sizeof(state->linear_b[thread_state->thread_id][0]));
+	memset(state->linear_c[thread_state->thread_id], 0, M * sizeof(state->linear_c[thread_state->thread_id][0]));
+	state->linear_c[thread_state->thread_id][0] = 1;
+	state->linear_b[thread_state->thread_id][0] = 1;
+
+	/*
+	 * Sub-step 3: initialize L and m to their initial values
+	 */
+	L = 0;
+	m = -1;
+
+	/*
+	 * NOTE: j is the N of the algorithm instructions
+	 * 	 M is the n of the algorithm instructions
+	 */
+	for (j = 0; j < M; j++) {
+
+		/*
+		 * Sub-step 4a: set the discrepancy
+		 */
+		d = (int) block[j];
+		for (k = 1; k <= L; k++) {
+			d += state->linear_c[thread_state->thread_id][k] * block[j - k];
+		}
+
+		d = d % 2;
+		if (d == 1) {
+
+			/*
+			 * Sub-step 4b: let t be a copy of c
+			 */
+			memcpy(state->linear_t[thread_state->thread_id], state->linear_c[thread_state->thread_id],
+			       M * sizeof(state->linear_t[thread_state->thread_id][0]));
+
+			/*
+			 * Sub-step 4c: update c array
+			 */
+			for (k = j - m; k < M; k++) {
+				state->linear_c[thread_state->thread_id][k] =
+						(BitSequence) ((state->linear_c[thread_state->thread_id][k] +
+								state->linear_b[thread_state->thread_id][k - j + m]) % 2);
+			}
+
+			/*
+			 * Sub-step 4d: update L, M and b
+			 */
+			if (L <= j / 2) {
+				L = j + 1 - L;
+				m = j;
+				memcpy(state->linear_b[thread_state->thread_id], state->linear_t[thread_state->thread_id],
+				       M * sizeof(state->linear_b[thread_state->thread_id][0]));
+			}
+		}
+	}
+
+	/*
+	 * Step 3: calculate the theoretical mean
+	 * NOTE: the conditional operator is checking if (M + 1) is even or odd
+	 */
+	mean = (M / 2.0)
+	       + (((M + 1) % 2) ? 10 : 8) / 36.0
+	       - (M / 3.0 + 2.0 / 9.0) / (double ) (1 << M);
+
+	/*
+	 * Step 4: calculate a value of T
+	 * NOTE: the conditional operator is checking if M is even or odd
+	 */
+	T = ((M % 2) ? (mean - L) : (L - mean)) + 2.0 / 9.0;
+
+	/*
+	 * Step 5: record the T value in v
+	 * This code computes the classes dynamically, depending on K.
+	 */
+	class = (double) (K_LINEARCOMPLEXITY - 1) / 2.0;
+	if (T <= - class) {
+		v[0]++;
+	} else if (T > class) {
+		v[K_LINEARCOMPLEXITY]++;
+	} else {
+		v[(int) ceil(T + class)]++;
+	}
+
+	return;
+}
+
+
 /*
  * LinearComplexity_print_stat - print private_stats information to the end of an open file
  *
@@ -722,14 +841,14 @@ LinearComplexity_print(struct state *state)
 	 */
 	stats_txt = filePathName(state->subDir[test_num], "stats.txt");
 	dbg(DBG_HIGH, "about to open/truncate: %s", stats_txt);
-	stats = openTruncate(stats_txt);
+	stats = openPrintFile(state, stats_txt);
 
 	/*
 	 * Open results.txt file
 	 */
 	results_txt = filePathName(state->subDir[test_num], "results.txt");
 	dbg(DBG_HIGH, "about to open/truncate: %s", results_txt);
-	results = openTruncate(results_txt);
+	results = openPrintFile(state, results_txt);
 
 	/*
 	 * Write results.txt and stats.txt files
@@ -819,7 +938,7 @@ LinearComplexity_print(struct state *state)
 			 */
 			data_txt = filePathName(state->subDir[test_num], data_filename);
 			dbg(DBG_HIGH, "about to open/truncate: %s", data_txt);
-			data = openTruncate(data_txt);
+			data = openPrintFile(state, data_txt);
 
 			/*
 			 * Write this particular data*.txt filename
@@ -1033,11 +1152,8 @@ LinearComplexity_metric_print(struct state *state, long int sampleCount, long in
 void
 LinearComplexity_metrics(struct state *state)
 {
-	long int sampleCount;	// Number of bitstreams in which we will count p_values
-	long int toolow;	// p_values that were below alpha
-	double p_value;		// p_value iteration test result(s)
-	long int *freqPerBin;	// Uniformity frequency bins
-	long int i;
+	struct p_val_tally *tally;	// Uniformity and proportion counts of the p_values
+	long int sampleCount;	// Number of bitstreams in which we counted p_values
 	long int j;
 
 	/*
@@ -1056,20 +1172,16 @@ LinearComplexity_metrics(struct state *state)
 		    "metrics driver interface for %s[%d] called with state.partitionCount: %d < 0",
 		    state->testNames[test_num], test_num, state->partitionCount[test_num]);
 	}
-	if (state->p_val[test_num]->count != (state->tp.numOfBitStreams * state->partitionCount[test_num])) {
-		warn(__func__,
-		     "metrics driver interface for %s[%d] called with p_val length: %ld != bit streams: %ld",
-		     state->testNames[test_num], test_num, state->p_val[test_num]->count,
-		     state->tp.numOfBitStreams * state->partitionCount[test_num]);
-	}
 
 	/*
-	 * Allocate uniformity frequency bins
+	 * Tally the p_values, unless they were tallied as iterations completed
 	 */
-	freqPerBin = malloc(state->tp.uniformity_bins * sizeof(freqPerBin[0]));
-	if (freqPerBin == NULL) {
-		errp(106, __func__, "cannot malloc of %ld elements of %ld bytes each for freqPerBin",
-		     state->tp.uniformity_bins, sizeof(long int));
+	tally = get_p_val_tally(state, test_num);
+	if (tally->count != (state->tp.numOfBitStreams * state->partitionCount[test_num])) {
+		warn(__func__,
+		     "metrics driver interface for %s[%d] called with p_val length: %ld != bit streams: %ld",
+		     state->testNames[test_num], test_num, tally->count,
+		     state->tp.numOfBitStreams * state->partitionCount[test_num]);
 	}
 
 	/*
@@ -1077,57 +1189,11 @@ LinearComplexity_metrics(struct state *state)
 	 */
 	for (j = 0; j < state->partitionCount[test_num]; ++j) {
 
-		/*
-		 * Set counters to zero
-		 */
-		toolow = 0;
-		sampleCount = 0;
-		memset(freqPerBin, 0, state->tp.uniformity_bins * sizeof(freqPerBin[0]));
-
-		/*
-		 * Tally p_value
-		 */
-		for (i = j; i < state->p_val[test_num]->count; i += state->partitionCount[test_num]) {
-
-			// Get the iteration p_value
-			p_value = get_value(state->p_val[test_num], double, i);
-			if (p_value == NON_P_VALUE) {
-				continue;	// the test was not possible for this iteration
-			}
-			// Case: random excursion test
-			if (state->is_excursion[test_num] == true) {
-				// Random excursion tests only sample > 0 p_values
-				if (p_value > 0.0) {
-					++sampleCount;
-				} else {
-					// Ignore p_value of 0 for random excursion tests
-					continue;
-				}
-			}
-			// Case: general (non-random excursion) test
-			else {
-				// All other tests count all p_values
-				++sampleCount;
-			}
-
-			// Count the number of p_values below alpha
-			if (p_value < state->tp.alpha) {
-				++toolow;
-			}
-			// Tally the p_value in a uniformity bin
-			if (p_value >= 1.0) {
-				++freqPerBin[state->tp.uniformity_bins - 1];
-			} else if (p_value >= 0.0) {
-				++freqPerBin[(int) floor(p_value * (double) state->tp.uniformity_bins)];
-			} else {
-				++freqPerBin[0];
-			}
-		}
-
 		/*
 		 * Print uniformity and proportional information for a tallied count
 		 */
-		LinearComplexity_metric_print(state, sampleCount, toolow, freqPerBin);
+		sampleCount = tally->sampleCount[j];
+		LinearComplexity_metric_print(state, sampleCount, tally->toolow[j], &tally->freqPerBin[j * tally->bins]);
 
 		/*
 		 * Track maximum samples
@@ -1143,12 +1209,6 @@ LinearComplexity_metrics(struct state *state)
 		}
 	}
 
-	/*
-	 * Free allocated storage
-	 */
-	free(freqPerBin);
-	freqPerBin = NULL;
-
 	return;
 }
 
@@ -1165,7 +1225,7 @@ LinearComplexity_metrics(struct state *state)
 void
 LinearComplexity_destroy(struct state *state)
 {
-	long int i;
+	struct LinearComplexity_carry *carry;	// Partial results of the bit streams of each thread
 
 	/*
 	 * Check preconditions (firewall)
@@ -1191,10 +1251,19 @@ LinearComplexity_destroy(struct state *state)
 		free(state->p_val[test_num]);
 		state->p_val[test_num] = NULL;
 	}
+	if (state->tally[test_num] != NULL) {
+		free_p_val_tally(state->tally[test_num]);
+		state->tally[test_num] = NULL;
+	}
 
 	/*
 	 * Free other test storage
 	 */
+	carry = state->streamCarry[test_num];
+	if (carry != NULL) {
+		free(carry);
+		state->streamCarry[test_num] = NULL;
+	}
 	if (state->datatxt_fmt[test_num] != NULL) {
 		free(state->datatxt_fmt[test_num]);
 		state->datatxt_fmt[test_num] = NULL;
@@ -1204,21 +1273,6 @@ LinearComplexity_destroy(struct state *state)
 		state->subDir[test_num] = NULL;
 	}
 
-	for (i = 0; i < state->numberOfThreads; i++) {
-		if (state->linear_b[i] != NULL) {
-			free(state->linear_b[i]);
-			state->linear_b[i] = NULL;
-		}
-		if (state->linear_c[i] != NULL) {
-			free(state->linear_c[i]);
-			state->linear_c[i] = NULL;
-		}
-		if (state->linear_t[i] != NULL) {
-			free(state->linear_t[i]);
-			state->linear_t[i] = NULL;
-		}
-	}
-
 	if (state->linear_b != NULL) {
 		free(state->linear_b);
 		state->linear_b = NULL;
@@ -36,6 +36,7 @@
 #include "../utils/externs.h"
 #include "../utils/cephes.h"
 #include "../utils/utilities.h"
+#include "../utils/stat_fncs.h"
 #include "../utils/debug.h"
 
 
@@ -60,6 +61,16 @@ struct LongestRunOfOnes_private_stats {
 };
 
 
+/*
+ * Carry - partial results of a bit stream kept between its chunks by each thread
+ */
+struct LongestRunOfOnes_carry {
+	struct LongestRunOfOnes_private_stats stat;	// Stats of the blocks streamed so far
+	long int v_obs;		// Maximum run length so far of the block being streamed
+	long int run;		// Length of the run of ones that ends the bits streamed so far
+};
+
+
 /*
  * Static const variables declarations
  */
@@ -278,10 +289,12 @@ LongestRunOfOnes_init(struct state *state)
 	 */
 	if (state->resultstxtFlag == true) {
 		state->stats[test_num] = create_dyn_array(sizeof(struct LongestRunOfOnes_private_stats),
-							  DEFAULT_CHUNK, state->tp.numOfBitStreams, false);        // stats.txt
+							  DEFAULT_CHUNK, retainedIterations(state), false);        // stats.txt
+	}
+	if (state->p_valTally == false) {
+		state->p_val[test_num] = create_dyn_array(sizeof(double),
+							  DEFAULT_CHUNK, retainedIterations(state), false);	// results.txt
 	}
-	state->p_val[test_num] = create_dyn_array(sizeof(double),
-						  DEFAULT_CHUNK, state->tp.numOfBitStreams, false);	// results.txt
 
 	/*
 	 * Determine format of data*.txt filenames based on state->partitionCount[test_num]
@@ -291,6 +304,15 @@ LongestRunOfOnes_init(struct state *state)
 	dbg(DBG_HIGH, "%s[%d] will form data*.txt filenames with the following format: %s",
 	    state->testNames[test_num], test_num, state->datatxt_fmt[test_num]);
 
+	/*
+	 * Allocate the partial results kept by each thread between the chunks of a bit stream
+	 */
+	state->streamCarry[test_num] = calloc((size_t) state->numberOfThreads, sizeof(struct LongestRunOfOnes_carry));
+	if (state->streamCarry[test_num] == NULL) {
+		errp(110, __func__, "cannot calloc for streamCarry: %ld elements of %lu bytes each", state->numberOfThreads,
+		     sizeof(struct LongestRunOfOnes_carry));
+	}
+
 	return;
 }
 
@@ -307,6 +329,41 @@ LongestRunOfOnes_init(struct state *state)
  */
 void
 LongestRunOfOnes_iterate(struct thread_state *thread_state)
+{
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (thread_state == NULL) {
+		err(111, __func__, "thread_state arg is NULL");
+	}
+	if (thread_state->global_state == NULL) {
+		err(111, __func__, "state arg is NULL");
+	}
+
+	/*
+	 * Stream the whole bit stream as a single chunk
+	 */
+	LongestRunOfOnes_stream(thread_state, 0, thread_state->global_state->tp.n);
+
+	return;
+}
+
+
+/*
+ * LongestRunOfOnes_stream - stream a chunk of a bit stream to the Longest Run of Ones test
+ *
+ * given:
+ *      thread_state    // current thread state
+ *      first           // index in the bit stream of the first bit of the chunk, 0 starts a new bit stream
+ *      count           // number of bits in the chunk, held by epsilon
+ *
+ * The chunks of a bit stream are streamed in order.  The iteration is recorded with the chunk
+ * that ends the bit stream.
+ *
+ * NOTE: The initialize function must be called before this function is called.
+ */
+void
+LongestRunOfOnes_stream(struct thread_state *thread_state, long int first, long int count)
 {
 	struct LongestRunOfOnes_private_stats stat;	// Stats for this iteration
 	const double *pi_term;	// Theoretical probabilities (see runs_table struct above)
@@ -317,6 +374,9 @@ LongestRunOfOnes_iterate(struct thread_state *thread_state)
 	long int v_obs;		// Current maximum run length for current block
 	double chi_term;	// Term for the statistic formula: chi^2 = chi_term * chi_term
 	long int run;		// Counter used to find longest run of ones
+	struct LongestRunOfOnes_carry *carry;	// Partial results of the bit stream of this thread
+	BitSequence *epsilon;	// Chunk of the bit stream
+	long int end;		// Number of bits of the chunk that are in one of the N blocks
 	long int i;
 	long int j;
 
@@ -340,51 +400,67 @@ LongestRunOfOnes_iterate(struct thread_state *thread_state)
 	if (state->epsilon[thread_state->thread_id] == NULL) {
 		err(111, __func__, "state->epsilon[%ld] is NULL", thread_state->thread_id);
 	}
+	if (state->streamCarry[test_num] == NULL) {
+		err(111, __func__, "state->streamCarry[%d] is NULL", test_num);
+	}
 
 	/*
 	 * Collect parameters from state
 	 */
 	n = state->tp.n;
+	epsilon = state->epsilon[thread_state->thread_id];
+	carry = (struct LongestRunOfOnes_carry *) state->streamCarry[test_num] + thread_state->thread_id;
 
 	/*
-	 * Find the appropriate runs_table entry that first satisfies the min_n requirement
+	 * Start a new bit stream
 	 */
-	stat.runs_table_index = 0;
-	while ((stat.runs_table_index < (sizeof(runs_table) / sizeof(runs_table[0]))) &&
-	       (n > runs_table[stat.runs_table_index].min_n)) {
-		++stat.runs_table_index;
-	}
-	if (stat.runs_table_index >= (sizeof(runs_table) / sizeof(runs_table[0]))) {
-		// ran off end of table, use the last table entry
-		stat.runs_table_index = (sizeof(runs_table) / sizeof(runs_table[0])) - 1;
+	if (first == 0) {
+
+		/*
+		 * Find the appropriate runs_table entry that first satisfies the min_n requirement
+		 */
+		carry->stat.runs_table_index = 0;
+		while ((carry->stat.runs_table_index < (sizeof(runs_table) / sizeof(runs_table[0]))) &&
+		       (n > runs_table[carry->stat.runs_table_index].min_n)) {
+			++carry->stat.runs_table_index;
+		}
+		if (carry->stat.runs_table_index >= (sizeof(runs_table) / sizeof(runs_table[0]))) {
+			// ran off end of table, use the last table entry
+			carry->stat.runs_table_index = (sizeof(runs_table) / sizeof(runs_table[0])) - 1;
+		}
+		carry->stat.M = runs_table[carry->stat.runs_table_index].M;
+		carry->stat.N = n / carry->stat.M;
+
+		/*
+		 * Clear counters
+		 */
+		memset(carry->stat.count, 0, sizeof(carry->stat.count));
+		carry->v_obs = 0;
+		carry->run = 0;
 	}
 
 	/*
 	 * Setup test parameters
 	 */
-	stat.M = runs_table[stat.runs_table_index].M;
+	stat = carry->stat;
 	pi_term = runs_table[stat.runs_table_index].pi_term;
 	min_class = runs_table[stat.runs_table_index].min_class;
 	max_class = runs_table[stat.runs_table_index].max_class;
-	stat.N = n / stat.M;
 
 	/*
-	 * Clear counters
+	 * Step 1: partition the sequence into N independent M-bit blocks, ignoring the bits after the last block
 	 */
-	memset(stat.count, 0, sizeof(stat.count));
-
-	/*
-	 * Step 1: partition the sequence into N independent M-bit blocks
-	 */
-	for (i = 0; i < stat.N; i++) {
+	v_obs = carry->v_obs;
+	run = carry->run;
+	end = MIN(count, stat.N * stat.M - first);
+	for (i = 0; i < end;) {
 
 		/*
 		 * Step 2a: determine maximum 1-bit run length for this block
 		 */
-		v_obs = 0;
-		run = 0;
-		for (j = 0; j < stat.M; j++) {
-			if (state->epsilon[thread_state->thread_id][(i * stat.M) + j] == 1) {
+		j = MIN(end, i + stat.M - (first + i) % stat.M);
+		for (; i < j; i++) {
+			if (epsilon[i] == 1) {
 				run++;
 				if (run > v_obs) {
 					v_obs = run;
@@ -393,6 +469,9 @@ LongestRunOfOnes_iterate(struct thread_state *thread_state)
 				run = 0;
 			}
 		}
+		if ((first + i) % stat.M != 0) {
+			break;	// The block goes on in the next chunk
+		}
 
 		/*
 		 * Step 2b: count the class based on the current run length
@@ -404,6 +483,18 @@ LongestRunOfOnes_iterate(struct thread_state *thread_state)
 		} else {
 			stat.count[CLASS_COUNT_LONGEST_RUN]++;
 		}
+		v_obs = 0;
+		run = 0;
+	}
+	carry->stat = stat;
+	carry->v_obs = v_obs;
+	carry->run = run;
+
+	/*
+	 * Wait for the rest of the bit stream
+	 */
+	if (first + count < n) {
+		return;
 	}
 
 	/*
@@ -458,7 +549,7 @@ LongestRunOfOnes_iterate(struct thread_state *thread_state)
 	if (state->resultstxtFlag == true) {
 		append_value(state->stats[test_num], &stat);
 	}
-	append_value(state->p_val[test_num], &p_value);
+	record_p_value(state, test_num, 0, p_value);
 
 	/*
 	 * Unlock mutex after making changes to the shared state
@@ -859,14 +950,14 @@ LongestRunOfOnes_print(struct state *state)
 	 */
 	stats_txt = filePathName(state->subDir[test_num], "stats.txt");
 	dbg(DBG_HIGH, "about to open/truncate: %s", stats_txt);
-	stats = openTruncate(stats_txt);
+	stats = openPrintFile(state, stats_txt);
 
 	/*
 	 * Open results.txt file
 	 */
 	results_txt = filePathName(state->subDir[test_num], "results.txt");
 	dbg(DBG_HIGH, "about to open/truncate: %s", results_txt);
-	results = openTruncate(results_txt);
+	results = openPrintFile(state, results_txt);
 
 	/*
 	 * Write results.txt and stats.txt files
@@ -956,7 +1047,7 @@ LongestRunOfOnes_print(struct state *state)
 			 */
 			data_txt = filePathName(state->subDir[test_num], data_filename);
 			dbg(DBG_HIGH, "about to open/truncate: %s", data_txt);
-			data = openTruncate(data_txt);
+			data = openPrintFile(state, data_txt);
 
 			/*
 			 * Write this particular data*.txt filename
@@ -1170,11 +1261,8 @@ LongestRunOfOnes_metric_print(struct state *state, long int sampleCount, long in
 void
 LongestRunOfOnes_metrics(struct state *state)
 {
-	long int sampleCount;	// Number of bitstreams in which we will count p_values
-	long int toolow;	// p_values that were below alpha
-	double p_value;		// p_value iteration test result(s)
-	long int *freqPerBin;	// Uniformity frequency bins
-	long int i;
+	struct p_val_tally *tally;	// Uniformity and proportion counts of the p_values
+	long int sampleCount;	// Number of bitstreams in which we counted p_values
 	long int j;
 
 	/*
@@ -1193,20 +1281,16 @@ LongestRunOfOnes_metrics(struct state *state)
 		    "metrics driver interface for %s[%d] called with state.partitionCount: %d < 0",
 		    state->testNames[test_num], test_num, state->partitionCount[test_num]);
 	}
-	if (state->p_val[test_num]->count != (state->tp.numOfBitStreams * state->partitionCount[test_num])) {
-		warn(__func__,
-		     "metrics driver interface for %s[%d] called with p_val length: %ld != bit streams: %ld",
-		     state->testNames[test_num], test_num, state->p_val[test_num]->count,
-		     state->tp.numOfBitStreams * state->partitionCount[test_num]);
-	}
 
 	/*
-	 * Allocate uniformity frequency bins
+	 * Tally the p_values, unless they were tallied as iterations completed
 	 */
-	freqPerBin = malloc(state->tp.uniformity_bins * sizeof(freqPerBin[0]));
-	if (freqPerBin == NULL) {
-		errp(116, __func__, "cannot malloc of %ld elements of %ld bytes each for freqPerBin",
-		     state->tp.uniformity_bins, sizeof(long int));
+	tally = get_p_val_tally(state, test_num);
+	if (tally->count != (state->tp.numOfBitStreams * state->partitionCount[test_num])) {
+		warn(__func__,
+		     "metrics driver interface for %s[%d] called with p_val length: %ld != bit streams: %ld",
+		     state->testNames[test_num], test_num, tally->count,
+		     state->tp.numOfBitStreams * state->partitionCount[test_num]);
 	}
 
 	/*
@@ -1214,57 +1298,11 @@ LongestRunOfOnes_metrics(struct state *state)
 	 */
 	for (j = 0; j < state->partitionCount[test_num]; ++j) {
 
-		/*
-		 * Set counters to zero
-		 */
-		toolow = 0;
-		sampleCount = 0;
-		memset(freqPerBin, 0, state->tp.uniformity_bins * sizeof(freqPerBin[0]));
-
-		/*
-		 * Tally p_value
-		 */
-		for (i = j; i < state->p_val[test_num]->count; i += state->partitionCount[test_num]) {
-
-			// Get the iteration p_value
-			p_value = get_value(state->p_val[test_num], double, i);
-			if (p_value == NON_P_VALUE) {
-				continue;	// the test was not possible for this iteration
-			}
-			// Case: random excursion test
-			if (state->is_excursion[test_num] == true) {
-				// Random excursion tests only sample > 0 p_values
-				if (p_value > 0.0) {
-					++sampleCount;
-				} else {
-					// Ignore p_value of 0 for random excursion tests
-					continue;
-				}
-			}
-			// Case: general (non-random excursion) test
-			else {
-				// All other tests count all p_values
-				++sampleCount;
-			}
-
-			// Count the number of p_values below alpha
-			if (p_value < state->tp.alpha) {
-				++toolow;
-			}
-			// Tally the p_value in a uniformity bin
-			if (p_value >= 1.0) {
-				++freqPerBin[state->tp.uniformity_bins - 1];
-			} else if (p_value >= 0.0) {
-				++freqPerBin[(int) floor(p_value * (double) state->tp.uniformity_bins)];
-			} else {
-				++freqPerBin[0];
-			}
-		}
-
 		/*
 		 * Print uniformity and proportional information for a tallied count
 		 */
-		LongestRunOfOnes_metric_print(state, sampleCount, toolow, freqPerBin);
+		sampleCount = tally->sampleCount[j];
+		LongestRunOfOnes_metric_print(state, sampleCount, tally->toolow[j], &tally->freqPerBin[j * tally->bins]);
 
 		/*
 		 * Track maximum samples
@@ -1280,12 +1318,6 @@ LongestRunOfOnes_metrics(struct state *state)
 		}
 	}
 
-	/*
-	 * Free allocated storage
-	 */
-	free(freqPerBin);
-	freqPerBin = NULL;
-
 	return;
 }
 
@@ -1326,10 +1358,18 @@ LongestRunOfOnes_destroy(struct state *state)
 		free(state->p_val[test_num]);
 		state->p_val[test_num] = NULL;
 	}
+	if (state->tally[test_num] != NULL) {
+		free_p_val_tally(state->tally[test_num]);
+		state->tally[test_num] = NULL;
+	}
 
 	/*
 	 * Free other test storage
 	 */
+	if (state->streamCarry[test_num] != NULL) {
+		free(state->streamCarry[test_num]);
+		state->streamCarry[test_num] = NULL;
+	}
 	if (state->datatxt_fmt[test_num] != NULL) {
 		free(state->datatxt_fmt[test_num]);
 		state->datatxt_fmt[test_num] = NULL;
@@ -35,17 +35,33 @@
 #include <errno.h>
 #include "../utils/externs.h"
 #include "../utils/utilities.h"
+#include "../utils/stat_fncs.h"
 #include "../utils/cephes.h"
 #include "../utils/debug.h"
+#include "../utils/arena.h"
 
 
 /*
  * Private stats - stats.txt information for this test
+ *
+ * Each element of stats[test_num] holds one iteration, followed by the stats of each of its templates.
+ * Elements are statsSize() octets long, so they must be located with iterationStats().
  */
 struct NonOverlappingTemplateMatchings_private_stats {
 	double mu;		// Theoretical mean under an assumption of randomness
 	double sigma_squared;	// Theoretical variance under an assumption of randomness
 	long int M;		// Length of the blocks to be tested
+	struct nonover_stats templates[];	// Stats of each template of the iteration
+};
+
+
+/*
+ * Carry - partial results of a bit stream kept between its chunks by each thread
+ */
+struct NonOverlappingTemplateMatchings_carry {
+	struct NonOverlappingTemplateMatchings_private_stats *stat;	// Stats of the bit stream being streamed
+	long int *next;		// Index in the bit stream where the next occurrence of each template may start
+	unsigned long word;	// Last m bits streamed, the last one being the lowest bit
 };
 
 
@@ -54,6 +70,11 @@ struct NonOverlappingTemplateMatchings_private_stats {
  */
 static const enum test test_num = TEST_NON_OVERLAPPING;	// This test number
 
+/*
+ * cephes_igamc() of the BLOCKS_NON_OVERLAPPING degrees of freedom of the test, set up by the initialize function
+ */
+static struct cephes_igamc_a igamc_blocks;
+
 /*
  * Expected number of non-overlapping templates for each possible template length
  *
@@ -162,9 +183,11 @@ static const long int numOfTemplates[MAXTEMPLEN + 1] = {
  * Forward static function declarations
  */
 static void appendTemplate(struct state *state, ULONG value, long int m);
+static size_t statsSize(struct state *state);
+static struct NonOverlappingTemplateMatchings_private_stats *iterationStats(struct dyn_array *stats, long int index);
 static bool NonOverlappingTemplateMatchings_print_stat(FILE * stream, struct state *state,
 						       struct NonOverlappingTemplateMatchings_private_stats *stat,
-						       struct dyn_array *nonover_stats, long int nonstat_index);
+						       struct dyn_array *p_val, long int p_val_index);
 static bool NonOverlappingTemplateMatchings_print_p_value(FILE * stream, double p_value);
 static void NonOverlappingTemplateMatchings_metric_print(struct state *state, long int sampleCount, long int toolow,
 							 long int *freqPerBin);
@@ -186,7 +209,11 @@ NonOverlappingTemplateMatchings_init(struct state *state)
 	long int M;		// Length of each block to be tested
 	long int m;		// Length of a template
 	ULONG max_num;		// Max decimal value of a template
+	struct NonOverlappingTemplateMatchings_carry *carry;	// Partial results of the bit streams of each thread
+	ULONG word;		// m-bit word of a template
 	ULONG i;
+	long int jj;
+	long int k;
 
 	/*
 	 * Check preconditions (firewall)
@@ -245,20 +272,29 @@ NonOverlappingTemplateMatchings_init(struct state *state)
 	}
 
 	/*
-	 * Allocate special BitSequence
+	 * Allocate the partial results kept by each thread between the chunks of a bit stream
 	 */
-	state->nonper_seq = malloc((size_t) state->numberOfThreads * sizeof(*state->nonper_seq));
-	if (state->nonper_seq == NULL) {
-		errp(130, __func__, "cannot malloc for nonper_seq: %ld elements of %lu bytes each", state->numberOfThreads,
-		     sizeof(*state->nonper_seq));
+	carry = calloc((size_t) state->numberOfThreads, sizeof(*carry));
+	if (carry == NULL) {
+		errp(130, __func__, "cannot calloc for streamCarry: %ld elements of %lu bytes each", state->numberOfThreads,
+		     sizeof(*carry));
 	}
 	for (i = 0; i < state->numberOfThreads; i++) {
-		state->nonper_seq[i] = malloc(m * sizeof(state->nonper_seq[i][0]));
-		if (state->nonper_seq[i] == NULL) {
-			errp(130, __func__, "cannot malloc of %ld elements of %ld bytes each for state->nonper_seq[%ul]",
-			     m, sizeof(state->nonper_seq[i][0]), i);
-		}
+		arenaAlloc(state, i, test_num, "carry next", (size_t) numOfTemplates[m] * sizeof(carry[i].next[0]),
+			   &carry[i].next);
 	}
+	state->streamCarry[test_num] = carry;
+
+	/*
+	 * Reserve the stats and the p_values of an iteration in the scratch area of each thread
+	 */
+	arenaReserveScratch(state, test_num, "stat", statsSize(state));
+	arenaReserveScratch(state, test_num, "p_values", (size_t) numOfTemplates[m] * sizeof(double));
+
+	/*
+	 * Set up the p-value function, which is evaluated for each template of each iteration
+	 */
+	cephes_igamc_setup(&igamc_blocks, BLOCKS_NON_OVERLAPPING / 2.0);
 
 	/*
 	 * Set the proper partitionCount value for this test [there will be more data*.txt for each iteration]
@@ -269,14 +305,16 @@ NonOverlappingTemplateMatchings_init(struct state *state)
 	/*
 	 * Allocate dynamic arrays
 	 *
-	 * NonOverlapping Template Test uses array of struct nonover_stats instead of p_value doubles
+	 * The stats of each template are only kept for stats.txt, with the stats of their iteration
 	 */
 	if (state->resultstxtFlag == true) {
-		state->stats[test_num] = create_dyn_array(sizeof(struct NonOverlappingTemplateMatchings_private_stats),
-							  DEFAULT_CHUNK, state->tp.numOfBitStreams, false);        // stats.txt
+		state->stats[test_num] = create_dyn_array(statsSize(state),
+							  DEFAULT_CHUNK, retainedIterations(state), false);        // stats.txt
+	}
+	if (state->p_valTally == false) {
+		state->p_val[test_num] = create_dyn_array(sizeof(double), DEFAULT_CHUNK,
+							  numOfTemplates[m] * retainedIterations(state), false);	// results.txt
 	}
-	state->p_val[test_num] = create_dyn_array(sizeof(struct nonover_stats), DEFAULT_CHUNK,
-						  numOfTemplates[m] * state->tp.numOfBitStreams, false);	// results.txt
 
 	/*
 	 * Generate nonovTemplates - array of non-overlapping templates
@@ -307,6 +345,31 @@ NonOverlappingTemplateMatchings_init(struct state *state)
 	}
 	dbg(DBG_HIGH, "Formed an array of %ld non-overlapping templates of %ld bytes each", numOfTemplates[m], m);
 
+	/*
+	 * Index the templates by their m-bit word, the first bit of a template being the highest bit of its word
+	 */
+	state->nonovTemplateIndex = malloc((size_t) max_num * sizeof(state->nonovTemplateIndex[0]));
+	if (state->nonovTemplateIndex == NULL) {
+		errp(130, __func__, "cannot malloc of %lu elements of %lu bytes each for nonovTemplateIndex",
+		     max_num, sizeof(state->nonovTemplateIndex[0]));
+	}
+	for (i = 0; i < max_num; i++) {
+		state->nonovTemplateIndex[i] = -1;
+	}
+	for (jj = 0; jj < numOfTemplates[m]; jj++) {
+		word = 0;
+		for (k = 0; k < m; k++) {
+			word = (word << 1) | get_value(state->nonovTemplates, BitSequence, m * jj + k);
+		}
+		state->nonovTemplateIndex[word] = jj;
+	}
+
+	/*
+	 * List the templates and their index, shared by all threads, in the memory budget
+	 */
+	arenaShared(state, test_num, "templates", (size_t) (numOfTemplates[m] * m) * sizeof(BitSequence));
+	arenaShared(state, test_num, "template index", (size_t) max_num * sizeof(state->nonovTemplateIndex[0]));
+
 	/*
 	 * Determine format of data*.txt filenames based on state->partitionCount[test_num]
 	 */
@@ -405,6 +468,41 @@ appendTemplate(struct state *state, ULONG value, long int m)
 }
 
 
+/*
+ * statsSize - size of the stats of an iteration, including the stats of each of its templates
+ *
+ * given:
+ *      state           // run state to test under
+ *
+ * returns:
+ *      size of an element of stats[test_num], in octets
+ */
+static size_t
+statsSize(struct state *state)
+{
+	return sizeof(struct NonOverlappingTemplateMatchings_private_stats) +
+	       (size_t) numOfTemplates[state->tp.nonOverlappingTemplateLength] * sizeof(struct nonover_stats);
+}
+
+
+/*
+ * iterationStats - locate the stats of an iteration
+ *
+ * given:
+ *      stats           // dynamic array of the stats of the iterations
+ *      index           // index of the iteration in stats
+ *
+ * returns:
+ *      address of the stats of the iteration, followed by the stats of its templates
+ */
+static struct NonOverlappingTemplateMatchings_private_stats *
+iterationStats(struct dyn_array *stats, long int index)
+{
+	return (struct NonOverlappingTemplateMatchings_private_stats *)
+		((unsigned char *) stats->data + (size_t) index * stats->elm_size);
+}
+
+
 /*
  * NonOverlappingTemplateMatchings_iterate - iterate one bit stream for Nonoverlapping Template test
  *
@@ -418,17 +516,58 @@ appendTemplate(struct state *state, ULONG value, long int m)
 void
 NonOverlappingTemplateMatchings_iterate(struct thread_state *thread_state)
 {
-	struct NonOverlappingTemplateMatchings_private_stats stat;	// Stats for this iteration
-	struct nonover_stats *nonover_stats;	// Stats for a template of this iteration
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (thread_state == NULL) {
+		err(132, __func__, "thread_state arg is NULL");
+	}
+	if (thread_state->global_state == NULL) {
+		err(132, __func__, "state arg is NULL");
+	}
+
+	/*
+	 * Stream the whole bit stream as a single chunk
+	 */
+	NonOverlappingTemplateMatchings_stream(thread_state, 0, thread_state->global_state->tp.n);
+
+	return;
+}
+
+
+/*
+ * NonOverlappingTemplateMatchings_stream - stream a chunk of a bit stream to the Non-overlapping Template test
+ *
+ * given:
+ *      thread_state    // current thread state
+ *      first           // index in the bit stream of the first bit of the chunk, 0 starts a new bit stream
+ *      count           // number of bits in the chunk, held by epsilon
+ *
+ * The chunks of a bit stream are streamed in order.  The iteration is recorded with the chunk
+ * that ends the bit stream.
+ *
+ * NOTE: The initialize function must be called before this function is called.
+ */
+void
+NonOverlappingTemplateMatchings_stream(struct thread_state *thread_state, long int first, long int count)
+{
+	struct NonOverlappingTemplateMatchings_private_stats *stat;	// Stats for this iteration and each of its templates
+	struct nonover_stats *nonover_stat;	// Stats for a template of this iteration
+	double *p_values;			// p_value of each template of this iteration
 	long int n;				// Length of a single bit stream
 	long int m;				// NonOverlapping Template Test - block length
-	unsigned int W_obs;			// Counter of the number of occurrences of a template in a block
 	double chi2_term;			// Term used to compute chi squared
-	bool match;				// Indicator of a match of a template in a block
+	struct NonOverlappingTemplateMatchings_carry *carry;	// Partial results of the bit stream of this thread
+	BitSequence *epsilon;			// Chunk of the bit stream
+	long int *next;				// Index where the next occurrence of each template may start
+	unsigned long word;			// Last m bits streamed, the last one being the lowest bit
+	unsigned long mask;			// Lowest m bits
+	long int end;				// Number of bits of the chunk that are in one of the blocks
+	long int block;				// Block of the bits being streamed
+	long int start;				// Index in the bit stream where the window of the last m bits starts
 	long int i;
 	long int j;
 	long int jj;
-	long int k;
 
 	/*
 	 * Check preconditions (firewall)
@@ -454,11 +593,11 @@ NonOverlappingTemplateMatchings_iterate(struct thread_state *thread_state)
 	if (state->epsilon[thread_state->thread_id] == NULL) {
 		err(132, __func__, "state->epsilon[%ld] is NULL", thread_state->thread_id);
 	}
-	if (state->nonper_seq == NULL) {
-		err(132, __func__, "state->nonper_seq is NULL");
+	if (state->nonovTemplateIndex == NULL) {
+		err(132, __func__, "state->nonovTemplateIndex is NULL");
 	}
-	if (state->nonper_seq[thread_state->thread_id] == NULL) {
-		err(132, __func__, "state->nonper_seq[%ld] is NULL", thread_state->thread_id);
+	if (state->streamCarry[test_num] == NULL) {
+		err(132, __func__, "state->streamCarry[%d] is NULL", test_num);
 	}
 
 	/*
@@ -469,113 +608,119 @@ NonOverlappingTemplateMatchings_iterate(struct thread_state *thread_state)
 		err(132, __func__, "(m*2): %ld is too large, 1 << (m:%ld * 2) > %ld bits long", m * 2, m, BITS_N_LONGINT - 1);
 	}
 	n = state->tp.n;
-	stat.M = n / BLOCKS_NON_OVERLAPPING;
-
-	/*
-	 * Step 3: compute the theoretical mean mu and variance sigma_squared
-	 * NOTE: The presence of the term [ 2^(2m) == 1 << m * 2 ] is the reason why MAXTEMPLEN
-	 * 	 cannot be greater than 15 in architectures where long int is 32 bits.
-	 */
-	stat.mu = (stat.M - m + 1) / ((double) ((long int) 1 << m));
-	stat.sigma_squared = stat.M * (1.0 / ((double) ((long int) 1 << m)) - (2.0 * m - 1.0) / ((double) ((long int) 1 << m * 2)));
-
-	/*
-	 * Check preconditions (firewall)
-	 */
-	if (stat.sigma_squared < 0.0) {
-		err(132, __func__, "sigma_squared: %f < 0.0", stat.sigma_squared);
-	}
-	if (isNegative(stat.mu)) {
-		err(132, __func__, "aborting %s, mean(mu) < 0.0: %f", state->testNames[test_num], stat.mu);
-	}
-	if (isZero(stat.mu)) {
-		err(132, __func__, "aborting %s, mean(mu) == 0.0: %f", state->testNames[test_num], stat.mu);
-	}
+	epsilon = state->epsilon[thread_state->thread_id];
+	carry = (struct NonOverlappingTemplateMatchings_carry *) state->streamCarry[test_num] + thread_state->thread_id;
 
 	/*
-	 * Initialize array of nonover_stats
+	 * Start a new bit stream
 	 */
-	nonover_stats = malloc((size_t) numOfTemplates[m] * sizeof(*nonover_stats));
-
-	/*
-	 * Process all template values
-	 */
-	for (jj = 0; jj < numOfTemplates[m]; jj++) {
-
-		struct nonover_stats nonover_stat;
+	if (first == 0) {
 
 		/*
-		 * Get the next template from the pool of precomputed ones
+		 * Take the stats of this iteration from the scratch area
 		 */
-		memcpy(state->nonper_seq[thread_state->thread_id], addr_value(state->nonovTemplates, BitSequence, m * jj),
-		       m * sizeof(BitSequence));
+		stat = arenaScratch(thread_state, statsSize(state));
+		stat->M = n / BLOCKS_NON_OVERLAPPING;
 
 		/*
-		 * Zeroize the occurrences counters for this template
+		 * Step 3: compute the theoretical mean mu and variance sigma_squared
+		 * NOTE: The presence of the term [ 2^(2m) == 1 << m * 2 ] is the reason why MAXTEMPLEN
+		 * 	 cannot be greater than 15 in architectures where long int is 32 bits.
 		 */
-		memset(nonover_stat.Wj, 0, sizeof(nonover_stat.Wj));
+		stat->mu = (stat->M - m + 1) / ((double) ((long int) 1 << m));
+		stat->sigma_squared = stat->M * (1.0 / ((double) ((long int) 1 << m)) -
+						 (2.0 * m - 1.0) / ((double) ((long int) 1 << m * 2)));
 
 		/*
-	 	 * Step 2: count the number of times that this template occurs within each block
-	 	 */
-		for (i = 0; i < BLOCKS_NON_OVERLAPPING; i++) {
-			W_obs = 0;
+		 * Check preconditions (firewall)
+		 */
+		if (stat->sigma_squared < 0.0) {
+			err(132, __func__, "sigma_squared: %f < 0.0", stat->sigma_squared);
+		}
+		if (isNegative(stat->mu)) {
+			err(132, __func__, "aborting %s, mean(mu) < 0.0: %f", state->testNames[test_num], stat->mu);
+		}
+		if (isZero(stat->mu)) {
+			err(132, __func__, "aborting %s, mean(mu) == 0.0: %f", state->testNames[test_num], stat->mu);
+		}
 
-			/*
-			 * Count occurrences of the current template in block i
-			 */
-			for (j = 0; j < stat.M - m + 1; j++) {
-				match = true;
-
-				/*
-				 * Check if all the m bits of the template match the bits being
-				 * considered in the block.
-				 */
-				for (k = 0; k < m; k++) {
-					if (state->nonper_seq[thread_state->thread_id][k] !=
-							state->epsilon[thread_state->thread_id][i * stat.M + j + k]) {
-						match = false;
-						break;
-					}
-				}
+		/*
+		 * Zeroize the occurrences counters of each template, which may occur anywhere
+		 */
+		for (jj = 0; jj < numOfTemplates[m]; jj++) {
+			memset(stat->templates[jj].Wj, 0, sizeof(stat->templates[jj].Wj));
+			carry->next[jj] = 0;
+		}
+		carry->stat = stat;
+		carry->word = 0;
+	}
+	stat = carry->stat;
+	next = carry->next;
 
-				/*
-				 * If all the bits match, count one occurrence of this template and
-				 * slide the window over m bits.
-				 */
-				if (match == true) {
-					W_obs++;
-					j += m - 1;
+	/*
+ 	 * Step 2: count the number of times that each template occurs within each block
+	 *
+	 * The window of the last m bits of a block is looked up among the templates at each bit.  As when
+	 * each template is matched along the block in turn, an occurrence of a template is only counted if
+	 * it does not overlap its previous occurrence, sliding the window of that template over m bits.
+ 	 */
+	mask = ((unsigned long) 1 << m) - 1;
+	word = carry->word;
+	end = MIN(count, BLOCKS_NON_OVERLAPPING * stat->M - first);
+	for (i = 0; i < end;) {
+		block = (first + i) / stat->M;
+		j = MIN(end, (block + 1) * stat->M - first);
+		for (; i < j; i++) {
+			word = ((word << 1) | epsilon[i]) & mask;
+			start = first + i - m + 1;
+			if (start >= block * stat->M) {
+				jj = state->nonovTemplateIndex[word];
+				if (jj >= 0 && start >= next[jj]) {
+					stat->templates[jj].Wj[block]++;
+					next[jj] = start + m;
 				}
 			}
-
-			/*
-			 * Store the count of occurrences found in this block
-			 */
-			nonover_stat.Wj[i] = W_obs;
 		}
+	}
+	carry->word = word;
+
+	/*
+	 * Wait for the rest of the bit stream
+	 */
+	if (first + count < n) {
+		return;
+	}
+	carry->stat = NULL;
+
+	/*
+	 * Take the p_values of the templates of this iteration from the scratch area
+	 */
+	p_values = arenaScratch(thread_state, (size_t) numOfTemplates[m] * sizeof(p_values[0]));
+
+	/*
+	 * Process all template values
+	 */
+	for (jj = 0; jj < numOfTemplates[m]; jj++) {
+
+		nonover_stat = &stat->templates[jj];
 
 		/*
 		 * Step 4: compute the test statistic
 		 */
-		nonover_stat.chi2 = 0.0;
+		nonover_stat->chi2 = 0.0;
 		for (i = 0; i < BLOCKS_NON_OVERLAPPING; i++) {
-			chi2_term = ((double) nonover_stat.Wj[i] - stat.mu) / sqrt(stat.sigma_squared);
-			nonover_stat.chi2 += (chi2_term * chi2_term);
+			chi2_term = ((double) nonover_stat->Wj[i] - stat->mu) / sqrt(stat->sigma_squared);
+			nonover_stat->chi2 += (chi2_term * chi2_term);
 		}
 
-		/*
-		 * Step 5: compute the test p-value
-		 */
-		nonover_stat.p_value = cephes_igamc(BLOCKS_NON_OVERLAPPING / 2.0, nonover_stat.chi2 / 2.0);
-
-		/*
-		 * Store the index of the template just tested in the stats
-		 */
-		nonover_stat.template_index = jj;
-		nonover_stats[jj] = nonover_stat;
+		p_values[jj] = nonover_stat->chi2 / 2.0;
 	}
 
+	/*
+	 * Step 5: compute the test p-value of each template
+	 */
+	cephes_igamc_batch(&igamc_blocks, p_values, p_values, numOfTemplates[m]);
+
 	/*
 	 * Lock mutex before making changes to the shared state
 	 */
@@ -591,40 +736,39 @@ NonOverlappingTemplateMatchings_iterate(struct thread_state *thread_state)
 		/*
 		 * Get the jj-th nonover_stat
 		 */
-		struct nonover_stats nonover_stat = nonover_stats[jj];
+		nonover_stat = &stat->templates[jj];
 
 		/*
 		 * Record success or failure for this iteration
 		 */
 		state->count[test_num]++;	// Count this iteration
 		state->valid[test_num]++;	// Count this valid iteration
-		if (isNegative(nonover_stat.p_value)) {
+		if (isNegative(p_values[jj])) {
 			state->failure[test_num]++;	// Bogus p_value < 0.0 treated as a failure
-			nonover_stat.success = false;	// FAILURE
+			nonover_stat->success = false;	// FAILURE
 			warn(__func__, "iteration %ld template[%ld] of test %s[%d] produced bogus p_value: %f < 0.0\n",
 			     thread_state->iteration_being_done + 1, jj, state->testNames[test_num], test_num,
-			     nonover_stat.p_value);
-		} else if (isGreaterThanOne(nonover_stat.p_value)) {
+			     p_values[jj]);
+		} else if (isGreaterThanOne(p_values[jj])) {
 			state->failure[test_num]++;	// Bogus p_value > 1.0 treated as a failure
-			nonover_stat.success = false;	// FAILURE
+			nonover_stat->success = false;	// FAILURE
 			warn(__func__, "iteration %ld template[%ld] of test %s[%d] produced bogus p_value: %f > 1.0\n",
 			     thread_state->iteration_being_done + 1, jj, state->testNames[test_num], test_num,
-			     nonover_stat.p_value);
-		} else if (nonover_stat.p_value < state->tp.alpha) {
+			     p_values[jj]);
+		} else if (p_values[jj] < state->tp.alpha) {
 			state->valid_p_val[test_num]++;	// Valid p_value in [0.0, 1.0] range
 			state->failure[test_num]++;	// Valid p_value but too low is a failure
-			nonover_stat.success = false;	// FAILURE
+			nonover_stat->success = false;	// FAILURE
 		} else {
 			state->valid_p_val[test_num]++;	// Valid p_value in [0.0, 1.0] range
 			state->success[test_num]++;	// Valid p_value not too low is a success
-			nonover_stat.success = true;	// SUCCESS
+			nonover_stat->success = true;	// SUCCESS
 		}
 
 		/*
-		 * Record non-over stats computed during this iteration
-		 * This is the only case when we append a struct to the p-value array.
+		 * Record the p_value of this template
 		 */
-		append_value(state->p_val[test_num], &nonover_stat);
+		record_p_value(state, test_num, jj, p_values[jj]);
 	}
 
 	/*
@@ -633,10 +777,11 @@ NonOverlappingTemplateMatchings_iterate(struct thread_state *thread_state)
 	 * Unlike other tests, we have one stat but multiple nonover_stat
 	 * (one for each template) per iteration.
 	 *
-	 * NOTE: The number of nonover_stat values in state->p_val is numOfTemplates[m].
+	 * NOTE: The number of p_values in state->p_val is numOfTemplates[m] per iteration,
+	 *	 and the stats of each template follow the stat of their iteration.
 	 */
 	if (state->resultstxtFlag == true) {
-		append_value(state->stats[test_num], &stat);
+		append_value(state->stats[test_num], stat);
 	}
 
 	/*
@@ -657,23 +802,24 @@ NonOverlappingTemplateMatchings_iterate(struct thread_state *thread_state)
  *      stream          // open writable FILE stream
  *      state           // run state to test under
  *      stat            // struct NonOverlappingTemplateMatchings_private_stats for format and print
- *      nonover_stats   // dynamic array of nonover_stats values
- *      nonstat_index   // starting index in nonover_stats array for 1st template of the iteration
+ *      p_val           // dynamic array of p_values
+ *      p_val_index     // starting index in p_val array for 1st template of the iteration
  *
  * returns:
  *      true --> no errors
  *      false --> an I/O error occurred
  *
  * NOTE: This function prints the initial header for an iteration to the stats.txt file.
- *       Finally the nonover_stats dynamic array is used to print the results from each
- *       template to stats.txt for this iteration.
+ *       Finally the stats of each template of the iteration, and their p_values, are used
+ *       to print the results from each template to stats.txt for this iteration.
  */
 static bool
 NonOverlappingTemplateMatchings_print_stat(FILE * stream, struct state *state,
 					   struct NonOverlappingTemplateMatchings_private_stats *stat,
-					   struct dyn_array *nonover_stats, long int nonstat_index)
+					   struct dyn_array *p_val, long int p_val_index)
 {
 	struct nonover_stats *nonover_stat;	// Current nonover_stats for a given iteration
+	double p_value;				// p_value of the current template
 	int io_ret;				// I/O return status
 	long int i;
 	long int j;
@@ -690,14 +836,14 @@ NonOverlappingTemplateMatchings_print_stat(FILE * stream, struct state *state,
 	if (stat == NULL) {
 		err(133, __func__, "stat arg is NULL");
 	}
-	if (nonover_stats == NULL) {
-		err(133, __func__, "stat nonover_stats is NULL");
+	if (p_val == NULL) {
+		err(133, __func__, "p_val arg is NULL");
 	}
-	if (nonstat_index < 0) {
-		err(133, __func__, "stat nonstat_index: %ld < 0", nonstat_index);
+	if (p_val_index < 0) {
+		err(133, __func__, "p_val_index: %ld < 0", p_val_index);
 	}
-	if (nonstat_index >= nonover_stats->count) {
-		err(133, __func__, "stat nonstat_index: %ld >= dyn_array count: %ld", nonstat_index, nonover_stats->count);
+	if (p_val_index >= p_val->count) {
+		err(133, __func__, "p_val_index: %ld >= dyn_array count: %ld", p_val_index, p_val->count);
 	}
 
 	/*
@@ -791,21 +937,18 @@ NonOverlappingTemplateMatchings_print_stat(FILE * stream, struct state *state,
 	/*
 	 * Print values for each template of this iteration
 	 */
-	for (i = 0; i < numOfTemplates[state->tp.nonOverlappingTemplateLength]; ++i, ++nonstat_index) {
+	for (i = 0; i < numOfTemplates[state->tp.nonOverlappingTemplateLength]; ++i, ++p_val_index) {
 
 		/*
-		 * Find address of the current nonover_stats element
+		 * Find the stats and the p_value of the current template
 		 */
-		if (nonstat_index >= nonover_stats->count) {
-			warn(__func__, "nonstat_index: %ld went beyond nonover_stats dyn_array count: %ld",
-			     nonstat_index, nonover_stats->count);
-			return false;
-		}
-		if (nonstat_index < 0) {
-			warn(__func__, "nonstat_index: %ld underflowed < 0", nonstat_index);
+		if (p_val_index >= p_val->count) {
+			warn(__func__, "p_val_index: %ld went beyond p_val dyn_array count: %ld",
+			     p_val_index, p_val->count);
 			return false;
 		}
-		nonover_stat = addr_value(nonover_stats, struct nonover_stats, nonstat_index);
+		nonover_stat = &stat->templates[i];
+		p_value = get_value(p_val, double, p_val_index);
 
 		/*
 		 * Print template bits
@@ -835,24 +978,22 @@ NonOverlappingTemplateMatchings_print_stat(FILE * stream, struct state *state,
 		/*
 		 * Print remainder of template stats line
 		 */
-		if (nonover_stat->p_value == NON_P_VALUE && nonover_stat->success == true) {
-			err(133, __func__, "nonover_stat->p_value was set to NON_P_VALUE but "
-					"nonover_stat->success == true for jj: %ld", nonover_stat->template_index);
+		if (p_value == NON_P_VALUE && nonover_stat->success == true) {
+			err(133, __func__, "p_value was set to NON_P_VALUE but "
+					"nonover_stat->success == true for jj: %ld", i);
 		}
 		if (nonover_stat->success == true) {
-			io_ret = fprintf(stream, "%9.6f %f SUCCESS %3ld\n", nonover_stat->chi2, nonover_stat->p_value,
-					 nonover_stat->template_index);
+			io_ret = fprintf(stream, "%9.6f %f SUCCESS %3ld\n", nonover_stat->chi2, p_value, i);
 			if (io_ret <= 0) {
 				return false;
 			}
-		} else if (nonover_stat->p_value == NON_P_VALUE) {
-			io_ret = fprintf(stream, "%9.6f	 __INVALID__ %3ld\n", nonover_stat->chi2, nonover_stat->template_index);
+		} else if (p_value == NON_P_VALUE) {
+			io_ret = fprintf(stream, "%9.6f	 __INVALID__ %3ld\n", nonover_stat->chi2, i);
 			if (io_ret <= 0) {
 				return false;
 			}
 		} else {
-			io_ret = fprintf(stream, "%9.6f %f FAILURE %3ld\n", nonover_stat->chi2, nonover_stat->p_value,
-					 nonover_stat->template_index);
+			io_ret = fprintf(stream, "%9.6f %f FAILURE %3ld\n", nonover_stat->chi2, p_value, i);
 			if (io_ret <= 0) {
 				return false;
 			}
@@ -934,7 +1075,6 @@ void
 NonOverlappingTemplateMatchings_print(struct state *state)
 {
 	struct NonOverlappingTemplateMatchings_private_stats *stat;	// Pointer to statistics of an iteration
-	struct nonover_stats *nonover_stat;	// current nonover_stats for a given iteration
 	FILE *stats = NULL;			// Open stats.txt file
 	FILE *results = NULL;			// Open results.txt file
 	FILE *data = NULL;			// Open data*.txt file
@@ -943,7 +1083,7 @@ NonOverlappingTemplateMatchings_print(struct state *state)
 	char *data_txt = NULL;			// Pathname for data*.txt
 	char data_filename[BUFSIZ + 1];		// Basename for a given data*.txt pathname
 	bool ok;				// true -> I/O was OK
-	long int nonstat_index;			// Starting index into state->nonstat from which to print
+	long int p_val_index;			// Index into state->p_val[test_num] from which to print
 	int snprintf_ret;			// snprintf return value
 	int io_ret;				// I/O return status
 	long int i;
@@ -985,31 +1125,31 @@ NonOverlappingTemplateMatchings_print(struct state *state)
 	 */
 	stats_txt = filePathName(state->subDir[test_num], "stats.txt");
 	dbg(DBG_HIGH, "about to open/truncate: %s", stats_txt);
-	stats = openTruncate(stats_txt);
+	stats = openPrintFile(state, stats_txt);
 
 	/*
 	 * Open results.txt file
 	 */
 	results_txt = filePathName(state->subDir[test_num], "results.txt");
 	dbg(DBG_HIGH, "about to open/truncate: %s", results_txt);
-	results = openTruncate(results_txt);
+	results = openPrintFile(state, results_txt);
 
 	/*
 	 * Write results.txt and stats.txt files
 	 */
-	nonstat_index = 0;
+	p_val_index = 0;
 	for (i = 0; i < state->stats[test_num]->count; ++i) {
 
 		/*
 		 * Locate stat for this iteration
 		 */
-		stat = addr_value(state->stats[test_num], struct NonOverlappingTemplateMatchings_private_stats, i);
+		stat = iterationStats(state->stats[test_num], i);
 
 		/*
 		 * Print stat to stats.txt
 		 */
 		errno = 0;	// paranoia
-		ok = NonOverlappingTemplateMatchings_print_stat(stats, state, stat, state->p_val[test_num], nonstat_index);
+		ok = NonOverlappingTemplateMatchings_print_stat(stats, state, stat, state->p_val[test_num], p_val_index);
 		if (ok == false) {
 			errp(135, __func__, "error in writing to %s", stats_txt);
 		}
@@ -1017,25 +1157,25 @@ NonOverlappingTemplateMatchings_print(struct state *state)
 		/*
 		 * Print p_value to results.txt
 		 */
-		for (j = 0; j < numOfTemplates[state->tp.nonOverlappingTemplateLength]; ++j, ++nonstat_index) {
+		for (j = 0; j < numOfTemplates[state->tp.nonOverlappingTemplateLength]; ++j, ++p_val_index) {
 
 			/*
-			 * Find address of the current nonover_stats element
+			 * Check the index of the current p_value
 			 */
-			if (nonstat_index >= state->p_val[test_num]->count) {
-				err(135, __func__, "nonstat_index: %ld went beyond p_val count: %ld",
-				    nonstat_index, state->p_val[test_num]->count);
+			if (p_val_index >= state->p_val[test_num]->count) {
+				err(135, __func__, "p_val_index: %ld went beyond p_val count: %ld",
+				    p_val_index, state->p_val[test_num]->count);
 			}
-			if (nonstat_index < 0) {
-				err(135, __func__, "nonstat_index: %ld underflowed < 0", nonstat_index);
+			if (p_val_index < 0) {
+				err(135, __func__, "p_val_index: %ld underflowed < 0", p_val_index);
 			}
-			nonover_stat = addr_value(state->p_val[test_num], struct nonover_stats, nonstat_index);
 
 			/*
 			 * Print p_value
 			 */
 			errno = 0;	// paranoia
-			ok = NonOverlappingTemplateMatchings_print_p_value(results, nonover_stat->p_value);
+			ok = NonOverlappingTemplateMatchings_print_p_value(results, get_value(state->p_val[test_num], double,
+												 p_val_index));
 			if (ok == false) {
 				errp(135, __func__, "error in writing to %s", results_txt);
 			}
@@ -1096,25 +1236,21 @@ NonOverlappingTemplateMatchings_print(struct state *state)
 			 */
 			data_txt = filePathName(state->subDir[test_num], data_filename);
 			dbg(DBG_HIGH, "about to open/truncate: %s", data_txt);
-			data = openTruncate(data_txt);
+			data = openPrintFile(state, data_txt);
 
 			/*
 			 * Write this particular data*.txt filename
 			 */
 			if (j < state->p_val[test_num]->count) {
-				for (nonstat_index = j; nonstat_index < state->p_val[test_num]->count;
-				     nonstat_index += state->partitionCount[test_num]) {
+				for (p_val_index = j; p_val_index < state->p_val[test_num]->count;
+				     p_val_index += state->partitionCount[test_num]) {
 
 					/*
-					 * Get p_value for an iteration belonging to this data*.txt filename
-					 */
-					nonover_stat = addr_value(state->p_val[test_num], struct nonover_stats, nonstat_index);
-
-					/*
-					 * Print p_value to results.txt
+					 * Print p_value for an iteration belonging to this data*.txt filename
 					 */
 					errno = 0;	// paranoia
-					ok = NonOverlappingTemplateMatchings_print_p_value(data, nonover_stat->p_value);
+					ok = NonOverlappingTemplateMatchings_print_p_value(data, get_value(state->p_val[test_num],
+												       double, p_val_index));
 					if (ok == false) {
 						errp(135, __func__, "error in writing to %s", data_txt);
 					}
@@ -1311,12 +1447,8 @@ NonOverlappingTemplateMatchings_metric_print(struct state *state, long int sampl
 void
 NonOverlappingTemplateMatchings_metrics(struct state *state)
 {
-	struct nonover_stats *nonover_stat;	// current nonover_stats for a given iteration
-	long int sampleCount;	// Number of bitstreams in which we will count p_values
-	long int toolow;	// p_values that were below alpha
-	double p_value;		// p_value iteration test result(s)
-	long int *freqPerBin;	// Uniformity frequency bins
-	long int i;
+	struct p_val_tally *tally;	// Uniformity and proportion counts of the p_values
+	long int sampleCount;	// Number of bitstreams in which we counted p_values
 	long int j;
 
 	/*
@@ -1335,80 +1467,29 @@ NonOverlappingTemplateMatchings_metrics(struct state *state)
 		    "metrics driver interface for %s[%d] called with state.partitionCount: %d < 0",
 		    state->testNames[test_num], test_num, state->partitionCount[test_num]);
 	}
-	if (state->p_val[test_num]->count != (state->tp.numOfBitStreams * state->partitionCount[test_num])) {
+
+	/*
+	 * Tally the p_values, unless they were tallied as iterations completed
+	 */
+	tally = get_p_val_tally(state, test_num);
+	if (tally->count != (state->tp.numOfBitStreams * state->partitionCount[test_num])) {
 		err(137, __func__,
 		    "print driver interface for %s[%d] called with p_val count: %ld != %ld*%d=%ld",
-		    state->testNames[test_num], test_num, state->p_val[test_num]->count,
+		    state->testNames[test_num], test_num, tally->count,
 		    state->tp.numOfBitStreams, state->partitionCount[test_num],
 		    state->tp.numOfBitStreams * state->partitionCount[test_num]);
 	}
 
-	/*
-	 * Allocate uniformity frequency bins
-	 */
-	freqPerBin = malloc(state->tp.uniformity_bins * sizeof(freqPerBin[0]));
-	if (freqPerBin == NULL) {
-		errp(137, __func__, "cannot malloc of %ld elements of %ld bytes each for freqPerBin",
-		     state->tp.uniformity_bins, sizeof(long int));
-	}
-
 	/*
 	 * Print for each partition (or the whole set of p_values if partitionCount is 1)
 	 */
 	for (j = 0; j < state->partitionCount[test_num]; ++j) {
 
-		/*
-		 * Set counters to zero
-		 */
-		toolow = 0;
-		sampleCount = 0;
-		memset(freqPerBin, 0, state->tp.uniformity_bins * sizeof(freqPerBin[0]));
-
-		/*
-		 * Tally p_value
-		 */
-		for (i = j; i < state->p_val[test_num]->count; i += state->partitionCount[test_num]) {
-
-			// Get the iteration p_value
-			nonover_stat = addr_value(state->p_val[test_num], struct nonover_stats, i);
-			p_value = nonover_stat->p_value;
-			if (p_value == NON_P_VALUE) {
-				continue;	// the test was not possible for this iteration
-			}
-			// Case: random excursion test
-			if (state->is_excursion[test_num] == true) {
-				// Random excursion tests only sample > 0 p_values
-				if (p_value > 0.0) {
-					++sampleCount;
-				} else {
-					// Ignore p_value of 0 for random excursion tests
-					continue;
-				}
-			}
-			// Case: general (non-random excursion) test
-			else {
-				// All other tests count all p_values
-				++sampleCount;
-			}
-
-			// Count the number of p_values below alpha
-			if (p_value < state->tp.alpha) {
-				++toolow;
-			}
-			// Tally the p_value in a uniformity bin
-			if (p_value >= 1.0) {
-				++freqPerBin[state->tp.uniformity_bins - 1];
-			} else if (p_value >= 0.0) {
-				++freqPerBin[(int) floor(p_value * (double) state->tp.uniformity_bins)];
-			} else {
-				++freqPerBin[0];
-			}
-		}
-
 		/*
 		 * Print uniformity and proportional information for a tallied count
 		 */
-		NonOverlappingTemplateMatchings_metric_print(state, sampleCount, toolow, freqPerBin);
+		sampleCount = tally->sampleCount[j];
+		NonOverlappingTemplateMatchings_metric_print(state, sampleCount, tally->toolow[j], &tally->freqPerBin[j * tally->bins]);
 
 		/*
 		 * Track maximum samples
@@ -1424,12 +1505,6 @@ NonOverlappingTemplateMatchings_metrics(struct state *state)
 		}
 	}
 
-	/*
-	 * Free allocated storage
-	 */
-	free(freqPerBin);
-	freqPerBin = NULL;
-
 	return;
 }
 
@@ -1446,7 +1521,7 @@ NonOverlappingTemplateMatchings_metrics(struct state *state)
 void
 NonOverlappingTemplateMatchings_destroy(struct state *state)
 {
-	long int i;
+	struct NonOverlappingTemplateMatchings_carry *carry;	// Partial results of the bit streams of each thread
 
 	/*
 	 * Check preconditions (firewall)
@@ -1472,6 +1547,10 @@ NonOverlappingTemplateMatchings_destroy(struct state *state)
 		free(state->p_val[test_num]);
 		state->p_val[test_num] = NULL;
 	}
+	if (state->tally[test_num] != NULL) {
+		free_p_val_tally(state->tally[test_num]);
+		state->tally[test_num] = NULL;
+	}
 
 	/*
 	 * Free other test storage
@@ -1489,15 +1568,14 @@ NonOverlappingTemplateMatchings_destroy(struct state *state)
 		free(state->nonovTemplates);
 		state->nonovTemplates = NULL;
 	}
-	for (i = 0; i < state->numberOfThreads; i++) {
-		if (state->nonper_seq[i] != NULL) {
-			free(state->nonper_seq[i]);
-			state->nonper_seq[i] = NULL;
-		}
+	if (state->nonovTemplateIndex != NULL) {
+		free(state->nonovTemplateIndex);
+		state->nonovTemplateIndex = NULL;
 	}
-	if (state->nonper_seq != NULL) {
-		free(state->nonper_seq);
-		state->nonper_seq = NULL;
+	carry = state->streamCarry[test_num];
+	if (carry != NULL) {
+		free(carry);
+		state->streamCarry[test_num] = NULL;
 	}
 
 	return;
@@ -35,6 +35,7 @@
 #include <errno.h>
 #include "../utils/externs.h"
 #include "../utils/utilities.h"
+#include "../utils/stat_fncs.h"
 #include "../utils/cephes.h"
 #include "../utils/debug.h"
 
@@ -52,6 +53,16 @@ struct OverlappingTemplateMatchings_private_stats {
 };
 
 
+/*
+ * Carry - partial results of a bit stream kept between its chunks by each thread
+ */
+struct OverlappingTemplateMatchings_carry {
+	long int v[K_OVERLAPPING + 1];	// Counters v of the blocks streamed so far
+	long int W_obs;		// Occurrences so far of the template in the block being streamed
+	long int run;		// Length of the run of ones that ends the bits streamed so far in the block
+};
+
+
 /*
  * Static const variables declarations
  */
@@ -181,10 +192,12 @@ OverlappingTemplateMatchings_init(struct state *state)
 	 */
 	if (state->resultstxtFlag == true) {
 		state->stats[test_num] = create_dyn_array(sizeof(struct OverlappingTemplateMatchings_private_stats),
-							  DEFAULT_CHUNK, state->tp.numOfBitStreams, false);        // stats.txt
+							  DEFAULT_CHUNK, retainedIterations(state), false);        // stats.txt
+	}
+	if (state->p_valTally == false) {
+		state->p_val[test_num] = create_dyn_array(sizeof(double),
+							  DEFAULT_CHUNK, retainedIterations(state), false);	// results.txt
 	}
-	state->p_val[test_num] = create_dyn_array(sizeof(double),
-						  DEFAULT_CHUNK, state->tp.numOfBitStreams, false);	// results.txt
 
 	/*
 	 * Determine format of data*.txt filenames based on state->partitionCount[test_num]
@@ -194,6 +207,15 @@ OverlappingTemplateMatchings_init(struct state *state)
 	dbg(DBG_HIGH, "%s[%d] will form data*.txt filenames with the following format: %s",
 	    state->testNames[test_num], test_num, state->datatxt_fmt[test_num]);
 
+	/*
+	 * Allocate the partial results kept by each thread between the chunks of a bit stream
+	 */
+	state->streamCarry[test_num] = calloc((size_t) state->numberOfThreads, sizeof(struct OverlappingTemplateMatchings_carry));
+	if (state->streamCarry[test_num] == NULL) {
+		errp(140, __func__, "cannot calloc for streamCarry: %ld elements of %lu bytes each", state->numberOfThreads,
+		     sizeof(struct OverlappingTemplateMatchings_carry));
+	}
+
 	return;
 }
 
@@ -210,17 +232,54 @@ OverlappingTemplateMatchings_init(struct state *state)
  */
 void
 OverlappingTemplateMatchings_iterate(struct thread_state *thread_state)
+{
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (thread_state == NULL) {
+		err(141, __func__, "thread_state arg is NULL");
+	}
+	if (thread_state->global_state == NULL) {
+		err(141, __func__, "state arg is NULL");
+	}
+
+	/*
+	 * Stream the whole bit stream as a single chunk
+	 */
+	OverlappingTemplateMatchings_stream(thread_state, 0, thread_state->global_state->tp.n);
+
+	return;
+}
+
+
+/*
+ * OverlappingTemplateMatchings_stream - stream a chunk of a bit stream to the Overlapping Template test
+ *
+ * given:
+ *      thread_state    // current thread state
+ *      first           // index in the bit stream of the first bit of the chunk, 0 starts a new bit stream
+ *      count           // number of bits in the chunk, held by epsilon
+ *
+ * The chunks of a bit stream are streamed in order.  The iteration is recorded with the chunk
+ * that ends the bit stream.
+ *
+ * NOTE: The initialize function must be called before this function is called.
+ */
+void
+OverlappingTemplateMatchings_stream(struct thread_state *thread_state, long int first, long int count)
 {
 	struct OverlappingTemplateMatchings_private_stats stat;	// Stats for this iteration
 	long int m;		// Overlapping Template Test - template length
 	long int n;		// Length of a single bit stream
-	bool match;		// 1 ==> template match
-	double W_obs;		// Counter of the number of occurrences of a template in a block
+	long int W_obs;		// Counter of the number of occurrences of a template in a block
 	double chi2_term;	// Term whose square is used to compute chi squared for this iteration
 	double p_value;		// p_value iteration test result(s)
+	struct OverlappingTemplateMatchings_carry *carry;	// Partial results of the bit stream of this thread
+	BitSequence *epsilon;	// Chunk of the bit stream
+	long int run;		// Length of the run of ones that ends the bits streamed so far in the block
+	long int end;		// Number of bits of the chunk that are in one of the N blocks
 	long int i;
 	long int j;
-	long int k;
 
 	/*
 	 * Check preconditions (firewall)
@@ -242,6 +301,9 @@ OverlappingTemplateMatchings_iterate(struct thread_state *thread_state)
 	if (state->epsilon[thread_state->thread_id] == NULL) {
 		err(141, __func__, "state->epsilon[%ld] is NULL", thread_state->thread_id);
 	}
+	if (state->streamCarry[test_num] == NULL) {
+		err(141, __func__, "state->streamCarry[%d] is NULL", test_num);
+	}
 
 	/*
 	 * Collect parameters
@@ -249,50 +311,76 @@ OverlappingTemplateMatchings_iterate(struct thread_state *thread_state)
 	m = state->tp.overlappingTemplateLength;
 	n = state->tp.n;
 	stat.N = n / BLOCK_LENGTH_OVERLAPPING;
+	epsilon = state->epsilon[thread_state->thread_id];
+	carry = (struct OverlappingTemplateMatchings_carry *) state->streamCarry[test_num] + thread_state->thread_id;
 
 	/*
 	 * Set the v counters to zero.
 	 * NOTE: v[k] counts the number of times the template occurs
 	 * 	 a total of k times cumulatively in the blocks
 	 */
-	memset(stat.v, 0, sizeof(stat.v));
+	if (first == 0) {
+		memset(carry->v, 0, sizeof(carry->v));
+		carry->W_obs = 0;
+		carry->run = 0;
+	}
+	memcpy(stat.v, carry->v, sizeof(stat.v));
 
 	/*
 	 * Step 2: calculate the number of occurrences of the template in each of the N blocks of length M.
 	 * NOTE: Because the template we are checking is made only of ones, we don't need to
 	 *       allocate any array for it. We compare with the constant B_VALUE (which is 1) instead.
+	 *
+	 * The template occurs at position j of a block when the run of ones that ends at position j + m - 1
+	 * of the block is at least m bits long, which can be counted as the bits of the block are streamed.
 	 */
-	for (i = 0; i < stat.N; i++) {
-
-		/*
-		 * Set the initial counter of the occurrences of the template in block i to zero
-		 */
-		W_obs = 0;
+	W_obs = carry->W_obs;
+	run = carry->run;
+	end = MIN(count, stat.N * BLOCK_LENGTH_OVERLAPPING - first);
+	for (i = 0; i < end;) {
 
 		/*
 		 * Increase the W_obs counter whenever there is an occurrence of the template in block i
 		 */
-		for (j = 0; j < BLOCK_LENGTH_OVERLAPPING - m + 1; j++) {
-			match = true;
-			for (k = 0; k < m; k++) {
-				if (B_VALUE != state->epsilon[thread_state->thread_id][i * BLOCK_LENGTH_OVERLAPPING + j + k]) {
-					match = false;
-					break;
+		j = MIN(end, i + BLOCK_LENGTH_OVERLAPPING - (first + i) % BLOCK_LENGTH_OVERLAPPING);
+		for (; i < j; i++) {
+			if (epsilon[i] == B_VALUE) {
+				run++;
+				if (run >= m) {
+					W_obs++;
 				}
-			}
-			if (match == true) {
-				W_obs++;
+			} else {
+				run = 0;
 			}
 		}
+		if ((first + i) % BLOCK_LENGTH_OVERLAPPING != 0) {
+			break;	// The block goes on in the next chunk
+		}
 
 		/*
 		 * Increase the counter v depending on the number of occurrences of the template in block i
 		 */
 		if (W_obs < K_OVERLAPPING) {
-			stat.v[(int) W_obs]++;
+			stat.v[W_obs]++;
 		} else {
 			stat.v[K_OVERLAPPING]++;
 		}
+
+		/*
+		 * Set the initial counter of the occurrences of the template in the next block to zero
+		 */
+		W_obs = 0;
+		run = 0;
+	}
+	memcpy(carry->v, stat.v, sizeof(stat.v));
+	carry->W_obs = W_obs;
+	carry->run = run;
+
+	/*
+	 * Wait for the rest of the bit stream
+	 */
+	if (first + count < n) {
+		return;
 	}
 
 	/*
@@ -347,7 +435,7 @@ OverlappingTemplateMatchings_iterate(struct thread_state *thread_state)
 	if (state->resultstxtFlag == true) {
 		append_value(state->stats[test_num], &stat);
 	}
-	append_value(state->p_val[test_num], &p_value);
+	record_p_value(state, test_num, 0, p_value);
 
 	/*
 	 * Unlock mutex after making changes to the shared state
@@ -624,14 +712,14 @@ OverlappingTemplateMatchings_print(struct state *state)
 	 */
 	stats_txt = filePathName(state->subDir[test_num], "stats.txt");
 	dbg(DBG_HIGH, "about to open/truncate: %s", stats_txt);
-	stats = openTruncate(stats_txt);
+	stats = openPrintFile(state, stats_txt);
 
 	/*
 	 * Open results.txt file
 	 */
 	results_txt = filePathName(state->subDir[test_num], "results.txt");
 	dbg(DBG_HIGH, "about to open/truncate: %s", results_txt);
-	results = openTruncate(results_txt);
+	results = openPrintFile(state, results_txt);
 
 	/*
 	 * Write results.txt and stats.txt files
@@ -721,7 +809,7 @@ OverlappingTemplateMatchings_print(struct state *state)
 			 */
 			data_txt = filePathName(state->subDir[test_num], data_filename);
 			dbg(DBG_HIGH, "about to open/truncate: %s", data_txt);
-			data = openTruncate(data_txt);
+			data = openPrintFile(state, data_txt);
 
 			/*
 			 * Write this particular data*.txt filename
@@ -935,11 +1023,8 @@ OverlappingTemplateMatchings_metric_print(struct state *state, long int sampleCo
 void
 OverlappingTemplateMatchings_metrics(struct state *state)
 {
-	long int sampleCount;	// Number of bitstreams in which we will count p_values
-	long int toolow;	// p_values that were below alpha
-	double p_value;		// p_value iteration test result(s)
-	long int *freqPerBin;	// Uniformity frequency bins
-	long int i;
+	struct p_val_tally *tally;	// Uniformity and proportion counts of the p_values
+	long int sampleCount;	// Number of bitstreams in which we counted p_values
 	long int j;
 
 	/*
@@ -958,20 +1043,16 @@ OverlappingTemplateMatchings_metrics(struct state *state)
 		    "metrics driver interface for %s[%d] called with state.partitionCount: %d < 0",
 		    state->testNames[test_num], test_num, state->partitionCount[test_num]);
 	}
-	if (state->p_val[test_num]->count != (state->tp.numOfBitStreams * state->partitionCount[test_num])) {
-		warn(__func__,
-		     "metrics driver interface for %s[%d] called with p_val length: %ld != bit streams: %ld",
-		     state->testNames[test_num], test_num, state->p_val[test_num]->count,
-		     state->tp.numOfBitStreams * state->partitionCount[test_num]);
-	}
 
 	/*
-	 * Allocate uniformity frequency bins
+	 * Tally the p_values, unless they were tallied as iterations completed
 	 */
-	freqPerBin = malloc(state->tp.uniformity_bins * sizeof(freqPerBin[0]));
-	if (freqPerBin == NULL) {
-		errp(146, __func__, "cannot malloc of %ld elements of %ld bytes each for freqPerBin",
-		     state->tp.uniformity_bins, sizeof(long int));
+	tally = get_p_val_tally(state, test_num);
+	if (tally->count != (state->tp.numOfBitStreams * state->partitionCount[test_num])) {
+		warn(__func__,
+		     "metrics driver interface for %s[%d] called with p_val length: %ld != bit streams: %ld",
+		     state->testNames[test_num], test_num, tally->count,
+		     state->tp.numOfBitStreams * state->partitionCount[test_num]);
 	}
 
 	/*
@@ -979,57 +1060,11 @@ OverlappingTemplateMatchings_metrics(struct state *state)
 	 */
 	for (j = 0; j < state->partitionCount[test_num]; ++j) {
 
-		/*
-		 * Set counters to zero
-		 */
-		toolow = 0;
-		sampleCount = 0;
-		memset(freqPerBin, 0, state->tp.uniformity_bins * sizeof(freqPerBin[0]));
-
-		/*
-		 * Tally p_value
-		 */
-		for (i = j; i < state->p_val[test_num]->count; i += state->partitionCount[test_num]) {
-
-			// Get the iteration p_value
-			p_value = get_value(state->p_val[test_num], double, i);
-			if (p_value == NON_P_VALUE) {
-				continue;	// the test was not possible for this iteration
-			}
-			// Case: random excursion test
-			if (state->is_excursion[test_num] == true) {
-				// Random excursion tests only sample > 0 p_values
-				if (p_value > 0.0) {
-					++sampleCount;
-				} else {
-					// Ignore p_value of 0 for random excursion tests
-					continue;
-				}
-			}
-			// Case: general (non-random excursion) test
-			else {
-				// All other tests count all p_values
-				++sampleCount;
-			}
-
-			// Count the number of p_values below alpha
-			if (p_value < state->tp.alpha) {
-				++toolow;
-			}
-			// Tally the p_value in a uniformity bin
-			if (p_value >= 1.0) {
-				++freqPerBin[state->tp.uniformity_bins - 1];
-			} else if (p_value >= 0.0) {
-				++freqPerBin[(int) floor(p_value * (double) state->tp.uniformity_bins)];
-			} else {
-				++freqPerBin[0];
-			}
-		}
-
 		/*
 		 * Print uniformity and proportional information for a tallied count
 		 */
-		OverlappingTemplateMatchings_metric_print(state, sampleCount, toolow, freqPerBin);
+		sampleCount = tally->sampleCount[j];
+		OverlappingTemplateMatchings_metric_print(state, sampleCount, tally->toolow[j], &tally->freqPerBin[j * tally->bins]);
 
 		/*
 		 * Track maximum samples
@@ -1045,12 +1080,6 @@ OverlappingTemplateMatchings_metrics(struct state *state)
 		}
 	}
 
-	/*
-	 * Free allocated storage
-	 */
-	free(freqPerBin);
-	freqPerBin = NULL;
-
 	return;
 }
 
@@ -1091,10 +1120,18 @@ OverlappingTemplateMatchings_destroy(struct state *state)
 		free(state->p_val[test_num]);
 		state->p_val[test_num] = NULL;
 	}
+	if (state->tally[test_num] != NULL) {
+		free_p_val_tally(state->tally[test_num]);
+		state->tally[test_num] = NULL;
+	}
 
 	/*
 	 * Free other test storage
 	 */
+	if (state->streamCarry[test_num] != NULL) {
+		free(state->streamCarry[test_num]);
+		state->streamCarry[test_num] = NULL;
+	}
 	if (state->datatxt_fmt[test_num] != NULL) {
 		free(state->datatxt_fmt[test_num]);
 		state->datatxt_fmt[test_num] = NULL;
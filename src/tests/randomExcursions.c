@@ -36,7 +36,9 @@
 #include "../utils/externs.h"
 #include "../utils/cephes.h"
 #include "../utils/utilities.h"
+#include "../utils/stat_fncs.h"
 #include "../utils/debug.h"
+#include "../utils/arena.h"
 
 
 /*
@@ -51,15 +53,33 @@ struct RandomExcursions_private_stats {
 };
 
 
+/*
+ * Carry - partial results of a bit stream kept between its chunks by each thread
+ */
+struct RandomExcursions_carry {
+	long int S;		// Partial sum of the -1/+1 states streamed so far
+	long int number_of_cycles;	// Number of cycles ended so far
+	long int cycle[NUMBER_OF_STATES_RND_EXCURSION];	// Counters of visits to each excursion state in the current cycle
+	long int counter[NUMBER_OF_STATES_RND_EXCURSION];	// Counters of visits to each excursion state in the last ended cycle
+	long int v[DEGREES_OF_FREEDOM_RND_EXCURSION][NUMBER_OF_STATES_RND_EXCURSION];	// Global frequency counters
+};
+
+
 /*
  * Static const variables declarations
  */
 static const enum test test_num = TEST_RND_EXCURSION;	// This test number
 
+/*
+ * cephes_igamc() of the degrees of freedom of the test, set up by the initialize function
+ */
+static struct cephes_igamc_a igamc_degrees;
+
 
 /*
  * Forward static function declarations
  */
+static void end_cycle(struct RandomExcursions_carry *carry);
 static bool RandomExcursions_print_stat(FILE * stream, struct state *state, struct RandomExcursions_private_stats *stat,
 					long int iteration);
 static bool RandomExcursions_print_stat2(FILE * stream, struct state *state, struct RandomExcursions_private_stats *stat,
@@ -116,28 +136,6 @@ RandomExcursions_init(struct state *state)
 		return;
 	}
 
-	/*
-	 * Allocate the partial sums and the cycle arrays for each thread
-	 */
-	state->rnd_excursion_S = malloc((size_t) state->numberOfThreads * sizeof(*state->rnd_excursion_S));
-	if (state->rnd_excursion_S == NULL) {
-		errp(150, __func__, "cannot malloc for rnd_excursion_S: %ld elements of %lu bytes each", state->numberOfThreads,
-		     sizeof(*state->rnd_excursion_S));
-	}
-	state->rnd_excursion_cycle = malloc((size_t) state->numberOfThreads * sizeof(*state->rnd_excursion_cycle));
-	if (state->rnd_excursion_cycle == NULL) {
-		errp(150, __func__, "cannot malloc for rnd_excursion_cycle: %ld elements of %lu bytes each", state->numberOfThreads,
-		     sizeof(*state->rnd_excursion_cycle));
-	}
-	for (i = 0; i < state->numberOfThreads; i++) {
-		state->rnd_excursion_S[i] = malloc(n * sizeof(state->rnd_excursion_S[i][0]));
-		if (state->rnd_excursion_S[i] == NULL) {
-			errp(150, __func__, "cannot malloc of %ld elements of %ld bytes each for state->rnd_excursion_S[%ld]",
-			     n, sizeof(state->rnd_excursion_S[i][0]), i);
-		}
-		state->rnd_excursion_cycle[i] = create_dyn_array(sizeof(long int), DEFAULT_CHUNK, (long int) state->c.sqrtn, true);
-	}
-
 	/*
 	 * Create working sub-directory if forming files such as results.txt and stats.txt
 	 */
@@ -206,15 +204,22 @@ RandomExcursions_init(struct state *state)
 				pow(state->rnd_excursion_pi_terms[i - 1][0], 4);
 	}
 
+	/*
+	 * Set up the p-value function, which is evaluated for each state of each iteration
+	 */
+	cephes_igamc_setup(&igamc_degrees, (double) (DEGREES_OF_FREEDOM_RND_EXCURSION - 1) / 2.0);
+
 	/*
 	 * Allocate dynamic arrays
 	 */
 	if (state->resultstxtFlag == true) {
 		state->stats[test_num] = create_dyn_array(sizeof(struct RandomExcursions_private_stats),
-							  DEFAULT_CHUNK, state->tp.numOfBitStreams, false);        // stats.txt
+							  DEFAULT_CHUNK, retainedIterations(state), false);        // stats.txt
+	}
+	if (state->p_valTally == false) {
+		state->p_val[test_num] = create_dyn_array(sizeof(double), DEFAULT_CHUNK,
+							  NUMBER_OF_STATES_RND_EXCURSION * retainedIterations(state), false); // results.txt
 	}
-	state->p_val[test_num] = create_dyn_array(sizeof(double), DEFAULT_CHUNK,
-						  NUMBER_OF_STATES_RND_EXCURSION * state->tp.numOfBitStreams, false); // results.txt
 
 	/*
 	 * Determine format of data*.txt filenames based on state->partitionCount[test_num]
@@ -224,6 +229,20 @@ RandomExcursions_init(struct state *state)
 	dbg(DBG_HIGH, "%s[%d] will form data*.txt filenames with the following format: %s",
 	    state->testNames[test_num], test_num, state->datatxt_fmt[test_num]);
 
+	/*
+	 * Allocate the partial results kept by each thread between the chunks of a bit stream
+	 */
+	state->streamCarry[test_num] = calloc((size_t) state->numberOfThreads, sizeof(struct RandomExcursions_carry));
+	if (state->streamCarry[test_num] == NULL) {
+		errp(150, __func__, "cannot calloc for streamCarry: %ld elements of %lu bytes each", state->numberOfThreads,
+		     sizeof(struct RandomExcursions_carry));
+	}
+
+	/*
+	 * Reserve the p_values of an iteration in the scratch area of each thread
+	 */
+	arenaReserveScratch(state, test_num, "p_values", NUMBER_OF_STATES_RND_EXCURSION * sizeof(double));
+
 	return;
 }
 
@@ -240,19 +259,50 @@ RandomExcursions_init(struct state *state)
  */
 void
 RandomExcursions_iterate(struct thread_state *thread_state)
+{
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (thread_state == NULL) {
+		err(151, __func__, "thread_state arg is NULL");
+	}
+	if (thread_state->global_state == NULL) {
+		err(151, __func__, "state arg is NULL");
+	}
+
+	/*
+	 * Stream the whole bit stream as a single chunk
+	 */
+	RandomExcursions_stream(thread_state, 0, thread_state->global_state->tp.n);
+
+	return;
+}
+
+
+/*
+ * RandomExcursions_stream - stream a chunk of a bit stream to the Random Excursions test
+ *
+ * given:
+ *      thread_state    // current thread state
+ *      first           // index in the bit stream of the first bit of the chunk, 0 starts a new bit stream
+ *      count           // number of bits in the chunk, held by epsilon
+ *
+ * The chunks of a bit stream are streamed in order.  The iteration is recorded with the chunk
+ * that ends the bit stream.
+ *
+ * NOTE: The initialize function must be called before this function is called.
+ */
+void
+RandomExcursions_stream(struct thread_state *thread_state, long int first, long int count)
 {
 	struct RandomExcursions_private_stats stat;	// Stats for this iteration
 	long int n;					// Length of a single bit stream
-	long int v[DEGREES_OF_FREEDOM_RND_EXCURSION][NUMBER_OF_STATES_RND_EXCURSION];	// Global frequency counters
-	struct dyn_array *cycle;	// Counter used for single iterations
-	long int *S;			// Array of the partial sums of the -1/+1 states
-	long int count_index;		// Index of the count array to be incremented
+	struct RandomExcursions_carry *carry;	// Partial results of the bit stream of this thread
+	BitSequence *epsilon;		// Chunk of the bit stream
+	long int S;			// Partial sum of the -1/+1 states
 	long int offset;		// Sum offset used to get the index of a state value in the counter array
 	long int x;			// State value to test
 	long int labs_x;		// Absolute value of the state value x
-	long int cycleStart;		// Index where a cycle starts
-	long int cycleStop;		// Index where a cycle ends
-	long int occurrences;		// Number of occurrences of a given state value in a cycle
 	double p_value;			// p_value iteration test result(s)
 	double *p_values;		// Array of p-values produced by this test
 	double sum_term;		// Value whose square is used to compute the test statistic
@@ -282,17 +332,8 @@ RandomExcursions_iterate(struct thread_state *thread_state)
 	if (state->rnd_excursion_stateX == NULL) {
 		err(151, __func__, "state->rnd_excursion_stateX is NULL");
 	}
-	if (state->rnd_excursion_S == NULL) {
-		err(151, __func__, "state->rnd_excursion_S is NULL");
-	}
-	if (state->rnd_excursion_S[thread_state->thread_id] == NULL) {
-		err(151, __func__, "state->rnd_excursion_S[%ld] is NULL", thread_state->thread_id);
-	}
-	if (state->rnd_excursion_cycle == NULL) {
-		err(151, __func__, "state->rnd_excursion_cycle is NULL");
-	}
-	if (state->rnd_excursion_cycle[thread_state->thread_id] == NULL) {
-		err(151, __func__, "state->rnd_excursion_cycle[%ld] is NULL", thread_state->thread_id);
+	if (state->streamCarry[test_num] == NULL) {
+		err(151, __func__, "state->streamCarry[%d] is NULL", test_num);
 	}
 	if (state->cSetup != true) {
 		err(151, __func__, "test constants not setup prior to calling %s for %s[%d]",
@@ -303,54 +344,75 @@ RandomExcursions_iterate(struct thread_state *thread_state)
 	 * Collect parameters from state
 	 */
 	n = state->tp.n;
-	S = state->rnd_excursion_S[thread_state->thread_id];
-	cycle = state->rnd_excursion_cycle[thread_state->thread_id];
+	epsilon = state->epsilon[thread_state->thread_id];
+	carry = (struct RandomExcursions_carry *) state->streamCarry[test_num] + thread_state->thread_id;
 
 	/*
-	 * Clear the cycle array for this iteration
+	 * Zeroize the partial sum and the counters when a new bit stream starts
 	 */
-	clear_dyn_array(cycle);
+	if (first == 0) {
+		memset(carry, 0, sizeof(*carry));
+	}
+	S = carry->S;
 
 	/*
 	 * Step 3: compute the partial sums of successively larger sub-sequences
 	 */
-	if ((int) state->epsilon[thread_state->thread_id][0] == 1) {
-		S[0] = 1;
-	} else if ((int) state->epsilon[thread_state->thread_id][0] == 0) {
-		S[0] = - 1;
-	} else {
-		err(41, __func__, "found a bit different than 1 or 0 in the sequence");
-	}
-	for (i = 1; i < n; i++) {
-		if ((int) state->epsilon[thread_state->thread_id][i] == 1) {
-			S[i] = S[i - 1] + 1;
-		} else if ((int) state->epsilon[thread_state->thread_id][i] == 0) {
-			S[i] = S[i - 1] - 1;
+	for (i = 0; i < count; i++) {
+		if ((int) epsilon[i] == 1) {
+			S++;
+		} else if ((int) epsilon[i] == 0) {
+			S--;
 		} else {
 			err(41, __func__, "found a bit different than 1 or 0 in the sequence");
 		}
 
+		/*
+		 * Step 5: for each non-zero state value x, compute the frequency of x within the current cycle
+		 */
+		if ((labs(S) >= 1) && (labs(S) <= MAX_EXCURSION_RND_EXCURSION)) {
+
+			/*
+			 * Get the index of this state value in the counter array.
+			 * This is done because the array cannot have negative indexes.
+			 * Thus, the most negative x will correspond to the item in index 0.
+			 *
+			 * For example, if MAX_EXCURSION_RND_EXCURSION is 4, the counter for
+			 * x = -4 is the counter[0] and the counter for x = 4 is counter[7]
+			 */
+			offset = (S < 0) ? MAX_EXCURSION_RND_EXCURSION : MAX_EXCURSION_RND_EXCURSION - 1;
+			carry->cycle[S + offset]++;
+		}
+
 		/*
 		 * Step 4a: whenever a 0 in the partial sums is found, which means that a cycle has
-		 * ended, append the ending position of that cycle to the cycle array
+		 * ended, count the cycle and its frequencies
 		 */
-		if (S[i] == 0) {
-			append_value(cycle, &i);
+		else if (S == 0) {
+			end_cycle(carry);
 		}
 	}
+	carry->S = S;
+
+	/*
+	 * Wait for the rest of the bit stream
+	 */
+	if (first + count < n) {
+		return;
+	}
 
 	/*
 	 * Step 4b: count the last cycle if it was not counted already
 	 */
-	if (S[n - 1] != 0) {
-		append_value(cycle, &n);
+	if (S != 0) {
+		end_cycle(carry);
 	}
 
 	/*
-	 * Step 4c: get the total number of cycles.
-	 * The number of cycles will be equal to the number of elements in the cycles array.
+	 * Step 4c: get the total number of cycles and the frequencies of the last cycle
 	 */
-	stat.number_of_cycles = cycle->count;
+	stat.number_of_cycles = carry->number_of_cycles;
+	memcpy(stat.counter, carry->counter, sizeof(stat.counter));
 
 	/*
 	 * Step 4d: determine if there are enough cycles
@@ -362,108 +424,7 @@ RandomExcursions_iterate(struct thread_state *thread_state)
 	 */
 	if (stat.test_possible == true) {
 
-		/*
-		 * Zeroize variables and global counters
-		 */
-		memset(v, 0, sizeof(v));
-		cycleStop = 0;
-
-		/*
-		 * Step 5: for each cycle and for each non-zero state value x,
-		 * compute the frequency of each x within each cycle.
-		 */
-		for (j = 0; j < stat.number_of_cycles; j++) {
-
-			/*
-			 * Get beginning and ending indexes of the cycle j
-			 */
-			cycleStart = cycleStop;
-			cycleStop = get_value(cycle, long int, j);
-
-			/*
-			 * Zeroize the counters for this test
-			 */
-			memset(stat.counter, 0, sizeof(stat.counter));
-
-			/*
-			 * Check preconditions (firewall)
-			 */
-			if (cycleStart < 0) {
-				err(151, __func__, "cycleStart: %ld < 0", cycleStart);
-			}
-			if (cycleStart > n) {
-				err(151, __func__, "cycleStart: %ld > n: %ld", cycleStart, n);
-			}
-			if (cycleStop < 0) {
-				err(151, __func__, "cycleStop: %ld < 0", cycleStop);
-			}
-			if (cycleStop > n) {
-				err(151, __func__, "cycleStop: %ld > n: %ld", cycleStop, n);
-			}
-
-			/*
-			 * Consider each partial sum value of the cycle
-			 */
-			for (i = cycleStart; i < cycleStop; i++) {
-
-				/*
-				 * Check if the value of the partial sum is one of the state values of interest
-				 */
-				if ((labs(S[i]) >= 1) && (labs(S[i]) <= MAX_EXCURSION_RND_EXCURSION)) {
-
-					/*
-					 * Get the index of this state value in the counter array.
-					 * This is done because the array cannot have negative indexes.
-					 * Thus, the most negative x will correspond to the item in index 0.
-					 *
-					 * For example, if MAX_EXCURSION_RND_EXCURSION is 4, the counter for
-					 * x = -4 is the counter[0] and the counter for x = 4 is counter[7]
-					 */
-					offset = (S[i] < 0) ? MAX_EXCURSION_RND_EXCURSION : MAX_EXCURSION_RND_EXCURSION - 1;
-					count_index = S[i] + offset;
-
-					/*
-					 * Check preconditions (firewall)
-					 */
-					if (count_index < 0) {
-						err(151, __func__, "count_index: %ld < 0", count_index);
-					}
-
-					/*
-					 * Increase the counter of the considered state value
-					 */
-					stat.counter[count_index]++;
-				}
-			}
-
-			/*
-			 * Step 6: for each of the states, increase the the counters of v consequently:
-			 * v[k][i] contains the exact number of cycles in which state i occurs exactly k times
-			 */
-			for (i = 0; i < NUMBER_OF_STATES_RND_EXCURSION; i++) {
-
-				/*
-				 * Get the number of occurrences of the state value in cycle i
-				 */
-				occurrences = stat.counter[i];
-
-				/*
-				 * If the number of occurrences is between 0 and MAX_K, count it in its counter
-				 */
-				if ((occurrences >= 0) && (occurrences < (DEGREES_OF_FREEDOM_RND_EXCURSION - 1))) {
-					v[stat.counter[i]][i]++;
-				}
-
-				/*
-				 * If the number of occurrences is bigger than MAX_K, count it in the MAX_K counter
-				 */
-				else if (occurrences >= DEGREES_OF_FREEDOM_RND_EXCURSION - 1) {
-					v[DEGREES_OF_FREEDOM_RND_EXCURSION - 1][i]++;
-				}
-			}
-		}
-
-		p_values = malloc(NUMBER_OF_STATES_RND_EXCURSION * sizeof(*p_values));
+		p_values = arenaScratch(thread_state, NUMBER_OF_STATES_RND_EXCURSION * sizeof(*p_values));
 
 		/*
 		 * Compute the test statistic and the p-value for each of the states.
@@ -491,7 +452,7 @@ RandomExcursions_iterate(struct thread_state *thread_state)
 			 */
 			stat.chi2[i] = 0.0;
 			for (j = 0; j < DEGREES_OF_FREEDOM_RND_EXCURSION; j++) {
-				sum_term = (double) v[j][i] - ((double) stat.number_of_cycles
+				sum_term = (double) carry->v[j][i] - ((double) stat.number_of_cycles
 							       * state->rnd_excursion_pi_terms[labs_x - 1][j]);
 				stat.chi2[i] += sum_term * sum_term / ((double) stat.number_of_cycles
 								       * state->rnd_excursion_pi_terms[labs_x - 1][j]);
@@ -500,7 +461,7 @@ RandomExcursions_iterate(struct thread_state *thread_state)
 			/*
 			 * Step 8: compute the p-value for this state
 			 */
-			p_value = cephes_igamc((double) (DEGREES_OF_FREEDOM_RND_EXCURSION - 1) / 2.0, stat.chi2[i] / 2.0);
+			p_value = cephes_igamc_fixed(&igamc_degrees, stat.chi2[i] / 2.0);
 
 			/*
 			 * Save p-value in the arrays of p-values
@@ -553,7 +514,7 @@ RandomExcursions_iterate(struct thread_state *thread_state)
 			/*
 			 * Record values computed during this iteration
 			 */
-			append_value(state->p_val[test_num], &p_value);
+			record_p_value(state, test_num, i, p_value);
 		}
 
 		/*
@@ -596,7 +557,7 @@ RandomExcursions_iterate(struct thread_state *thread_state)
 		 */
 		p_value = NON_P_VALUE;
 		for (i = 0; i < NUMBER_OF_STATES_RND_EXCURSION; i++) {
-			append_value(state->p_val[test_num], &p_value);
+			record_p_value(state, test_num, i, p_value);
 		}
 	}
 
@@ -611,6 +572,58 @@ RandomExcursions_iterate(struct thread_state *thread_state)
 }
 
 
+/*
+ * end_cycle - count a cycle that has ended and the frequencies of the excursion states within it
+ *
+ * given:
+ *      carry           // partial results of the bit stream
+ *
+ * This auxiliary function counts the cycle that has just ended and moves its
+ * visits to each excursion state into the global frequency counters.
+ */
+static void
+end_cycle(struct RandomExcursions_carry *carry)
+{
+	long int occurrences;		// Number of occurrences of a given state value in a cycle
+	long int i;
+
+	/*
+	 * Step 6: for each of the states, increase the the counters of v consequently:
+	 * v[k][i] contains the exact number of cycles in which state i occurs exactly k times
+	 */
+	for (i = 0; i < NUMBER_OF_STATES_RND_EXCURSION; i++) {
+
+		/*
+		 * Get the number of occurrences of the state value in the cycle
+		 */
+		occurrences = carry->cycle[i];
+
+		/*
+		 * If the number of occurrences is between 0 and MAX_K, count it in its counter
+		 */
+		if ((occurrences >= 0) && (occurrences < (DEGREES_OF_FREEDOM_RND_EXCURSION - 1))) {
+			carry->v[occurrences][i]++;
+		}
+
+		/*
+		 * If the number of occurrences is bigger than MAX_K, count it in the MAX_K counter
+		 */
+		else if (occurrences >= DEGREES_OF_FREEDOM_RND_EXCURSION - 1) {
+			carry->v[DEGREES_OF_FREEDOM_RND_EXCURSION - 1][i]++;
+		}
+	}
+
+	/*
+	 * Keep the frequencies of the last ended cycle for stats.txt and start a new cycle
+	 */
+	memcpy(carry->counter, carry->cycle, sizeof(carry->counter));
+	memset(carry->cycle, 0, sizeof(carry->cycle));
+	carry->number_of_cycles++;
+
+	return;
+}
+
+
 /*
  * RandomExcursions_print_stat - print private_stats information to the end of an open file
  *
@@ -992,14 +1005,14 @@ RandomExcursions_print(struct state *state)
 	 */
 	stats_txt = filePathName(state->subDir[test_num], "stats.txt");
 	dbg(DBG_HIGH, "about to open/truncate: %s", stats_txt);
-	stats = openTruncate(stats_txt);
+	stats = openPrintFile(state, stats_txt);
 
 	/*
 	 * Open results.txt file
 	 */
 	results_txt = filePathName(state->subDir[test_num], "results.txt");
 	dbg(DBG_HIGH, "about to open/truncate: %s", results_txt);
-	results = openTruncate(results_txt);
+	results = openPrintFile(state, results_txt);
 
 	/*
 	 * Write results.txt and stats.txt files
@@ -1015,7 +1028,7 @@ RandomExcursions_print(struct state *state)
 		 * Print stat to stats.txt
 		 */
 		errno = 0;	// paranoia
-		ok = RandomExcursions_print_stat(stats, state, stat, i);
+		ok = RandomExcursions_print_stat(stats, state, stat, state->printedIterations + i);
 		if (ok == false) {
 			errp(155, __func__, "error in writing to %s", stats_txt);
 		}
@@ -1104,7 +1117,7 @@ RandomExcursions_print(struct state *state)
 			 */
 			data_txt = filePathName(state->subDir[test_num], data_filename);
 			dbg(DBG_HIGH, "about to open/truncate: %s", data_txt);
-			data = openTruncate(data_txt);
+			data = openPrintFile(state, data_txt);
 
 			/*
 			 * Write this particular data*.txt filename
@@ -1318,11 +1331,8 @@ RandomExcursions_metric_print(struct state *state, long int sampleCount, long in
 void
 RandomExcursions_metrics(struct state *state)
 {
-	long int sampleCount;	// Number of bitstreams in which we will count p_values
-	long int toolow;	// p_values that were below alpha
-	double p_value;		// p_value iteration test result(s)
-	long int *freqPerBin;	// Uniformity frequency bins
-	long int i;
+	struct p_val_tally *tally;	// Uniformity and proportion counts of the p_values
+	long int sampleCount;	// Number of bitstreams in which we counted p_values
 	long int j;
 
 	/*
@@ -1341,20 +1351,16 @@ RandomExcursions_metrics(struct state *state)
 		    "metrics driver interface for %s[%d] called with state.partitionCount: %d < 0",
 		    state->testNames[test_num], test_num, state->partitionCount[test_num]);
 	}
-	if (state->p_val[test_num]->count != (state->tp.numOfBitStreams * state->partitionCount[test_num])) {
-		warn(__func__,
-		     "metrics driver interface for %s[%d] called with p_val length: %ld != bit streams: %ld",
-		     state->testNames[test_num], test_num, state->p_val[test_num]->count,
-		     state->tp.numOfBitStreams * state->partitionCount[test_num]);
-	}
 
 	/*
-	 * Allocate uniformity frequency bins
+	 * Tally the p_values, unless they were tallied as iterations completed
 	 */
-	freqPerBin = malloc(state->tp.uniformity_bins * sizeof(freqPerBin[0]));
-	if (freqPerBin == NULL) {
-		errp(157, __func__, "cannot malloc of %ld elements of %ld bytes each for freqPerBin",
-		     state->tp.uniformity_bins, sizeof(long int));
+	tally = get_p_val_tally(state, test_num);
+	if (tally->count != (state->tp.numOfBitStreams * state->partitionCount[test_num])) {
+		warn(__func__,
+		     "metrics driver interface for %s[%d] called with p_val length: %ld != bit streams: %ld",
+		     state->testNames[test_num], test_num, tally->count,
+		     state->tp.numOfBitStreams * state->partitionCount[test_num]);
 	}
 
 	/*
@@ -1362,57 +1368,11 @@ RandomExcursions_metrics(struct state *state)
 	 */
 	for (j = 0; j < state->partitionCount[test_num]; ++j) {
 
-		/*
-		 * Set counters to zero
-		 */
-		toolow = 0;
-		sampleCount = 0;
-		memset(freqPerBin, 0, state->tp.uniformity_bins * sizeof(freqPerBin[0]));
-
-		/*
-		 * Tally p_value
-		 */
-		for (i = j; i < state->p_val[test_num]->count; i += state->partitionCount[test_num]) {
-
-			// Get the iteration p_value
-			p_value = get_value(state->p_val[test_num], double, i);
-			if (p_value == NON_P_VALUE) {
-				continue;	// the test was not possible for this iteration
-			}
-			// Case: random excursion test
-			if (state->is_excursion[test_num] == true) {
-				// Random excursion tests only sample > 0 p_values
-				if (p_value > 0.0) {
-					++sampleCount;
-				} else {
-					// Ignore p_value of 0 for random excursion tests
-					continue;
-				}
-			}
-			// Case: general (non-random excursion) test
-			else {
-				// All other tests count all p_values
-				++sampleCount;
-			}
-
-			// Count the number of p_values below alpha
-			if (p_value < state->tp.alpha) {
-				++toolow;
-			}
-			// Tally the p_value in a uniformity bin
-			if (p_value >= 1.0) {
-				++freqPerBin[state->tp.uniformity_bins - 1];
-			} else if (p_value >= 0.0) {
-				++freqPerBin[(int) floor(p_value * (double) state->tp.uniformity_bins)];
-			} else {
-				++freqPerBin[0];
-			}
-		}
-
 		/*
 		 * Print uniformity and proportional information for a tallied count
 		 */
-		RandomExcursions_metric_print(state, sampleCount, toolow, freqPerBin);
+		sampleCount = tally->sampleCount[j];
+		RandomExcursions_metric_print(state, sampleCount, tally->toolow[j], &tally->freqPerBin[j * tally->bins]);
 
 		/*
 		 * Track maximum samples
@@ -1428,12 +1388,6 @@ RandomExcursions_metrics(struct state *state)
 		}
 	}
 
-	/*
-	 * Free allocated storage
-	 */
-	free(freqPerBin);
-	freqPerBin = NULL;
-
 	return;
 }
 
@@ -1476,10 +1430,18 @@ RandomExcursions_destroy(struct state *state)
 		free(state->p_val[test_num]);
 		state->p_val[test_num] = NULL;
 	}
+	if (state->tally[test_num] != NULL) {
+		free_p_val_tally(state->tally[test_num]);
+		state->tally[test_num] = NULL;
+	}
 
 	/*
 	 * Free other test storage
 	 */
+	if (state->streamCarry[test_num] != NULL) {
+		free(state->streamCarry[test_num]);
+		state->streamCarry[test_num] = NULL;
+	}
 	if (state->datatxt_fmt[test_num] != NULL) {
 		free(state->datatxt_fmt[test_num]);
 		state->datatxt_fmt[test_num] = NULL;
@@ -1492,24 +1454,6 @@ RandomExcursions_destroy(struct state *state)
 		free(state->rnd_excursion_stateX);
 		state->rnd_excursion_stateX = NULL;
 	}
-	for (i = 0; i < state->numberOfThreads; i++) {
-		if (state->rnd_excursion_S[i] != NULL) {
-			free(state->rnd_excursion_S[i]);
-			state->rnd_excursion_S[i] = NULL;
-		}
-		if (state->rnd_excursion_cycle[i] != NULL) {
-			free_dyn_array(state->rnd_excursion_cycle[i]);
-			state->rnd_excursion_cycle[i] = NULL;
-		}
-	}
-	if (state->rnd_excursion_S != NULL) {
-		free(state->rnd_excursion_S);
-		state->rnd_excursion_S = NULL;
-	}
-	if (state->rnd_excursion_cycle != NULL) {
-		free(state->rnd_excursion_cycle);
-		state->rnd_excursion_cycle = NULL;
-	}
 	// Free the theoretical probabilities matrix
 	if (state->rnd_excursion_pi_terms != NULL) {
 
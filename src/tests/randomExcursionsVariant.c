@@ -36,7 +36,9 @@
 #include "../utils/externs.h"
 #include "../utils/cephes.h"
 #include "../utils/utilities.h"
+#include "../utils/stat_fncs.h"
 #include "../utils/debug.h"
+#include "../utils/arena.h"
 
 
 /*
@@ -50,6 +52,16 @@ struct RandomExcursionsVariant_private_stats {
 };
 
 
+/*
+ * Carry - partial results of a bit stream kept between its chunks by each thread
+ */
+struct RandomExcursionsVariant_carry {
+	long int S;		// Partial sum of the -1/+1 states streamed so far
+	long int number_of_cycles;	// Number of cycles ended so far
+	long int visits[2 * MAX_EXCURSION_RND_EXCURSION_VAR + 1];	// Counters of visits to each partial sum value in range
+};
+
+
 /*
  * Static const variables declarations
  */
@@ -139,31 +151,17 @@ RandomExcursionsVariant_init(struct state *state)
 		state->rnd_excursion_var_stateX[NUMBER_OF_STATES_RND_EXCURSION_VAR - MAX_EXCURSION_RND_EXCURSION_VAR + i - 1] = i;
 	}
 
-	/*
-	 * Allocate partial sums working array for each thread
-	 */
-	state->ex_var_partial_sums = malloc((size_t) state->numberOfThreads * sizeof(*state->ex_var_partial_sums));
-	if (state->ex_var_partial_sums == NULL) {
-		errp(190, __func__, "cannot malloc for ex_var_partial_sums: %ld elements of %lu bytes each", state->numberOfThreads,
-		     sizeof(*state->ex_var_partial_sums));
-	}
-	for (i = 0; i < state->numberOfThreads; i++) {
-		state->ex_var_partial_sums[i] = malloc(n * sizeof(state->ex_var_partial_sums[i][0]));
-		if (state->ex_var_partial_sums[i] == NULL) {
-			errp(190, __func__, "cannot malloc of %ld elements of %ld bytes each for state->ex_var_partial_sums[%ld]",
-			     state->tp.n, sizeof(state->ex_var_partial_sums[i][0]), i);
-		}
-	}
-
 	/*
 	 * Allocate dynamic arrays
 	 */
 	if (state->resultstxtFlag == true) {
 		state->stats[test_num] = create_dyn_array(sizeof(struct RandomExcursionsVariant_private_stats),
-							  DEFAULT_CHUNK, state->tp.numOfBitStreams, false);        // stats.txt
+							  DEFAULT_CHUNK, retainedIterations(state), false);        // stats.txt
+	}
+	if (state->p_valTally == false) {
+		state->p_val[test_num] = create_dyn_array(sizeof(double), DEFAULT_CHUNK, NUMBER_OF_STATES_RND_EXCURSION_VAR *
+				retainedIterations(state), false);						// results.txt
 	}
-	state->p_val[test_num] = create_dyn_array(sizeof(double), DEFAULT_CHUNK, NUMBER_OF_STATES_RND_EXCURSION_VAR *
-			state->tp.numOfBitStreams, false);						// results.txt
 
 	/*
 	 * Determine format of data*.txt filenames based on state->partitionCount[test_num]
@@ -173,6 +171,20 @@ RandomExcursionsVariant_init(struct state *state)
 	dbg(DBG_HIGH, "%s[%d] will form data*.txt filenames with the following format: %s",
 	    state->testNames[test_num], test_num, state->datatxt_fmt[test_num]);
 
+	/*
+	 * Allocate the partial results kept by each thread between the chunks of a bit stream
+	 */
+	state->streamCarry[test_num] = calloc((size_t) state->numberOfThreads, sizeof(struct RandomExcursionsVariant_carry));
+	if (state->streamCarry[test_num] == NULL) {
+		errp(160, __func__, "cannot calloc for streamCarry: %ld elements of %lu bytes each", state->numberOfThreads,
+		     sizeof(struct RandomExcursionsVariant_carry));
+	}
+
+	/*
+	 * Reserve the p_values of an iteration in the scratch area of each thread
+	 */
+	arenaReserveScratch(state, test_num, "p_values", NUMBER_OF_STATES_RND_EXCURSION_VAR * sizeof(double));
+
 	return;
 }
 
@@ -189,10 +201,47 @@ RandomExcursionsVariant_init(struct state *state)
  */
 void
 RandomExcursionsVariant_iterate(struct thread_state *thread_state)
+{
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (thread_state == NULL) {
+		err(161, __func__, "thread_state arg is NULL");
+	}
+	if (thread_state->global_state == NULL) {
+		err(161, __func__, "state arg is NULL");
+	}
+
+	/*
+	 * Stream the whole bit stream as a single chunk
+	 */
+	RandomExcursionsVariant_stream(thread_state, 0, thread_state->global_state->tp.n);
+
+	return;
+}
+
+
+/*
+ * RandomExcursionsVariant_stream - stream a chunk of a bit stream to the Random Excursions Variant test
+ *
+ * given:
+ *      thread_state    // current thread state
+ *      first           // index in the bit stream of the first bit of the chunk, 0 starts a new bit stream
+ *      count           // number of bits in the chunk, held by epsilon
+ *
+ * The chunks of a bit stream are streamed in order.  The iteration is recorded with the chunk
+ * that ends the bit stream.
+ *
+ * NOTE: The initialize function must be called before this function is called.
+ */
+void
+RandomExcursionsVariant_stream(struct thread_state *thread_state, long int first, long int count)
 {
 	struct RandomExcursionsVariant_private_stats stat;	// Stats for this iteration
 	long int n;		// Length of a single bit stream
-	long int *S;		// Array of the partial sums of the -1/+1 states
+	struct RandomExcursionsVariant_carry *carry;	// Partial results of the bit stream of this thread
+	BitSequence *epsilon;	// Chunk of the bit stream
+	long int S;		// Partial sum of the -1/+1 states
 	double p_value;		// p_value iteration test result(s)
 	double *p_values;	// Array of p-values produced by this test
 	long int i;
@@ -221,11 +270,8 @@ RandomExcursionsVariant_iterate(struct thread_state *thread_state)
 	if (state->rnd_excursion_var_stateX == NULL) {
 		err(161, __func__, "state->rnd_excursion_var_stateX is NULL");
 	}
-	if (state->ex_var_partial_sums == NULL) {
-		err(161, __func__, "state->ex_var_partial_sums is NULL");
-	}
-	if (state->ex_var_partial_sums[thread_state->thread_id] == NULL) {
-		err(161, __func__, "state->ex_var_partial_sums[%ld] is NULL", thread_state->thread_id);
+	if (state->streamCarry[test_num] == NULL) {
+		err(161, __func__, "state->streamCarry[%d] is NULL", test_num);
 	}
 	if (state->cSetup != true) {
 		err(161, __func__, "test constants not setup prior to calling %s for %s[%d]",
@@ -235,46 +281,56 @@ RandomExcursionsVariant_iterate(struct thread_state *thread_state)
 	/*
 	 * Collect parameters from state
 	 */
-	S = state->ex_var_partial_sums[thread_state->thread_id];
 	n = state->tp.n;
+	epsilon = state->epsilon[thread_state->thread_id];
+	carry = (struct RandomExcursionsVariant_carry *) state->streamCarry[test_num] + thread_state->thread_id;
 
 	/*
-	 * Set the initial value of the counter of the number of cycles
+	 * Zeroize the partial sum and the counters when a new bit stream starts
 	 */
-	stat.number_of_cycles = 0;
+	if (first == 0) {
+		memset(carry, 0, sizeof(*carry));
+	}
+	S = carry->S;
 
 	/*
 	 * Step 2: compute the partial sums of successively larger sub-sequences
 	 */
-	if ((int) state->epsilon[thread_state->thread_id][0] == 1) {
-		S[0] = 1;
-	} else if ((int) state->epsilon[thread_state->thread_id][0] == 0) {
-		S[0] = - 1;
-	} else {
-		err(41, __func__, "found a bit different than 1 or 0 in the sequence");
-	}
-	for (j = 1; j < n; j++) {
-		if ((int) state->epsilon[thread_state->thread_id][j] == 1) {
-			S[j] = S[j - 1] + 1;
-		} else if ((int) state->epsilon[thread_state->thread_id][j] == 0) {
-			S[j] = S[j - 1] - 1;
+	for (j = 0; j < count; j++) {
+		if ((int) epsilon[j] == 1) {
+			S++;
+		} else if ((int) epsilon[j] == 0) {
+			S--;
 		} else {
 			err(41, __func__, "found a bit different than 1 or 0 in the sequence");
 		}
 
 		/*
-		 * Step 3a: whenever a 0 in the partial sums is found, which means that a cycle has
-		 * ended, count a new cycle in the counter of cycles
+		 * Step 4: count times when the partial sum matches each excursion state value
 		 */
-		if (S[j] == 0) {
-			stat.number_of_cycles++;
+		if (labs(S) <= MAX_EXCURSION_RND_EXCURSION_VAR) {
+			carry->visits[S + MAX_EXCURSION_RND_EXCURSION_VAR]++;
 		}
 	}
+	carry->S = S;
+
+	/*
+	 * Wait for the rest of the bit stream
+	 */
+	if (first + count < n) {
+		return;
+	}
+
+	/*
+	 * Step 3a: each 0 in the partial sums means that a cycle has ended,
+	 * so the number of cycles is the number of visits to 0
+	 */
+	stat.number_of_cycles = carry->visits[MAX_EXCURSION_RND_EXCURSION_VAR];
 
 	/*
 	 * Step 3b: count the last cycle if it was not counted already
 	 */
-	if (S[n - 1] != 0) {
+	if (S != 0) {
 		stat.number_of_cycles++;
 	}
 
@@ -288,7 +344,7 @@ RandomExcursionsVariant_iterate(struct thread_state *thread_state)
 	 */
 	if (stat.test_possible == true) {
 
-		p_values = malloc(NUMBER_OF_STATES_RND_EXCURSION_VAR * sizeof(*p_values));
+		p_values = arenaScratch(thread_state, NUMBER_OF_STATES_RND_EXCURSION_VAR * sizeof(*p_values));
 
 		/*
 		 * For each of the state values, compute the test statistic and the p-value
@@ -296,14 +352,9 @@ RandomExcursionsVariant_iterate(struct thread_state *thread_state)
 		for (i = 0; i < NUMBER_OF_STATES_RND_EXCURSION_VAR; i++) {
 
 			/*
-			 * Step 4: count times when the partial sum matches this excursion state value
+			 * Get the number of times when the partial sum matched this excursion state value
 			 */
-			stat.counter[i] = 0;
-			for (j = 0; j < n; j++) {
-				if (S[j] == state->rnd_excursion_var_stateX[i]) {
-					stat.counter[i]++;
-				}
-			}
+			stat.counter[i] = carry->visits[state->rnd_excursion_var_stateX[i] + MAX_EXCURSION_RND_EXCURSION_VAR];
 
 			/*
 			 * Step 5: compute the test p-value for this excursion state value
@@ -363,7 +414,7 @@ RandomExcursionsVariant_iterate(struct thread_state *thread_state)
 			/*
 			 * Record values computed during this iteration
 			 */
-			append_value(state->p_val[test_num], &p_value);
+			record_p_value(state, test_num, i, p_value);
 		}
 
 		/*
@@ -407,7 +458,7 @@ RandomExcursionsVariant_iterate(struct thread_state *thread_state)
 		 */
 		p_value = NON_P_VALUE;
 		for (i = 0; i < NUMBER_OF_STATES_RND_EXCURSION_VAR; i++) {
-			append_value(state->p_val[test_num], &p_value);
+			record_p_value(state, test_num, i, p_value);
 		}
 	}
 
@@ -775,14 +826,14 @@ RandomExcursionsVariant_print(struct state *state)
 	 */
 	stats_txt = filePathName(state->subDir[test_num], "stats.txt");
 	dbg(DBG_HIGH, "about to open/truncate: %s", stats_txt);
-	stats = openTruncate(stats_txt);
+	stats = openPrintFile(state, stats_txt);
 
 	/*
 	 * Open results.txt file
 	 */
 	results_txt = filePathName(state->subDir[test_num], "results.txt");
 	dbg(DBG_HIGH, "about to open/truncate: %s", results_txt);
-	results = openTruncate(results_txt);
+	results = openPrintFile(state, results_txt);
 
 	/*
 	 * Write results.txt and stats.txt files
@@ -798,7 +849,7 @@ RandomExcursionsVariant_print(struct state *state)
 		 * Print stat to stats.txt
 		 */
 		errno = 0;	// paranoia
-		ok = RandomExcursionsVariant_print_stat(stats, state, stat, i);
+		ok = RandomExcursionsVariant_print_stat(stats, state, stat, state->printedIterations + i);
 		if (ok == false) {
 			errp(165, __func__, "error in writing to %s", stats_txt);
 		}
@@ -887,7 +938,7 @@ RandomExcursionsVariant_print(struct state *state)
 			 */
 			data_txt = filePathName(state->subDir[test_num], data_filename);
 			dbg(DBG_HIGH, "about to open/truncate: %s", data_txt);
-			data = openTruncate(data_txt);
+			data = openPrintFile(state, data_txt);
 
 			/*
 			 * Write this particular data*.txt filename
@@ -1101,11 +1152,8 @@ RandomExcursionsVariant_metric_print(struct state *state, long int sampleCount,
 void
 RandomExcursionsVariant_metrics(struct state *state)
 {
-	long int sampleCount;	// Number of bitstreams in which we will count p_values
-	long int toolow;	// p_values that were below alpha
-	double p_value;		// p_value iteration test result(s)
-	long int *freqPerBin;	// Uniformity frequency bins
-	long int i;
+	struct p_val_tally *tally;	// Uniformity and proportion counts of the p_values
+	long int sampleCount;	// Number of bitstreams in which we counted p_values
 	long int j;
 
 	/*
@@ -1124,20 +1172,16 @@ RandomExcursionsVariant_metrics(struct state *state)
 		    "metrics driver interface for %s[%d] called with state.partitionCount: %d < 0",
 		    state->testNames[test_num], test_num, state->partitionCount[test_num]);
 	}
-	if (state->p_val[test_num]->count != (state->tp.numOfBitStreams * state->partitionCount[test_num])) {
-		warn(__func__,
-		     "metrics driver interface for %s[%d] called with p_val length: %ld != bit streams: %ld",
-		     state->testNames[test_num], test_num, state->p_val[test_num]->count,
-		     state->tp.numOfBitStreams * state->partitionCount[test_num]);
-	}
 
 	/*
-	 * Allocate uniformity frequency bins
+	 * Tally the p_values, unless they were tallied as iterations completed
 	 */
-	freqPerBin = malloc(state->tp.uniformity_bins * sizeof(freqPerBin[0]));
-	if (freqPerBin == NULL) {
-		errp(167, __func__, "cannot malloc of %ld elements of %ld bytes each for freqPerBin",
-		     (long int) state->tp.uniformity_bins, sizeof(long int));
+	tally = get_p_val_tally(state, test_num);
+	if (tally->count != (state->tp.numOfBitStreams * state->partitionCount[test_num])) {
+		warn(__func__,
+		     "metrics driver interface for %s[%d] called with p_val length: %ld != bit streams: %ld",
+		     state->testNames[test_num], test_num, tally->count,
+		     state->tp.numOfBitStreams * state->partitionCount[test_num]);
 	}
 
 	/*
@@ -1145,57 +1189,11 @@ RandomExcursionsVariant_metrics(struct state *state)
 	 */
 	for (j = 0; j < state->partitionCount[test_num]; ++j) {
 
-		/*
-		 * Set counters to zero
-		 */
-		toolow = 0;
-		sampleCount = 0;
-		memset(freqPerBin, 0, state->tp.uniformity_bins * sizeof(freqPerBin[0]));
-
-		/*
-		 * Tally p_value
-		 */
-		for (i = j; i < state->p_val[test_num]->count; i += state->partitionCount[test_num]) {
-
-			// Get the iteration p_value
-			p_value = get_value(state->p_val[test_num], double, i);
-			if (p_value == NON_P_VALUE) {
-				continue;	// the test was not possible for this iteration
-			}
-			// Case: random excursion test
-			if (state->is_excursion[test_num] == true) {
-				// Random excursion tests only sample > 0 p_values
-				if (p_value > 0.0) {
-					++sampleCount;
-				} else {
-					// Ignore p_value of 0 for random excursion tests
-					continue;
-				}
-			}
-			// Case: general (non-random excursion) test
-			else {
-				// All other tests count all p_values
-				++sampleCount;
-			}
-
-			// Count the number of p_values below alpha
-			if (p_value < state->tp.alpha) {
-				++toolow;
-			}
-			// Tally the p_value in a uniformity bin
-			if (p_value >= 1.0) {
-				++freqPerBin[state->tp.uniformity_bins - 1];
-			} else if (p_value >= 0.0) {
-				++freqPerBin[(int) floor(p_value * (double) state->tp.uniformity_bins)];
-			} else {
-				++freqPerBin[0];
-			}
-		}
-
 		/*
 		 * Print uniformity and proportional information for a tallied count
 		 */
-		RandomExcursionsVariant_metric_print(state, sampleCount, toolow, freqPerBin);
+		sampleCount = tally->sampleCount[j];
+		RandomExcursionsVariant_metric_print(state, sampleCount, tally->toolow[j], &tally->freqPerBin[j * tally->bins]);
 
 		/*
 		 * Track maximum samples
@@ -1211,12 +1209,6 @@ RandomExcursionsVariant_metrics(struct state *state)
 		}
 	}
 
-	/*
-	 * Free allocated storage
-	 */
-	free(freqPerBin);
-	freqPerBin = NULL;
-
 	return;
 }
 
@@ -1233,8 +1225,6 @@ RandomExcursionsVariant_metrics(struct state *state)
 void
 RandomExcursionsVariant_destroy(struct state *state)
 {
-	long int i;
-
 	/*
 	 * Check preconditions (firewall)
 	 */
@@ -1259,10 +1249,18 @@ RandomExcursionsVariant_destroy(struct state *state)
 		free(state->p_val[test_num]);
 		state->p_val[test_num] = NULL;
 	}
+	if (state->tally[test_num] != NULL) {
+		free_p_val_tally(state->tally[test_num]);
+		state->tally[test_num] = NULL;
+	}
 
 	/*
 	 * Free other test storage
 	 */
+	if (state->streamCarry[test_num] != NULL) {
+		free(state->streamCarry[test_num]);
+		state->streamCarry[test_num] = NULL;
+	}
 	if (state->datatxt_fmt[test_num] != NULL) {
 		free(state->datatxt_fmt[test_num]);
 		state->datatxt_fmt[test_num] = NULL;
@@ -1275,16 +1273,6 @@ RandomExcursionsVariant_destroy(struct state *state)
 		free(state->rnd_excursion_var_stateX);
 		state->rnd_excursion_var_stateX = NULL;
 	}
-	for (i = 0; i < state->numberOfThreads; i++) {
-		if (state->ex_var_partial_sums[i] != NULL) {
-			free(state->ex_var_partial_sums[i]);
-			state->ex_var_partial_sums[i] = NULL;
-		}
-	}
-	if (state->ex_var_partial_sums != NULL) {
-		free(state->ex_var_partial_sums);
-		state->ex_var_partial_sums = NULL;
-	}
 
 	return;
 }
@@ -38,7 +38,9 @@
 #include "../utils/cephes.h"
 #include "../utils/matrix.h"
 #include "../utils/utilities.h"
+#include "../utils/stat_fncs.h"
 #include "../utils/debug.h"
+#include "../utils/arena.h"
 
 
 /*
@@ -53,6 +55,15 @@ struct Rank_private_stats {
 };
 
 
+/*
+ * Carry - partial results of a bit stream kept between its chunks by each thread
+ */
+struct Rank_carry {
+	long int F_M;		// Frequency of rank NUMBER_OF_ROWS_RANK of the matrices streamed so far
+	long int F_M_minus_one;	// Frequency of rank NUMBER_OF_ROWS_RANK-1 of the matrices streamed so far
+};
+
+
 /*
  * Static const variables declarations
  */
@@ -92,6 +103,7 @@ Rank_init(struct state *state)
 	double product;			// Probability product, used when computing values of static variables
 	int r;				// Row count to consider, used when computing values of static variables
 	int i;
+	int j;
 
 	/*
 	 * Check preconditions (firewall)
@@ -180,13 +192,21 @@ Rank_init(struct state *state)
 	/*
 	 * Allocate the array for the rank test matrices for each thread
 	 */
-	state->rank_matrix = malloc((size_t) state->numberOfThreads * sizeof(*state->rank_matrix));
+	state->rank_matrix = calloc((size_t) state->numberOfThreads + 1, sizeof(*state->rank_matrix));
 	if (state->rank_matrix == NULL) {
-		errp(50, __func__, "cannot malloc for rank_matrix: %ld elements of %ld bytes each", state->numberOfThreads,
+		errp(50, __func__, "cannot calloc for rank_matrix: %ld elements of %ld bytes each", state->numberOfThreads + 1,
 		     sizeof(*state->rank_matrix));
 	}
 	for (i = 0; i < state->numberOfThreads; i++) {
-		state->rank_matrix[i] = create_matrix(NUMBER_OF_ROWS_RANK, NUMBER_OF_COLS_RANK);
+		state->rank_matrix[i] = calloc(NUMBER_OF_ROWS_RANK, sizeof(state->rank_matrix[i][0]));
+		if (state->rank_matrix[i] == NULL) {
+			errp(50, __func__, "cannot calloc for rank_matrix[%d]: %d elements of %ld bytes each", i,
+			     NUMBER_OF_ROWS_RANK, sizeof(state->rank_matrix[i][0]));
+		}
+		for (j = 0; j < NUMBER_OF_ROWS_RANK; j++) {
+			arenaAlloc(state, i, test_num, "rank_matrix", NUMBER_OF_COLS_RANK * sizeof(state->rank_matrix[i][j][0]),
+				   &state->rank_matrix[i][j]);
+		}
 	}
 
 	/*
@@ -202,10 +222,12 @@ Rank_init(struct state *state)
 	 */
 	if (state->resultstxtFlag == true) {
 		state->stats[test_num] = create_dyn_array(sizeof(struct Rank_private_stats),
-							  DEFAULT_CHUNK, state->tp.numOfBitStreams, false);        // stats.txt
+							  DEFAULT_CHUNK, retainedIterations(state), false);        // stats.txt
+	}
+	if (state->p_valTally == false) {
+		state->p_val[test_num] = create_dyn_array(sizeof(double),
+							  DEFAULT_CHUNK, retainedIterations(state), false);	// results.txt
 	}
-	state->p_val[test_num] = create_dyn_array(sizeof(double),
-						  DEFAULT_CHUNK, state->tp.numOfBitStreams, false);	// results.txt
 
 	/*
 	 * Determine format of data*.txt filenames based on state->partitionCount[test_num]
@@ -215,6 +237,15 @@ Rank_init(struct state *state)
 	dbg(DBG_HIGH, "%s[%d] will form data*.txt filenames with the following format: %s",
 	    state->testNames[test_num], test_num, state->datatxt_fmt[test_num]);
 
+	/*
+	 * Allocate the partial results kept by each thread between the chunks of a bit stream
+	 */
+	state->streamCarry[test_num] = calloc((size_t) state->numberOfThreads, sizeof(struct Rank_carry));
+	if (state->streamCarry[test_num] == NULL) {
+		errp(170, __func__, "cannot calloc for streamCarry: %ld elements of %lu bytes each", state->numberOfThreads,
+		     sizeof(struct Rank_carry));
+	}
+
 	return;
 }
 
@@ -231,13 +262,52 @@ Rank_init(struct state *state)
  */
 void
 Rank_iterate(struct thread_state *thread_state)
+{
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (thread_state == NULL) {
+		err(171, __func__, "thread_state arg is NULL");
+	}
+	if (thread_state->global_state == NULL) {
+		err(171, __func__, "state arg is NULL");
+	}
+
+	/*
+	 * Stream the whole bit stream as a single chunk
+	 */
+	Rank_stream(thread_state, 0, thread_state->global_state->tp.n);
+
+	return;
+}
+
+
+/*
+ * Rank_stream - stream a chunk of a bit stream to the Rank test
+ *
+ * given:
+ *      thread_state    // current thread state
+ *      first           // index in the bit stream of the first bit of the chunk, 0 starts a new bit stream
+ *      count           // number of bits in the chunk, held by epsilon
+ *
+ * The chunks of a bit stream are streamed in order.  The iteration is recorded with the chunk
+ * that ends the bit stream.
+ *
+ * NOTE: The initialize function must be called before this function is called.
+ */
+void
+Rank_stream(struct thread_state *thread_state, long int first, long int count)
 {
 	struct Rank_private_stats stat;	// Stats for this iteration
 	BitSequence **matrix;		// The matrix state->rank_matrix
 	BitSequence *row;		// A row of the matrix state->rank_matrix
 	int R;				// Rank of a given NUMBER_OF_ROWS_RANK by NUMBER_OF_COLS_RANK matrix
 	double p_value;			// p_value iteration test result(s)
-	long int k;
+	struct Rank_carry *carry;	// Partial results of the bit stream of this thread
+	BitSequence *epsilon;		// Chunk of the bit stream
+	long int end;			// Number of bits of the chunk that are in one of the matrices
+	long int offset;		// Index in its matrix of the bit being copied
+	long int len;			// Number of bits copied at once into a row of the matrix
 	long int i;
 
 	/*
@@ -266,6 +336,9 @@ Rank_iterate(struct thread_state *thread_state)
 	if (state->rank_matrix[thread_state->thread_id] == NULL) {
 		err(171, __func__, "state->rank_matrix[%ld] is NULL", thread_state->thread_id);
 	}
+	if (state->streamCarry[test_num] == NULL) {
+		err(171, __func__, "state->streamCarry[%d] is NULL", test_num);
+	}
 	if (state->cSetup != true) {
 		err(171, __func__, "test constants not setup prior to calling %s for %s[%d]",
 		    __func__, state->testNames[test_num], test_num);
@@ -275,37 +348,51 @@ Rank_iterate(struct thread_state *thread_state)
 	 * Setup test parameters
 	 */
 	matrix = state->rank_matrix[thread_state->thread_id];
-	stat.F_M = 0;
-	stat.F_M_minus_one = 0;
-
-	/*
-	 * Zeroize the Rank test matrix
-	 */
-	for (i = 0; i < NUMBER_OF_ROWS_RANK; ++i) {
+	epsilon = state->epsilon[thread_state->thread_id];
+	carry = (struct Rank_carry *) state->streamCarry[test_num] + thread_state->thread_id;
+	if (first == 0) {
+		carry->F_M = 0;
+		carry->F_M_minus_one = 0;
 
 		/*
-		 * Find the row
+		 * Zeroize the Rank test matrix
 		 */
-		row = matrix[i];
-		if (row == NULL) {	// paranoia
-			err(171, __func__, "row pointer %ld of rank_matrix is NULL", i);
-		}
+		for (i = 0; i < NUMBER_OF_ROWS_RANK; ++i) {
 
-		/*
-		 * Zeroize the full row
-		 */
-		memset(row, 0, NUMBER_OF_COLS_RANK * sizeof(row[0]));
+			/*
+			 * Find the row
+			 */
+			row = matrix[i];
+			if (row == NULL) {	// paranoia
+				err(171, __func__, "row pointer %ld of rank_matrix is NULL", i);
+			}
+
+			/*
+			 * Zeroize the full row
+			 */
+			memset(row, 0, NUMBER_OF_COLS_RANK * sizeof(row[0]));
+		}
 	}
+	stat.F_M = carry->F_M;
+	stat.F_M_minus_one = carry->F_M_minus_one;
 
 	/*
 	 * Step 1a: divide the sequence into disjoint blocks of NUMBER_OF_ROWS_RANK * NUMBER_OF_COLS_RANK bits
 	 */
-	for (k = 0; k < matrix_count; k++) {
+	end = MIN(count, matrix_count * (NUMBER_OF_ROWS_RANK * NUMBER_OF_COLS_RANK) - first);
+	for (i = 0; i < end; i += len) {
 
 		/*
-	 	 * Step 1b: copy bits of each block into a NUMBER_OF_ROWS_RANK * NUMBER_OF_COLS_RANK matrix
+	 	 * Step 1b: copy bits of each block into a NUMBER_OF_ROWS_RANK * NUMBER_OF_COLS_RANK matrix,
+		 * up to the end of a row, as a block may span chunks
 	 	 */
-		def_matrix(thread_state, NUMBER_OF_ROWS_RANK, NUMBER_OF_COLS_RANK, matrix, k);
+		offset = (first + i) % (NUMBER_OF_ROWS_RANK * NUMBER_OF_COLS_RANK);
+		len = MIN(end - i, NUMBER_OF_COLS_RANK - offset % NUMBER_OF_COLS_RANK);
+		memcpy(&matrix[offset / NUMBER_OF_COLS_RANK][offset % NUMBER_OF_COLS_RANK], epsilon + i,
+		       len * sizeof(epsilon[0]));
+		if (offset + len < NUMBER_OF_ROWS_RANK * NUMBER_OF_COLS_RANK) {
+			continue;	// The block goes on
+		}
 
 		/*
 	 	 * Step 2: determine the binary rank of each matrix
@@ -321,6 +408,15 @@ Rank_iterate(struct thread_state *thread_state)
 			stat.F_M_minus_one++;	// rank NUMBER_OF_ROWS_RANK-1 found
 		}
 	}
+	carry->F_M = stat.F_M;
+	carry->F_M_minus_one = stat.F_M_minus_one;
+
+	/*
+	 * Wait for the rest of the bit stream
+	 */
+	if (first + count < state->tp.n) {
+		return;
+	}
 
 	/*
 	 * Step 3b: count the number of matrices with rank less than (full rank - 1)
@@ -383,7 +479,7 @@ Rank_iterate(struct thread_state *thread_state)
 	if (state->resultstxtFlag == true) {
 		append_value(state->stats[test_num], &stat);
 	}
-	append_value(state->p_val[test_num], &p_value);
+	record_p_value(state, test_num, 0, p_value);
 
 	/*
 	 * Unlock mutex after making changes to the shared state
@@ -650,14 +746,14 @@ Rank_print(struct state *state)
 	 */
 	stats_txt = filePathName(state->subDir[test_num], "stats.txt");
 	dbg(DBG_HIGH, "about to open/truncate: %s", stats_txt);
-	stats = openTruncate(stats_txt);
+	stats = openPrintFile(state, stats_txt);
 
 	/*
 	 * Open results.txt file
 	 */
 	results_txt = filePathName(state->subDir[test_num], "results.txt");
 	dbg(DBG_HIGH, "about to open/truncate: %s", results_txt);
-	results = openTruncate(results_txt);
+	results = openPrintFile(state, results_txt);
 
 	/*
 	 * Write results.txt and stats.txt files
@@ -747,7 +843,7 @@ Rank_print(struct state *state)
 			 */
 			data_txt = filePathName(state->subDir[test_num], data_filename);
 			dbg(DBG_HIGH, "about to open/truncate: %s", data_txt);
-			data = openTruncate(data_txt);
+			data = openPrintFile(state, data_txt);
 
 			/*
 			 * Write this particular data*.txt filename
@@ -961,11 +1057,8 @@ Rank_metric_print(struct state *state, long int sampleCount, long int toolow, lo
 void
 Rank_metrics(struct state *state)
 {
-	long int sampleCount;	// Number of bitstreams in which we will count p_values
-	long int toolow;	// p_values that were below alpha
-	double p_value;		// p_value iteration test result(s)
-	long int *freqPerBin;	// Uniformity frequency bins
-	long int i;
+	struct p_val_tally *tally;	// Uniformity and proportion counts of the p_values
+	long int sampleCount;	// Number of bitstreams in which we counted p_values
 	long int j;
 
 	/*
@@ -984,20 +1077,16 @@ Rank_metrics(struct state *state)
 		    "metrics driver interface for %s[%d] called with state.partitionCount: %d < 0",
 		    state->testNames[test_num], test_num, state->partitionCount[test_num]);
 	}
-	if (state->p_val[test_num]->count != (state->tp.numOfBitStreams * state->partitionCount[test_num])) {
-		warn(__func__,
-		     "metrics driver interface for %s[%d] called with p_val length: %ld != bit streams: %ld",
-		     state->testNames[test_num], test_num, state->p_val[test_num]->count,
-		     state->tp.numOfBitStreams * state->partitionCount[test_num]);
-	}
 
 	/*
-	 * Allocate uniformity frequency bins
+	 * Tally the p_values, unless they were tallied as iterations completed
 	 */
-	freqPerBin = malloc(state->tp.uniformity_bins * sizeof(freqPerBin[0]));
-	if (freqPerBin == NULL) {
-		errp(176, __func__, "cannot malloc of %ld elements of %ld bytes each for freqPerBin",
-		     state->tp.uniformity_bins, sizeof(long int));
+	tally = get_p_val_tally(state, test_num);
+	if (tally->count != (state->tp.numOfBitStreams * state->partitionCount[test_num])) {
+		warn(__func__,
+		     "metrics driver interface for %s[%d] called with p_val length: %ld != bit streams: %ld",
+		     state->testNames[test_num], test_num, tally->count,
+		     state->tp.numOfBitStreams * state->partitionCount[test_num]);
 	}
 
 	/*
@@ -1005,57 +1094,11 @@ Rank_metrics(struct state *state)
 	 */
 	for (j = 0; j < state->partitionCount[test_num]; ++j) {
 
-		/*
-		 * Set counters to zero
-		 */
-		toolow = 0;
-		sampleCount = 0;
-		memset(freqPerBin, 0, state->tp.uniformity_bins * sizeof(freqPerBin[0]));
-
-		/*
-		 * Tally p_value
-		 */
-		for (i = j; i < state->p_val[test_num]->count; i += state->partitionCount[test_num]) {
-
-			// Get the iteration p_value
-			p_value = get_value(state->p_val[test_num], double, i);
-			if (p_value == NON_P_VALUE) {
-				continue;	// the test was not possible for this iteration
-			}
-			// Case: random excursion test
-			if (state->is_excursion[test_num] == true) {
-				// Random excursion tests only sample > 0 p_values
-				if (p_value > 0.0) {
-					++sampleCount;
-				} else {
-					// Ignore p_value of 0 for random excursion tests
-					continue;
-				}
-			}
-			// Case: general (non-random excursion) test
-			else {
-				// All other tests count all p_values
-				++sampleCount;
-			}
-
-			// Count the number of p_values below alpha
-			if (p_value < state->tp.alpha) {
-				++toolow;
-			}
-			// Tally the p_value in a uniformity bin
-			if (p_value >= 1.0) {
-				++freqPerBin[state->tp.uniformity_bins - 1];
-			} else if (p_value >= 0.0) {
-				++freqPerBin[(int) floor(p_value * (double) state->tp.uniformity_bins)];
-			} else {
-				++freqPerBin[0];
-			}
-		}
-
 		/*
 		 * Print uniformity and proportional information for a tallied count
 		 */
-		Rank_metric_print(state, sampleCount, toolow, freqPerBin);
+		sampleCount = tally->sampleCount[j];
+		Rank_metric_print(state, sampleCount, tally->toolow[j], &tally->freqPerBin[j * tally->bins]);
 
 		/*
 		 * Track maximum samples
@@ -1071,12 +1114,6 @@ Rank_metrics(struct state *state)
 		}
 	}
 
-	/*
-	 * Free allocated storage
-	 */
-	free(freqPerBin);
-	freqPerBin = NULL;
-
 	return;
 }
 
@@ -1093,7 +1130,7 @@ Rank_metrics(struct state *state)
 void
 Rank_destroy(struct state *state)
 {
-	int i, j;
+	int i;
 
 	/*
 	 * Check preconditions (firewall)
@@ -1119,10 +1156,18 @@ Rank_destroy(struct state *state)
 		free(state->p_val[test_num]);
 		state->p_val[test_num] = NULL;
 	}
+	if (state->tally[test_num] != NULL) {
+		free_p_val_tally(state->tally[test_num]);
+		state->tally[test_num] = NULL;
+	}
 
 	/*
 	 * Free other test storage
 	 */
+	if (state->streamCarry[test_num] != NULL) {
+		free(state->streamCarry[test_num]);
+		state->streamCarry[test_num] = NULL;
+	}
 	if (state->datatxt_fmt[test_num] != NULL) {
 		free(state->datatxt_fmt[test_num]);
 		state->datatxt_fmt[test_num] = NULL;
@@ -1133,21 +1178,14 @@ Rank_destroy(struct state *state)
 	}
 
 	/*
-	 * Free the matrices for each thread
+	 * Free the matrices for each thread, whose rows are in the arenas
+	 *
+	 * The matrices are NULL terminated, so that they are all freed even if -M ran fewer threads.
 	 */
-	for (i = 0; i < state->numberOfThreads; i++) {
-		if (state->rank_matrix[i] != NULL) {
-			for (j = 0; j < NUMBER_OF_ROWS_RANK; j++) {
-				if (state->rank_matrix[i][j] != NULL) {
-					free(state->rank_matrix[i][j]);
-					state->rank_matrix[i][j] = NULL;
-				}
-			}
+	if (state->rank_matrix != NULL) {
+		for (i = 0; state->rank_matrix[i] != NULL; i++) {
 			free(state->rank_matrix[i]);
-			state->rank_matrix[i] = NULL;
 		}
-	}
-	if (state->rank_matrix != NULL) {
 		free(state->rank_matrix);
 		state->rank_matrix = NULL;
 	}
@@ -36,6 +36,7 @@
 #include "../utils/externs.h"
 #include "../utils/cephes.h"
 #include "../utils/utilities.h"
+#include "../utils/stat_fncs.h"
 #include "../utils/debug.h"
 
 
@@ -51,6 +52,16 @@ struct Runs_private_stats {
 };
 
 
+/*
+ * Carry - partial results of a bit stream kept between its chunks by each thread
+ */
+struct Runs_carry {
+	long int S;		// Number of 1 bits streamed so far
+	long int V_n;		// Number of runs streamed so far, the last one may go on
+	BitSequence last;	// Last bit streamed
+};
+
+
 /*
  * Static const variables declarations
  */
@@ -141,10 +152,12 @@ Runs_init(struct state *state)
 	 */
 	if (state->resultstxtFlag == true) {
 		state->stats[test_num] = create_dyn_array(sizeof(struct Runs_private_stats),
-							  DEFAULT_CHUNK, state->tp.numOfBitStreams, false);        // stats.txt
+							  DEFAULT_CHUNK, retainedIterations(state), false);        // stats.txt
+	}
+	if (state->p_valTally == false) {
+		state->p_val[test_num] = create_dyn_array(sizeof(double),
+							  DEFAULT_CHUNK, retainedIterations(state), false);	// results.txt
 	}
-	state->p_val[test_num] = create_dyn_array(sizeof(double),
-						  DEFAULT_CHUNK, state->tp.numOfBitStreams, false);	// results.txt
 
 	/*
 	 * Determine format of data*.txt filenames based on state->partitionCount[test_num]
@@ -154,6 +167,15 @@ Runs_init(struct state *state)
 	dbg(DBG_HIGH, "%s[%d] will form data*.txt filenames with the following format: %s",
 	    state->testNames[test_num], test_num, state->datatxt_fmt[test_num]);
 
+	/*
+	 * Allocate the partial results kept by each thread between the chunks of a bit stream
+	 */
+	state->streamCarry[test_num] = calloc((size_t) state->numberOfThreads, sizeof(struct Runs_carry));
+	if (state->streamCarry[test_num] == NULL) {
+		errp(180, __func__, "cannot calloc for streamCarry: %ld elements of %lu bytes each", state->numberOfThreads,
+		     sizeof(struct Runs_carry));
+	}
+
 	return;
 }
 
@@ -170,12 +192,50 @@ Runs_init(struct state *state)
  */
 void
 Runs_iterate(struct thread_state *thread_state)
+{
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (thread_state == NULL) {
+		err(181, __func__, "thread_state arg is NULL");
+	}
+	if (thread_state->global_state == NULL) {
+		err(181, __func__, "state arg is NULL");
+	}
+
+	/*
+	 * Stream the whole bit stream as a single chunk
+	 */
+	Runs_stream(thread_state, 0, thread_state->global_state->tp.n);
+
+	return;
+}
+
+
+/*
+ * Runs_stream - stream a chunk of a bit stream to the Runs test
+ *
+ * given:
+ *      thread_state    // current thread state
+ *      first           // index in the bit stream of the first bit of the chunk, 0 starts a new bit stream
+ *      count           // number of bits in the chunk, held by epsilon
+ *
+ * The chunks of a bit stream are streamed in order.  The iteration is recorded with the chunk
+ * that ends the bit stream.
+ *
+ * NOTE: The initialize function must be called before this function is called.
+ */
+void
+Runs_stream(struct thread_state *thread_state, long int first, long int count)
 {
 	struct Runs_private_stats stat;	// Stats for this iteration
 	long int n;			// Length of a single bit stream
 	long int S;			// Number of 1 bits in the sequence
 	double p_value;			// p_value iteration test result(s)
 	long int k;
+	struct Runs_carry *carry;	// Partial results of the bit stream of this thread
+	BitSequence *epsilon;		// Chunk of the bit stream
+	long int V_n;			// Number of runs streamed so far
 
 	/*
 	 * Check preconditions (firewall)
@@ -197,6 +257,9 @@ Runs_iterate(struct thread_state *thread_state)
 	if (state->epsilon[thread_state->thread_id] == NULL) {
 		err(181, __func__, "state->epsilon[%ld] is NULL", thread_state->thread_id);
 	}
+	if (state->streamCarry[test_num] == NULL) {
+		err(181, __func__, "state->streamCarry[%d] is NULL", test_num);
+	}
 	if (state->cSetup != true) {
 		err(181, __func__, "test constants not setup prior to calling %s for %s[%d]",
 		    __func__, state->testNames[test_num], test_num);
@@ -206,16 +269,46 @@ Runs_iterate(struct thread_state *thread_state)
 	 * Collect parameters from state
 	 */
 	n = state->tp.n;
+	epsilon = state->epsilon[thread_state->thread_id];
+	carry = (struct Runs_carry *) state->streamCarry[test_num] + thread_state->thread_id;
+	if (first == 0) {
+		carry->S = 0;
+		carry->V_n = 1;
+		carry->last = epsilon[0];
+	}
 
 	/*
 	 * Step 1: determine the proportion of ones in the input sequence
 	 */
-	S = 0;
-	for (k = 0; k < n; k++) {
-		if (state->epsilon[thread_state->thread_id][k]) {
+	S = carry->S;
+	for (k = 0; k < count; k++) {
+		if (epsilon[k]) {
 			S++;
 		}
 	}
+	carry->S = S;
+
+	/*
+	 * Count the runs of step 3 as the chunks go by, the test statistic needs the whole bit stream
+	 */
+	V_n = carry->V_n;
+	if (epsilon[0] != carry->last) {
+		V_n++;
+	}
+	for (k = 1; k < count; k++) {
+		if (epsilon[k] != epsilon[k - 1]) {
+			V_n++;
+		}
+	}
+	carry->V_n = V_n;
+	carry->last = epsilon[count - 1];
+
+	/*
+	 * Wait for the rest of the bit stream
+	 */
+	if (first + count < n) {
+		return;
+	}
 	stat.pi = (double) S / (double) n;
 
 	/*
@@ -231,12 +324,7 @@ Runs_iterate(struct thread_state *thread_state)
 		/*
 		 * Step 3: compute the test statistic
 		 */
-		stat.V_n = 1;
-		for (k = 1; k < n; k++) {
-			if (state->epsilon[thread_state->thread_id][k] != state->epsilon[thread_state->thread_id][k - 1]) {
-				stat.V_n++;
-			}
-		}
+		stat.V_n = V_n;
 
 		/*
 		 * Step 4: compute the test P-value
@@ -283,7 +371,7 @@ Runs_iterate(struct thread_state *thread_state)
 		if (state->resultstxtFlag == true) {
 			append_value(state->stats[test_num], &stat);
 		}
-		append_value(state->p_val[test_num], &p_value);
+		record_p_value(state, test_num, 0, p_value);
 	}
 
 	/*
@@ -319,7 +407,7 @@ Runs_iterate(struct thread_state *thread_state)
 		 * Record non p-value of this invalid iteration
 		 */
 		p_value = NON_P_VALUE;
-		append_value(state->p_val[test_num], &p_value);
+		record_p_value(state, test_num, 0, p_value);
 	}
 
 	/*
@@ -611,14 +699,14 @@ Runs_print(struct state *state)
 	 */
 	stats_txt = filePathName(state->subDir[test_num], "stats.txt");
 	dbg(DBG_HIGH, "about to open/truncate: %s", stats_txt);
-	stats = openTruncate(stats_txt);
+	stats = openPrintFile(state, stats_txt);
 
 	/*
 	 * Open results.txt file
 	 */
 	results_txt = filePathName(state->subDir[test_num], "results.txt");
 	dbg(DBG_HIGH, "about to open/truncate: %s", results_txt);
-	results = openTruncate(results_txt);
+	results = openPrintFile(state, results_txt);
 
 	/*
 	 * Write results.txt and stats.txt files
@@ -708,7 +796,7 @@ Runs_print(struct state *state)
 			 */
 			data_txt = filePathName(state->subDir[test_num], data_filename);
 			dbg(DBG_HIGH, "about to open/truncate: %s", data_txt);
-			data = openTruncate(data_txt);
+			data = openPrintFile(state, data_txt);
 
 			/*
 			 * Write this particular data*.txt filename
@@ -922,11 +1010,8 @@ Runs_metric_print(struct state *state, long int sampleCount, long int toolow, lo
 void
 Runs_metrics(struct state *state)
 {
-	long int sampleCount;	// Number of bitstreams in which we will count p_values
-	long int toolow;	// p_values that were below alpha
-	double p_value;		// p_value iteration test result(s)
-	long int *freqPerBin;	// Uniformity frequency bins
-	long int i;
+	struct p_val_tally *tally;	// Uniformity and proportion counts of the p_values
+	long int sampleCount;	// Number of bitstreams in which we counted p_values
 	long int j;
 
 	/*
@@ -945,20 +1030,16 @@ Runs_metrics(struct state *state)
 		    "metrics driver interface for %s[%d] called with state.partitionCount: %d < 0",
 		    state->testNames[test_num], test_num, state->partitionCount[test_num]);
 	}
-	if (state->p_val[test_num]->count != (state->tp.numOfBitStreams * state->partitionCount[test_num])) {
-		warn(__func__,
-		     "metrics driver interface for %s[%d] called with p_val length: %ld != bit streams: %ld",
-		     state->testNames[test_num], test_num, state->p_val[test_num]->count,
-		     state->tp.numOfBitStreams * state->partitionCount[test_num]);
-	}
 
 	/*
-	 * Allocate uniformity frequency bins
+	 * Tally the p_values, unless they were tallied as iterations completed
 	 */
-	freqPerBin = malloc(state->tp.uniformity_bins * sizeof(freqPerBin[0]));
-	if (freqPerBin == NULL) {
-		errp(186, __func__, "cannot malloc of %ld elements of %ld bytes each for freqPerBin",
-		     state->tp.uniformity_bins, sizeof(long int));
+	tally = get_p_val_tally(state, test_num);
+	if (tally->count != (state->tp.numOfBitStreams * state->partitionCount[test_num])) {
+		warn(__func__,
+		     "metrics driver interface for %s[%d] called with p_val length: %ld != bit streams: %ld",
+		     state->testNames[test_num], test_num, tally->count,
+		     state->tp.numOfBitStreams * state->partitionCount[test_num]);
 	}
 
 	/*
@@ -966,57 +1047,11 @@ Runs_metrics(struct state *state)
 	 */
 	for (j = 0; j < state->partitionCount[test_num]; ++j) {
 
-		/*
-		 * Set counters to zero
-		 */
-		toolow = 0;
-		sampleCount = 0;
-		memset(freqPerBin, 0, state->tp.uniformity_bins * sizeof(freqPerBin[0]));
-
-		/*
-		 * Tally p_value
-		 */
-		for (i = j; i < state->p_val[test_num]->count; i += state->partitionCount[test_num]) {
-
-			// Get the iteration p_value
-			p_value = get_value(state->p_val[test_num], double, i);
-			if (p_value == NON_P_VALUE) {
-				continue;	// the test was not possible for this iteration
-			}
-			// Case: random excursion test
-			if (state->is_excursion[test_num] == true) {
-				// Random excursion tests only sample > 0 p_values
-				if (p_value > 0.0) {
-					++sampleCount;
-				} else {
-					// Ignore p_value of 0 for random excursion tests
-					continue;
-				}
-			}
-			// Case: general (non-random excursion) test
-			else {
-				// All other tests count all p_values
-				++sampleCount;
-			}
-
-			// Count the number of p_values below alpha
-			if (p_value < state->tp.alpha) {
-				++toolow;
-			}
-			// Tally the p_value in a uniformity bin
-			if (p_value >= 1.0) {
-				++freqPerBin[state->tp.uniformity_bins - 1];
-			} else if (p_value >= 0.0) {
-				++freqPerBin[(int) floor(p_value * (double) state->tp.uniformity_bins)];
-			} else {
-				++freqPerBin[0];
-			}
-		}
-
 		/*
 		 * Print uniformity and proportional information for a tallied count
 		 */
-		Runs_metric_print(state, sampleCount, toolow, freqPerBin);
+		sampleCount = tally->sampleCount[j];
+		Runs_metric_print(state, sampleCount, tally->toolow[j], &tally->freqPerBin[j * tally->bins]);
 
 		/*
 		 * Track maximum samples
@@ -1032,12 +1067,6 @@ Runs_metrics(struct state *state)
 		}
 	}
 
-	/*
-	 * Free allocated storage
-	 */
-	free(freqPerBin);
-	freqPerBin = NULL;
-
 	return;
 }
 
@@ -1078,10 +1107,18 @@ Runs_destroy(struct state *state)
 		free(state->p_val[test_num]);
 		state->p_val[test_num] = NULL;
 	}
+	if (state->tally[test_num] != NULL) {
+		free_p_val_tally(state->tally[test_num]);
+		state->tally[test_num] = NULL;
+	}
 
 	/*
 	 * Free other test storage
 	 */
+	if (state->streamCarry[test_num] != NULL) {
+		free(state->streamCarry[test_num]);
+		state->streamCarry[test_num] = NULL;
+	}
 	if (state->datatxt_fmt[test_num] != NULL) {
 		free(state->datatxt_fmt[test_num]);
 		state->datatxt_fmt[test_num] = NULL;
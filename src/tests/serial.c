@@ -36,7 +36,9 @@
 #include "../utils/externs.h"
 #include "../utils/cephes.h"
 #include "../utils/utilities.h"
+#include "../utils/stat_fncs.h"
 #include "../utils/debug.h"
+#include "../utils/arena.h"
 
 
 /*
@@ -53,6 +55,15 @@ struct Serial_private_stats {
 };
 
 
+/*
+ * Carry - partial results of a bit stream kept between its chunks by each thread
+ */
+struct Serial_carry {
+	unsigned long word;	// Last m bits streamed so far
+	unsigned long head;	// First m - 1 bits of the bit stream, needed to wrap around its end
+};
+
+
 /*
  * Static const variables declarations
  */
@@ -129,11 +140,7 @@ Serial_init(struct state *state)
 		     sizeof(*state->serial_v));
 	}
 	for (i = 0; i < state->numberOfThreads; i++) {
-		state->serial_v[i] = malloc(state->serial_v_len * sizeof(state->serial_v[i][0]));
-		if (state->serial_v[i] == NULL) {
-			errp(190, __func__, "cannot malloc of %ld elements of %ld bytes each for state->serial_v[%ld]",
-			     state->serial_v_len, sizeof(state->universal_T[i][0]), i);
-		}
+		arenaAlloc(state, i, test_num, "serial_v", state->serial_v_len * sizeof(state->serial_v[i][0]), &state->serial_v[i]);
 	}
 
 	/*
@@ -149,10 +156,12 @@ Serial_init(struct state *state)
 	 */
 	if (state->resultstxtFlag == true) {
 		state->stats[test_num] = create_dyn_array(sizeof(struct Serial_private_stats),
-							  DEFAULT_CHUNK, state->tp.numOfBitStreams, false);        // stats.txt
+							  DEFAULT_CHUNK, retainedIterations(state), false);        // stats.txt
+	}
+	if (state->p_valTally == false) {
+		state->p_val[test_num] = create_dyn_array(sizeof(double),
+							  DEFAULT_CHUNK, 2 * retainedIterations(state), false);	// results.txt data
 	}
-	state->p_val[test_num] = create_dyn_array(sizeof(double),
-						  DEFAULT_CHUNK, 2 * state->tp.numOfBitStreams, false);	// results.txt data
 
 	/*
 	 * Determine format of data*.txt filenames based on state->partitionCount[test_num]
@@ -162,6 +171,15 @@ Serial_init(struct state *state)
 	dbg(DBG_HIGH, "%s[%d] will form data*.txt filenames with the following format: %s",
 	    state->testNames[test_num], test_num, state->datatxt_fmt[test_num]);
 
+	/*
+	 * Allocate the partial results kept by each thread between the chunks of a bit stream
+	 */
+	state->streamCarry[test_num] = calloc((size_t) state->numberOfThreads, sizeof(struct Serial_carry));
+	if (state->streamCarry[test_num] == NULL) {
+		errp(190, __func__, "cannot calloc for streamCarry: %ld elements of %lu bytes each", state->numberOfThreads,
+		     sizeof(struct Serial_carry));
+	}
+
 	return;
 }
 
@@ -178,11 +196,52 @@ Serial_init(struct state *state)
  */
 void
 Serial_iterate(struct thread_state *thread_state)
+{
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (thread_state == NULL) {
+		err(191, __func__, "thread_state arg is NULL");
+	}
+	if (thread_state->global_state == NULL) {
+		err(191, __func__, "state arg is NULL");
+	}
+
+	/*
+	 * Stream the whole bit stream as a single chunk
+	 */
+	Serial_stream(thread_state, 0, thread_state->global_state->tp.n);
+
+	return;
+}
+
+
+/*
+ * Serial_stream - stream a chunk of a bit stream to the Serial test
+ *
+ * given:
+ *      thread_state    // current thread state
+ *      first           // index in the bit stream of the first bit of the chunk, 0 starts a new bit stream
+ *      count           // number of bits in the chunk, held by epsilon
+ *
+ * The chunks of a bit stream are streamed in order.  The iteration is recorded with the chunk
+ * that ends the bit stream.
+ *
+ * NOTE: The initialize function must be called before this function is called.
+ */
+void
+Serial_stream(struct thread_state *thread_state, long int first, long int count)
 {
 	struct Serial_private_stats stat;	// Stats for this iteration
 	long int m;		// Serial block length (state->tp.serialBlockLength)
 	double p_value1;	// p_value iteration test result(s) - #1
 	double p_value2;	// p_value iteration test result(s) - #2
+	long int *v;		// Frequency counters of the m-bit sub-sequences (state->serial_v)
+	struct Serial_carry *carry;	// Partial results of the bit stream of this thread
+	BitSequence *epsilon;	// Chunk of the bit stream
+	unsigned long mask;	// Bit-mask used to keep the last m bits
+	unsigned long word;	// Decimal representation of the last m bits
+	long int j;
 
 	/*
 	 * Check preconditions (firewall)
@@ -198,14 +257,79 @@ Serial_iterate(struct thread_state *thread_state)
 		dbg(DBG_LOW, "iterate function[%d] %s called when test vector was false", test_num, __func__);
 		return;
 	}
+	if (state->epsilon == NULL) {
+		err(191, __func__, "state->epsilon is NULL");
+	}
+	if (state->epsilon[thread_state->thread_id] == NULL) {
+		err(191, __func__, "state->epsilon[%ld] is NULL", thread_state->thread_id);
+	}
+	if (state->serial_v == NULL) {
+		err(191, __func__, "state->serial_v is NULL");
+	}
+	if (state->serial_v[thread_state->thread_id] == NULL) {
+		err(191, __func__, "state->serial_v[%ld] is NULL", thread_state->thread_id);
+	}
+	if (state->streamCarry[test_num] == NULL) {
+		err(191, __func__, "state->streamCarry[%d] is NULL", test_num);
+	}
 
 	/*
 	 * Collect parameters from state
 	 */
 	m = state->tp.serialBlockLength;
+	v = state->serial_v[thread_state->thread_id];
+	epsilon = state->epsilon[thread_state->thread_id];
+	carry = (struct Serial_carry *) state->streamCarry[test_num] + thread_state->thread_id;
+
+	/*
+	 * Zeroize the counters of the m-bit sub-sequences when a new bit stream starts
+	 */
+	if (first == 0) {
+		carry->word = 0;
+		carry->head = 0;
+		memset(v, 0, state->serial_v_len * sizeof(v[0]));
+	}
+	mask = ((unsigned long) 1 << m) - 1;
+	word = carry->word;
+
+	/*
+	 * Step 2: compute the frequency of all the overlapping m-bit sub-sequences
+	 *
+	 * The decimal representation of the last m bits is kept as the bits are streamed,
+	 * and the counter in the array v of each complete sub-sequence is incremented.
+	 * The first m - 1 bits are kept aside for the sub-sequences that wrap around
+	 * the end of the bit stream (as indicated in the paper).
+	 */
+	for (j = 0; j < count; j++) {
+		word = ((word << 1) + epsilon[j]) & mask;
+		if (first + j >= m - 1) {
+			v[word]++;
+		} else {
+			carry->head = word;
+		}
+	}
+
+	/*
+	 * Wait for the rest of the bit stream
+	 */
+	if (first + count < state->tp.n) {
+		carry->word = word;
+		return;
+	}
+
+	/*
+	 * Count the m - 1 sub-sequences that wrap around the end of the bit stream
+	 */
+	for (j = m - 2; j >= 0; j--) {
+		word = ((word << 1) + ((carry->head >> j) & 1)) & mask;
+		v[word]++;
+	}
 
 	/*
 	 * Perform the test
+	 *
+	 * NOTE: compute_psi2 folds the counters of the m-bit sub-sequences into the counters
+	 * of the (m-1)-bit sub-sequences that are their prefixes, for the next call.
 	 */
 	stat.psim0 = compute_psi2(thread_state, m);
 	stat.psim1 = compute_psi2(thread_state, m - 1);
@@ -286,8 +410,8 @@ Serial_iterate(struct thread_state *thread_state)
 	if (state->resultstxtFlag == true) {
 		append_value(state->stats[test_num], &stat);
 	}
-	append_value(state->p_val[test_num], &p_value1);
-	append_value(state->p_val[test_num], &p_value2);
+	record_p_value(state, test_num, 0, p_value1);
+	record_p_value(state, test_num, 1, p_value2);
 
 	/*
 	 * Unlock mutex after making changes to the shared state
@@ -307,15 +431,19 @@ Serial_iterate(struct thread_state *thread_state)
  *      blocksize	// length of an overlapping sub-sequence
  *
  * This auxiliary function computes the psi-squared values needed for the
- * test statistic of the Serial test.
+ * test statistic of the Serial test, from the counters in the array v of
+ * the blocksize-bit sub-sequences.
+ *
+ * Each (blocksize-1)-bit sub-sequence is the prefix of two blocksize-bit ones,
+ * so the counters are then folded in place into the counters of the
+ * (blocksize-1)-bit sub-sequences, ready for the next call.
  */
 static double
 compute_psi2(struct thread_state *thread_state, long int blocksize)
 {
 	long int n;		// Length of a single bit stream
 	long int powLen;	// Number of possible m-bit sub-sequences
-	long int mask;		// Bit-mask used to discard the extra bits of a sequence
-	long int dec;		// Decimal representation of an m-bit sub-sequence
+	long int *v;		// Frequency counters of the blocksize-bit sub-sequences
 	double sum;		// Sum of the squares of all the counters, needed to compute psi-squared
 	long int i;
 
@@ -329,12 +457,6 @@ compute_psi2(struct thread_state *thread_state, long int blocksize)
 	if (state == NULL) {
 		err(192, __func__, "state arg is NULL");
 	}
-	if (state->epsilon == NULL) {
-		err(192, __func__, "state->epsilon is NULL");
-	}
-	if (state->epsilon[thread_state->thread_id] == NULL) {
-		err(192, __func__, "state->epsilon[%ld] is NULL", thread_state->thread_id);
-	}
 	if ((blocksize == 0) || (blocksize == -1)) {
 		return 0.0;
 	}
@@ -352,6 +474,7 @@ compute_psi2(struct thread_state *thread_state, long int blocksize)
 	 * Collect parameters from state
 	 */
 	n = state->tp.n;
+	v = state->serial_v[thread_state->thread_id];
 
 	/*
 	 * Compute how many counters are needed, i.e. how many different possible
@@ -364,59 +487,21 @@ compute_psi2(struct thread_state *thread_state, long int blocksize)
 	}
 
 	/*
-	 * Zeroize those counters in the array v
-	 */
-	memset(state->serial_v[thread_state->thread_id], 0, powLen * sizeof(state->serial_v[thread_state->thread_id][0]));
-
-	/*
-	 * Compute the mask that will be used by the algorithm
-	 */
-	mask = (1 << blocksize) - 1;
-
-	/*
-	 * Step 2: compute the frequency of all the overlapping sub-sequences
-	 *
-	 * This algorithm works by taking each consecutive overlapping sub-sequence
-	 * of length blocksize from the original sequence epsilon of length n.
-	 *
-	 * For each sub-sequence found, the decimal representation is computed and
-	 * the corresponding counter in the array v is incremented.
-	 *
-	 * It is convenient to use the decimal representation because we can more easily
-	 * store and have access to the counters of each block in the array v with size 2^blocksize.
-	 *
-	 * NOTE: i % n is used to avoid appending blocksize-1 bits in the end (as indicated in the paper)
+	 * Compute the sum of the squares of all the frequencies (needed for step 3)
 	 */
-	for (dec = 0, i = 0; i < n + blocksize; i++) {
-
-		/*
-		 * Get the decimal representation of the current block.
-		 * This line of code works by shifting the decimal representation of the
-		 * previous number left by 1 bit, adding to it the following bit of epsilon,
-		 * and then discarding the left-most bit by doing an AND with the mask (in fact,
-		 * the mask is used to keep only the right-most blocksize bits of the number).
-		 */
-		dec = ((dec << 1) + (int) state->epsilon[thread_state->thread_id][i % n]) & mask;
-
-		/*
-		 * If we have already counted the first (blocksize - 1) bits of epsilon,
-		 * count the occurrence of the current block in its corresponding counter.
-		 *
-		 * NOTE: this check is important because during the first (blocksize - 1) iterations
-		 * of this loop, dec will be the decimal representation of blocks of length
-		 * which is smaller than blocksize.
-		 */
-		if (i >= blocksize) {
-			state->serial_v[thread_state->thread_id][dec]++;
-		}
+	sum = 0.0;
+	for (i = 0; i < powLen; i++) {
+		sum += (double) v[i] * (double) v[i];
 	}
 
 	/*
-	 * Compute the sum of the squares of all the frequencies (needed for step 3)
+	 * Fold the counters into those of the (blocksize-1)-bit prefixes
+	 *
+	 * NOTE: v[i] is written after v[2*i] and v[2*i + 1] are read, and no later
+	 * iteration reads it, so the fold can be done in place.
 	 */
-	sum = 0.0;
-	for (i = 0; i < powLen; i++) {
-		sum += (double) state->serial_v[thread_state->thread_id][i] * (double) state->serial_v[thread_state->thread_id][i];
+	for (i = 0; i < powLen / 2; i++) {
+		v[i] = v[2 * i] + v[2 * i + 1];
 	}
 
 	/*
@@ -718,14 +803,14 @@ Serial_print(struct state *state)
 	 */
 	stats_txt = filePathName(state->subDir[test_num], "stats.txt");
 	dbg(DBG_HIGH, "about to open/truncate: %s", stats_txt);
-	stats = openTruncate(stats_txt);
+	stats = openPrintFile(state, stats_txt);
 
 	/*
 	 * Open results.txt file
 	 */
 	results_txt = filePathName(state->subDir[test_num], "results.txt");
 	dbg(DBG_HIGH, "about to open/truncate: %s", results_txt);
-	results = openTruncate(results_txt);
+	results = openPrintFile(state, results_txt);
 
 	/*
 	 * Write results.txt and stats.txt files
@@ -825,7 +910,7 @@ Serial_print(struct state *state)
 			 */
 			data_txt = filePathName(state->subDir[test_num], data_filename);
 			dbg(DBG_HIGH, "about to open/truncate: %s", data_txt);
-			data = openTruncate(data_txt);
+			data = openPrintFile(state, data_txt);
 
 			/*
 			 * Write this particular data*.txt filename
@@ -1039,11 +1124,8 @@ Serial_metric_print(struct state *state, long int sampleCount, long int toolow,
 void
 Serial_metrics(struct state *state)
 {
-	long int sampleCount;	// Number of bitstreams in which we will count p_values
-	long int toolow;	// p_values that were below alpha
-	double p_value;		// p_value iteration test result(s)
-	long int *freqPerBin;	// Uniformity frequency bins
-	long int i;
+	struct p_val_tally *tally;	// Uniformity and proportion counts of the p_values
+	long int sampleCount;	// Number of bitstreams in which we counted p_values
 	long int j;
 
 	/*
@@ -1062,20 +1144,16 @@ Serial_metrics(struct state *state)
 		    "metrics driver interface for %s[%d] called with state.partitionCount: %d < 0",
 		    state->testNames[test_num], test_num, state->partitionCount[test_num]);
 	}
-	if (state->p_val[test_num]->count != (state->tp.numOfBitStreams * state->partitionCount[test_num])) {
-		warn(__func__,
-		     "metrics driver interface for %s[%d] called with p_val length: %ld != bit streams: %ld",
-		     state->testNames[test_num], test_num, state->p_val[test_num]->count,
-		     state->tp.numOfBitStreams * state->partitionCount[test_num]);
-	}
 
 	/*
-	 * Allocate uniformity frequency bins
+	 * Tally the p_values, unless they were tallied as iterations completed
 	 */
-	freqPerBin = malloc(state->tp.uniformity_bins * sizeof(freqPerBin[0]));
-	if (freqPerBin == NULL) {
-		errp(197, __func__, "cannot malloc of %ld elements of %ld bytes each for freqPerBin",
-		     state->tp.uniformity_bins, sizeof(long int));
+	tally = get_p_val_tally(state, test_num);
+	if (tally->count != (state->tp.numOfBitStreams * state->partitionCount[test_num])) {
+		warn(__func__,
+		     "metrics driver interface for %s[%d] called with p_val length: %ld != bit streams: %ld",
+		     state->testNames[test_num], test_num, tally->count,
+		     state->tp.numOfBitStreams * state->partitionCount[test_num]);
 	}
 
 	/*
@@ -1083,57 +1161,11 @@ Serial_metrics(struct state *state)
 	 */
 	for (j = 0; j < state->partitionCount[test_num]; ++j) {
 
-		/*
-		 * Set counters to zero
-		 */
-		toolow = 0;
-		sampleCount = 0;
-		memset(freqPerBin, 0, state->tp.uniformity_bins * sizeof(freqPerBin[0]));
-
-		/*
-		 * Tally p_value
-		 */
-		for (i = j; i < state->p_val[test_num]->count; i += state->partitionCount[test_num]) {
-
-			// Get the iteration p_value
-			p_value = get_value(state->p_val[test_num], double, i);
-			if (p_value == NON_P_VALUE) {
-				continue;	// the test was not possible for this iteration
-			}
-			// Case: random excursion test
-			if (state->is_excursion[test_num] == true) {
-				// Random excursion tests only sample > 0 p_values
-				if (p_value > 0.0) {
-					++sampleCount;
-				} else {
-					// Ignore p_value of 0 for random excursion tests
-					continue;
-				}
-			}
-			// Case: general (non-random excursion) test
-			else {
-				// All other tests count all p_values
-				++sampleCount;
-			}
-
-			// Count the number of p_values below alpha
-			if (p_value < state->tp.alpha) {
-				++toolow;
-			}
-			// Tally the p_value in a uniformity bin
-			if (p_value >= 1.0) {
-				++freqPerBin[state->tp.uniformity_bins - 1];
-			} else if (p_value >= 0.0) {
-				++freqPerBin[(int) floor(p_value * (double) state->tp.uniformity_bins)];
-			} else {
-				++freqPerBin[0];
-			}
-		}
-
 		/*
 		 * Print uniformity and proportional information for a tallied count
 		 */
-		Serial_metric_print(state, sampleCount, toolow, freqPerBin, j);
+		sampleCount = tally->sampleCount[j];
+		Serial_metric_print(state, sampleCount, tally->toolow[j], &tally->freqPerBin[j * tally->bins], j);
 
 		/*
 		 * Track maximum samples
@@ -1149,12 +1181,6 @@ Serial_metrics(struct state *state)
 		}
 	}
 
-	/*
-	 * Free allocated storage
-	 */
-	free(freqPerBin);
-	freqPerBin = NULL;
-
 	return;
 }
 
@@ -1171,8 +1197,6 @@ Serial_metrics(struct state *state)
 void
 Serial_destroy(struct state *state)
 {
-	long int i;
-
 	/*
 	 * Check preconditions (firewall)
 	 */
@@ -1197,10 +1221,18 @@ Serial_destroy(struct state *state)
 		free(state->p_val[test_num]);
 		state->p_val[test_num] = NULL;
 	}
+	if (state->tally[test_num] != NULL) {
+		free_p_val_tally(state->tally[test_num]);
+		state->tally[test_num] = NULL;
+	}
 
 	/*
 	 * Free other test storage
 	 */
+	if (state->streamCarry[test_num] != NULL) {
+		free(state->streamCarry[test_num]);
+		state->streamCarry[test_num] = NULL;
+	}
 	if (state->datatxt_fmt[test_num] != NULL) {
 		free(state->datatxt_fmt[test_num]);
 		state->datatxt_fmt[test_num] = NULL;
@@ -1209,12 +1241,6 @@ Serial_destroy(struct state *state)
 		free(state->subDir[test_num]);
 		state->subDir[test_num] = NULL;
 	}
-	for (i = 0; i < state->numberOfThreads; i++) {
-		if (state->serial_v[i] != NULL) {
-			free(state->serial_v[i]);
-			state->serial_v[i] = NULL;
-		}
-	}
 	if (state->serial_v != NULL) {
 		free(state->serial_v);
 		state->serial_v = NULL;
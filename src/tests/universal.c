@@ -36,8 +36,10 @@
 #include <limits.h>
 #include "../utils/externs.h"
 #include "../utils/utilities.h"
+#include "../utils/stat_fncs.h"
 #include "../utils/cephes.h"
 #include "../utils/debug.h"
+#include "../utils/arena.h"
 
 
 /*
@@ -53,6 +55,17 @@ struct Universal_private_stats {
 };
 
 
+/*
+ * Carry - partial results of a bit stream kept between its chunks by each thread
+ */
+struct Universal_carry {
+	double sum;		// Sum of the log2 distances of the blocks streamed so far
+	long int block;		// Number of the blocks streamed so far
+	uint64_t word;		// Bits streamed so far of the next block, packed in the low bits
+	long int bits;		// Number of bits streamed so far of the next block
+};
+
+
 /*
  * Static const variables declarations
  */
@@ -83,6 +96,7 @@ static const double variance[MAX_L_UNIVERSAL + 1] = {
 /*
  * Forward static function declarations
  */
+static uint64_t pack_bits(const BitSequence *epsilon);
 static bool Universal_print_stat(FILE * stream, struct state *state, struct Universal_private_stats *stat, double p_value);
 static bool Universal_print_p_value(FILE * stream, double p_value);
 static void Universal_metric_print(struct state *state, long int sampleCount, long int toolow, long int *freqPerBin);
@@ -207,12 +221,24 @@ Universal_init(struct state *state)
 		     sizeof(*state->universal_T));
 	}
 	for (i = 0; i < state->numberOfThreads; i++) {
-		state->universal_T[i] = malloc(p * sizeof(state->universal_T[i][0]));
-		if (state->universal_T[i] == NULL) {
-			errp(200, __func__, "cannot malloc of %ld elements of %ld bytes each for state->universal_T[%ld]",
-			     p, sizeof(state->universal_T[i][0]), i);
-		}
+		arenaAlloc(state, i, test_num, "universal_T", p * sizeof(state->universal_T[i][0]), &state->universal_T[i]);
+	}
+
+	/*
+	 * Allocate the table, shared by all threads, with the log2 of the distances between re-occurrences
+	 * of the same L-bit block.  The distances are about 2^L on average, larger ones are rare and use log().
+	 */
+	state->universal_log2_len = LOG2_GAPS_UNIVERSAL * p;
+	state->universal_log2 = malloc((size_t) state->universal_log2_len * sizeof(state->universal_log2[0]));
+	if (state->universal_log2 == NULL) {
+		errp(200, __func__, "cannot malloc of %ld elements of %ld bytes each for state->universal_log2",
+		     state->universal_log2_len, sizeof(state->universal_log2[0]));
 	}
+	state->universal_log2[0] = 0.0;	// a block never re-occurs at a distance of 0
+	for (i = 1; i < state->universal_log2_len; i++) {
+		state->universal_log2[i] = log((double) i) / state->c.log2;
+	}
+	arenaShared(state, test_num, "universal_log2", (size_t) state->universal_log2_len * sizeof(state->universal_log2[0]));
 
 	/*
 	 * Create working sub-directory if forming files such as results.txt and stats.txt
@@ -227,10 +253,12 @@ Universal_init(struct state *state)
 	 */
 	if (state->resultstxtFlag == true) {
 		state->stats[test_num] = create_dyn_array(sizeof(struct Universal_private_stats),
-							  DEFAULT_CHUNK, state->tp.numOfBitStreams, false);        // stats.txt
+							  DEFAULT_CHUNK, retainedIterations(state), false);        // stats.txt
+	}
+	if (state->p_valTally == false) {
+		state->p_val[test_num] = create_dyn_array(sizeof(double),
+							  DEFAULT_CHUNK, retainedIterations(state), false);	// results.txt
 	}
-	state->p_val[test_num] = create_dyn_array(sizeof(double),
-						  DEFAULT_CHUNK, state->tp.numOfBitStreams, false);	// results.txt
 
 	/*
 	 * Determine format of data*.txt filenames based on state->partitionCount[test_num]
@@ -240,6 +268,15 @@ Universal_init(struct state *state)
 	dbg(DBG_HIGH, "%s[%d] will form data*.txt filenames with the following format: %s",
 	    state->testNames[test_num], test_num, state->datatxt_fmt[test_num]);
 
+	/*
+	 * Allocate the partial results kept by each thread between the chunks of a bit stream
+	 */
+	state->streamCarry[test_num] = calloc((size_t) state->numberOfThreads, sizeof(struct Universal_carry));
+	if (state->streamCarry[test_num] == NULL) {
+		errp(200, __func__, "cannot calloc for streamCarry: %ld elements of %lu bytes each", state->numberOfThreads,
+		     sizeof(struct Universal_carry));
+	}
+
 	return;
 }
 
@@ -256,15 +293,59 @@ Universal_init(struct state *state)
  */
 void
 Universal_iterate(struct thread_state *thread_state)
+{
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (thread_state == NULL) {
+		err(201, __func__, "thread_state arg is NULL");
+	}
+	if (thread_state->global_state == NULL) {
+		err(201, __func__, "state arg is NULL");
+	}
+
+	/*
+	 * Stream the whole bit stream as a single chunk
+	 */
+	Universal_stream(thread_state, 0, thread_state->global_state->tp.n);
+
+	return;
+}
+
+
+/*
+ * Universal_stream - stream a chunk of a bit stream to the Universal test
+ *
+ * given:
+ *      thread_state    // current thread state
+ *      first           // index in the bit stream of the first bit of the chunk, 0 starts a new bit stream
+ *      count           // number of bits in the chunk, held by epsilon
+ *
+ * The chunks of a bit stream are streamed in order.  The iteration is recorded with the chunk
+ * that ends the bit stream.
+ *
+ * NOTE: The initialize function must be called before this function is called.
+ */
+void
+Universal_stream(struct thread_state *thread_state, long int first, long int count)
 {
 	struct Universal_private_stats stat;	// Stats for this iteration
 	long int L;		// Length of each block
-	long int *T;		// Table with block number of the last occurrence of each block
+	uint32_t *T;		// Table with block number of the last occurrence of each block
 	long int p;		// Number of possible L-bit blocks and size of the table T
+	const double *log2_gap;	// log2 of the distances below log2_len
+	long int log2_len;	// Number of distances in log2_gap
+	long int gap;		// Distance between re-occurrences of the same L-bit block
 	double arg;		// Term used to compute p-value
 	double p_value;		// p_value iteration test result(s)
 	double c;		// Constant used in the formula of the standard deviation
-	long decRep;		// Decimal representation of a block
+	long int decRep;	// Decimal representation of a block
+	uint64_t word;		// Bits streamed but not yet cut into blocks, packed in the low bits
+	uint64_t mask;		// Mask of the L low bits
+	struct Universal_carry *carry;	// Partial results of the bit stream of this thread
+	BitSequence *epsilon;	// Chunk of the bit stream
+	long int bits;		// Number of bits in word not yet cut into blocks
+	long int end;		// Number of bits of the chunk that are in one of the Q + K blocks
 	long int i;
 	long int j;
 
@@ -294,6 +375,12 @@ Universal_iterate(struct thread_state *thread_state)
 	if (state->universal_T[thread_state->thread_id] == NULL) {
 		err(201, __func__, "state->universal_T[%ld] is NULL", thread_state->thread_id);
 	}
+	if (state->universal_log2 == NULL) {
+		err(201, __func__, "state->universal_log2 is NULL");
+	}
+	if (state->streamCarry[test_num] == NULL) {
+		err(201, __func__, "state->streamCarry[%d] is NULL", test_num);
+	}
 	if (state->cSetup != true) {
 		err(201, __func__, "test constants not setup prior to calling %s for %s[%d]",
 		    __func__, state->testNames[test_num], test_num);
@@ -304,6 +391,8 @@ Universal_iterate(struct thread_state *thread_state)
 	 */
 	L = state->universal_L;
 	T = state->universal_T[thread_state->thread_id];
+	log2_gap = state->universal_log2;
+	log2_len = state->universal_log2_len;
 
 	/*
 	 * Check preconditions (firewall)
@@ -323,55 +412,98 @@ Universal_iterate(struct thread_state *thread_state)
 	}
 	stat.Q = 10 * p;
 	stat.K = 100 * stat.Q;
-	stat.sum = 0.0;
-	memset(T, 0, p * sizeof(T[0]));	// zeroize T
+	epsilon = state->epsilon[thread_state->thread_id];
+	carry = (struct Universal_carry *) state->streamCarry[test_num] + thread_state->thread_id;
+	if (first == 0) {
+		carry->sum = 0.0;
+		carry->block = 0;
+		carry->word = 0;
+		carry->bits = 0;
+		memset(T, 0, p * sizeof(T[0]));	// zeroize T
+	}
+	stat.sum = carry->sum;
+	i = carry->block;
+	word = carry->word;
+	bits = carry->bits;
 
 	/*
-	 * Step 2: using the initialization segment, fill table T with block number
-	 * of the last occurrence of each L-bit block.
+	 * Get decimal representation of each block, as its bits are streamed.
+	 * It is convenient to use this representation because we can store and
+	 * have access to the contents of each block in the table T with size 2^L.
+	 *
+	 * The bits are packed 8 at a time into word and each L-bit block is
+	 * shifted and masked out of it once all its bits are in.
 	 */
-	for (i = 1; i <= stat.Q; i++) {
+	mask = ((uint64_t) 1 << L) - 1;
+	end = MIN(count, (stat.Q + stat.K) * L - first);
+	j = 0;
+	for (;;) {
+		while (bits >= L) {
+			bits -= L;
+			decRep = (long int) ((word >> bits) & mask);
+			i++;
 
-		/*
-		 * Get decimal representation of the block.
-		 * It is convenient to use this representation because we can store and
-		 * have access to the contents of each block in the table T with size 2^L.
-		 */
-		decRep = 0;
-		for (j = 0; j < L; j++) {
-			decRep += state->epsilon[thread_state->thread_id][(i - 1) * L + j] * ((long int) 1 << (L - 1 - j));
-		}
+			/*
+			 * Step 2: using the initialization segment, fill table T with block number
+			 * of the last occurrence of each L-bit block.
+			 */
+			if (i <= stat.Q) {
 
-		/*
-		 * Save the block number of this last occurrence of the this L-bit block in the table.
-		 */
-		T[decRep] = i;
-	}
+				/*
+				 * Save the block number of this last occurrence of the this L-bit block in the table.
+				 */
+				T[decRep] = (uint32_t) i;
+			}
 
-	/*
-	 * Step 3: examine each of the K blocks in the test segment and determine
-	 * the number of blocks since the last occurrence of the same L-bit block
-	 */
-	for (i = stat.Q + 1; i <= stat.Q + stat.K; i++) {
+			/*
+			 * Step 3: examine each of the K blocks in the test segment and determine
+			 * the number of blocks since the last occurrence of the same L-bit block
+			 */
+			else {
+
+				/*
+				 * Add the distance between re-occurrences of the same L-bit block to an
+				 * accumulating log2 sum of all the differences detected in the K blocks
+				 */
+				gap = i - (long int) T[decRep];
+				if (gap < log2_len) {
+					stat.sum += log2_gap[gap];
+				} else {
+					stat.sum += log((double) gap) / state->c.log2;
+				}
 
-		/*
-		 * Get decimal representation of the block
-		 */
-		decRep = 0;
-		for (j = 0; j < L; j++) {
-			decRep += state->epsilon[thread_state->thread_id][(i - 1) * L + j] * ((long int) 1 << (L - 1 - j));
+				/*
+				 * Replace the value in the table with the location of the current block
+				 */
+				T[decRep] = (uint32_t) i;
+			}
 		}
 
 		/*
-		 * Add the distance between re-occurrences of the same L-bit block to an
-		 * accumulating log2 sum of all the differences detected in the K blocks
+		 * Stream the next bits of the chunk
 		 */
-		stat.sum += log(i - T[decRep]) / state->c.log2;
+		if (j + 8 <= end) {
+			word = (word << 8) | pack_bits(epsilon + j);
+			bits += 8;
+			j += 8;
+		} else if (j < end) {
+			word = (word << 1) | epsilon[j];
+			bits++;
+			j++;
+		} else {
+			break;
+		}
+	}
+	carry->sum = stat.sum;
+	carry->block = i;
+	carry->word = word & mask;
+	carry->bits = bits;
 
-		/*
-		 * Replace the value in the table with the location of the current block
-		 */
-		T[decRep] = i;
+	/*
+	 * Wait for the rest of the bit stream
+	 */
+	if (first + count < state->tp.n) {
+		return;
 	}
 
 	/*
@@ -425,7 +557,7 @@ Universal_iterate(struct thread_state *thread_state)
 	if (state->resultstxtFlag == true) {
 		append_value(state->stats[test_num], &stat);
 	}
-	append_value(state->p_val[test_num], &p_value);
+	record_p_value(state, test_num, 0, p_value);
 
 	/*
 	 * Unlock mutex after making changes to the shared state
@@ -438,6 +570,35 @@ Universal_iterate(struct thread_state *thread_state)
 }
 
 
+/*
+ * pack_bits - pack 8 bits of a bit stream, one bit per byte, into a byte
+ *
+ * given:
+ *      epsilon         // 8 bits of a bit stream, each byte is 0 or 1
+ *
+ * returns:
+ *      the 8 bits with the first bit as the most significant one
+ */
+static uint64_t
+pack_bits(const BitSequence *epsilon)
+{
+#if defined(__BYTE_ORDER__) && defined(__ORDER_LITTLE_ENDIAN__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+	uint64_t bytes;		// The 8 bytes of the bits, epsilon[k] in bits 8k
+
+	/*
+	 * Each byte k lands on the bit 7 - k of the top byte, no two products overlap so there is no carry
+	 */
+	memcpy(&bytes, epsilon, sizeof(bytes));
+	return (bytes * UINT64_C(0x8040201008040201)) >> 56;
+#else
+	return ((uint64_t) epsilon[0] << 7) | ((uint64_t) epsilon[1] << 6) | ((uint64_t) epsilon[2] << 5) |
+		((uint64_t) epsilon[3] << 4) | ((uint64_t) epsilon[4] << 3) | ((uint64_t) epsilon[5] << 2) |
+		((uint64_t) epsilon[6] << 1) | (uint64_t) epsilon[7];
+#endif
+}
+
+
+
 /*
  * Universal_print_stat - print private_stats information to the end of an open file
  *
@@ -688,14 +849,14 @@ Universal_print(struct state *state)
 	 */
 	stats_txt = filePathName(state->subDir[test_num], "stats.txt");
 	dbg(DBG_HIGH, "about to open/truncate: %s", stats_txt);
-	stats = openTruncate(stats_txt);
+	stats = openPrintFile(state, stats_txt);
 
 	/*
 	 * Open results.txt file
 	 */
 	results_txt = filePathName(state->subDir[test_num], "results.txt");
 	dbg(DBG_HIGH, "about to open/truncate: %s", results_txt);
-	results = openTruncate(results_txt);
+	results = openPrintFile(state, results_txt);
 
 	/*
 	 * Write results.txt and stats.txt files
@@ -789,7 +950,7 @@ Universal_print(struct state *state)
 			 */
 			data_txt = filePathName(state->subDir[test_num], data_filename);
 			dbg(DBG_HIGH, "about to open/truncate: %s", data_txt);
-			data = openTruncate(data_txt);
+			data = openPrintFile(state, data_txt);
 
 			/*
 			 * Write this particular data*.txt filename
@@ -1003,11 +1164,8 @@ Universal_metric_print(struct state *state, long int sampleCount, long int toolo
 void
 Universal_metrics(struct state *state)
 {
-	long int sampleCount;	// Number of bitstreams in which we will count p_values
-	long int toolow;	// p_values that were below alpha
-	double p_value;		// p_value iteration test result(s)
-	long int *freqPerBin;	// Uniformity frequency bins
-	long int i;
+	struct p_val_tally *tally;	// Uniformity and proportion counts of the p_values
+	long int sampleCount;	// Number of bitstreams in which we counted p_values
 	long int j;
 
 	/*
@@ -1026,20 +1184,16 @@ Universal_metrics(struct state *state)
 		    "metrics driver interface for %s[%d] called with state.partitionCount: %d < 0",
 		    state->testNames[test_num], test_num, state->partitionCount[test_num]);
 	}
-	if (state->p_val[test_num]->count != (state->tp.numOfBitStreams * state->partitionCount[test_num])) {
-		warn(__func__,
-		     "metrics driver interface for %s[%d] called with p_val length: %ld != bit streams: %ld",
-		     state->testNames[test_num], test_num, state->p_val[test_num]->count,
-		     state->tp.numOfBitStreams * state->partitionCount[test_num]);
-	}
 
 	/*
-	 * Allocate uniformity frequency bins
+	 * Tally the p_values, unless they were tallied as iterations completed
 	 */
-	freqPerBin = malloc(state->tp.uniformity_bins * sizeof(freqPerBin[0]));
-	if (freqPerBin == NULL) {
-		errp(206, __func__, "cannot malloc of %ld elements of %ld bytes each for freqPerBin",
-		     state->tp.uniformity_bins, sizeof(long int));
+	tally = get_p_val_tally(state, test_num);
+	if (tally->count != (state->tp.numOfBitStreams * state->partitionCount[test_num])) {
+		warn(__func__,
+		     "metrics driver interface for %s[%d] called with p_val length: %ld != bit streams: %ld",
+		     state->testNames[test_num], test_num, tally->count,
+		     state->tp.numOfBitStreams * state->partitionCount[test_num]);
 	}
 
 	/*
@@ -1047,57 +1201,11 @@ Universal_metrics(struct state *state)
 	 */
 	for (j = 0; j < state->partitionCount[test_num]; ++j) {
 
-		/*
-		 * Set counters to zero
-		 */
-		toolow = 0;
-		sampleCount = 0;
-		memset(freqPerBin, 0, state->tp.uniformity_bins * sizeof(freqPerBin[0]));
-
-		/*
-		 * Tally p_value
-		 */
-		for (i = j; i < state->p_val[test_num]->count; i += state->partitionCount[test_num]) {
-
-			// Get the iteration p_value
-			p_value = get_value(state->p_val[test_num], double, i);
-			if (p_value == NON_P_VALUE) {
-				continue;	// the test was not possible for this iteration
-			}
-			// Case: random excursion test
-			if (state->is_excursion[test_num] == true) {
-				// Random excursion tests only sample > 0 p_values
-				if (p_value > 0.0) {
-					++sampleCount;
-				} else {
-					// Ignore p_value of 0 for random excursion tests
-					continue;
-				}
-
-				// Case: general (non-random excursion) test
-			} else {
-				// All other tests count all p_values
-				++sampleCount;
-			}
-
-			// Count the number of p_values below alpha
-			if (p_value < state->tp.alpha) {
-				++toolow;
-			}
-			// Tally the p_value in a uniformity bin
-			if (p_value >= 1.0) {
-				++freqPerBin[state->tp.uniformity_bins - 1];
-			} else if (p_value >= 0.0) {
-				++freqPerBin[(int) floor(p_value * (double) state->tp.uniformity_bins)];
-			} else {
-				++freqPerBin[0];
-			}
-		}
-
 		/*
 		 * Print uniformity and proportional information for a tallied count
 		 */
-		Universal_metric_print(state, sampleCount, toolow, freqPerBin);
+		sampleCount = tally->sampleCount[j];
+		Universal_metric_print(state, sampleCount, tally->toolow[j], &tally->freqPerBin[j * tally->bins]);
 
 		/*
 		 * Track maximum samples
@@ -1113,12 +1221,6 @@ Universal_metrics(struct state *state)
 		}
 	}
 
-	/*
-	 * Free allocated storage
-	 */
-	free(freqPerBin);
-	freqPerBin = NULL;
-
 	return;
 }
 
@@ -1135,8 +1237,6 @@ Universal_metrics(struct state *state)
 void
 Universal_destroy(struct state *state)
 {
-	long int i;
-
 	/*
 	 * Check preconditions (firewall)
 	 */
@@ -1161,10 +1261,18 @@ Universal_destroy(struct state *state)
 		free(state->p_val[test_num]);
 		state->p_val[test_num] = NULL;
 	}
+	if (state->tally[test_num] != NULL) {
+		free_p_val_tally(state->tally[test_num]);
+		state->tally[test_num] = NULL;
+	}
 
 	/*
 	 * Free other test storage
 	 */
+	if (state->streamCarry[test_num] != NULL) {
+		free(state->streamCarry[test_num]);
+		state->streamCarry[test_num] = NULL;
+	}
 	if (state->datatxt_fmt[test_num] != NULL) {
 		free(state->datatxt_fmt[test_num]);
 		state->datatxt_fmt[test_num] = NULL;
@@ -1173,16 +1281,14 @@ Universal_destroy(struct state *state)
 		free(state->subDir[test_num]);
 		state->subDir[test_num] = NULL;
 	}
-	for (i = 0; i < state->numberOfThreads; i++) {
-		if (state->universal_T[i] != NULL) {
-			free(state->universal_T[i]);
-			state->universal_T[i] = NULL;
-		}
-	}
 	if (state->universal_T != NULL) {
 		free(state->universal_T);
 		state->universal_T = NULL;
 	}
+	if (state->universal_log2 != NULL) {
+		free(state->universal_log2);
+		state->universal_log2 = NULL;
+	}
 
 	return;
 }
@@ -0,0 +1,802 @@
+// arena.c
+// Carve the per-thread buffers of the enabled tests out of one arena per thread
+
+/*
+ * This code has been heavily modified by the following people:
+ *
+ *      Landon Curt Noll
+ *      Tom Gilgan
+ *      Riccardo Paccagnella
+ *
+ * See the README.md and the initial comment in sts.c for more information.
+ *
+ * WE (THOSE LISTED ABOVE WHO HEAVILY MODIFIED THIS CODE) DISCLAIM ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL WE (THOSE LISTED ABOVE
+ * WHO HEAVILY MODIFIED THIS CODE) BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF
+ * USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ * chongo (Landon Curt Noll, http://www.isthe.com/chongo/index.html) /\oo/\
+ *
+ * Share and enjoy! :-)
+ */
+
+
+// Exit codes: 254
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "externs.h"
+#include "utilities.h"
+#include "arena.h"
+#include "debug.h"
+
+
+#   define ARENA_ALIGN (64)			// Every buffer starts on a cache line
+#   define ARENA_HUGE_PAGE (2 * 1024 * 1024)	// Size of a transparent huge page, the arenas start on one
+#   define MAX_ARENA_BUDGET (64)		// Maximum number of buffers in the memory budget
+
+#   if defined(MAP_ANON) && !defined(MAP_ANONYMOUS)
+#      define MAP_ANONYMOUS MAP_ANON
+#   endif
+
+
+/*
+ * Forward static function declarations
+ */
+static size_t roundUp(size_t bytes, size_t multiple);
+static void mapArena(struct arena *arena, long int thread_id, size_t bytes);
+static void *allocBlock(struct arena *arena, size_t bytes);
+static void setSlot(void *slot, void *buf);
+static void addBudget(struct state *state, int test_num, const char *what, size_t bytes, bool scratch, bool shared);
+static void releaseArena(struct arena *arena);
+
+
+/*
+ * roundUp - round a number of bytes up to a multiple of a power of 2
+ */
+static size_t
+roundUp(size_t bytes, size_t multiple)
+{
+	return (bytes + multiple - 1) & ~(multiple - 1);
+}
+
+
+/*
+ * createArenas - create the empty arena of each thread
+ *
+ * given:
+ *      state           // run state to test under
+ *
+ * This function must be called before the init functions of the tests, which carve their
+ * per-thread buffers out of the arenas with arenaAlloc() and size the scratch areas with
+ * arenaReserveScratch().  Nothing is mapped yet: once every buffer is carved, sealArenas()
+ * maps each arena once, with the size of its buffers and scratch area.
+ */
+void
+createArenas(struct state *state)
+{
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (state == NULL) {
+		err(254, __func__, "state arg is NULL");
+	}
+	if (state->numberOfThreads <= 0) {
+		err(254, __func__, "numberOfThreads: %ld must be > 0", state->numberOfThreads);
+	}
+	if (state->arena != NULL) {
+		dbg(DBG_HIGH, "arenas already created");
+		return;
+	}
+
+	/*
+	 * Allocate the arenas and the memory budget
+	 */
+	state->arena = calloc((size_t) state->numberOfThreads, sizeof(state->arena[0]));
+	if (state->arena == NULL) {
+		errp(254, __func__, "cannot calloc for arena: %ld elements of %lu bytes each", state->numberOfThreads,
+		     sizeof(state->arena[0]));
+	}
+	state->arenaBudget = calloc(MAX_ARENA_BUDGET, sizeof(state->arenaBudget[0]));
+	if (state->arenaBudget == NULL) {
+		errp(254, __func__, "cannot calloc for arenaBudget: %d elements of %lu bytes each", MAX_ARENA_BUDGET,
+		     sizeof(state->arenaBudget[0]));
+	}
+	state->arenaBudgetCount = 0;
+	state->arenaScratch = 0;
+	state->arenaSealed = false;
+	return;
+}
+
+
+/*
+ * mapArena - map an arena, starting on a huge page
+ *
+ * given:
+ *      arena           // arena to map
+ *      thread_id       // thread that owns the arena
+ *      bytes           // bytes of the arena, > 0
+ *
+ * When the arena cannot be mapped, arena->base is left NULL and its buffers are allocated one by one.
+ */
+static void
+mapArena(struct arena *arena, long int thread_id, size_t bytes)
+{
+#if defined(MAP_ANONYMOUS)
+	BYTE *map;		// Mapped memory, with room to align it
+	BYTE *base;		// First huge page of the mapped memory
+	size_t mapped;		// Bytes to keep mapped at base
+
+	mapped = roundUp(bytes, (size_t) sysconf(_SC_PAGESIZE));
+	map = mmap(NULL, mapped + ARENA_HUGE_PAGE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (map == MAP_FAILED) {
+		warnp(__func__, "cannot map %lu bytes for the arena of thread %ld, allocating its buffers one by one",
+		      (unsigned long) mapped, thread_id);
+		return;
+	}
+	base = map + (roundUp((uintptr_t) map, ARENA_HUGE_PAGE) - (uintptr_t) map);
+	if (base > map) {
+		munmap(map, (size_t) (base - map));
+	}
+	munmap(base + mapped, (size_t) (map + ARENA_HUGE_PAGE - base));
+	arena->base = base;
+	arena->mapped = mapped;
+#   if defined(MADV_HUGEPAGE)
+	madvise(base, mapped, MADV_HUGEPAGE);	// advisory, so failure does not matter
+#   endif /* MADV_HUGEPAGE */
+#else /* MAP_ANONYMOUS */
+	warn(__func__, "cannot map anonymous memory for the arena of thread %ld, allocating its buffers one by one",
+	     thread_id);
+#endif /* MAP_ANONYMOUS */
+	return;
+}
+
+
+/*
+ * allocBlock - allocate a zeroized, cache line aligned buffer, when its arena is not mapped
+ *
+ * given:
+ *      arena           // arena that owns the buffer
+ *      bytes           // bytes of the buffer, a multiple of ARENA_ALIGN
+ *
+ * returns:
+ *      the buffer, freed by destroyArenas()
+ */
+static void *
+allocBlock(struct arena *arena, size_t bytes)
+{
+	void **blocks;		// Grown array of buffers
+	void *block;		// Allocated buffer
+	int ret;
+
+	blocks = realloc(arena->blocks, (size_t) (arena->blockCount + 1) * sizeof(arena->blocks[0]));
+	if (blocks == NULL) {
+		errp(254, __func__, "cannot realloc for %ld arena blocks", arena->blockCount + 1);
+	}
+	arena->blocks = blocks;
+	ret = posix_memalign(&block, ARENA_ALIGN, MAX(bytes, ARENA_ALIGN));
+	if (ret != 0) {
+		errno = ret;
+		errp(254, __func__, "cannot posix_memalign %lu bytes", (unsigned long) bytes);
+	}
+	memset(block, 0, bytes);
+	arena->blocks[arena->blockCount++] = block;
+	return block;
+}
+
+
+/*
+ * setSlot - set the pointer of a caller of arenaAlloc() to its buffer
+ *
+ * given:
+ *      slot            // address of a pointer to an object type
+ *      buf             // buffer
+ *
+ * The pointer is copied as bytes, as the slot may be of any object pointer type.
+ */
+static void
+setSlot(void *slot, void *buf)
+{
+	memcpy(slot, &buf, sizeof(buf));
+	return;
+}
+
+
+/*
+ * arenaAlloc - carve a buffer out of the arena of a thread
+ *
+ * given:
+ *      state           // run state to test under
+ *      thread_id       // thread that owns the buffer
+ *      test_num        // test that uses the buffer, or 0 for the driver
+ *      what            // name of the buffer for the memory budget, must be a string constant
+ *      bytes           // bytes of the buffer
+ *      slot            // address of the pointer to set to the buffer, such as &state->fft_X[i]
+ *
+ * Buffers are carved by the init functions, before sealArenas(), which maps the arena and sets
+ * *slot to a zeroized, cache line aligned buffer that lasts until destroyArenas().  Until then
+ * *slot is not set: the buffer must not be used by init.  The buffers are never freed one by one.
+ * The buffers of thread 0 are listed in the memory budget.
+ */
+void
+arenaAlloc(struct state *state, long int thread_id, int test_num, const char *what, size_t bytes, void *slot)
+{
+	struct arena *arena;		// Arena of the thread
+	struct arena_carve *carves;	// Grown array of carved buffers
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (state == NULL) {
+		err(254, __func__, "state arg is NULL");
+	}
+	if (what == NULL) {
+		err(254, __func__, "what arg is NULL");
+	}
+	if (slot == NULL) {
+		err(254, __func__, "slot arg is NULL");
+	}
+	if (state->arena == NULL) {
+		err(254, __func__, "arenas not created prior to carving %s", what);
+	}
+	if (thread_id < 0 || thread_id >= state->numberOfThreads) {
+		err(254, __func__, "thread_id: %ld must be in [0, %ld)", thread_id, state->numberOfThreads);
+	}
+	if (state->arenaSealed == true) {
+		err(254, __func__, "cannot carve %s once the arenas are sealed", what);
+	}
+	arena = &state->arena[thread_id];
+	bytes = roundUp(bytes, ARENA_ALIGN);
+
+	/*
+	 * Record the buffer, placed after the buffers carved before it
+	 */
+	carves = realloc(arena->carves, (size_t) (arena->carveCount + 1) * sizeof(arena->carves[0]));
+	if (carves == NULL) {
+		errp(254, __func__, "cannot realloc for %ld carved buffers", arena->carveCount + 1);
+	}
+	arena->carves = carves;
+	arena->carves[arena->carveCount].offset = arena->used;
+	arena->carves[arena->carveCount].bytes = bytes;
+	arena->carves[arena->carveCount].slot = slot;
+	arena->carveCount++;
+	arena->used += bytes;
+	if (thread_id == 0) {
+		addBudget(state, test_num, what, bytes, false, false);
+	}
+	return;
+}
+
+
+/*
+ * arenaReserveScratch - reserve room in the scratch area of every arena
+ *
+ * given:
+ *      state           // run state to test under
+ *      test_num        // test that uses the scratch, or 0 for the driver
+ *      what            // name of the scratch for the memory budget, must be a string constant
+ *      bytes           // bytes that the test takes from the scratch area in one iteration
+ *
+ * The init function of a test that takes buffers from arenaScratch() while iterating
+ * must reserve them, before sealArenas().
+ */
+void
+arenaReserveScratch(struct state *state, int test_num, const char *what, size_t bytes)
+{
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (state == NULL) {
+		err(254, __func__, "state arg is NULL");
+	}
+	if (what == NULL) {
+		err(254, __func__, "what arg is NULL");
+	}
+	if (state->arena == NULL) {
+		err(254, __func__, "arenas not created prior to reserving scratch for %s", what);
+	}
+	if (state->arenaSealed == true) {
+		err(254, __func__, "cannot reserve scratch for %s once the arenas are sealed", what);
+	}
+
+	/*
+	 * Grow the scratch area of every arena
+	 */
+	bytes = roundUp(bytes, ARENA_ALIGN);
+	state->arenaScratch += bytes;
+	addBudget(state, test_num, what, bytes, true, false);
+	return;
+}
+
+
+/*
+ * arenaShared - list a table shared by all threads in the memory budget
+ *
+ * given:
+ *      state           // run state to test under
+ *      test_num        // test that uses the table, or 0 for the driver
+ *      what            // name of the table for the memory budget, must be a string constant
+ *      bytes           // bytes of the table, or an estimate of them for tables allocated by a library
+ *
+ * Tables that are allocated once by init and read by every thread are not in the arenas,
+ * but they count against -M memlimit as well.  The init function of a test must list them
+ * before sealArenas(), whether or not they are allocated yet.
+ */
+void
+arenaShared(struct state *state, int test_num, const char *what, size_t bytes)
+{
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (state == NULL) {
+		err(254, __func__, "state arg is NULL");
+	}
+	if (what == NULL) {
+		err(254, __func__, "what arg is NULL");
+	}
+	if (state->arena == NULL) {
+		err(254, __func__, "arenas not created prior to listing the shared table %s", what);
+	}
+	if (state->arenaSealed == true) {
+		err(254, __func__, "cannot list the shared table %s once the arenas are sealed", what);
+	}
+
+	addBudget(state, test_num, what, bytes, false, true);
+	return;
+}
+
+
+/*
+ * sealArenas - map the arenas once every buffer is carved
+ *
+ * given:
+ *      state           // run state to test under
+ *
+ * Each arena is mapped once, with the size of its buffers followed by the scratch area, and
+ * the pointer of each carved buffer is set.  When an arena cannot be mapped, its buffers are
+ * allocated one by one instead.
+ */
+void
+sealArenas(struct state *state)
+{
+	struct arena *arena;	// Arena of a thread
+	long int i;
+	long int j;
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (state == NULL) {
+		err(254, __func__, "state arg is NULL");
+	}
+	if (state->arena == NULL) {
+		err(254, __func__, "arenas not created prior to sealing them");
+	}
+	if (state->arenaSealed == true) {
+		return;
+	}
+
+	/*
+	 * Map each arena, and place its buffers and its scratch area
+	 */
+	for (i = 0; i < state->numberOfThreads; i++) {
+		arena = &state->arena[i];
+		arena->size = arena->used + state->arenaScratch;
+		if (arena->size > 0) {
+			mapArena(arena, i, arena->size);
+		}
+		for (j = 0; j < arena->carveCount; j++) {
+			if (arena->base != NULL) {
+				setSlot(arena->carves[j].slot, arena->base + arena->carves[j].offset);
+			} else {
+				setSlot(arena->carves[j].slot, allocBlock(arena, arena->carves[j].bytes));
+			}
+		}
+		if (arena->base != NULL) {
+			arena->scratch = arena->base + arena->used;
+		} else {
+			arena->size = 0;
+			arena->scratch = allocBlock(arena, state->arenaScratch);
+		}
+		arena->scratchUsed = 0;
+		free(arena->carves);
+		arena->carves = NULL;
+		arena->carveCount = 0;
+	}
+	state->arenaSealed = true;
+	return;
+}
+
+
+/*
+ * arenaFootprint - bytes of the buffers and scratch area in the arena of each thread
+ *
+ * given:
+ *      state           // run state to test under
+ *
+ * returns:
+ *      bytes listed in the memory budget, the same for each thread
+ */
+size_t
+arenaFootprint(struct state *state)
+{
+	size_t total = 0;	// Bytes of the arena of each thread
+	long int i;
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (state == NULL) {
+		err(254, __func__, "state arg is NULL");
+	}
+
+	for (i = 0; i < state->arenaBudgetCount; i++) {
+		if (state->arenaBudget[i].shared == false) {
+			total += state->arenaBudget[i].bytes;
+		}
+	}
+	return total;
+}
+
+
+/*
+ * sharedFootprint - bytes of the tables shared by all threads
+ *
+ * given:
+ *      state           // run state to test under
+ *
+ * returns:
+ *      bytes listed in the memory budget by arenaShared()
+ */
+size_t
+sharedFootprint(struct state *state)
+{
+	size_t total = 0;	// Bytes of the shared tables
+	long int i;
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (state == NULL) {
+		err(254, __func__, "state arg is NULL");
+	}
+
+	for (i = 0; i < state->arenaBudgetCount; i++) {
+		if (state->arenaBudget[i].shared == true) {
+			total += state->arenaBudget[i].bytes;
+		}
+	}
+	return total;
+}
+
+
+/*
+ * trimArenas - run with fewer threads, dropping the arenas of the threads beyond them
+ *
+ * given:
+ *      state           // run state to test under
+ *      threads         // number of threads to keep, >= 1 and <= state->numberOfThreads
+ *
+ * This function must be called before sealArenas(), so that the arenas of the threads beyond
+ * the kept ones are never mapped.  The pointers to the buffers that the tests carved for them
+ * are not set: as the tests only use the buffers of threads below state->numberOfThreads,
+ * they are never read.
+ */
+void
+trimArenas(struct state *state, long int threads)
+{
+	long int i;
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (state == NULL) {
+		err(254, __func__, "state arg is NULL");
+	}
+	if (state->arena == NULL) {
+		err(254, __func__, "arenas not created prior to trimming them");
+	}
+	if (state->arenaSealed == true) {
+		err(254, __func__, "cannot trim the arenas once they are sealed");
+	}
+	if (threads < 1 || threads > state->numberOfThreads) {
+		err(254, __func__, "threads: %ld must be in [1, %ld]", threads, state->numberOfThreads);
+	}
+
+	for (i = threads; i < state->numberOfThreads; i++) {
+		releaseArena(&state->arena[i]);
+	}
+	state->numberOfThreads = threads;
+	return;
+}
+
+
+/*
+ * touchArena - touch each page of the arena of the calling worker thread
+ *
+ * given:
+ *      thread_state    // state of the calling worker thread
+ *
+ * The pages of an arena are only placed on a NUMA node when they are first accessed.
+ * Accessing them from the (already pinned) worker thread that owns them makes that
+ * placement node-local to the worker.  The contents of the buffers are left as they are.
+ */
+void
+touchArena(struct thread_state *thread_state)
+{
+	struct state *state;	// Global run state
+	struct arena *arena;	// Arena of the calling thread
+	volatile BYTE *page;	// Byte in the page being touched
+	size_t pagesize;	// Bytes in a page
+	size_t offset;
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (thread_state == NULL) {
+		err(254, __func__, "thread_state arg is NULL");
+	}
+	state = thread_state->global_state;
+	if (state == NULL) {
+		err(254, __func__, "state arg is NULL");
+	}
+	if (state->arena == NULL) {
+		return;
+	}
+	arena = &state->arena[thread_state->thread_id];
+	if (arena->base == NULL) {
+		return;
+	}
+
+	/*
+	 * Touch each page
+	 */
+	pagesize = (size_t) sysconf(_SC_PAGESIZE);
+	for (offset = 0; offset < arena->size; offset += pagesize) {
+		page = arena->base + offset;
+		*page = *page;
+	}
+	return;
+}
+
+
+/*
+ * arenaScratch - take a buffer from the scratch area of the calling thread for the current iteration
+ *
+ * given:
+ *      thread_state    // state of the calling thread
+ *      bytes           // bytes of the buffer
+ *
+ * returns:
+ *      a cache line aligned buffer, that is not zeroized, which lasts until resetScratch()
+ *
+ * The buffers taken in an iteration must fit in the scratch reserved by arenaReserveScratch().
+ */
+void *
+arenaScratch(struct thread_state *thread_state, size_t bytes)
+{
+	struct state *state;	// Global run state
+	struct arena *arena;	// Arena of the calling thread
+	void *buf;		// Buffer taken from the scratch area
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (thread_state == NULL) {
+		err(254, __func__, "thread_state arg is NULL");
+	}
+	state = thread_state->global_state;
+	if (state == NULL) {
+		err(254, __func__, "state arg is NULL");
+	}
+	if (state->arena == NULL || state->arenaSealed != true) {
+		err(254, __func__, "arenas not sealed prior to taking scratch");
+	}
+	arena = &state->arena[thread_state->thread_id];
+
+	/*
+	 * Take the buffer
+	 */
+	bytes = roundUp(bytes, ARENA_ALIGN);
+	if (bytes > state->arenaScratch - arena->scratchUsed) {
+		err(254, __func__, "thread %ld took %lu bytes of scratch beyond the %lu bytes reserved",
+		    thread_state->thread_id, (unsigned long) (arena->scratchUsed + bytes),
+		    (unsigned long) state->arenaScratch);
+	}
+	buf = arena->scratch + arena->scratchUsed;
+	arena->scratchUsed += bytes;
+	return buf;
+}
+
+
+/*
+ * resetScratch - hand out the scratch area of the calling thread again, for a new iteration
+ *
+ * given:
+ *      thread_state    // state of the calling thread
+ */
+void
+resetScratch(struct thread_state *thread_state)
+{
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (thread_state == NULL) {
+		err(254, __func__, "thread_state arg is NULL");
+	}
+	if (thread_state->global_state == NULL) {
+		err(254, __func__, "state arg is NULL");
+	}
+	if (thread_state->global_state->arena == NULL) {
+		return;
+	}
+
+	thread_state->global_state->arena[thread_state->thread_id].scratchUsed = 0;
+	return;
+}
+
+
+/*
+ * addBudget - list a buffer of the arena of each thread in the memory budget
+ *
+ * given:
+ *      state           // run state to test under
+ *      test_num        // test that uses the buffer, or 0 for the driver
+ *      what            // name of the buffer
+ *      bytes           // bytes of the buffer
+ *      scratch         // true ==> buffer is in the scratch area
+ *      shared          // true ==> table shared by all threads, not in the arenas
+ *
+ * Buffers of the same test and name, such as the columns of a matrix, are listed once.
+ */
+static void
+addBudget(struct state *state, int test_num, const char *what, size_t bytes, bool scratch, bool shared)
+{
+	struct arena_budget *budget;	// Listed buffer
+	long int i;
+
+	for (i = 0; i < state->arenaBudgetCount; i++) {
+		budget = &state->arenaBudget[i];
+		if (budget->test_num == test_num && budget->scratch == scratch && budget->shared == shared &&
+		    strcmp(budget->what, what) == 0) {
+			budget->bytes += bytes;
+			return;
+		}
+	}
+	if (state->arenaBudgetCount >= MAX_ARENA_BUDGET) {
+		dbg(DBG_MED, "memory budget is full, %s is not listed", what);
+		return;
+	}
+	budget = &state->arenaBudget[state->arenaBudgetCount++];
+	budget->test_num = test_num;
+	budget->what = what;
+	budget->bytes = bytes;
+	budget->scratch = scratch;
+	budget->shared = shared;
+	return;
+}
+
+
+/*
+ * reportArenas - report the buffers in the arena of each thread
+ *
+ * given:
+ *      state           // run state to test under
+ */
+void
+reportArenas(struct state *state)
+{
+	struct arena_budget *budget;	// Listed buffer
+	size_t total;			// Bytes of the arena of each thread
+	long int i;
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (state == NULL) {
+		err(254, __func__, "state arg is NULL");
+	}
+	if (state->arena == NULL) {
+		return;
+	}
+
+	total = arenaFootprint(state);
+	msg("Memory budget: %.1f MiB per thread, %.1f MiB for %ld thread%s%s, and %.1f MiB of shared tables",
+	    (double) total / 1048576.0, (double) total * (double) state->numberOfThreads / 1048576.0,
+	    state->numberOfThreads, (state->numberOfThreads == 1) ? "" : "s",
+	    (state->arenaSealed != true) ? "" : ((state->arena[0].base != NULL) ? ", in one arena per thread" :
+						 ", allocated buffer by buffer"),
+	    (double) sharedFootprint(state) / 1048576.0);
+	for (i = 0; i < state->arenaBudgetCount; i++) {
+		budget = &state->arenaBudget[i];
+		msg("    %-24s %-16s %12.1f KiB%s", (budget->test_num > 0) ? state->testNames[budget->test_num] : "driver",
+		    budget->what, (double) budget->bytes / 1024.0, (budget->scratch == true) ? ", scratch of each iteration" :
+		    ((budget->shared == true) ? ", shared by all threads" : ""));
+	}
+	return;
+}
+
+
+/*
+ * releaseArena - free the storage of an arena
+ *
+ * given:
+ *      arena           // arena to free
+ */
+static void
+releaseArena(struct arena *arena)
+{
+	long int i;
+
+	if (arena->base != NULL) {
+		munmap(arena->base, arena->mapped);
+		arena->base = NULL;
+	}
+	if (arena->carves != NULL) {
+		free(arena->carves);
+		arena->carves = NULL;
+	}
+	arena->carveCount = 0;
+	for (i = 0; i < arena->blockCount; i++) {
+		free(arena->blocks[i]);
+	}
+	if (arena->blocks != NULL) {
+		free(arena->blocks);
+		arena->blocks = NULL;
+	}
+	arena->blockCount = 0;
+	arena->size = 0;
+	arena->scratch = NULL;
+	return;
+}
+
+
+/*
+ * destroyArenas - free the arenas and every buffer carved out of them
+ *
+ * given:
+ *      state           // run state to test under
+ *
+ * This function must be called after the destroy functions of the tests.
+ */
+void
+destroyArenas(struct state *state)
+{
+	long int i;
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (state == NULL) {
+		err(254, __func__, "state arg is NULL");
+	}
+	if (state->arena == NULL) {
+		return;
+	}
+
+	/*
+	 * Free the storage of each arena
+	 */
+	for (i = 0; i < state->numberOfThreads; i++) {
+		releaseArena(&state->arena[i]);
+	}
+	free(state->arena);
+	state->arena = NULL;
+	if (state->arenaBudget != NULL) {
+		free(state->arenaBudget);
+		state->arenaBudget = NULL;
+	}
+	state->arenaBudgetCount = 0;
+	state->arenaScratch = 0;
+	state->arenaSealed = false;
+	return;
+}
@@ -0,0 +1,45 @@
+/*****************************************************************************
+ P E R  T H R E A D  A R E N A  F U N C T I O N  P R O T O T Y P E S
+ *****************************************************************************/
+
+/*
+ * This code has been heavily modified by the following people:
+ *
+ *      Landon Curt Noll
+ *      Tom Gilgan
+ *      Riccardo Paccagnella
+ *
+ * See the README.md and the initial comment in sts.c for more information.
+ *
+ * WE (THOSE LISTED ABOVE WHO HEAVILY MODIFIED THIS CODE) DISCLAIM ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL WE (THOSE LISTED ABOVE
+ * WHO HEAVILY MODIFIED THIS CODE) BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF
+ * USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ * chongo (Landon Curt Noll, http://www.isthe.com/chongo/index.html) /\oo/\
+ *
+ * Share and enjoy! :-)
+ */
+
+#ifndef ARENA_H
+#   define ARENA_H
+
+extern void createArenas(struct state *state);
+extern void arenaAlloc(struct state *state, long int thread_id, int test_num, const char *what, size_t bytes, void *slot);
+extern void arenaReserveScratch(struct state *state, int test_num, const char *what, size_t bytes);
+extern void arenaShared(struct state *state, int test_num, const char *what, size_t bytes);
+extern void sealArenas(struct state *state);
+extern size_t arenaFootprint(struct state *state);
+extern size_t sharedFootprint(struct state *state);
+extern void trimArenas(struct state *state, long int threads);
+extern void reportArenas(struct state *state);
+extern void touchArena(struct thread_state *thread_state);
+extern void *arenaScratch(struct thread_state *thread_state, size_t bytes);
+extern void resetScratch(struct thread_state *thread_state);
+extern void destroyArenas(struct state *state);
+
+#endif				/* ARENA_H */
@@ -56,8 +56,117 @@ static double cephes_p1evl(double x, double *coef, int N);
 static double cephes_polevl(double x, double *coef, int N);
 #endif /* HAVE_LGAMMA */
 
+static double igamc_fraction(double a, double x, double lgam_a);
+static double igam_series(double a, double x, double lgam_a);
+
+
 double
 cephes_igamc(double a, double x)
+{
+	if ((x <= 0) || (a <= 0)) {
+		return (1.0);
+	}
+
+	if ((x < 1.0) || (x < a)) {
+		return (1.e0 - cephes_igam(a, x));
+	}
+
+	return igamc_fraction(a, x, cephes_lgam(a));
+}
+
+double
+cephes_igam(double a, double x)
+{
+	if ((x <= 0) || (a <= 0)) {
+		return 0.0;
+	}
+
+	if ((x > 1.0) && (x > a)) {
+		return 1.e0 - cephes_igamc(a, x);
+	}
+
+	return igam_series(a, x, cephes_lgam(a));
+}
+
+
+/*
+ * cephes_igamc_setup - set up cephes_igamc() for a fixed a
+ *
+ * given:
+ *      igamc_a         // evaluator to set up
+ *      a               // a argument of all its evaluations
+ *
+ * The tests call cephes_igamc() with a constant a, usually half their degrees of freedom.
+ * The evaluator computes cephes_lgam(a) once, instead of on every call.
+ */
+void
+cephes_igamc_setup(struct cephes_igamc_a *igamc_a, double a)
+{
+	igamc_a->a = a;
+	igamc_a->lgam_a = (a > 0) ? cephes_lgam(a) : 0.0;
+}
+
+
+/*
+ * cephes_igamc_fixed - cephes_igamc(a, x) for the a of an evaluator
+ *
+ * given:
+ *      igamc_a         // evaluator set up by cephes_igamc_setup()
+ *      x               // x argument
+ *
+ * returns:
+ *      the same value as cephes_igamc(igamc_a->a, x)
+ */
+double
+cephes_igamc_fixed(const struct cephes_igamc_a *igamc_a, double x)
+{
+	double a = igamc_a->a;
+
+	if ((x <= 0) || (a <= 0)) {
+		return (1.0);
+	}
+
+	if ((x < 1.0) || (x < a)) {
+		return (1.e0 - igam_series(a, x, igamc_a->lgam_a));
+	}
+
+	return igamc_fraction(a, x, igamc_a->lgam_a);
+}
+
+
+/*
+ * cephes_igamc_batch - cephes_igamc(a, x[i]) for many x values and the a of an evaluator
+ *
+ * given:
+ *      igamc_a         // evaluator set up by cephes_igamc_setup()
+ *      x               // x arguments
+ *      q               // where to store the results, may be x
+ *      count           // number of x arguments
+ *
+ * q[i] is the same value as cephes_igamc(igamc_a->a, x[i]).
+ *
+ * NOTE: Evaluating several continued fractions side by side, for the compiler to vectorize,
+ *	 was slower than this loop: the number of steps to converge varies with x, so most lanes
+ *	 wait for the slowest one.
+ */
+void
+cephes_igamc_batch(const struct cephes_igamc_a *igamc_a, const double *x, double *q, long int count)
+{
+	long int i;
+
+	for (i = 0; i < count; i++) {
+		q[i] = cephes_igamc_fixed(igamc_a, x[i]);
+	}
+
+	return;
+}
+
+
+/*
+ * igamc_fraction - continued fraction of cephes_igamc(), for x >= 1 and x >= a
+ */
+static double
+igamc_fraction(double a, double x, double lgam_a)
 {
 	double ans;
 	double ax;
@@ -74,15 +183,7 @@ cephes_igamc(double a, double x)
 	double qkm1;
 	double qkm2;
 
-	if ((x <= 0) || (a <= 0)) {
-		return (1.0);
-	}
-
-	if ((x < 1.0) || (x < a)) {
-		return (1.e0 - cephes_igam(a, x));
-	}
-
-	ax = a * log(x) - x - cephes_lgam(a);
+	ax = a * log(x) - x - lgam_a;
 
 	if (ax < -MAXLOG) {
 		dbg(DBG_VVHIGH, "igamc: UNDERFLOW\n");
@@ -131,26 +232,22 @@ cephes_igamc(double a, double x)
 	return ans * ax;
 }
 
-double
-cephes_igam(double a, double x)
+
+/*
+ * igam_series - power series of cephes_igam(), for x <= 1 or x <= a
+ */
+static double
+igam_series(double a, double x, double lgam_a)
 {
 	double ans;
 	double ax;
 	double c;
 	double r;
 
-	if ((x <= 0) || (a <= 0)) {
-		return 0.0;
-	}
-
-	if ((x > 1.0) && (x > a)) {
-		return 1.e0 - cephes_igamc(a, x);
-	}
-
 	/*
 	 * Compute x**a * exp(-x) / gamma(a)
 	 */
-	ax = a * log(x) - x - cephes_lgam(a);
+	ax = a * log(x) - x - lgam_a;
 	if (ax < -MAXLOG) {
 		dbg(DBG_VVHIGH, "igam: UNDERFLOW\n");
 		return 0.0;
@@ -28,8 +28,19 @@
 #      define HAVE_LGAMMA
 #   endif
 
+/*
+ * cephes_igamc_a - cephes_igamc() evaluator for a fixed a
+ */
+struct cephes_igamc_a {
+	double a;		// a argument of all the evaluations
+	double lgam_a;		// cephes_lgam(a), computed once by cephes_igamc_setup()
+};
+
 extern double cephes_igamc(double a, double x);
 extern double cephes_igam(double a, double x);
+extern void cephes_igamc_setup(struct cephes_igamc_a *igamc_a, double a);
+extern double cephes_igamc_fixed(const struct cephes_igamc_a *igamc_a, double x);
+extern void cephes_igamc_batch(const struct cephes_igamc_a *igamc_a, const double *x, double *q, long int count);
 #   if defined(HAVE_LGAMMA)
 #      define cephes_lgam(x) (lgamma(x))
 #   else
@@ -0,0 +1,597 @@
+// coordinator.c
+// Do the jobs of randdata in worker processes and assess them once (-J)
+
+/*
+ * This code has been heavily modified by the following people:
+ *
+ *      Landon Curt Noll
+ *      Tom Gilgan
+ *      Riccardo Paccagnella
+ *
+ * See the README.md and the initial comment in sts.c for more information.
+ *
+ * WE (THOSE LISTED ABOVE WHO HEAVILY MODIFIED THIS CODE) DISCLAIM ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL WE (THOSE LISTED ABOVE
+ * WHO HEAVILY MODIFIED THIS CODE) BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF
+ * USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ * chongo (Landon Curt Noll, http://www.isthe.com/chongo/index.html) /\oo/\
+ *
+ * Share and enjoy! :-)
+ */
+
+
+// Exit codes: 248 thru 252
+
+// global capabilities
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#endif /* _WIN32 */
+#include "externs.h"
+#include "utilities.h"
+#include "pvalues.h"
+#include "coordinator.h"
+#include "debug.h"
+
+
+#ifndef _WIN32
+/*
+ * Forward static function declarations
+ */
+static bool readMessage(int fd, void *buf, size_t len);
+static void writeMessage(int fd, const void *buf, size_t len);
+static void runWorker(struct state *state, int fd);
+static void runJob(struct state *state, long int jobnum);
+static void receiveResult(struct state *state, struct worker_process *worker, long int id);
+#endif /* _WIN32 */
+
+
+/*
+ * count_bitstreams - count the whole bitstreams of randdata
+ *
+ * given:
+ *      state           // run state to test under
+ *
+ * returns:
+ *      number of bitstreams of -S bitcount bits that randdata holds
+ *
+ * As with -j jobnum, ASCII randdata is counted as one bit per octet.
+ */
+long int
+count_bitstreams(struct state *state)
+{
+	struct stat buf;	// status of randdata
+	long int fileBits;	// Number of bits of randdata
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (state == NULL) {
+		err(248, __func__, "state arg is NULL");
+	}
+	if (state->randomDataPath == NULL || state->stdinData == true) {
+		err(248, __func__, "the bitstreams of randdata can only be counted in a file, not in standard input");
+	}
+	if (state->tp.n < 1) {
+		err(248, __func__, "bitcount(n): %ld must be >= 1", state->tp.n);
+	}
+
+	if (stat(state->randomDataPath, &buf) < 0) {
+		errp(248, __func__, "cannot stat randdata: %s", state->randomDataPath);
+	}
+	if (state->dataFormat == FORMAT_ASCII_01) {
+		fileBits = (long int) buf.st_size;
+	} else {
+		fileBits = (long int) buf.st_size * BITS_N_BYTE;
+	}
+
+	return fileBits / state->tp.n;
+}
+
+
+/*
+ * count_jobs - count the whole jobs of randdata from -j jobnum on
+ *
+ * given:
+ *      state           // run state to test under
+ *
+ * returns:
+ *      number of jobs of -i iterations of -S bitcount bits that randdata holds, starting at job -j jobnum
+ */
+long int
+count_jobs(struct state *state)
+{
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (state == NULL) {
+		err(248, __func__, "state arg is NULL");
+	}
+	if (state->tp.numOfBitStreams < 1) {
+		err(248, __func__, "iterations: %ld must be >= 1", state->tp.numOfBitStreams);
+	}
+
+	return MAX(0, count_bitstreams(state) / state->tp.numOfBitStreams - state->jobnum);
+}
+
+
+/*
+ * plan_shards - print a plan of the jobs of randdata for -L shards hosts (or workers)
+ *
+ * given:
+ *      state           // run state to test under
+ *
+ * Every job runs the same tests over the same number of bits, so the estimated cost of
+ * a shard (iterations times bitcount for each of its jobs) is balanced by giving each shard
+ * a contiguous range of jobnums whose lengths differ by at most one job.
+ *
+ * With -i iterations, randdata is cut into jobs of that many bitstreams. Without,
+ * each shard gets a single job and the whole bitstreams of randdata are split evenly.
+ * The bits left over at the end of randdata are reported and not tested.
+ *
+ * The plan is printed on stdout as a sts command per shard, followed by the
+ * command that assesses the .pvalues files of all shards once they are gathered in one directory.
+ */
+void
+plan_shards(struct state *state)
+{
+	long int bitstreams;	// Number of whole bitstreams in randdata
+	long int iterations;	// Number of bitstreams per job
+	long int jobs;		// Number of whole jobs in randdata
+	long int shards;	// Number of shards to plan
+	long int first;		// First jobnum of a shard
+	long int last;		// Last jobnum of a shard + 1
+	long int i;
+	const char *format;	// -F format letter
+	char bins[MAX_DATA_DIGITS + 8];	// -P 8=bins of every command, or an empty string
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (state == NULL) {
+		err(248, __func__, "state arg is NULL");
+	}
+	if (state->planShards < 1) {
+		err(248, __func__, "shards: %ld must be >= 1", state->planShards);
+	}
+	shards = state->planShards;
+
+	/*
+	 * Cut randdata into jobs
+	 */
+	bitstreams = count_bitstreams(state);
+	if (state->iterationFlag == true) {
+		iterations = state->tp.numOfBitStreams;
+	} else {
+		iterations = bitstreams / shards;
+	}
+	if (iterations < 1 || bitstreams < iterations) {
+		err(248, __func__, "randdata holds %ld whole bitstreams of %ld bits: too few for %ld shards of %ld iterations",
+		    bitstreams, state->tp.n, shards, MAX(1, iterations));
+	}
+	jobs = bitstreams / iterations;
+	if (jobs < shards) {
+		warn(__func__, "only %ld jobs of %ld iterations for %ld shards: %ld shards will be idle, consider a smaller -i",
+		     jobs, iterations, shards, shards - jobs);
+	}
+	format = (state->dataFormat == FORMAT_ASCII_01) ? "a" : "r";
+
+	/*
+	 * A .sketch file (-K) is tallied in the -P 8=bins of its run, that must be the bins of all the jobs
+	 */
+	bins[0] = '\0';
+	if (state->uniformityBinsFlag == false && state->legacy_output == false) {
+		snprintf(bins, sizeof(bins), " -P 8=%ld", MAX(1, (long int) sqrt(jobs * iterations)));
+	}
+
+	/*
+	 * Print the plan
+	 */
+	printf("# randdata: %s\n", state->randomDataPath);
+	printf("# %ld whole bitstreams of %ld bits, %ld jobs of %ld iterations, %ld shards\n",
+	       bitstreams, state->tp.n, jobs, iterations, shards);
+	printf("# %ld whole bitstreams left untested at the end of randdata\n", bitstreams - jobs * iterations);
+	for (i = 0; i < shards; ++i) {
+		first = (i * jobs) / shards;
+		last = ((i + 1) * jobs) / shards;
+		if (first >= last) {
+			printf("# shard %ld: idle\n", i);
+			continue;
+		}
+		printf("# shard %ld: jobs %ld thru %ld, %ld bitstreams, %.2f%% of the estimated cost\n",
+		       i, first, last - 1, (last - first) * iterations, 100.0 * (double) (last - first) / (double) jobs);
+		if (last - first == 1) {
+			printf("sts -m i -F %s -S %ld -i %ld%s -j %ld %s\n",
+			       format, state->tp.n, iterations, bins, first, state->randomDataPath);
+		} else {
+			printf("for j in $(seq %ld %ld); do sts -m i -F %s -S %ld -i %ld%s -j $j %s; done\n",
+			       first, last - 1, format, state->tp.n, iterations, bins, state->randomDataPath);
+		}
+	}
+	printf("# add the same -t, -P, -K and -w options to every command, gather the .pvalues or .sketch files and run:\n");
+	printf("sts -m a -S %ld%s -d pvaluesdir -w workDir %s\n", state->tp.n, bins, state->randomDataPath);
+}
+
+
+/*
+ * coordinate - do the jobs of randdata in worker processes and merge their p_value tallies (-J)
+ *
+ * given:
+ *      state           // run state to test under, initialized by init()
+ *
+ * Each of the state->workerCount worker processes is forked with a socket to this process.
+ * A worker asks for a job by sending the tallies of its previous job (or an empty message
+ * when it starts), and is answered with the jobnum of the next job, or -1 when all jobs are handed out.
+ * Jobs -j jobnum thru the last whole job of randdata are done, and the tallies of every job are merged
+ * into state, so that metrics() assesses all of them at once.
+ */
+void
+coordinate(struct state *state)
+{
+#ifndef _WIN32
+	struct worker_process *workers;	// Worker processes
+	struct pollfd *fds;		// Sockets to the workers, as polled
+	long int jobs;			// Number of jobs to do
+	long int count;			// Number of worker processes
+	long int nextJob;		// Next jobnum to hand out
+	long int lastJob;		// Last jobnum to hand out
+	long int running;		// Number of workers not yet told to exit
+	long int i, j;
+	int64_t message;		// Jobnum sent to a worker
+	int sv[2];			// Socket pair to a worker
+	int status;			// Exit status of a worker
+	pid_t pid;
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (state == NULL) {
+		err(249, __func__, "state arg is NULL");
+	}
+	if (state->p_valTally == false) {
+		err(249, __func__, "p_values of the jobs of worker processes must be tallied");
+	}
+
+	/*
+	 * Count the jobs, and tally them in the uniformity bins of all their iterations
+	 */
+	jobs = count_jobs(state);
+	if (jobs < 1) {
+		err(249, __func__, "randdata holds no whole job of %ld iterations of %ld bits from jobnum %ld: %s",
+		    state->tp.numOfBitStreams, state->tp.n, state->jobnum, state->randomDataPath);
+	}
+	if (state->uniformityBinsFlag == false && state->legacy_output == false) {
+		state->tp.uniformity_bins = MAX(1, (long int) sqrt(jobs * state->tp.numOfBitStreams));
+	}
+	count = MIN(state->workerCount, jobs);
+	nextJob = state->jobnum;
+	lastJob = state->jobnum + jobs - 1;
+	dbg(DBG_LOW, "Start of iterate phase: jobs %ld thru %ld in %ld worker processes", nextJob, lastJob, count);
+
+	/*
+	 * Each worker opens randdata by itself, so that no file offset is shared
+	 */
+	if (state->streamFile != NULL) {
+		if (fclose(state->streamFile) != 0) {
+			errp(249, __func__, "error closing: %s", state->randomDataPath);
+		}
+		state->streamFile = NULL;
+	}
+
+	/*
+	 * Fork the workers
+	 */
+	workers = calloc((size_t) count, sizeof(workers[0]));
+	fds = calloc((size_t) count, sizeof(fds[0]));
+	if (workers == NULL || fds == NULL) {
+		errp(249, __func__, "cannot calloc %ld worker processes", count);
+	}
+	fflush(NULL);		// nothing buffered is to be written again by a worker
+	for (i = 0; i < count; i++) {
+		if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0) {
+			errp(249, __func__, "cannot create the socket to worker process %ld", i);
+		}
+		pid = fork();
+		if (pid < 0) {
+			errp(249, __func__, "cannot fork worker process %ld", i);
+		}
+		if (pid == 0) {
+			close(sv[0]);
+			for (j = 0; j < i; j++) {
+				close(workers[j].fd);
+			}
+			runWorker(state, sv[1]);
+			exit(0);
+		}
+		close(sv[1]);
+		workers[i].pid = (long int) pid;
+		workers[i].fd = sv[0];
+		workers[i].jobnum = -1;
+		dbg(DBG_MED, "forked worker process %ld: pid %ld", i, workers[i].pid);
+	}
+
+	/*
+	 * Hand out the jobs as the workers ask for them, and merge the tallies they send back
+	 */
+	running = count;
+	while (running > 0) {
+		for (i = 0; i < count; i++) {
+			fds[i].fd = workers[i].fd;
+			fds[i].events = POLLIN;
+			fds[i].revents = 0;
+		}
+		if (poll(fds, (nfds_t) count, -1) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			errp(249, __func__, "error polling the sockets to the worker processes");
+		}
+		for (i = 0; i < count; i++) {
+			if (workers[i].fd < 0 || fds[i].revents == 0) {
+				continue;
+			}
+			receiveResult(state, &workers[i], i);
+			if (nextJob <= lastJob) {
+				message = nextJob;
+				workers[i].jobnum = nextJob++;
+				writeMessage(workers[i].fd, &message, sizeof(message));
+				dbg(DBG_HIGH, "worker process %ld was handed job %ld", i, workers[i].jobnum);
+			} else {
+				message = -1;
+				writeMessage(workers[i].fd, &message, sizeof(message));
+				close(workers[i].fd);
+				workers[i].fd = -1;
+				--running;
+			}
+		}
+	}
+
+	/*
+	 * Wait for the workers to exit
+	 */
+	for (i = 0; i < count; i++) {
+		if (waitpid((pid_t) workers[i].pid, &status, 0) < 0) {
+			errp(249, __func__, "error waiting for worker process %ld: pid %ld", i, workers[i].pid);
+		}
+		if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+			err(249, __func__, "worker process %ld: pid %ld failed after sending the tallies of all its jobs",
+			    i, workers[i].pid);
+		}
+	}
+	free(fds);
+	free(workers);
+
+	/*
+	 * The tallies are of all the iterations of all the jobs
+	 */
+	state->tp.numOfBitStreams *= jobs;
+	dbg(DBG_LOW, "End of iterate phase: %ld iterations in %ld jobs\n", state->tp.numOfBitStreams, jobs);
+#else /* _WIN32 */
+	err(249, __func__, "worker processes (-J) are not supported on this platform");
+#endif /* _WIN32 */
+
+	return;
+}
+
+#ifndef _WIN32
+
+/*
+ * readMessage - read a whole message from a socket
+ *
+ * given:
+ *      fd              // socket to read from
+ *      buf             // where to store the message
+ *      len             // length of the message in octets
+ *
+ * returns:
+ *      true ==> the message was read,
+ *      false ==> the other end closed the socket before the message started
+ *
+ * This function does not return if the socket is closed in the middle of a message.
+ */
+static bool
+readMessage(int fd, void *buf, size_t len)
+{
+	size_t done;		// octets read so far
+	ssize_t ret;		// read return
+
+	for (done = 0; done < len; done += (size_t) ret) {
+		ret = read(fd, (char *) buf + done, len - done);
+		if (ret < 0 && errno == EINTR) {
+			ret = 0;
+			continue;
+		}
+		if (ret < 0) {
+			errp(250, __func__, "error reading %lu octets from socket", len);
+		}
+		if (ret == 0) {
+			if (done == 0) {
+				return false;
+			}
+			err(250, __func__, "socket closed after %lu of %lu octets", done, len);
+		}
+	}
+
+	return true;
+}
+
+
+/*
+ * writeMessage - write a whole message to a socket
+ *
+ * given:
+ *      fd              // socket to write to
+ *      buf             // message to write
+ *      len             // length of the message in octets
+ */
+static void
+writeMessage(int fd, const void *buf, size_t len)
+{
+	size_t done;		// octets written so far
+	ssize_t ret;		// write return
+
+	for (done = 0; done < len; done += (size_t) ret) {
+		ret = write(fd, (const char *) buf + done, len - done);
+		if (ret < 0 && errno == EINTR) {
+			ret = 0;
+			continue;
+		}
+		if (ret < 0) {
+			errp(250, __func__, "error writing %lu octets to socket", len);
+		}
+	}
+
+	return;
+}
+
+
+/*
+ * receiveResult - receive the tallies of the previous job of a worker, or its first request for a job
+ *
+ * given:
+ *      state           // run state to merge the tallies into
+ *      worker          // worker whose socket is readable
+ *      id              // number of the worker, for messages
+ *
+ * A message is the int64_t size of a .sketch image, followed by the image itself.
+ * The first message of a worker, sent before its first job, is empty.
+ */
+static void
+receiveResult(struct state *state, struct worker_process *worker, long int id)
+{
+	int64_t size;		// size of the .sketch image
+	char *image;		// .sketch image of the job
+	char *name;		// name of the job, for warnings
+
+	if (readMessage(worker->fd, &size, sizeof(size)) == false) {
+		err(251, __func__, "worker process %ld: pid %ld exited before %s",
+		    id, worker->pid, worker->jobnum < 0 ? "its first job" : "completing its job");
+	}
+	if (worker->jobnum < 0) {
+		if (size != 0) {
+			err(251, __func__, "worker process %ld: pid %ld sent %ld octets before its first job",
+			    id, worker->pid, (long int) size);
+		}
+		return;
+	}
+	if (size <= 0) {
+		err(251, __func__, "worker process %ld: pid %ld sent no tallies for job %ld", id, worker->pid, worker->jobnum);
+	}
+
+	/*
+	 * Merge the tallies of the job
+	 */
+	image = malloc((size_t) size);
+	if (image == NULL) {
+		errp(251, __func__, "cannot malloc %ld octets for the tallies of job %ld", (long int) size, worker->jobnum);
+	}
+	if (readMessage(worker->fd, image, (size_t) size) == false) {
+		err(251, __func__, "worker process %ld: pid %ld exited while sending job %ld", id, worker->pid, worker->jobnum);
+	}
+	asprintf(&name, "job %ld of worker process %ld", worker->jobnum, id);
+	if (merge_sketch(state, name, image, (size_t) size) == false) {
+		err(251, __func__, "cannot merge the tallies of %s", name);
+	}
+	dbg(DBG_MED, "merged the tallies of %s", name);
+	free(name);
+	free(image);
+	worker->jobnum = -1;
+
+	return;
+}
+
+
+/*
+ * runWorker - do the jobs handed out by the coordinator, in a worker process
+ *
+ * given:
+ *      state           // run state of the coordinator, as forked
+ *      fd              // worker end of the socket to the coordinator
+ */
+static void
+runWorker(struct state *state, int fd)
+{
+	int64_t jobnum;		// Job to do, or -1 when there are no more jobs
+	int64_t size;		// size of the .sketch image of the job, as sent
+	size_t imageSize;	// size of the .sketch image of the job
+	void *image;		// .sketch image of the job
+
+	/*
+	 * Ask for a first job
+	 */
+	size = 0;
+	writeMessage(fd, &size, sizeof(size));
+
+	/*
+	 * Do each job, and send its tallies to ask for the next one
+	 */
+	while (readMessage(fd, &jobnum, sizeof(jobnum)) == true && jobnum >= 0) {
+		runJob(state, (long int) jobnum);
+		image = build_sketch(state, &imageSize);
+		size = (int64_t) imageSize;
+		writeMessage(fd, &size, sizeof(size));
+		writeMessage(fd, image, (size_t) size);
+		free(image);
+	}
+	close(fd);
+
+	return;
+}
+
+
+/*
+ * runJob - do the iterations of a job, in a worker process
+ *
+ * given:
+ *      state           // run state of the worker
+ *      jobnum          // job to do
+ *
+ * The counts and tallies of the previous job are cleared first.
+ */
+static void
+runJob(struct state *state, long int jobnum)
+{
+	int test;
+
+	for (test = 1; test <= NUMOFTESTS; test++) {
+		state->count[test] = 0;
+		state->valid[test] = 0;
+		state->success[test] = 0;
+		state->failure[test] = 0;
+		state->valid_p_val[test] = 0;
+		if (state->tally[test] != NULL) {
+			free_p_val_tally(state->tally[test]);
+			state->tally[test] = NULL;
+		}
+	}
+
+	state->jobnum = jobnum;
+	state->iterationsMissing = state->tp.numOfBitStreams;
+	state->streamFile = fopen(state->randomDataPath, "r");
+	if (state->streamFile == NULL) {
+		errp(252, __func__, "unable to open data file to reading: %s", state->randomDataPath);
+	}
+	dbg(DBG_MED, "worker process %ld: start of job %ld", (long int) getpid(), jobnum);
+
+	invokeTestSuite(state);
+
+	return;
+}
+
+#endif /* _WIN32 */
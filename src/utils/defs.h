@@ -27,6 +27,8 @@
 #   include "../utils/config.h"
 #   include "../utils/dyn_alloc.h"
 #   include <pthread.h>
+#   include <stdint.h>
+#   include <time.h>
 #if !defined(LEGACY_FFT)
 #   include <fftw3.h>
 #else /* LEGACY_FFT */
@@ -126,6 +128,20 @@
 #   define DEFAULT_UNIFORMITY_LEVEL	(0.0001)	// -P 10=uni_level, uniformity errors have values below this
 #   define DEFAULT_ALPHA		(0.01)		// -P 11=alpha, p_value significance level
 
+#   define BATCH_INPUT_BYTES		(1048576)	// Max input bytes read at once for a batch of iterations
+#   define BATCH_SHARE			(2)		// A batch is at most 1/(BATCH_SHARE*threads) of the missing iterations
+#   define WRITER_CHUNK			(1024)		// -W hands this many iterations of a test at once to the writer thread
+#   define WRITER_QUEUE			(2 * NUMOFTESTS)	// Max chunks waiting for the writer thread before iterating blocks
+
+#   define PVAL_MAGIC			"STSPVAL"	// First 8 octets (with the NUL) of a v2 .pvalues file
+#   define PVAL_VERSION			(3)		// Version of the .pvalues file format written by -m i
+#   define PVAL_VERSION_P_VALUES		(2)		// Oldest version of the format whose .pvalues files can be read
+#   define PVAL_BYTE_ORDER		(0x01020304)	// Byte order marker, as written by the host that wrote the file
+#   define PVAL_MSB_FIRST		(1)		// Raw binary (-F r) octets are split into bits most significant first
+#   define PVAL_CONTENT_P_VALUES	(0)		// A .pvalues file holds the p_values of each test
+#   define PVAL_CONTENT_SKETCH		(1)		// A .sketch file (-K) holds the p_value tallies of each test
+#   define PVAL_CONTENT_CHECKPOINT	(2)		// A .checkpoint file (-C) holds the completed iterations and results so far
+
 /*****************************************************************************
  INPUT SIZE RECOMMENDATIONS CONSTANTS
  *****************************************************************************/
@@ -179,6 +195,7 @@
 #   define MIN_UNIVERSAL		(387840)	// Minimum n to allow L >= 6 for TEST_UNIVERSAL
 #   define MIN_L_UNIVERSAL		(6)		// Minimum value of L for TEST_UNIVERSAL
 #   define MAX_L_UNIVERSAL		(16)		// Maximum value of L for TEST_UNIVERSAL
+#   define LOG2_GAPS_UNIVERSAL		(4)		// Distances below this times 2^L use the log2 table of TEST_UNIVERSAL
 
 #   define MIN_LENGTH_LINEARCOMPLEXITY	(1000000)	// Minimum n for TEST_LINEARCOMPLEXITY
 #   define MIN_M_LINEARCOMPLEXITY	(500)		// Minimum M for TEST_LINEARCOMPLEXITY
@@ -249,6 +266,13 @@ enum run_mode {
 	MODE_ASSESS_ONLY = 'a',		// Collect the p-values from the binary files specified from '-d file...' and assess them
 };
 
+// Worker thread placement policies
+enum placement {
+	PLACEMENT_NONE = 0,		// Let the operating system place worker threads (default)
+	PLACEMENT_CORE = 1,		// Pin each worker thread to one CPU, spreading workers across NUMA nodes
+	PLACEMENT_NODE = 2,		// Pin each worker thread to all the CPUs of one NUMA node, round robin across nodes
+};
+
 #   define MIN_PARAM (1)	// minimum -P parameter number
 #   define MAX_PARAM (11)	// maximum -P parameter number
 #   define MAX_INT_PARAM (9)	// maximum -P parameter that is an integer, beyond this are doubles
@@ -341,14 +365,221 @@ struct metric_results {
 };
 
 /*
- * Special data for each template of each iteration in p_val (instead of just p_value doubles) for the NONOVERLAPPING test
+ * Special data for each template of each iteration of the NONOVERLAPPING test, kept in its stats for stats.txt (-s)
+ *
+ * The p_value of each template is kept in p_val as for any other test.
  */
 struct nonover_stats {
-	double p_value;			// Test p_value for a given template
-	bool success;			// Success or failure for a given template
 	double chi2;			// Test statistic for a given template
-	long int template_index;	// Template number of a given template
 	unsigned int Wj[BLOCKS_NON_OVERLAPPING]; // Number of times that m-bit template occurs within each block
+	bool success;			// Success or failure for a given template
+};
+
+/*
+ * Uniformity and proportion counts of the p_values of a test, as needed by the metrics
+ */
+struct p_val_tally {
+	long int partitionCount;	// Number of partitions (data*.txt files) of the p_values of the test
+	long int bins;			// Number of uniformity bins of each partition
+	long int count;			// Number of p_values tallied, including NON_P_VALUE ones
+	long int *sampleCount;		// Per partition number of p_values sampled by the metrics
+	long int *toolow;		// Per partition number of sampled p_values below alpha
+	long int *freqPerBin;		// Per partition uniformity bins (partitionCount rows of bins counts)
+};
+
+/*
+ * Iterations of a test handed to the -W writer thread
+ */
+struct write_chunk {
+	int test;			// Test that performed the iterations
+	struct dyn_array *stats;	// stats of the iterations (for stats.txt)
+	struct dyn_array *p_val;	// p_values of the iterations (for results.txt and data*.txt)
+	struct write_chunk *next;	// Next chunk to write, or NULL
+};
+
+/*
+ * Background writer of stats.txt, results.txt and data*.txt (-W)
+ */
+struct writer {
+	pthread_t thread;		// Writer thread
+	pthread_mutex_t mutex;		// Protects the chunk queue and stop
+	pthread_cond_t cond;		// Signaled when a chunk is queued or written, or when stop is set
+	struct write_chunk *head;	// Oldest queued chunk, or NULL
+	struct write_chunk *tail;	// Newest queued chunk, or NULL
+	long int queued;		// Number of queued chunks
+	bool stop;			// true ==> write the queued chunks and exit
+	long int printed[NUMOFTESTS + 1];	// Number of iterations of each test already written
+	struct state *state;		// Private copy of the run state, used by the writer thread to print chunks
+};
+
+/*
+ * Header of a v2 .pvalues or .sketch file
+ *
+ * A v2 .pvalues file is made of this header, followed by an offset table of header.testCount
+ * struct pval_entry, followed by the p_values of each test in the table as arrays of doubles.
+ * A .sketch file has the same layout, with a struct pval_sketch per test instead of p_values.
+ * All fields and p_values are written in the byte order of the host that wrote the file.
+ * All fields and arrays are 8 octet aligned, so that the file may be mapped and scanned in place.
+ *
+ * The checksum is the 64-bit FNV-1a hash of the 64-bit words of the whole file, with the
+ * checksum field taken as 0.
+ */
+struct pval_header {
+	char magic[8];				// PVAL_MAGIC
+	uint32_t byteOrder;			// PVAL_BYTE_ORDER
+	uint32_t version;			// PVAL_VERSION
+	uint64_t headerSize;			// sizeof(struct pval_header)
+	uint64_t fileSize;			// Size of the whole file in octets
+	uint64_t checksum;			// FNV-1a hash of the file
+	int64_t jobnum;				// -j jobnum of the run that wrote the file
+	int64_t numOfBitStreams;		// -i iterations of the run that wrote the file
+	int64_t n;				// -P 9=bitcount, Length of a single bit stream
+	int64_t blockFrequencyBlockLength;	// -P 1=M, Block Frequency Test - block length
+	int64_t nonOverlappingTemplateLength;	// -P 2=m, NonOverlapping Template Test - block length
+	int64_t overlappingTemplateLength;	// -P 3=m, Overlapping Template Test - block length
+	int64_t approximateEntropyBlockLength;	// -P 4=m, Approximate Entropy Test - block length
+	int64_t serialBlockLength;		// -P 5=m, Serial Test - block length
+	int64_t linearComplexitySequenceLength;	// -P 6=M, Linear Complexity Test - block length
+	double alpha;				// -P 11=alpha of the run that wrote the file
+	uint32_t bitOrder;			// PVAL_MSB_FIRST
+	uint32_t dataFormat;			// -F format of the tested data
+	uint32_t testCount;			// Number of struct pval_entry in the offset table
+	uint32_t content;			// PVAL_CONTENT_P_VALUES, PVAL_CONTENT_SKETCH or PVAL_CONTENT_CHECKPOINT
+};
+
+/*
+ * Offset table entry of a v2 .pvalues or .sketch file: where the p_values or the tally of a test are
+ */
+struct pval_entry {
+	int64_t test;				// Test number
+	int64_t partitionCount;			// Number of p_values of the test per iteration
+	int64_t count;				// Number of p_values, including NON_P_VALUE ones
+	uint64_t offset;			// Offset in octets from the start of the file of the p_values or tally
+};
+
+/*
+ * Tally of the p_values of a test in a .sketch file
+ *
+ * It is followed by the int64_t per partition arrays of the tally:
+ *
+ *      sampleCount[partitionCount]
+ *      toolow[partitionCount]
+ *      freqPerBin[partitionCount * bins]
+ *
+ * The tally is only in the -P 8=bins of the run that wrote it, so that a .sketch file can only be assessed
+ * with these bins: p_values cannot be moved to other bins without knowing them.
+ */
+struct pval_sketch {
+	int64_t count;				// Number of iterations of the test
+	int64_t valid;				// Number of testable iterations
+	int64_t success;			// Number of successful iterations
+	int64_t failure;			// Number of failed iterations
+	int64_t valid_p_val;			// Number of p_values in [0.0, 1.0]
+	int64_t tallied;			// Number of p_values tallied, including NON_P_VALUE ones
+	int64_t bins;				// -P 8=bins of freqPerBin
+};
+
+/*
+ * Completed iterations in a .checkpoint file
+ *
+ * A .checkpoint file has the layout of a .sketch file, with this struct right after the offset table,
+ * followed by the uint64_t words of the bitmap of completed iterations (bit i % 64 of word i / 64 is set
+ * once iteration i is completed).
+ */
+struct pval_progress {
+	int64_t completed;			// Number of completed iterations
+	int64_t words;				// Number of words of the bitmap, (iterations + 63) / 64
+};
+
+/*
+ * Results of a test in a .checkpoint file
+ *
+ * It is followed by the p_val array elements and the stats array elements, each padded to 8 octets,
+ * and if p_values are tallied, by the int64_t per partition arrays of the tally, as in a .sketch file.
+ * The array elements are written as they are in memory: a .checkpoint is only read back by the same build.
+ */
+struct pval_checkpoint {
+	int64_t count;				// Number of iterations of the test
+	int64_t valid;				// Number of testable iterations
+	int64_t success;			// Number of successful iterations
+	int64_t failure;			// Number of failed iterations
+	int64_t valid_p_val;			// Number of p_values in [0.0, 1.0]
+	int64_t p_valCount;			// Number of p_val array elements, or -1 if p_values are tallied
+	int64_t p_valSize;			// Size in octets of a p_val array element
+	int64_t statsCount;			// Number of stats array elements, or -1 without -s
+	int64_t statsSize;			// Size in octets of a stats array element
+	int64_t tallied;			// Number of p_values tallied, or -1 if p_values are kept
+	int64_t bins;				// -P 8=bins of freqPerBin
+};
+
+/*
+ * Completed iterations of a run that writes checkpoints (-C) or resumes from one (-r)
+ */
+struct checkpoint {
+	pthread_mutex_t mutex;		// Protects all below
+	pthread_cond_t cond;		// Signaled when an iteration ends or a checkpoint was written
+	uint64_t *done;			// Bitmap of completed iterations
+	long int words;			// Number of words of the done bitmap
+	long int completed;		// Number of completed iterations
+	long int active;		// Number of iterations being done
+	long int next;			// Write a checkpoint once completed reaches next
+	bool pending;			// true ==> a checkpoint waits for the iterations being done to end
+};
+
+/*
+ * Worker process of the local coordinator (-J)
+ */
+struct worker_process {
+	long int pid;			// Process id of the worker
+	int fd;				// Coordinator end of the socket to the worker, or -1 once the worker was told to exit
+	long int jobnum;		// Job being done by the worker, or -1 if none
+};
+
+/*
+ * Files of -d pvaluesdir shared by the threads that read them (-m a)
+ */
+struct pval_reader {
+	pthread_mutex_t mutex;		// Protects next
+	char **filenames;		// Names of the .pvalues files to read
+	long int count;			// Number of filenames
+	long int next;			// Index in filenames of the next file to read
+};
+
+/*
+ * Thread that reads .pvalues files (-m a)
+ */
+struct pval_worker {
+	pthread_t thread;		// Reading thread
+	struct pval_reader *reader;	// Files to read
+	struct state *state;		// Private copy of the run state, whose tally[] the thread fills
+};
+
+/*
+ * Range of the kept p_values of a test, tallied by one thread before the metrics
+ */
+struct tally_range {
+	int test;			// Test that produced the p_values
+	long int first;			// Index of the first p_value of the range, at the start of an iteration
+	long int last;			// Index of the last p_value of the range + 1
+};
+
+/*
+ * Kept p_values of all tests shared by the threads that tally them
+ */
+struct tally_pool {
+	pthread_mutex_t mutex;		// Protects next
+	struct tally_range *ranges;	// Ranges of p_values to tally
+	long int count;			// Number of ranges
+	long int next;			// Index in ranges of the next range to tally
+};
+
+/*
+ * Thread that tallies kept p_values
+ */
+struct tally_worker {
+	pthread_t thread;		// Tallying thread
+	struct tally_pool *pool;	// Ranges to tally
+	struct state *state;		// Private copy of the run state, whose tally[] the thread fills
 };
 
 /*
@@ -360,6 +591,95 @@ struct Node
 	struct Node *next;
 };
 
+// Format of the -R timing report
+enum timing_format {
+	TIMING_NONE = 0,		// Do not account for time spent (default)
+	TIMING_TEXT = 1,		// Report time spent as text on stderr
+	TIMING_JSON = 2,		// Report time spent as text on stderr and as JSON in workDir/timing.json
+};
+
+// Phases of a test, as called by the driver
+enum timing_phase {
+	PHASE_INIT = 0,			// init() of a test
+	PHASE_ITERATE = 1,		// iterate() of a test, summed over all threads
+	PHASE_PRINT = 2,		// print() of a test
+	PHASE_METRICS = 3,		// metrics() of a test
+};
+#   define NUMOFPHASES (4)		// Number of enum timing_phase values
+
+/*
+ * Time accounted to a phase
+ */
+struct phase_time {
+	double wall;			// Elapsed wall clock seconds
+	double cpu;			// CPU seconds used by the thread(s) doing the work
+	long int calls;			// Number of timed calls
+	long int bits;			// Number of bits processed by the timed calls
+};
+
+/*
+ * Time accounted to each test, phase and thread of a run
+ */
+struct timing {
+	struct phase_time phase[NUMOFTESTS + 1][NUMOFPHASES];	// Per test, per phase time (PHASE_ITERATE summed over threads)
+	struct phase_time **iterate;		// Per thread, per test iterate time ([numberOfThreads][NUMOFTESTS + 1])
+	struct phase_time *read;		// Per thread time spent reading input data (while holding the mutex)
+	struct phase_time *parse;		// Per thread time spent converting input data into epsilon
+	long int numberOfThreads;		// Number of rows in iterate[], read[] and parse[]
+	struct timespec runWall;		// Wall clock time at the start of the run
+	struct timespec runCPU;			// Process CPU time at the start of the run
+};
+
+/*
+ * CPU and NUMA node layout of the host, as seen by this process
+ */
+struct topology {
+	long int numberOfCPUs;		// Number of CPUs this process is allowed to run on
+	long int numberOfNodes;		// Number of NUMA nodes holding at least one of those CPUs
+	long int *cpu;			// CPU ids, ordered round robin across nodes (numberOfCPUs elements)
+	long int *cpuNode;		// Index into nodeId[] of the node holding cpu[i] (numberOfCPUs elements)
+	long int *nodeId;		// Operating system id of each NUMA node (numberOfNodes elements)
+};
+
+/*
+ * Buffer carved out of an arena, placed when the arena is mapped
+ */
+struct arena_carve {
+	size_t offset;			// Offset of the buffer from the base of the arena
+	size_t bytes;			// Bytes of the buffer
+	void *slot;			// Address of the pointer to set to the buffer
+};
+
+/*
+ * Arena - memory of a worker thread, carved at init into the per-thread buffers of the enabled tests
+ *
+ * The buffers are only sized at init: the arena is mapped once they are all known, and is
+ * followed by a scratch area that is handed out again for each iteration.
+ */
+struct arena {
+	BYTE *base;			// First byte of the arena, or NULL if not mapped
+	size_t mapped;			// Bytes mapped at base
+	size_t used;			// Bytes of the buffers carved for the whole run
+	size_t size;			// Bytes of the buffers and of the scratch area, once sealed
+	BYTE *scratch;			// Scratch area, once sealed
+	size_t scratchUsed;		// Bytes of the scratch area handed out for the current iteration
+	struct arena_carve *carves;	// Buffers carved out of the arena, until it is sealed
+	long int carveCount;		// Number of buffers in carves
+	void **blocks;			// Buffers allocated one by one, when the arena could not be mapped
+	long int blockCount;		// Number of buffers in blocks
+};
+
+/*
+ * Buffer of the arena of each thread, as reported in the memory budget
+ */
+struct arena_budget {
+	int test_num;			// Test that uses the buffer, or 0 for the driver
+	const char *what;		// Name of the buffer
+	size_t bytes;			// Bytes of the buffer in the arena of each thread
+	bool scratch;			// true ==> buffer is in the scratch area, reset for each iteration
+	bool shared;			// true ==> table allocated once and shared by all threads, not in the arenas
+};
+
 /*
  * state - execution state, initialized and set up by the command line, augmented by test results
  */
@@ -427,12 +747,13 @@ struct state {
 	char *datatxt_fmt[NUMOFTESTS + 1];	// Format of data*.txt filenames or NULL
 
 	struct dyn_array *stats[NUMOFTESTS + 1];// Per test dynamic array of per iteration data (for stats.txt if -s)
-	struct dyn_array *p_val[NUMOFTESTS + 1];// Per test dynamic array of p_values (nonover_stats for the nonOverlapping test)
+	struct dyn_array *p_val[NUMOFTESTS + 1];// Per test dynamic array of p_values
 
 	bool is_excursion[NUMOFTESTS + 1];	// true --> test is a form of random excursion
 
 	BitSequence **epsilon;			// Bit stream
 	BitSequence *tmpepsilon;		// Buffer to write to file in dataFormat
+	BitSequence **batch;			// Input data of the iterations claimed at once by each thread
 
 	long int count[NUMOFTESTS + 1];		// Count of completed iterations, including tests skipped due to conditions
 	long int valid[NUMOFTESTS + 1];		// Count of completed testable iterations, ignores tests skipped due to conditions
@@ -449,19 +770,21 @@ struct state {
 
 	struct dyn_array *nonovTemplates;	// Array of non-overlapping template words for TEST_NON_OVERLAPPING
 
-	double **fft_m;				// test m array for TEST_DFT
-	double **fft_X;				// test X array for TEST_DFT
+	double **fft_X;				// test X array for TEST_DFT, the in-place fftw output, unused by fft_plan
+	struct rfftf_plan *fftf_plan;		// Single precision real FFT of TEST_DFT, if -D float
+	float **fftf_work;			// test work array of 2n floats for the FFT in TEST_DFT, if -D float
 # if defined(LEGACY_FFT)
-	double **fft_wsave;			// test wsave array for legacy dfft library in TEST_DFT
+	double **fft_wsave;			// test work array of n (2n with fft_plan) doubles for the FFT in TEST_DFT
+	double *fft_wa;				// Twiddle factors of legacy dfft library, shared read-only by threads
+	long int *fft_ifac;			// Factors of n for legacy dfft library, shared read-only by threads
+	struct rfft_plan *fft_plan;		// In-tree real FFT when n is a power of 2, else NULL for legacy dfft
 #else /* LEGACY_FFT */
-	fftw_plan *fftw_p;			// Plan containing information about the fastest way to compute the transform
-	fftw_complex **fftw_out;		// Output array for fftw library output in TEST_DFT
+	fftw_plan fftw_p;			// Plan of the transform, executed by every thread on its own fft_X
 #endif /* LEGACY_FFT */
 
 	BitSequence ***rank_matrix;		// Rank test 32 by 32 matrix for TEST_RANK
 
 	long int *rnd_excursion_var_stateX;	// Pointer to NUMBER_OF_STATES_RND_EXCURSION_VAR states for TEST_RND_EXCURSION_VAR
-	long int **ex_var_partial_sums;		// Array of n partial sums for TEST_RND_EXCURSION_VAR
 
 	BitSequence **linear_b;			// LFSR array b for TEST_LINEARCOMPLEXITY
 	BitSequence **linear_c;			// LFSR array c for TEST_LINEARCOMPLEXITY
@@ -473,17 +796,56 @@ struct state {
 	long int **serial_v;			// Frequency count for TEST_SERIAL
 	long int serial_v_len;			// Number of long ints in serial_v for TEST_SERIAL
 
-	BitSequence **nonper_seq;		// Special BitSequence for TEST_NON_OVERLAPPING
+	long int *nonovTemplateIndex;		// Index of the template of each m-bit word, or -1, for TEST_NON_OVERLAPPING
 
 	long int universal_L;			// Length of each block for TEST_UNIVERSAL
-	long int **universal_T;			// Working Universal template
+	uint32_t **universal_T;			// Working Universal template
+	double *universal_log2;			// log2 of the distances below universal_log2_len for TEST_UNIVERSAL
+	long int universal_log2_len;		// Number of distances in universal_log2
 
-	long int **rnd_excursion_S;		// Sum of -1/+1 states for TEST_RND_EXCURSION
-	struct dyn_array **rnd_excursion_cycle;	// Contains the index of the ending position of each cycle for TEST_RND_EXCURSION
 	long int *rnd_excursion_stateX;		// Pointer to NUMBER_OF_STATES_RND_EXCURSION states for TEST_RND_EXCURSION_VAR
 	double **rnd_excursion_pi_terms;	// Theoretical probabilities for states of TEST_RND_EXCURSION_VAR
 
 	bool legacy_output;			// true ==> try to mimic output format of legacy code
+
+	bool placementFlag;			// true if -N placement was given
+	enum placement placement;		// -N placement: how worker threads are pinned to CPUs
+	struct topology *topology;		// CPU and NUMA node layout, or NULL if not yet discovered
+
+	struct arena *arena;			// Arena of each thread holding its buffers, or NULL if not yet created
+	struct arena_budget *arenaBudget;	// Buffers of the arena of each thread, for the memory budget
+	long int arenaBudgetCount;		// Number of buffers in arenaBudget
+	size_t arenaScratch;			// Bytes of the scratch area of each arena
+	bool arenaSealed;			// true ==> the arenas are mapped, no more buffers may be carved
+	long int memLimit;			// -M memlimit: MiB that the threads and kept results may use, 0 ==> no limit
+
+	bool timingFlag;			// true if -R timing was given
+	enum timing_format timingFormat;	// -R timing: how to report time spent in each test and phase
+	struct timing *timing;			// Time accounted to each test, phase and thread, or NULL if not timing
+
+	bool p_valTally;			// true ==> tally p_values as iterations complete instead of keeping them
+	struct p_val_tally *tally[NUMOFTESTS + 1];	// Per test p_value tally, or NULL until tallied
+
+	bool writerFlag;			// -W: true -> write stats.txt, results.txt and data*.txt while iterating
+	struct writer *writer;			// Background writer if -W, or NULL
+	long int printedIterations;		// Iterations already printed by earlier -W chunks, print() appends if > 0
+
+	bool sketchFlag;			// -K: true -> with -m i, save the p_value tallies in a .sketch file
+
+	long int checkpointCycle;		// -C checkpointCycle: write a checkpoint every checkpointCycle iterations
+					//			(def: 0: do not checkpoint)
+	bool resumeFlag;			// -r: true -> resume from the checkpoint in workDir
+	struct checkpoint *checkpoint;		// Completed iterations if -C or -r, or NULL
+
+	long int workerCount;			// -J workers: number of worker processes doing the jobs of randdata
+					//		(def: 0: iterate in this process)
+	bool allIterations;			// -i all: test every whole bitstream of randdata
+	long int planShards;			// -L shards: print a plan of the jobs of randdata for shards hosts and exit
+					//		(def: 0: do not plan)
+	bool dftFloat;				// -D float: Discrete Fourier Transform test in single precision
+	long int streamChunk;			// -X chunk: read and test each bitstream in chunks of chunk bits
+					//		(def: 0: test whole bitstreams)
+	void *streamCarry[NUMOFTESTS + 1];	// Per test array of the per thread partial results kept between chunks
 };
 
 struct thread_state {
@@ -500,7 +862,9 @@ struct thread_state {
  */
 extern void init(struct state *state);
 extern void iterate(struct thread_state *thread_state);
+extern void iterateChunk(struct thread_state *thread_state, long int first, long int count);
 extern void print(struct state *state);
+extern void printTest(struct state *state, int test);
 extern void metrics(struct state *state);
 extern void destroy(struct state *state);
 
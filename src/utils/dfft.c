@@ -18,6 +18,13 @@
  *
  * __ogg_fdrffti == initialization __ogg_fdrfftf == forward transform __ogg_fdrfftb == backward transform
  *
+ * void __ogg_fdrffti_shared(int n, double *wa, long int *ifac)
+ * void __ogg_fdrfftf_shared(int n, double *r, double *ch, double *wa, long int *ifac)
+ *
+ * Same as __ogg_fdrffti and __ogg_fdrfftf, but with the twiddle factors wa (of length n) apart from the work array
+ * ch (of length n): wa and ifac are initialized once, and only read by the forward transforms, so that they may be
+ * shared by threads that each have their own ch.
+ *
  * Parameters are n == length of sequence r == sequence to be transformed (input) == transformed sequence (output) wsave == work
  * array of length 2n (allocated by caller) ifac == work array of length 15 (WORK_ARRAY_LEN) (allocated by caller)
  *
@@ -166,6 +173,15 @@ __ogg_fdrffti(long int n, double *wsave, long int *ifac)
 	drfti1(n, wsave + n, ifac);
 }
 
+void
+__ogg_fdrffti_shared(long int n, double *wa, long int *ifac)
+{
+	if (n == 1) {
+		return;
+	}
+	drfti1(n, wa, ifac);
+}
+
 #ifdef LBBBBBBBBBBBBB
 
 void
@@ -828,6 +844,15 @@ __ogg_fdrfftf(long int n, double *r, double *wsave, long int *ifac)
 	drftf1(n, r, wsave, wsave + n, ifac);
 }
 
+void
+__ogg_fdrfftf_shared(long int n, double *r, double *ch, double *wa, long int *ifac)
+{
+	if (n == 1) {
+		return;
+	}
+	drftf1(n, r, ch, wa, ifac);
+}
+
 #ifdef LBBBBBBBBBBBBBBBB
 
 STIN void
@@ -33,6 +33,8 @@
 
 extern void __ogg_fdrffti(long int n, double *wsave, long int *ifac);
 extern void __ogg_fdrfftf(long int n, double *X, double *wsave, long int *ifac);
+extern void __ogg_fdrffti_shared(long int n, double *wa, long int *ifac);
+extern void __ogg_fdrfftf_shared(long int n, double *X, double *ch, double *wa, long int *ifac);
 
 #endif				/* DFFT_H */
 #endif /* LEGACY_FFT */
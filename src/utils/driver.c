@@ -46,6 +46,10 @@
 #include "utilities.h"
 #include "debug.h"
 #include "stat_fncs.h"
+#include "placement.h"
+#include "arena.h"
+#include "timing.h"
+#include "writer.h"
 
 extern long int debuglevel;	// -v lvl: defines the level of verbosity for debugging
 
@@ -55,6 +59,7 @@ extern long int debuglevel;	// -v lvl: defines the level of verbosity for debugg
 struct driver {
 	void (*init) (struct state *state);			// Initialize the test and check input size recommendations
 	void (*iterate) (struct thread_state * thread_state);	// Perform a single iteration test on the bitstream
+	void (*stream) (struct thread_state * thread_state, long int first, long int count);	// Same on a chunk of the bitstream, NULL if it cannot stream
 	void (*print) (struct state *state);			// Log iteration info into stats.txt, data*.txt, results.txt if -s
 	void (*metrics) (struct state *state);			// Uniformity and proportional analysis of a test
 	void (*destroy) (struct state *state);			// Final test cleanup and memory de-allocation
@@ -68,11 +73,13 @@ static const struct driver testDriver[NUMOFTESTS + 1] = {
 	 NULL,
 	 NULL,
 	 NULL,
+	 NULL,
 	 },
 
 	{			// TEST_FREQUENCY = 1, Frequency test (frequency.c)
 	 Frequency_init,
 	 Frequency_iterate,
+	 Frequency_stream,
 	 Frequency_print,
 	 Frequency_metrics,
 	 Frequency_destroy,
@@ -81,6 +88,7 @@ static const struct driver testDriver[NUMOFTESTS + 1] = {
 	{			// TEST_BLOCK_FREQUENCY = 2, Block Frequency test (blockFrequency.c)
 	 BlockFrequency_init,
 	 BlockFrequency_iterate,
+	 BlockFrequency_stream,
 	 BlockFrequency_print,
 	 BlockFrequency_metrics,
 	 BlockFrequency_destroy,
@@ -89,6 +97,7 @@ static const struct driver testDriver[NUMOFTESTS + 1] = {
 	{			// TEST_CUSUM = 3, Cumulative Sums test (cusum.c)
 	 CumulativeSums_init,
 	 CumulativeSums_iterate,
+	 CumulativeSums_stream,
 	 CumulativeSums_print,
 	 CumulativeSums_metrics,
 	 CumulativeSums_destroy,
@@ -97,6 +106,7 @@ static const struct driver testDriver[NUMOFTESTS + 1] = {
 	{			// TEST_RUNS = 4, Runs test (runs.c)
 	 Runs_init,
 	 Runs_iterate,
+	 Runs_stream,
 	 Runs_print,
 	 Runs_metrics,
 	 Runs_destroy,
@@ -105,6 +115,7 @@ static const struct driver testDriver[NUMOFTESTS + 1] = {
 	{			// TEST_LONGEST_RUN = 5, Longest Runs test (longestRunOfOnes.c)
 	 LongestRunOfOnes_init,
 	 LongestRunOfOnes_iterate,
+	 LongestRunOfOnes_stream,
 	 LongestRunOfOnes_print,
 	 LongestRunOfOnes_metrics,
 	 LongestRunOfOnes_destroy,
@@ -113,6 +124,7 @@ static const struct driver testDriver[NUMOFTESTS + 1] = {
 	{			// TEST_RANK = 6, Rank test (rank.c)
 	 Rank_init,
 	 Rank_iterate,
+	 Rank_stream,
 	 Rank_print,
 	 Rank_metrics,
 	 Rank_destroy,
@@ -121,6 +133,7 @@ static const struct driver testDriver[NUMOFTESTS + 1] = {
 	{			// TEST_DFT = 7, Discrete Fourier Transform test (discreteFourierTransform.c)
 	 DiscreteFourierTransform_init,
 	 DiscreteFourierTransform_iterate,
+	 NULL,
 	 DiscreteFourierTransform_print,
 	 DiscreteFourierTransform_metrics,
 	 DiscreteFourierTransform_destroy,
@@ -129,6 +142,7 @@ static const struct driver testDriver[NUMOFTESTS + 1] = {
 	{			// TEST_NON_OVERLAPPING = 8, Non-overlapping Template test (nonOverlappingTemplateMatchings.c)
 	 NonOverlappingTemplateMatchings_init,
 	 NonOverlappingTemplateMatchings_iterate,
+	 NonOverlappingTemplateMatchings_stream,
 	 NonOverlappingTemplateMatchings_print,
 	 NonOverlappingTemplateMatchings_metrics,
 	 NonOverlappingTemplateMatchings_destroy,
@@ -137,6 +151,7 @@ static const struct driver testDriver[NUMOFTESTS + 1] = {
 	{			// TEST_OVERLAPPING = 9, Overlapping Template test (overlappingTemplateMatchings.c)
 	 OverlappingTemplateMatchings_init,
 	 OverlappingTemplateMatchings_iterate,
+	 OverlappingTemplateMatchings_stream,
 	 OverlappingTemplateMatchings_print,
 	 OverlappingTemplateMatchings_metrics,
 	 OverlappingTemplateMatchings_destroy,
@@ -145,6 +160,7 @@ static const struct driver testDriver[NUMOFTESTS + 1] = {
 	{			// TEST_UNIVERSAL = 10, Universal test (universal.c)
 	 Universal_init,
 	 Universal_iterate,
+	 Universal_stream,
 	 Universal_print,
 	 Universal_metrics,
 	 Universal_destroy,
@@ -153,6 +169,7 @@ static const struct driver testDriver[NUMOFTESTS + 1] = {
 	{			// TEST_APEN = 11, Approximate Entropy test (approximateEntropy.c)
 	 ApproximateEntropy_init,
 	 ApproximateEntropy_iterate,
+	 ApproximateEntropy_stream,
 	 ApproximateEntropy_print,
 	 ApproximateEntropy_metrics,
 	 ApproximateEntropy_destroy,
@@ -161,6 +178,7 @@ static const struct driver testDriver[NUMOFTESTS + 1] = {
 	{			// TEST_RND_EXCURSION = 12, Random Excursions test (randomExcursions.c)
 	 RandomExcursions_init,
 	 RandomExcursions_iterate,
+	 RandomExcursions_stream,
 	 RandomExcursions_print,
 	 RandomExcursions_metrics,
 	 RandomExcursions_destroy,
@@ -169,6 +187,7 @@ static const struct driver testDriver[NUMOFTESTS + 1] = {
 	{			// TEST_RND_EXCURSION_VAR = 13, Random Excursions Variant test (randomExcursionsVariant.c)
 	 RandomExcursionsVariant_init,
 	 RandomExcursionsVariant_iterate,
+	 RandomExcursionsVariant_stream,
 	 RandomExcursionsVariant_print,
 	 RandomExcursionsVariant_metrics,
 	 RandomExcursionsVariant_destroy,
@@ -177,6 +196,7 @@ static const struct driver testDriver[NUMOFTESTS + 1] = {
 	{			// TEST_SERIAL = 14, Serial test (serial.c)
 	 Serial_init,
 	 Serial_iterate,
+	 Serial_stream,
 	 Serial_print,
 	 Serial_metrics,
 	 Serial_destroy,
@@ -185,6 +205,7 @@ static const struct driver testDriver[NUMOFTESTS + 1] = {
 	{			// TEST_LINEARCOMPLEXITY = 15, Linear Complexity test (linearComplexity.c)
 	 LinearComplexity_init,
 	 LinearComplexity_iterate,
+	 LinearComplexity_stream,
 	 LinearComplexity_print,
 	 LinearComplexity_metrics,
 	 LinearComplexity_destroy,
@@ -194,6 +215,9 @@ static const struct driver testDriver[NUMOFTESTS + 1] = {
 /*
  * Forward static function declarations
  */
+static bool fitMemoryLimit(struct state *state);
+static void reportMemory(struct state *state, long int retained);
+static size_t keptResults(struct state *state, int test, long int retained);
 static void finishMetricTestsSentence(test_metric_result result, struct state *state);
 
 /*
@@ -205,7 +229,9 @@ static void finishMetricTestsSentence(test_metric_result result, struct state *s
 void
 init(struct state *state)
 {
+	struct timestamp start;	// Start of the init of a test, if timing
 	int test_count;		// Number of tests enabled after initialization
+	bool changed;		// true ==> -M memlimit changed how the run is done
 	int i;
 
 	/*
@@ -320,12 +346,48 @@ init(struct state *state)
 	 */
 	state->cSetup = true;
 
+	/*
+	 * Start accounting for time spent, if requested
+	 */
+	initTiming(state);
+
+	/*
+	 * Discover the CPU and NUMA node layout on which worker threads will run
+	 */
+	if (state->runMode != MODE_ASSESS_ONLY) {
+		discoverTopology(state);
+	}
+
+	/*
+	 * When streaming bitstreams in chunks (-X), disable the tests that need a whole bitstream at once
+	 */
+	if (state->streamChunk > 0) {
+		for (i = 1; i <= NUMOFTESTS; i++) {
+			if (state->testVector[i] == true && testDriver[i].stream == NULL) {
+				warn(__func__, "disabling test %s[%d]: it cannot be streamed in chunks of -X %ld bits",
+				     state->testNames[i], i, state->streamChunk);
+				state->testVector[i] = false;
+			}
+		}
+	}
+
+	/*
+	 * Create the empty arena of each thread, out of which the tests carve their per-thread buffers
+	 */
+	createArenas(state);
+
 	/*
 	 * Initialize all active tests
 	 */
 	for (i = 1; i <= NUMOFTESTS; i++) {
 		if (state->testVector[i] == true && testDriver[i].init != NULL) {
-			testDriver[i].init(state);
+			if (state->timing != NULL) {
+				startTimer(&start);
+				testDriver[i].init(state);
+				stopTimer(&start, &state->timing->phase[i][PHASE_INIT], 0);
+			} else {
+				testDriver[i].init(state);
+			}
 		}
 	}
 
@@ -368,15 +430,44 @@ init(struct state *state)
 
 	/*
 	 * Allocate the array for the bit stream copied to memory for each thread
+	 *
+	 * When streaming (-X), only a chunk of the bit stream is in memory at once.
 	 */
 	for (i = 0; i < state->numberOfThreads; i++) {
-		state->epsilon[i] = calloc((size_t) state->tp.n, sizeof(BitSequence));
-		if (state->epsilon == NULL) {
-			errp(50, __func__, "cannot calloc for epsilon[%d]: %ld elements of %lu bytes each", i,
-			     state->tp.n, sizeof(BitSequence));
-		}
+		arenaAlloc(state, i, 0, "epsilon", (size_t) epsilonLength(state) * sizeof(BitSequence), &state->epsilon[i]);
+	}
+
+	/*
+	 * Allocate the array for the input data of the iterations claimed at once by each thread
+	 */
+	state->batch = calloc((size_t) state->numberOfThreads, sizeof(*state->batch));
+	if (state->batch == NULL) {
+		errp(50, __func__, "cannot calloc for batch: %ld elements of %lu bytes each", state->numberOfThreads,
+		     sizeof(*state->batch));
+	}
+	for (i = 0; i < state->numberOfThreads; i++) {
+		arenaAlloc(state, i, 0, "batch", (size_t) (batchIterations(state) * iterationBytes(state)) * sizeof(BitSequence),
+			   &state->batch[i]);
+	}
+
+	/*
+	 * Every per-thread buffer is carved, fit them and the kept results in -M memlimit before the arenas are mapped
+	 */
+	changed = fitMemoryLimit(state);
+
+	/*
+	 * Map the arena of each thread once, and report where the bytes go
+	 */
+	sealArenas(state);
+	if (changed == true || debuglevel >= DBG_LOW) {
+		reportMemory(state, retainedIterations(state));
 	}
 
+	/*
+	 * Start writing stats.txt, results.txt and data*.txt while iterating, if requested
+	 */
+	startWriter(state);
+
 	/*
 	 * Report the end of the init phase
 	 */
@@ -386,6 +477,168 @@ init(struct state *state)
 }
 
 
+/*
+ * fitMemoryLimit - fit the buffers of the threads and the kept results in -M memlimit
+ *
+ * given:
+ *      state           // run state to test under
+ *
+ * The arena of each thread, the tables shared by the threads and the stats and p_val arrays
+ * of each test are sized by init, so the bytes they need are known before any bitstream is
+ * read and before the arenas are mapped.  When they do not fit in -M memlimit, -s is first
+ * switched to -W so that only WRITER_CHUNK iterations of results are kept, then fewer threads
+ * are run.  If a single thread still does not fit, the run is refused.
+ *
+ * returns:
+ *      true ==> the limit changed how the run is done, false ==> it did not
+ */
+static bool
+fitMemoryLimit(struct state *state)
+{
+	size_t perThread;	// Bytes of the arena of each thread
+	size_t shared;		// Bytes of the tables shared by the threads
+	size_t results;		// Bytes of the results kept by all tests
+	size_t limit;		// -M memlimit in bytes
+	long int retained;	// Iterations the stats and p_val arrays were sized for by init
+	long int threads;	// Number of threads that fit
+	bool changed = false;	// true ==> the limit changed how the run is done
+	int i;
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (state == NULL) {
+		err(50, __func__, "state arg is NULL");
+	}
+
+	/*
+	 * Measure the bytes of each thread and of the kept results
+	 */
+	perThread = arenaFootprint(state);
+	shared = sharedFootprint(state);
+	retained = retainedIterations(state);
+	results = 0;
+	for (i = 1; i <= NUMOFTESTS; i++) {
+		if (state->testVector[i] == true) {
+			results += keptResults(state, i, retained);
+		}
+	}
+
+	if (state->memLimit > 0) {
+		limit = (size_t) state->memLimit * 1048576;
+
+		/*
+		 * Keep only WRITER_CHUNK iterations of results, by writing them while iterating as -W does
+		 */
+		if (perThread * (size_t) state->numberOfThreads + shared + results > limit && state->writerFlag == false &&
+		    state->resultstxtFlag == true && state->runMode == MODE_ITERATE_AND_ASSESS &&
+		    state->checkpointCycle == 0 && state->resumeFlag == false && retained > WRITER_CHUNK) {
+			warn(__func__, "-M memlimit: the results of %ld iterations need %.1f MiB, writing them while "
+			     "iterating, as with -W", retained, (double) results / 1048576.0);
+			state->writerFlag = true;
+			changed = true;
+			results = 0;
+			for (i = 1; i <= NUMOFTESTS; i++) {
+				if (state->testVector[i] == true) {
+					results += keptResults(state, i, retained);
+				}
+			}
+		}
+
+		/*
+		 * Run as many threads as fit, but at least 1
+		 *
+		 * -X chunk only shrinks the buffers of the threads, so it is only suggested when they are what does not fit.
+		 */
+		if (perThread + shared + results > limit) {
+			reportMemory(state, retained);
+			err(50, __func__, "-M memlimit: %ld MiB cannot hold the %.1f MiB of 1 thread, the %.1f MiB of shared "
+			    "tables and the %.1f MiB of kept results%s", state->memLimit, (double) perThread / 1048576.0,
+			    (double) shared / 1048576.0, (double) results / 1048576.0,
+			    (state->streamChunk == 0 && shared + results < limit) ?
+			    ", -X chunk would test the bitstreams in chunks" : "");
+		}
+		threads = (perThread > 0) ? (long int) ((limit - shared - results) / perThread) : state->numberOfThreads;
+		if (threads < state->numberOfThreads) {
+			warn(__func__, "-M memlimit: %ld MiB holds %ld of the %ld threads, running %ld thread%s",
+			     state->memLimit, threads, state->numberOfThreads, threads, (threads == 1) ? "" : "s");
+			trimArenas(state, threads);
+			changed = true;
+		}
+	}
+	return changed;
+}
+
+
+/*
+ * reportMemory - report the buffers of the threads and the results kept by the tests
+ *
+ * given:
+ *      state           // run state to test under
+ *      retained        // iterations the stats and p_val arrays were sized for by init
+ */
+static void
+reportMemory(struct state *state, long int retained)
+{
+	size_t results = 0;	// Bytes of the results kept by all tests
+	size_t bytes;		// Bytes of the results kept by a test
+	int i;
+
+	reportArenas(state);
+	for (i = 1; i <= NUMOFTESTS; i++) {
+		if (state->testVector[i] == true) {
+			results += keptResults(state, i, retained);
+		}
+	}
+	if (results > 0) {
+		msg("Kept results: %.1f MiB for %ld iteration%s at once", (double) results / 1048576.0,
+		    retainedIterations(state), (retainedIterations(state) == 1) ? "" : "s");
+		for (i = 1; i <= NUMOFTESTS; i++) {
+			bytes = (state->testVector[i] == true) ? keptResults(state, i, retained) : 0;
+			if (bytes > 0) {
+				msg("    %-24s %-16s %12.1f KiB", state->testNames[i], "stats and p_val", (double) bytes / 1024.0);
+			}
+		}
+	}
+	if (state->memLimit > 0) {
+		msg("Memory limit: %ld MiB, %.1f MiB are needed by %ld thread%s, the shared tables and the kept results",
+		    state->memLimit, ((double) arenaFootprint(state) * (double) state->numberOfThreads +
+				      (double) sharedFootprint(state) + (double) results) / 1048576.0,
+		    state->numberOfThreads, (state->numberOfThreads == 1) ? "" : "s");
+	}
+	return;
+}
+
+
+/*
+ * keptResults - bytes of the stats and p_val arrays of a test, for the iterations kept at once
+ *
+ * given:
+ *      state           // run state to test under
+ *      test            // test whose arrays to measure
+ *      retained        // iterations the arrays were sized for by init
+ *
+ * returns:
+ *      bytes of the arrays, scaled to retainedIterations() if -M switched to -W since init
+ */
+static size_t
+keptResults(struct state *state, int test, long int retained)
+{
+	size_t bytes = 0;	// Bytes of the arrays, as sized by init
+
+	if (state->stats[test] != NULL) {
+		bytes += (size_t) state->stats[test]->allocated * state->stats[test]->elm_size;
+	}
+	if (state->p_val[test] != NULL) {
+		bytes += (size_t) state->p_val[test]->allocated * state->p_val[test]->elm_size;
+	}
+	if (retained <= 0) {
+		return bytes;
+	}
+	return bytes * (size_t) retainedIterations(state) / (size_t) retained;
+}
+
+
 /*
  * iterate - perform a single run of all the enabled tests on a bitstream
  *
@@ -395,6 +648,7 @@ init(struct state *state)
 void
 iterate(struct thread_state *thread_state)
 {
+	struct timestamp start;	// Start of the iterate of a test, if timing
 	int i;
 
 	/*
@@ -408,6 +662,11 @@ iterate(struct thread_state *thread_state)
 		err(51, __func__, "state is NULL");
 	}
 
+	/*
+	 * Hand out the scratch area of this thread again
+	 */
+	resetScratch(thread_state);
+
 	/*
 	 * Perform an iteration for each test on the current bitstream
 	 */
@@ -417,10 +676,92 @@ iterate(struct thread_state *thread_state)
 		 * Call test iterate function if the test is enabled
 		 */
 		if (state->testVector[i] == true && testDriver[i].iterate != NULL) {
-			testDriver[i].iterate(thread_state);
+			if (state->timing != NULL) {
+				startTimer(&start);
+				testDriver[i].iterate(thread_state);
+				stopTimer(&start, &state->timing->iterate[thread_state->thread_id][i], state->tp.n);
+			} else {
+				testDriver[i].iterate(thread_state);
+			}
+		}
+	}
+
+	/*
+	 * Hand the tests that kept enough iterations to the writer thread, if -W
+	 */
+	if (state->writer != NULL) {
+		queueFullChunks(thread_state);
+	}
+
+	return;
+}
+
+
+/*
+ * iterateChunk - perform part of a single run of all the enabled tests on a chunk of a bitstream
+ *
+ * given:
+ *      thread_state    // current thread state
+ *      first           // index in the bitstream of the first bit of the chunk
+ *      count           // number of bits in the chunk, held by epsilon
+ *
+ * When streaming (-X), each bitstream is read and tested in consecutive chunks, starting with
+ * first == 0.  Each test keeps its partial results between the chunks of a bitstream, and records
+ * the iteration on the chunk that ends the bitstream.
+ */
+void
+iterateChunk(struct thread_state *thread_state, long int first, long int count)
+{
+	struct timestamp start;	// Start of the stream of a test, if timing
+	int i;
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (thread_state == NULL) {
+		err(51, __func__, "thread_state arg is NULL");
+	}
+	struct state *state = thread_state->global_state;
+	if (state == NULL) {
+		err(51, __func__, "state is NULL");
+	}
+	if (first < 0 || count <= 0 || first + count > state->tp.n) {
+		err(51, __func__, "chunk of %ld bits at %ld is not within bitcount(n): %ld", count, first, state->tp.n);
+	}
+
+	/*
+	 * Hand out the scratch area of this thread again, for a new bitstream
+	 */
+	if (first == 0) {
+		resetScratch(thread_state);
+	}
+
+	/*
+	 * Stream the chunk to each test
+	 */
+	for (i = 1; i <= NUMOFTESTS; ++i) {
+
+		/*
+		 * Call test stream function if the test is enabled
+		 */
+		if (state->testVector[i] == true && testDriver[i].stream != NULL) {
+			if (state->timing != NULL) {
+				startTimer(&start);
+				testDriver[i].stream(thread_state, first, count);
+				stopTimer(&start, &state->timing->iterate[thread_state->thread_id][i], count);
+			} else {
+				testDriver[i].stream(thread_state, first, count);
+			}
 		}
 	}
 
+	/*
+	 * Hand the tests that kept enough iterations to the writer thread, if -W, once the bitstream is done
+	 */
+	if (state->writer != NULL && first + count == state->tp.n) {
+		queueFullChunks(thread_state);
+	}
+
 	return;
 }
 
@@ -442,18 +783,23 @@ print(struct state *state)
 	if (state == NULL) {
 		err(52, __func__, "state arg is NULL");
 	}
+	dbg(DBG_LOW, "Start of print phase");
+
+	/*
+	 * With -W, the writer thread already printed most iterations: have it print the rest
+	 */
+	if (state->writer != NULL) {
+		stopWriter(state);
+	}
 
 	/*
 	 * Print results from each test
 	 *
 	 * or old code: partition results
 	 */
-	dbg(DBG_LOW, "Start of print phase");
-	for (i = 1; i <= NUMOFTESTS; i++) {
-		if (state->testVector[i] == true) {
-			if (testDriver[i].print != NULL) {
-				testDriver[i].print(state);	// print results of a test
-			}
+	else {
+		for (i = 1; i <= NUMOFTESTS; i++) {
+			printTest(state, i);
 		}
 	}
 
@@ -466,6 +812,47 @@ print(struct state *state)
 }
 
 
+/*
+ * printTest - print to results.txt, data*.txt, stats.txt for the iterations kept by a test
+ *
+ * given:
+ *      state           // current processing state
+ *      test            // test to print
+ *
+ * This function is called by print(), or by the writer thread for each chunk of iterations if -W.
+ */
+void
+printTest(struct state *state, int test)
+{
+	struct timestamp start;	// Start of the print of a test, if timing
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (state == NULL) {
+		err(52, __func__, "state arg is NULL");
+	}
+	if (test <= 0 || test > NUMOFTESTS) {
+		err(52, __func__, "test: %d must be in [1, %d]", test, NUMOFTESTS);
+	}
+
+	/*
+	 * Print results of the test
+	 */
+	if (state->testVector[test] == true && testDriver[test].print != NULL) {
+		if (state->timing != NULL) {
+			startTimer(&start);
+			testDriver[test].print(state);
+			stopTimer(&start, &state->timing->phase[test][PHASE_PRINT], 0);
+		} else {
+			testDriver[test].print(state);
+		}
+	}
+
+	return;
+}
+
+
 /*
  * metrics - uniformity and proportional analysis
  *
@@ -475,6 +862,7 @@ print(struct state *state)
 void
 metrics(struct state *state)
 {
+	struct timestamp start;	// Start of the metrics of a test, if timing
 	long int passRate;
 	bool case1;
 	bool case2;
@@ -536,9 +924,14 @@ metrics(struct state *state)
 	}
 
 	/*
-	 * Perform metrics processing for each test and print each result to the output files
+	 * Tally the kept p_values of all tests in parallel, so that the metrics of each test only assess its tally
 	 */
 	dbg(DBG_LOW, "Start of assess phase");
+	tally_kept_p_values(state);
+
+	/*
+	 * Perform metrics processing for each test and print each result to the output files
+	 */
 	for (i = 1; i <= NUMOFTESTS; i++) {	// FOR EACH TEST
 
 		// Check if the test is enabled
@@ -548,7 +941,13 @@ metrics(struct state *state)
 			if (testDriver[i].metrics != NULL) {
 				dbg(DBG_MED, "Start of assess metrics phase for test[%d]: %s", i,
 				    ((state->testNames[i] == NULL) ? "((NULL test name))" : state->testNames[i]));
-				testDriver[i].metrics(state);
+				if (state->timing != NULL) {
+					startTimer(&start);
+					testDriver[i].metrics(state);
+					stopTimer(&start, &state->timing->phase[i][PHASE_METRICS], 0);
+				} else {
+					testDriver[i].metrics(state);
+				}
 				dbg(DBG_MED, "End of assess metrics phase for test[%d]: %s", i,
 				    ((state->testNames[i] == NULL) ? "((NULL test name))" : state->testNames[i]));
 			}
@@ -706,8 +1105,31 @@ metrics(struct state *state)
 		 * If in distributed mode, specify from which files the p-values were taken
 		 */
 		if (state->runMode == MODE_ASSESS_ONLY) {
-			io_ret = fprintf(state->finalRept, "using the p-values from the following files:\n\n\t%s/"
-					"sts.*.*.%ld.pvalues\n\n", state->pvalues_dir, state->tp.n);
+			io_ret = fprintf(state->finalRept, "using the p-values from the following files:\n\n");
+			if (io_ret <= 0) {
+				errp(5, __func__, "error in writing to finalRept");
+			}
+			for (i = 0; i < 2; ++i) {
+				const char *extension = (i == 0) ? ".pvalues" : ".sketch";
+				struct Node *current;
+
+				for (current = state->filenames; current != NULL; current = current->next) {
+					size_t length = strlen(current->filename);
+
+					if (length > strlen(extension) &&
+					    strcmp(current->filename + length - strlen(extension), extension) == 0) {
+						break;
+					}
+				}
+				if (current != NULL) {
+					io_ret = fprintf(state->finalRept, "\t%s/sts.*.*.%ld%s\n", state->pvalues_dir,
+							 state->tp.n, extension);
+					if (io_ret <= 0) {
+						errp(5, __func__, "error in writing to finalRept");
+					}
+				}
+			}
+			io_ret = fprintf(state->finalRept, "\n");
 			if (io_ret <= 0) {
 				errp(5, __func__, "error in writing to finalRept");
 			}
@@ -1220,16 +1642,15 @@ destroy(struct state *state)
 		free(state->tmpepsilon);
 		state->tmpepsilon = NULL;
 	}
-	for (i = 0; i < state->numberOfThreads; i++) {
-		if (state->epsilon[i] != NULL) {
-			free(state->epsilon[i]);
-			state->epsilon[i] = NULL;
-		}
-	}
 	if (state->epsilon != NULL) {
 		free(state->epsilon);
 		state->epsilon = NULL;
 	}
+	if (state->batch != NULL) {
+		free(state->batch);
+		state->batch = NULL;
+	}
+	destroyArenas(state);
 	if (state->freqFilePath != NULL) {
 		free(state->freqFilePath);
 		state->freqFilePath = NULL;
@@ -1238,6 +1659,8 @@ destroy(struct state *state)
 		free(state->finalReptPath);
 		state->finalReptPath = NULL;
 	}
+	destroyTopology(state);
+	destroyTiming(state);
 
 	/*
 	 * Report the end of the metric phase
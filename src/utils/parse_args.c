@@ -40,6 +40,7 @@
 #include <math.h>
 #include "../utils/externs.h"
 #include "utilities.h"
+#include "coordinator.h"
 #include "debug.h"
 
 /*
@@ -202,7 +203,8 @@ static struct state const defaultstate = {
 	 false, false, false, false, true, true, false, false,
 	},
 
-	// epsilon, tmpepsilon
+	// epsilon, tmpepsilon, batch
+	NULL,
 	NULL,
 	NULL,
 
@@ -238,24 +240,26 @@ static struct state const defaultstate = {
 	// nonovTemplates
 	NULL,
 
-	// fft_m, fft_X
+	// fft_X, fftf_plan, fftf_work
+	NULL,
 	NULL,
 	NULL,
 
 # if defined(LEGACY_FFT)
-	// fft_wsave
+	// fft_wsave, fft_wa, fft_ifac, fft_plan
 	NULL,
-#else /* LEGACY_FFT */
-	// fftw_p and fftw_out
 	NULL,
 	NULL,
+	NULL,
+#else /* LEGACY_FFT */
+	// fftw_p
+	NULL,
 #endif /* LEGACY_FFT */
 
 	// rank_matrix
 	NULL,
 
-	// rnd_excursion_var_stateX, ex_var_partial_sums
-	NULL,
+	// rnd_excursion_var_stateX
 	NULL,
 
 	// linear_b, linear_c, linear_t
@@ -271,21 +275,74 @@ static struct state const defaultstate = {
 	NULL,
 	0,
 
-	// nonper_seq
+	// nonovTemplateIndex
 	NULL,
 
-	// universal_L, universal_T
+	// universal_L, universal_T, universal_log2, universal_log2_len
 	0,
+	NULL,
+	NULL,
 	0,
 
-	// rnd_excursion_S, rnd_excursion_cycle, rnd_excursion_stateX, rnd_excursion_pi_terms
+	// rnd_excursion_stateX, rnd_excursion_pi_terms
+	NULL,
+	NULL,
+
+	// legacy_output
+	false,
+
+	// placementFlag, placement, topology
+	false,
+	PLACEMENT_NONE,
 	NULL,
+
+	// arena, arenaBudget, arenaBudgetCount, arenaScratch, arenaSealed, memLimit
 	NULL,
 	NULL,
+	0,
+	0,
+	false,
+	0,
+
+	// timingFlag, timingFormat, timing
+	false,
+	TIMING_NONE,
 	NULL,
 
-	// legacy_output
+	// p_valTally, tally
 	false,
+	{NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+	 NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+	},
+
+	// writerFlag, writer, printedIterations
+	false,
+	NULL,
+	0,
+
+	// sketchFlag
+	false,
+
+	// checkpointCycle, resumeFlag, checkpoint
+	0,
+	false,
+	NULL,
+
+	// workerCount
+	0,
+
+	// allIterations, planShards
+	false,
+	0,
+
+	// dftFloat
+	false,
+
+	// streamChunk, streamCarry
+	0,
+	{NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+	 NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+	},
 /* *INDENT-ON* */
 };
 
@@ -297,8 +354,8 @@ static struct state const defaultstate = {
 static const char * const usage =
 "[-v level] [-A] [-t test1[,test2]..]\n"
 "             [-P num=value[,num=value]..] [-i iterations] [-I reportCycle] [-O]\n"
-"             [-w workDir] [-c] [-s] [-F format] [-j jobnum] [-S bitcount]\n"
-"             [-m mode] [-T numOfThreads] [-d pvaluesdir] [-h] [randdata]\n"
+"             [-w workDir] [-c] [-s] [-W] [-F format] [-j jobnum] [-S bitcount]\n"
+"             [-m mode] [-K] [-C checkpointCycle] [-r] [-L shards] [-J workers] [-T numOfThreads] [-N placement] [-M memlimit] [-R timing] [-D precision] [-X chunk] [-d pvaluesdir] [-h] [randdata]\n"
 "\n"
 "    -v  debuglevel     debug level (def: 0 -> no debug messages)\n"
 "    -A                 ask a human what to do, use obsolete interactive mode (def: batch mode)\n"
@@ -332,6 +389,7 @@ static const char * const usage =
 static const char * const usage2 =
 "\n"
 "    -i iterations      number of iterations (number of bitstreams) to test (if no -A, def: 1) (same as -P 7=iterations)\n"
+"                       all --> test every whole bitstream of randdata\n"
 "\n"
 "    -I reportCycle     report after completion of reportCycle iterations (def: 0: do not report)\n"
 "    -O                 try to mimic output format of legacy code (def: don't be output compatible)\n"
@@ -339,6 +397,10 @@ static const char * const usage2 =
 "    -w workDir         write experiment results under workDir (def: .)\n"
 "    -c                 don't create any directories needed for creating files (def: do create)\n"
 "    -s                 create result.txt, data*.txt, and stats.txt (def: don't create)\n"
+"                       Without -s (and in -m b mode), p-values are not kept: only the uniformity bin counts\n"
+"                       and proportions needed by the final assessment are kept, so memory does not grow with -i.\n"
+"    -W                 write stats.txt, results.txt and data*.txt from a background thread while iterating (implies -s)\n"
+"                       Iterations are handed to the writer in chunks and then freed, so memory does not grow with -i.\n"
 "    -F format          randdata format: 'r': raw binary, 'a': ASCII '0'/'1' chars (def: 'r')\n"
 "    -S bitcount        Number of bits to process in a single iteration (def: 1048576 == 1024*1024) (same as -P 9=bitcount)\n"
 "    -j jobnum          seek into randdata, jobnum * bitcount * iterations bits (def: 0)\n"
@@ -348,13 +410,48 @@ static const char * const usage2 =
 "                       i --> test the given data, but not assess it, and instead save the p-values in a binary filename\n"
 "                             of the form: workDir/sts.__jobnum__.__iterations__.__bitcount__.pvalue\n"
 "                       a --> collect the p-values from the binary files specified from '-d pvaluesdir' and assess them\n"
-"\n"
+"    -K                 with -m i, save only the mergeable tallies of the p-values of each test, in a binary filename\n"
+"                           of the form: workDir/sts.__jobnum__.__iterations__.__bitcount__.sketch\n"
+"                       The size of a .sketch file does not depend on the number of iterations. It is tallied in the\n"
+"                           -P 8=bins of the run, give every job the -P 8=bins of all the jobs (see -L).\n"
+"    -C checkpointCycle write a checkpoint every checkpointCycle iterations (def: 0: do not checkpoint), in a file\n"
+"                           of the form: workDir/sts.__jobnum__.__iterations__.__bitcount__.checkpoint\n"
+"    -r                 resume from the checkpoint in workDir: skip its completed iterations and seek past them in randdata\n"
+"                       The checkpoint is removed once the run completes.\n"
+"    -L shards          print a plan of the jobs of randdata for shards hosts (or -J workers), and exit\n"
+"                           With -i iterations, each job has that many iterations. Without, each shard has one job\n"
+"                           and all the whole bitstreams of randdata are split evenly across shards.\n"
+"    -J workers         fork workers processes that each take the next job of randdata, from job -j jobnum thru the\n"
+"                           last whole job of iterations in randdata, and assess the tallies of all jobs at once\n"
+"                       Each worker process runs a single thread unless -T numOfThreads is given. Implies no -s.\n"
+"\n";
+static const char * const usage3 =
 "    -T numOfThreads    custom number of threads for this run (default: takes the number of cores of the CPU)\n"
+"                           With -m a, the .pvalues files are read by up to this many threads\n"
+"    -N placement       none --> let the operating system place worker threads (default)\n"
+"                       core --> pin each worker thread to one CPU, spreading workers across NUMA nodes\n"
+"                       node --> pin each worker thread to the CPUs of one NUMA node, round robin across nodes\n"
+"                       When pinned, each worker first-touches its own buffers so they are allocated node-local.\n"
+"    -M memlimit        MiB that the buffers and tables of the threads and the kept results may use (def: 0: no limit)\n"
+"                           Beyond it, -s switches to -W and fewer threads are used. Refuses to start if 1 thread\n"
+"                           does not fit, printing where the bytes go.\n"
+"\n"
+"    -R timing          text --> at the end of the run, report wall time, CPU time and bits/second spent by each test\n"
+"                                in its init, iterate, print and metrics phases, and by each thread parsing input\n"
+"                       json --> same as text, and also write the report to workDir/timing.json\n"
+"\n"
+"    -D precision       double --> Discrete Fourier Transform test in double precision (default)\n"
+"                       float  --> in single precision, faster, with the moduli close to the threshold counted\n"
+"                                  again in double precision (bitcount must be a power of 2, see README.md)\n"
+"    -X chunk           read and test each bitstream in chunks of chunk bits, a multiple of 8 (def: 0: whole bitstreams)\n"
+"                           Only chunk bits per thread are in memory, so bitcount may exceed the RAM. The Discrete\n"
+"                           Fourier Transform test needs whole bitstreams, it is disabled.\n"
 "\n"
 "    -d pvaluesdir      path to the folder with the binary files with previously computed p-values (requires mode -m a)\n"
 "                       This will assess p-values found files of the form:\n"
 "\n"
 "                           pvaluesdir/sts.__jobnum__.__iterations__.__bitcount__.pvalues\n"
+"                           pvaluesdir/sts.__jobnum__.__iterations__.__bitcount__.sketch\n"
 "\n"
 "                       where __bitcount__ is a specified bitcount value.  The __iterations__ field is the number of\n"
 "                       iterations that the given file holds.  The __jobnum__ field is the job number and is ignored.\n"
@@ -459,7 +556,7 @@ parse_args(struct state *state, int argc, char **argv)
 	 */
 	opterr = 0;
 	brkt = NULL;
-	while ((option = getopt(argc, argv, "v:Abt:g:pP:S:i:I:Ow:csf:F:j:m:T:d:h")) != -1) {
+	while ((option = getopt(argc, argv, "v:Abt:g:pP:S:i:I:Ow:csWf:F:j:m:KC:rJ:L:T:N:M:R:D:X:d:h")) != -1) {
 		switch (option) {
 
 		case 'v':	// -v debuglevel
@@ -596,6 +693,11 @@ parse_args(struct state *state, int argc, char **argv)
 
 		case 'i':	// -i iterations
 			state->iterationFlag = true;
+			if (strcmp(optarg, "all") == 0) {
+				state->allIterations = true;	// counted once randdata is known
+				break;
+			}
+			state->allIterations = false;
 			state->tp.numOfBitStreams = str2longint(&success, optarg);
 			if (success == false) {
 				usage_errp(1, __func__, "error in parsing -i iterations: %s", optarg);
@@ -643,6 +745,11 @@ parse_args(struct state *state, int argc, char **argv)
 			state->resultstxtFlag = true;
 			break;
 
+		case 'W':	// -W (write result.txt and stats.txt while iterating)
+			state->resultstxtFlag = true;
+			state->writerFlag = true;
+			break;
+
 		case 'F':	// -F format: 'r' or '1': raw binary, 'a' or '0': ASCII '0'/'1' chars
 			state->dataFormatFlag = true;
 			state->dataFormat = (enum format) (optarg[0]);
@@ -700,6 +807,44 @@ parse_args(struct state *state, int argc, char **argv)
 			}
 			break;
 
+		case 'K':	// -K (with -m i, save a .sketch instead of a .pvalues file)
+			state->sketchFlag = true;
+			break;
+
+		case 'C':	// -C checkpointCycle
+			state->checkpointCycle = str2longint(&success, optarg);
+			if (success == false) {
+				usage_errp(1, __func__, "error in parsing -C checkpointCycle: %s", optarg);
+			}
+			if (state->checkpointCycle < 0) {
+				usage_err(1, __func__, "-C checkpointCycle: %ld must be >= 0", state->checkpointCycle);
+			}
+			break;
+
+		case 'r':	// -r (resume from the checkpoint in workDir)
+			state->resumeFlag = true;
+			break;
+
+		case 'J':	// -J workers
+			state->workerCount = str2longint(&success, optarg);
+			if (success == false) {
+				usage_errp(1, __func__, "error in parsing -J workers: %s", optarg);
+			}
+			if (state->workerCount < 0) {
+				usage_err(1, __func__, "-J workers: %ld must be >= 0", state->workerCount);
+			}
+			break;
+
+		case 'L':	// -L shards
+			state->planShards = str2longint(&success, optarg);
+			if (success == false) {
+				usage_errp(1, __func__, "error in parsing -L shards: %s", optarg);
+			}
+			if (state->planShards < 1) {
+				usage_err(1, __func__, "-L shards: %ld must be >= 1", state->planShards);
+			}
+			break;
+
 		case 'T':	// -v debuglevel
 			state->numberOfThreadsFlag = true;
 			state->numberOfThreads = str2longint(&success, optarg);
@@ -711,6 +856,61 @@ parse_args(struct state *state, int argc, char **argv)
 			}
 			break;
 
+		case 'N':	// -N placement (none, core or node)
+			state->placementFlag = true;
+			if (strcmp(optarg, "none") == 0) {
+				state->placement = PLACEMENT_NONE;
+			} else if (strcmp(optarg, "core") == 0) {
+				state->placement = PLACEMENT_CORE;
+			} else if (strcmp(optarg, "node") == 0) {
+				state->placement = PLACEMENT_NODE;
+			} else {
+				usage_err(1, __func__, "-N placement must be one of none, core or node: %s", optarg);
+			}
+			break;
+
+		case 'M':	// -M memlimit
+			state->memLimit = str2longint(&success, optarg);
+			if (success == false) {
+				usage_errp(1, __func__, "error in parsing -M memlimit: %s", optarg);
+			}
+			if (state->memLimit < 0) {
+				usage_err(1, __func__, "-M memlimit: %ld must be >= 0", state->memLimit);
+			}
+			break;
+
+		case 'R':	// -R timing (text or json)
+			state->timingFlag = true;
+			if (strcmp(optarg, "text") == 0) {
+				state->timingFormat = TIMING_TEXT;
+			} else if (strcmp(optarg, "json") == 0) {
+				state->timingFormat = TIMING_JSON;
+			} else {
+				usage_err(1, __func__, "-R timing must be one of text or json: %s", optarg);
+			}
+			break;
+
+		case 'D':	// -D precision (double or float) of the Discrete Fourier Transform test
+			if (strcmp(optarg, "double") == 0) {
+				state->dftFloat = false;
+			} else if (strcmp(optarg, "float") == 0) {
+				state->dftFloat = true;
+			} else {
+				usage_err(1, __func__, "-D precision must be one of double or float: %s", optarg);
+			}
+			break;
+
+		case 'X':	// -X chunk
+			state->streamChunk = str2longint(&success, optarg);
+			if (success == false) {
+				usage_errp(1, __func__, "error in parsing -X chunk: %s", optarg);
+			}
+			if (state->streamChunk < 0 || (state->streamChunk % BITS_N_BYTE) != 0) {
+				usage_err(1, __func__, "-X chunk: %ld must be a multiple of %d that is >= 0",
+					  state->streamChunk, BITS_N_BYTE);
+			}
+			break;
+
 		case 'd':	// -d folder with precomputed .pvalues files
 			state->pvalues_dir = strdup(optarg);
 			if (state->pvalues_dir == NULL) {
@@ -720,9 +920,9 @@ parse_args(struct state *state, int argc, char **argv)
 
 		case 'h':	// -h (print out help)
 			if (program == NULL) {
-				fprintf(stderr, "usage: sts %s%s", usage, usage2);
+				fprintf(stderr, "usage: sts %s%s%s", usage, usage2, usage3);
 			} else {
-				fprintf(stderr, "usage: %s %s%s", program, usage, usage2);
+				fprintf(stderr, "usage: %s %s%s%s", program, usage, usage2, usage3);
 			}
 			fprintf(stderr, "\nVersion: %s\n", version);
 			exit(0);
@@ -778,6 +978,29 @@ parse_args(struct state *state, int argc, char **argv)
 		}
 	}
 
+	/*
+	 * Count the whole bitstreams of randdata (if -i all) or plan its jobs (if -L shards)
+	 */
+	if (state->allIterations == true || state->planShards > 0) {
+		if (state->randomDataArg == false || state->stdinData == true) {
+			usage_err(1, __func__, "-i all and -L shards require randdata to be a file, not standard input");
+		}
+		if (state->tp.n < 1) {
+			usage_err(1, __func__, "bitcount(n): %ld must be >= 1", state->tp.n);
+		}
+	}
+	if (state->allIterations == true) {
+		if (state->jobnum != 0 && state->planShards == 0) {
+			usage_err(1, __func__, "-i all cannot be used with -j jobnum: %ld", state->jobnum);
+		}
+		state->tp.numOfBitStreams = count_bitstreams(state);
+		if (state->tp.numOfBitStreams < 1) {
+			usage_err(1, __func__, "-i all: randdata holds no whole bitstream of %ld bits: %s",
+				  state->tp.n, state->randomDataPath);
+		}
+		dbg(DBG_LOW, "-i all: randdata holds %ld whole bitstreams of %ld bits", state->tp.numOfBitStreams, state->tp.n);
+	}
+
 	/*
 	 * Ask how many iterations have to be performed unless batch mode (-b) is enabled or -i bitstreams was not given
 	 */
@@ -864,7 +1087,8 @@ parse_args(struct state *state, int argc, char **argv)
 	 * If a custom number of threads was set and this number is greater than the number of bitstreams
 	 * (aka iterations) set, fire a warning to the user that only $numOfBitstreams threads will be used.
 	 */
-	if (state->numberOfThreadsFlag == true && state->numberOfThreads > state->tp.numOfBitStreams) {
+	if (state->numberOfThreadsFlag == true && state->numberOfThreads > state->tp.numOfBitStreams &&
+	    state->runMode != MODE_ASSESS_ONLY) {
 		warn(__func__, "You chose to use %ld threads. However this number is greater than the number of bitstreams, which"
 				     " you set to %ld. Therefore only %ld threads will be used.", state->numberOfThreads,
 		     state->tp.numOfBitStreams, state->tp.numOfBitStreams);
@@ -920,10 +1144,11 @@ parse_args(struct state *state, int argc, char **argv)
 
 					/*
 					 * If we were able to count 5 tokens and the tokens match the naming pattern
-					 * of the sts p-values files (sts.*.*.$n.pvalues)
+					 * of the sts p-values files (sts.*.*.$n.pvalues) or sketch files (sts.*.*.$n.sketch)
 					 */
 					if (token_number == 5 && strcmp(*parsed_tokens, "sts") == 0 &&
-							strcmp(*(parsed_tokens + token_number - 1), "pvalues") == 0 &&
+							(strcmp(*(parsed_tokens + token_number - 1), "pvalues") == 0 ||
+							 strcmp(*(parsed_tokens + token_number - 1), "sketch") == 0) &&
 							atoi(*(parsed_tokens + token_number - 2)) == state->tp.n) {
 
 						/*
@@ -971,6 +1196,103 @@ parse_args(struct state *state, int argc, char **argv)
 					"not supported. This run won't produce any stats.txt or results.txt file.");
 			state->resultstxtFlag = false;
 		}
+		state->writerFlag = false;
+
+		/*
+		 * The number of iterations is only known now that the files were found
+		 */
+		if (state->uniformityBinsFlag == false && state->legacy_output == false) {
+			state->tp.uniformity_bins = MAX(1, (long int) sqrt(state->tp.numOfBitStreams));
+		}
+
+		/*
+		 * The .pvalues files are read in parallel, by at most one thread per file
+		 */
+		if (state->numberOfThreadsFlag == false) {
+#ifndef _WIN32
+			state->numberOfThreads = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+		}
+	}
+
+	/*
+	 * When running in ITERATE_ONLY MODE, every p_value is kept for the .pvalues file
+	 */
+	if (state->runMode == MODE_ITERATE_ONLY && state->writerFlag == true) {
+		warn(__func__, "You have chosen to use the sts in mode 'i' (iterate only). In this mode the -W flag is "
+				"not supported. stats.txt and results.txt will be written after all iterations, as with -s.");
+		state->writerFlag = false;
+	}
+
+	/*
+	 * A .sketch file is only saved in mode 'i' (iterate only)
+	 */
+	if (state->runMode != MODE_ITERATE_ONLY && state->sketchFlag == true) {
+		warn(__func__, "The -K flag is only supported in mode 'i' (iterate only). It will be ignored.");
+		state->sketchFlag = false;
+	}
+
+	/*
+	 * Worker processes (-J) do whole jobs of a randdata file, and send back the tallies of their p_values
+	 */
+	if (state->workerCount > 0) {
+		if (state->runMode != MODE_ITERATE_AND_ASSESS) {
+			warn(__func__, "The -J flag is only supported in mode 'b' (iterate and assess). It will be ignored.");
+			state->workerCount = 0;
+		} else if (state->stdinData == true || state->randomDataPath == NULL) {
+			usage_err(1, __func__, "-J workers requires randdata to be a file, not standard input");
+		} else if (state->legacy_output == true) {
+			usage_err(1, __func__, "-J workers is not supported with -O");
+		} else {
+			if (state->resultstxtFlag == true) {
+				warn(__func__, "The -s and -W flags are not supported with -J. "
+						"This run won't produce any stats.txt or results.txt file.");
+				state->resultstxtFlag = false;
+				state->writerFlag = false;
+			}
+			if (state->checkpointCycle > 0 || state->resumeFlag == true) {
+				warn(__func__, "The -C and -r flags are not supported with -J. They will be ignored.");
+				state->checkpointCycle = 0;
+				state->resumeFlag = false;
+			}
+
+			/*
+			 * Each worker process runs a single thread, unless -T says otherwise
+			 */
+			if (state->numberOfThreadsFlag == false) {
+				state->numberOfThreads = 1;
+			}
+		}
+	}
+
+	/*
+	 * Checkpoints are only written and resumed while iterating
+	 */
+	if (state->runMode == MODE_ASSESS_ONLY && (state->checkpointCycle > 0 || state->resumeFlag == true)) {
+		warn(__func__, "The -C and -r flags are not supported in mode 'a' (assess only). They will be ignored.");
+		state->checkpointCycle = 0;
+		state->resumeFlag = false;
+	}
+
+	/*
+	 * A checkpoint holds every iteration kept so far, which -W frees once written
+	 */
+	if ((state->checkpointCycle > 0 || state->resumeFlag == true) && state->writerFlag == true) {
+		warn(__func__, "The -W flag is not supported with -C or -r. "
+				"stats.txt and results.txt will be written after all iterations, as with -s.");
+		state->writerFlag = false;
+	}
+
+	/*
+	 * When neither -s nor -m i need each p_value, only the counts needed by the metrics are kept
+	 *
+	 * In -m a mode the p_values are tallied as they are scanned from the .pvalues files.
+	 * With -m i -K, the tallies are what is saved in the .sketch file.
+	 */
+	if ((state->runMode == MODE_ITERATE_AND_ASSESS && state->resultstxtFlag == false) ||
+	    (state->runMode == MODE_ITERATE_ONLY && state->sketchFlag == true && state->resultstxtFlag == false) ||
+	    state->runMode == MODE_ASSESS_ONLY) {
+		state->p_valTally = true;
 	}
 
 	/*
@@ -985,6 +1307,29 @@ parse_args(struct state *state, int argc, char **argv)
 	if (state->tp.n < GLOBAL_MIN_BITCOUNT) {
 		usage_err(1, __func__, "bitcount(n): %ld must >= %d", state->tp.n, GLOBAL_MIN_BITCOUNT);
 	}
+	if (state->dftFloat == true && (state->tp.n & (state->tp.n - 1)) != 0) {
+		usage_err(1, __func__, "-D float requires a bitcount(n) that is a power of 2: %ld", state->tp.n);
+	}
+
+	/*
+	 * Streaming in chunks (-X) is only needed when a chunk is shorter than a bitstream
+	 */
+	if (state->streamChunk >= state->tp.n) {
+		warn(__func__, "-X chunk: %ld is not less than bitcount(n): %ld, whole bitstreams will be tested",
+		     state->streamChunk, state->tp.n);
+		state->streamChunk = 0;
+	}
+
+	/*
+	 * Standard input cannot be seeked: the chunks of the bitstreams must be read in order by a single thread
+	 */
+	if (state->streamChunk > 0 && state->stdinData == true && state->numberOfThreads > 1) {
+		if (state->numberOfThreadsFlag == true) {
+			warn(__func__, "-X chunk reads standard input with a single thread, ignoring -T %ld",
+			     state->numberOfThreads);
+		}
+		state->numberOfThreads = 1;
+	}
 
 	/*
 	 * Report on how we will run, if debugging
@@ -1030,10 +1375,10 @@ change_params(struct state *state, long int parameter, long int value, double d_
 		state->tp.linearComplexitySequenceLength = value;
 		break;
 	case PARAM_numOfBitStreams:
-		state->uniformityBinsFlag = true;
 		state->tp.numOfBitStreams = value;
 		break;
 	case PARAM_uniformity_bins:
+		state->uniformityBinsFlag = true;
 		state->tp.uniformity_bins = value;
 		break;
 	case PARAM_n:
@@ -1201,6 +1546,55 @@ print_option_summary(struct state *state, char *where)
 		dbg(DBG_MED, "\tno -s was given");
 		dbg(DBG_MED, "\t  do not create result.txt, data*.txt and stats.txt");
 	}
+	if (state->p_valTally == true) {
+		dbg(DBG_MED, "\t  tally p_values as iterations complete instead of keeping them");
+	}
+	if (state->writerFlag == true) {
+		dbg(DBG_MED, "\t-W was given");
+		dbg(DBG_MED, "\t  write result.txt, data*.txt and stats.txt from a background thread while iterating");
+	} else {
+		dbg(DBG_MED, "\tno -W was given");
+	}
+	if (state->sketchFlag == true) {
+		dbg(DBG_MED, "\t-K was given");
+		dbg(DBG_MED, "\t  save the tallies of the p_values in a .sketch file");
+	} else {
+		dbg(DBG_MED, "\tno -K was given");
+	}
+	if (state->checkpointCycle > 0) {
+		dbg(DBG_MED, "\t-C checkpointCycle was given");
+		dbg(DBG_MED, "\t  will write a checkpoint every %ld iterations", state->checkpointCycle);
+	} else {
+		dbg(DBG_MED, "\tno -C checkpointCycle was given");
+	}
+	if (state->resumeFlag == true) {
+		dbg(DBG_MED, "\t-r was given");
+		dbg(DBG_MED, "\t  resume from the checkpoint in workDir");
+	} else {
+		dbg(DBG_MED, "\tno -r was given");
+	}
+	if (state->allIterations == true) {
+		dbg(DBG_MED, "\t-i all was given");
+		dbg(DBG_MED, "\t  will test every whole bitstream of randdata");
+	}
+	if (state->planShards > 0) {
+		dbg(DBG_MED, "\t-L shards was given");
+		dbg(DBG_MED, "\t  will print a plan of the jobs of randdata for %ld shards", state->planShards);
+	}
+	if (state->dftFloat == true) {
+		dbg(DBG_MED, "\t-D float was given");
+		dbg(DBG_MED, "\t  the Discrete Fourier Transform test will be done in single precision");
+	}
+	if (state->streamChunk > 0) {
+		dbg(DBG_MED, "\t-X chunk was given");
+		dbg(DBG_MED, "\t  will read and test each bitstream in chunks of %ld bits", state->streamChunk);
+	}
+	if (state->workerCount > 0) {
+		dbg(DBG_MED, "\t-J workers was given");
+		dbg(DBG_MED, "\t  will do the jobs of randdata in %ld worker processes", state->workerCount);
+	} else {
+		dbg(DBG_MED, "\tno -J workers was given");
+	}
 	if (state->dataFormatFlag == true) {
 		dbg(DBG_MED, "\t-F format was given");
 	} else {
@@ -1240,7 +1634,39 @@ print_option_summary(struct state *state, char *where)
 	} else {
 		dbg(DBG_MED, "\tno -T numOfThreads was given");
 	}
-	dbg(DBG_MED, "\t  will use %ld threads\n", state->numberOfThreads);
+	dbg(DBG_MED, "\t  will use %ld threads", state->numberOfThreads);
+	if (state->placementFlag == true) {
+		dbg(DBG_MED, "\t-N placement was given");
+	} else {
+		dbg(DBG_MED, "\tno -N placement was given");
+	}
+	switch (state->placement) {
+	case PLACEMENT_NONE:
+		dbg(DBG_MED, "\t  -N none: let the operating system place worker threads");
+		break;
+	case PLACEMENT_CORE:
+		dbg(DBG_MED, "\t  -N core: pin each worker thread to one CPU");
+		break;
+	case PLACEMENT_NODE:
+		dbg(DBG_MED, "\t  -N node: pin each worker thread to the CPUs of one NUMA node");
+		break;
+	default:
+		dbg(DBG_MED, "\t  -N %d: unknown placement", state->placement);
+		break;
+	}
+	if (state->memLimit > 0) {
+		dbg(DBG_MED, "\t-M memlimit was given");
+		dbg(DBG_MED, "\t  the buffers of the threads and the kept results will fit in %ld MiB", state->memLimit);
+	} else {
+		dbg(DBG_MED, "\tno -M memlimit was given");
+	}
+	if (state->timingFlag == true) {
+		dbg(DBG_MED, "\t-R timing was given");
+		dbg(DBG_MED, "\t  will report time spent by each test, phase and thread%s\n",
+		    (state->timingFormat == TIMING_JSON) ? ", also in timing.json" : "");
+	} else {
+		dbg(DBG_MED, "\tno -R timing was given\n");
+	}
 
 	/*
 	 * Report on test parameters
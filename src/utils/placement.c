@@ -0,0 +1,572 @@
+// placement.c
+// Place worker threads on CPUs and NUMA nodes
+
+/*
+ * This code has been heavily modified by the following people:
+ *
+ *      Landon Curt Noll
+ *      Tom Gilgan
+ *      Riccardo Paccagnella
+ *
+ * See the README.md and the initial comment in sts.c for more information.
+ *
+ * WE (THOSE LISTED ABOVE WHO HEAVILY MODIFIED THIS CODE) DISCLAIM ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL WE (THOSE LISTED ABOVE
+ * WHO HEAVILY MODIFIED THIS CODE) BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF
+ * USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ * chongo (Landon Curt Noll, http://www.isthe.com/chongo/index.html) /\oo/\
+ *
+ * Share and enjoy! :-)
+ */
+
+
+// Exit codes: 80 thru 84
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#if defined(__linux__)
+#include <sched.h>
+#endif /* __linux__ */
+#include "externs.h"
+#include "utilities.h"
+#include "placement.h"
+#include "debug.h"
+
+
+#   define SYSFS_NODE_DIR "/sys/devices/system/node"	// Linux sysfs directory describing NUMA nodes
+#   define MAX_CPU_ID (4096)				// CPU ids must be < MAX_CPU_ID to be considered
+
+
+/*
+ * Forward static function declarations
+ */
+#if defined(__linux__)
+static long int readNodeCPUs(long int node_id, long int *nodeOfCPU, long int node_index);
+#endif /* __linux__ */
+static int compareNodeIds(const void *a, const void *b);
+static void reportTopology(struct state *state);
+static void formatCPUs(char *buf, size_t len, struct topology *topology, long int node_index);
+
+
+/*
+ * discoverTopology - determine which CPUs and NUMA nodes this process may use
+ *
+ * given:
+ *      state           // run state to test under
+ *
+ * Fills in state->topology with the CPUs that this process is allowed to run on,
+ * grouped by the NUMA node that holds them.  The cpu[] array is ordered round robin
+ * across nodes so that consecutive worker threads land on different nodes.
+ *
+ * When NUMA information is not available (non-Linux hosts, or sysfs not mounted)
+ * all CPUs are considered to belong to a single node.
+ *
+ * A topology report is printed when -N placement was given, or when debugging.
+ */
+void
+discoverTopology(struct state *state)
+{
+	struct topology *topology;	// Discovered topology
+	long int *nodeOfCPU;		// For each CPU id, index of its node, or -1 if CPU is not usable
+	long int maxNodes;		// Number of node ids allocated in topology->nodeId
+	long int taken;			// Number of CPUs already placed in the round robin order
+	long int round;			// Round robin pass number
+	long int seen;			// Number of CPUs of the current node seen in the current pass
+	long int cpu;
+	long int i;
+#if defined(__linux__)
+	cpu_set_t allowed;		// CPUs this process is allowed to run on
+	DIR *dir;			// Open SYSFS_NODE_DIR
+	struct dirent *entry;		// Entry in SYSFS_NODE_DIR
+	long int node_id;		// Operating system node id parsed from a SYSFS_NODE_DIR entry
+	char extra;			// Trailing character after a parsed node id
+#endif /* __linux__ */
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (state == NULL) {
+		err(80, __func__, "state arg is NULL");
+	}
+	if (state->topology != NULL) {
+		dbg(DBG_HIGH, "topology already discovered");
+		return;
+	}
+
+	/*
+	 * Allocate topology
+	 */
+	topology = calloc(1, sizeof(*topology));
+	if (topology == NULL) {
+		errp(80, __func__, "cannot calloc topology of %lu bytes", sizeof(*topology));
+	}
+	nodeOfCPU = malloc(MAX_CPU_ID * sizeof(nodeOfCPU[0]));
+	if (nodeOfCPU == NULL) {
+		errp(80, __func__, "cannot malloc of %d elements of %lu bytes each for nodeOfCPU",
+		     MAX_CPU_ID, sizeof(nodeOfCPU[0]));
+	}
+	maxNodes = MAX_CPU_ID;
+	topology->nodeId = malloc(maxNodes * sizeof(topology->nodeId[0]));
+	if (topology->nodeId == NULL) {
+		errp(80, __func__, "cannot malloc of %ld elements of %lu bytes each for nodeId",
+		     maxNodes, sizeof(topology->nodeId[0]));
+	}
+
+	/*
+	 * Determine the CPUs we are allowed to use
+	 *
+	 * A usable CPU that is not (yet) assigned to any node is marked with node index 0.
+	 */
+	for (cpu = 0; cpu < MAX_CPU_ID; ++cpu) {
+		nodeOfCPU[cpu] = -1;
+	}
+#if defined(__linux__)
+	CPU_ZERO(&allowed);
+	errno = 0;		// paranoia
+	if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+		warnp(__func__, "sched_getaffinity failed, assuming all online CPUs are usable");
+		for (cpu = 0; cpu < MIN(sysconf(_SC_NPROCESSORS_ONLN), CPU_SETSIZE); ++cpu) {
+			CPU_SET(cpu, &allowed);
+		}
+	}
+	for (cpu = 0; cpu < MIN(MAX_CPU_ID, CPU_SETSIZE); ++cpu) {
+		if (CPU_ISSET(cpu, &allowed)) {
+			nodeOfCPU[cpu] = 0;
+		}
+	}
+#else /* __linux__ */
+	for (cpu = 0; cpu < MIN(sysconf(_SC_NPROCESSORS_ONLN), MAX_CPU_ID); ++cpu) {
+		nodeOfCPU[cpu] = 0;
+	}
+#endif /* __linux__ */
+
+	/*
+	 * Collect the NUMA node ids, in ascending order
+	 */
+	topology->numberOfNodes = 0;
+#if defined(__linux__)
+	dir = opendir(SYSFS_NODE_DIR);
+	if (dir != NULL) {
+		while ((entry = readdir(dir)) != NULL && topology->numberOfNodes < maxNodes) {
+			if (sscanf(entry->d_name, "node%ld%c", &node_id, &extra) == 1 && node_id >= 0) {
+				topology->nodeId[topology->numberOfNodes++] = node_id;
+			}
+		}
+		closedir(dir);
+	} else {
+		dbg(DBG_MED, "cannot open %s, assuming a single NUMA node", SYSFS_NODE_DIR);
+	}
+	qsort(topology->nodeId, (size_t) topology->numberOfNodes, sizeof(topology->nodeId[0]), compareNodeIds);
+
+	/*
+	 * Assign usable CPUs to nodes, dropping nodes without any usable CPU (such as memory only nodes)
+	 */
+	for (i = 0; i < topology->numberOfNodes; ++i) {
+		if (readNodeCPUs(topology->nodeId[i], nodeOfCPU, i) <= 0) {
+			dbg(DBG_MED, "NUMA node %ld has no usable CPUs, ignoring it", topology->nodeId[i]);
+			memmove(&topology->nodeId[i], &topology->nodeId[i + 1],
+				(topology->numberOfNodes - i - 1) * sizeof(topology->nodeId[0]));
+			--topology->numberOfNodes;
+			--i;
+		}
+	}
+#endif /* __linux__ */
+	if (topology->numberOfNodes <= 0) {
+		topology->numberOfNodes = 1;
+		topology->nodeId[0] = 0;
+	}
+
+	/*
+	 * Count usable CPUs
+	 */
+	topology->numberOfCPUs = 0;
+	for (cpu = 0; cpu < MAX_CPU_ID; ++cpu) {
+		if (nodeOfCPU[cpu] >= 0) {
+			++topology->numberOfCPUs;
+		}
+	}
+	if (topology->numberOfCPUs <= 0) {
+		err(80, __func__, "found no usable CPUs");
+	}
+	topology->cpu = malloc(topology->numberOfCPUs * sizeof(topology->cpu[0]));
+	if (topology->cpu == NULL) {
+		errp(80, __func__, "cannot malloc of %ld elements of %lu bytes each for cpu",
+		     topology->numberOfCPUs, sizeof(topology->cpu[0]));
+	}
+	topology->cpuNode = malloc(topology->numberOfCPUs * sizeof(topology->cpuNode[0]));
+	if (topology->cpuNode == NULL) {
+		errp(80, __func__, "cannot malloc of %ld elements of %lu bytes each for cpuNode",
+		     topology->numberOfCPUs, sizeof(topology->cpuNode[0]));
+	}
+
+	/*
+	 * Order CPUs round robin across nodes: the 1st CPU of each node, then the 2nd CPU of each node, ...
+	 */
+	taken = 0;
+	for (round = 0; taken < topology->numberOfCPUs; ++round) {
+		for (i = 0; i < topology->numberOfNodes; ++i) {
+			seen = 0;
+			for (cpu = 0; cpu < MAX_CPU_ID; ++cpu) {
+				if (nodeOfCPU[cpu] == i) {
+					if (seen == round) {
+						topology->cpu[taken] = cpu;
+						topology->cpuNode[taken] = i;
+						++taken;
+						break;
+					}
+					++seen;
+				}
+			}
+		}
+	}
+	free(nodeOfCPU);
+	state->topology = topology;
+
+	/*
+	 * Pinning is not supported on this host
+	 */
+#if !defined(__linux__)
+	if (state->placement != PLACEMENT_NONE) {
+		warn(__func__, "-N placement is not supported on this platform, worker threads will not be pinned");
+		state->placement = PLACEMENT_NONE;
+	}
+#endif /* __linux__ */
+
+	/*
+	 * Report the topology
+	 */
+	reportTopology(state);
+	return;
+}
+
+
+#if defined(__linux__)
+/*
+ * readNodeCPUs - mark the usable CPUs listed in the cpulist of a NUMA node
+ *
+ * given:
+ *      node_id         // operating system id of the NUMA node
+ *      nodeOfCPU       // for each CPU id, index of its node, or -1 if CPU is not usable
+ *      node_index      // index of the node to store into nodeOfCPU
+ *
+ * returns:
+ *      number of usable CPUs found on this node
+ *
+ * The cpulist file holds comma separated CPU ids and ranges, such as: 0-7,16-23
+ */
+static long int
+readNodeCPUs(long int node_id, long int *nodeOfCPU, long int node_index)
+{
+	char path[BUFSIZ + 1];	// Path of the cpulist file of the node
+	FILE *stream;		// Open cpulist file
+	long int first;		// First CPU id of a range
+	long int last;		// Last CPU id of a range
+	long int found = 0;	// Number of usable CPUs found on this node
+	long int cpu;
+	int c;
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (nodeOfCPU == NULL) {
+		err(81, __func__, "nodeOfCPU arg is NULL");
+	}
+
+	/*
+	 * Open the cpulist of the node
+	 */
+	snprintf(path, BUFSIZ, "%s/node%ld/cpulist", SYSFS_NODE_DIR, node_id);
+	path[BUFSIZ] = '\0';	// paranoia
+	errno = 0;		// paranoia
+	stream = fopen(path, "r");
+	if (stream == NULL) {
+		dbg(DBG_MED, "cannot open %s", path);
+		return 0;
+	}
+
+	/*
+	 * Parse each range
+	 */
+	while (fscanf(stream, "%ld", &first) == 1) {
+		last = first;
+		c = fgetc(stream);
+		if (c == '-') {
+			if (fscanf(stream, "%ld", &last) != 1) {
+				break;
+			}
+			c = fgetc(stream);
+		}
+		for (cpu = MAX(first, 0); cpu <= last && cpu < MAX_CPU_ID; ++cpu) {
+			if (nodeOfCPU[cpu] >= 0) {
+				nodeOfCPU[cpu] = node_index;
+				++found;
+			}
+		}
+		if (c != ',') {
+			break;
+		}
+	}
+	fclose(stream);
+	return found;
+}
+#endif /* __linux__ */
+
+
+/*
+ * compareNodeIds - qsort comparison of two long int node ids
+ */
+static int
+compareNodeIds(const void *a, const void *b)
+{
+	long int x = *(const long int *) a;
+	long int y = *(const long int *) b;
+
+	return (x > y) - (x < y);
+}
+
+
+/*
+ * formatCPUs - format the CPU ids of a node as a compact list of ranges
+ *
+ * given:
+ *      buf             // where to write the list
+ *      len             // size of buf
+ *      topology        // discovered topology
+ *      node_index      // index of the node in topology->nodeId[]
+ */
+static void
+formatCPUs(char *buf, size_t len, struct topology *topology, long int node_index)
+{
+	long int cpus[MAX_CPU_ID];	// Sorted CPU ids of the node
+	long int count = 0;		// Number of CPU ids of the node
+	size_t used = 0;		// Number of chars written into buf
+	long int i;
+	long int j;
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (buf == NULL || topology == NULL || len <= 0) {
+		err(82, __func__, "called with bogus args");
+	}
+
+	/*
+	 * Collect and sort the CPU ids of the node
+	 */
+	for (i = 0; i < topology->numberOfCPUs; ++i) {
+		if (topology->cpuNode[i] == node_index) {
+			cpus[count++] = topology->cpu[i];
+		}
+	}
+	qsort(cpus, (size_t) count, sizeof(cpus[0]), compareNodeIds);
+
+	/*
+	 * Write ranges of consecutive ids
+	 */
+	buf[0] = '\0';
+	for (i = 0; i < count && used < len; i = j + 1) {
+		for (j = i; j + 1 < count && cpus[j + 1] == cpus[j] + 1; ++j) {
+		}
+		if (j > i) {
+			used += snprintf(buf + used, len - used, "%s%ld-%ld", (i > 0) ? "," : "", cpus[i], cpus[j]);
+		} else {
+			used += snprintf(buf + used, len - used, "%s%ld", (i > 0) ? "," : "", cpus[i]);
+		}
+	}
+	return;
+}
+
+
+/*
+ * reportTopology - report the host topology and where each worker thread will run
+ *
+ * given:
+ *      state           // run state to test under
+ */
+static void
+reportTopology(struct state *state)
+{
+	struct topology *topology;	// Discovered topology
+	char buf[BUFSIZ + 1];		// Formatted CPU list
+	long int node_index;		// Index of the node of a thread
+	long int i;
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (state == NULL) {
+		err(83, __func__, "state arg is NULL");
+	}
+	topology = state->topology;
+	if (topology == NULL) {
+		err(83, __func__, "state->topology is NULL");
+	}
+	if (state->placement == PLACEMENT_NONE && debuglevel < DBG_LOW) {
+		return;
+	}
+
+	/*
+	 * Report nodes and their CPUs
+	 */
+	msg("Topology: %ld NUMA node%s, %ld CPU%s usable by this process", topology->numberOfNodes,
+	       (topology->numberOfNodes == 1) ? "" : "s", topology->numberOfCPUs, (topology->numberOfCPUs == 1) ? "" : "s");
+	for (i = 0; i < topology->numberOfNodes; ++i) {
+		formatCPUs(buf, BUFSIZ, topology, i);
+		buf[BUFSIZ] = '\0';	// paranoia
+		msg("    node %ld: CPUs %s", topology->nodeId[i], buf);
+	}
+
+	/*
+	 * Report thread placement
+	 */
+	switch (state->placement) {
+	case PLACEMENT_CORE:
+		msg("Placement: %ld worker thread%s pinned to cores", state->numberOfThreads,
+		       (state->numberOfThreads == 1) ? "" : "s");
+		for (i = 0; i < state->numberOfThreads; ++i) {
+			msg("    thread %ld: CPU %ld on node %ld", i, topology->cpu[i % topology->numberOfCPUs],
+			       topology->nodeId[topology->cpuNode[i % topology->numberOfCPUs]]);
+		}
+		if (state->numberOfThreads > topology->numberOfCPUs) {
+			warn(__func__, "%ld worker threads share %ld CPUs", state->numberOfThreads, topology->numberOfCPUs);
+		}
+		break;
+	case PLACEMENT_NODE:
+		msg("Placement: %ld worker thread%s pinned to NUMA nodes", state->numberOfThreads,
+		       (state->numberOfThreads == 1) ? "" : "s");
+		for (i = 0; i < state->numberOfThreads; ++i) {
+			node_index = i % topology->numberOfNodes;
+			formatCPUs(buf, BUFSIZ, topology, node_index);
+			buf[BUFSIZ] = '\0';	// paranoia
+			msg("    thread %ld: node %ld, CPUs %s", i, topology->nodeId[node_index], buf);
+		}
+		break;
+	default:
+		msg("Placement: %ld worker thread%s placed by the operating system", state->numberOfThreads,
+		       (state->numberOfThreads == 1) ? "" : "s");
+		break;
+	}
+	return;
+}
+
+
+/*
+ * placeThread - pin the calling worker thread according to -N placement
+ *
+ * given:
+ *      thread_state    // state of the calling worker thread
+ *
+ * This function must be called by the worker thread itself.  Failure to pin
+ * is reported as a warning: the run continues with the default placement.
+ */
+void
+placeThread(struct thread_state *thread_state)
+{
+	struct state *state;		// Global run state
+	struct topology *topology;	// Discovered topology
+#if defined(__linux__)
+	cpu_set_t cpuset;		// CPUs this thread will be pinned to
+	long int node_index;		// Index of the node this thread will be pinned to
+	long int i;
+	int ret;
+#endif /* __linux__ */
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (thread_state == NULL) {
+		err(84, __func__, "thread_state arg is NULL");
+	}
+	state = thread_state->global_state;
+	if (state == NULL) {
+		err(84, __func__, "state arg is NULL");
+	}
+	if (state->placement == PLACEMENT_NONE) {
+		return;
+	}
+	topology = state->topology;
+	if (topology == NULL) {
+		err(84, __func__, "state->topology is NULL");
+	}
+
+#if defined(__linux__)
+	/*
+	 * Form the CPU set of this thread
+	 */
+	CPU_ZERO(&cpuset);
+	if (state->placement == PLACEMENT_CORE) {
+		CPU_SET(topology->cpu[thread_state->thread_id % topology->numberOfCPUs], &cpuset);
+	} else {
+		node_index = thread_state->thread_id % topology->numberOfNodes;
+		for (i = 0; i < topology->numberOfCPUs; ++i) {
+			if (topology->cpuNode[i] == node_index) {
+				CPU_SET(topology->cpu[i], &cpuset);
+			}
+		}
+	}
+
+	/*
+	 * Pin this thread
+	 */
+	ret = pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset);
+	if (ret != 0) {
+		errno = ret;
+		warnp(__func__, "cannot pin thread %ld, leaving it unpinned", thread_state->thread_id);
+		return;
+	}
+	dbg(DBG_HIGH, "thread %ld pinned", thread_state->thread_id);
+#endif /* __linux__ */
+
+	return;
+}
+
+
+/*
+ * destroyTopology - free the discovered topology
+ *
+ * given:
+ *      state           // run state to test under
+ */
+void
+destroyTopology(struct state *state)
+{
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (state == NULL) {
+		err(80, __func__, "state arg is NULL");
+	}
+	if (state->topology == NULL) {
+		return;
+	}
+
+	/*
+	 * Free topology storage
+	 */
+	if (state->topology->cpu != NULL) {
+		free(state->topology->cpu);
+		state->topology->cpu = NULL;
+	}
+	if (state->topology->cpuNode != NULL) {
+		free(state->topology->cpuNode);
+		state->topology->cpuNode = NULL;
+	}
+	if (state->topology->nodeId != NULL) {
+		free(state->topology->nodeId);
+		state->topology->nodeId = NULL;
+	}
+	free(state->topology);
+	state->topology = NULL;
+	return;
+}
@@ -0,0 +1,2078 @@
+// pvalues.c
+// Write and read the .pvalues files of the distributed mode of operation (-m i and -m a),
+// and the checkpoints of long runs (-C and -r)
+
+/*
+ * This code has been heavily modified by the following people:
+ *
+ *      Landon Curt Noll
+ *      Tom Gilgan
+ *      Riccardo Paccagnella
+ *
+ * See the README.md and the initial comment in sts.c for more information.
+ *
+ * WE (THOSE LISTED ABOVE WHO HEAVILY MODIFIED THIS CODE) DISCLAIM ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL WE (THOSE LISTED ABOVE
+ * WHO HEAVILY MODIFIED THIS CODE) BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF
+ * USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ * chongo (Landon Curt Noll, http://www.isthe.com/chongo/index.html) /\oo/\
+ *
+ * Share and enjoy! :-)
+ */
+
+
+// Exit codes: 240 thru 247
+
+// global capabilities
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+#include "externs.h"
+#include "utilities.h"
+#include "pvalues.h"
+#include "debug.h"
+
+
+#define FNV_OFFSET_BASIS ((uint64_t) 0xcbf29ce484222325ULL)	// 64-bit FNV-1a initial hash
+#define FNV_PRIME ((uint64_t) 0x100000001b3ULL)		// 64-bit FNV-1a multiplier
+#define PVAL_WRITE_BUFFER (1024)			// Number of values converted at once before being written
+
+
+/*
+ * Forward static function declarations
+ */
+static uint32_t swap32(uint32_t value);
+static uint64_t swap64(uint64_t value);
+static uint64_t hashWords(uint64_t hash, const void *buf, size_t len, bool swap);
+static void writeWords(FILE *p_val_file, uint64_t *hash, const void *buf, size_t len, char *filename);
+static void writeLongs(FILE *p_val_file, uint64_t *hash, const long int *values, long int count, char *filename);
+static void writePadded(FILE *p_val_file, uint64_t *hash, const void *buf, size_t len, char *filename);
+static void initHeader(struct state *state, struct pval_header *header, uint32_t content, int testCount,
+		       uint64_t fileSize);
+static char *workFilePath(struct state *state);
+static void finishWorkFile(struct state *state, FILE *p_val_file, struct pval_header *header, uint64_t hash,
+			   char *work_filepath, char *extension);
+static void *mapFile(char *path, size_t *size);
+static void unmapFile(void *base, size_t size);
+static bool checkHeader(struct state *state, char *filename, const void *base, size_t size,
+			struct pval_header *header, bool *swap);
+static bool checkEntries(struct state *state, char *filename, const void *base, size_t size,
+			 struct pval_header *header, struct pval_entry *entries, bool swap);
+static int64_t getWord(const void *words, uint64_t index, bool swap);
+static bool checkSketch(struct state *state, char *filename, const void *base, size_t size,
+			struct pval_entry *entry, struct pval_sketch *sketch, bool swap);
+static void mergeSketch(struct state *state, const void *base, struct pval_entry *entry,
+			struct pval_sketch *sketch, bool swap);
+static uint64_t writeSketch(struct state *state, FILE *p_val_file, struct pval_header *header, char *filename);
+static bool tallyMappedFile(struct state *state, char *filename, const void *base, size_t size);
+static void tallyLegacyFile(struct state *state, char *filename, char *path);
+static void readFile(struct state *state, char *filename);
+static void *readFiles(void *arg);
+static long int readSketchBins(char *path);
+static long int sketchBins(struct state *state);
+static char *checkpointPath(struct state *state);
+static void restoreTest(struct state *state, char *filename, const void *base, size_t size, struct pval_entry *entry);
+
+
+/*
+ * swap32 - reverse the byte order of a 32-bit word
+ */
+static uint32_t
+swap32(uint32_t value)
+{
+	return ((value & 0x000000ffU) << 24) | ((value & 0x0000ff00U) << 8) |
+	       ((value & 0x00ff0000U) >> 8) | ((value & 0xff000000U) >> 24);
+}
+
+
+/*
+ * swap64 - reverse the byte order of a 64-bit word
+ */
+static uint64_t
+swap64(uint64_t value)
+{
+	return ((uint64_t) swap32((uint32_t) (value & 0xffffffffU)) << 32) | (uint64_t) swap32((uint32_t) (value >> 32));
+}
+
+
+/*
+ * hashWords - update a 64-bit FNV-1a hash with 64-bit words
+ *
+ * given:
+ *      hash            // hash of the previous words
+ *      buf             // words to hash, need not be aligned
+ *      len             // length of buf in octets, a multiple of 8
+ *      swap            // true ==> buf was written by a host of the other byte order
+ *
+ * returns:
+ *      hash updated with the words of buf, as they were seen by the host that wrote them
+ */
+static uint64_t
+hashWords(uint64_t hash, const void *buf, size_t len, bool swap)
+{
+	const unsigned char *p = buf;	// next word to hash
+	uint64_t word;			// current word
+	size_t i;
+
+	for (i = 0; i + sizeof(word) <= len; i += sizeof(word)) {
+		memcpy(&word, p + i, sizeof(word));
+		if (swap == true) {
+			word = swap64(word);
+		}
+		hash ^= word;
+		hash *= FNV_PRIME;
+	}
+
+	return hash;
+}
+
+
+/*
+ * writeWords - write 64-bit words to a .pvalues work file and hash them
+ *
+ * given:
+ *      p_val_file      // open .pvalues work file
+ *      hash            // pointer to the hash of the words written so far
+ *      buf             // words to write
+ *      len             // length of buf in octets, a multiple of 8
+ *      filename        // name of the work file, for error messages
+ */
+static void
+writeWords(FILE *p_val_file, uint64_t *hash, const void *buf, size_t len, char *filename)
+{
+	size_t ret;		// fwrite return
+
+	if (len == 0) {
+		return;
+	}
+	ret = fwrite(buf, len, 1, p_val_file);
+	if (ferror(p_val_file)) {
+		errp(240, __func__, "error while writing %lu octets to p-value file: %s", len, filename);
+	}
+	if (ret != 1) {
+		err(240, __func__, "unable to write %lu octets to p-value file: %s", len, filename);
+	}
+	*hash = hashWords(*hash, buf, len, false);
+
+	return;
+}
+
+
+/*
+ * writeLongs - write long ints as 64-bit words to a .pvalues work file and hash them
+ *
+ * given:
+ *      p_val_file      // open .pvalues work file
+ *      hash            // pointer to the hash of the words written so far
+ *      values          // values to write
+ *      count           // number of values
+ *      filename        // name of the work file, for error messages
+ */
+static void
+writeLongs(FILE *p_val_file, uint64_t *hash, const long int *values, long int count, char *filename)
+{
+	int64_t buffer[PVAL_WRITE_BUFFER];	// values converted to 64-bit words
+	long int i, j;
+
+	for (i = 0; i < count; i += j) {
+		for (j = 0; j < PVAL_WRITE_BUFFER && i + j < count; j++) {
+			buffer[j] = (int64_t) values[i + j];
+		}
+		writeWords(p_val_file, hash, buffer, (size_t) j * sizeof(buffer[0]), filename);
+	}
+
+	return;
+}
+
+
+/*
+ * writePadded - write octets to a work file, padded with 0 octets to a multiple of 8, and hash them
+ *
+ * given:
+ *      p_val_file      // open work file
+ *      hash            // pointer to the hash of the words written so far
+ *      buf             // octets to write
+ *      len             // number of octets
+ *      filename        // name of the work file, for error messages
+ */
+static void
+writePadded(FILE *p_val_file, uint64_t *hash, const void *buf, size_t len, char *filename)
+{
+	uint64_t word;		// last partial word, padded with 0 octets
+	size_t whole;		// octets in whole words
+
+	whole = len - (len % sizeof(word));
+	writeWords(p_val_file, hash, buf, whole, filename);
+	if (whole < len) {
+		word = 0;
+		memcpy(&word, (const char *) buf + whole, len - whole);
+		writeWords(p_val_file, hash, &word, sizeof(word), filename);
+	}
+
+	return;
+}
+
+
+/*
+ * initHeader - fill the header of a v2 .pvalues or .sketch file, with a 0 checksum
+ *
+ * given:
+ *      state           // run state to test under
+ *      header          // header to fill
+ *      content         // PVAL_CONTENT_P_VALUES, PVAL_CONTENT_SKETCH or PVAL_CONTENT_CHECKPOINT
+ *      testCount       // number of entries in the offset table
+ *      fileSize        // size of the whole file in octets
+ */
+static void
+initHeader(struct state *state, struct pval_header *header, uint32_t content, int testCount, uint64_t fileSize)
+{
+	memset(header, 0, sizeof(*header));
+	strncpy(header->magic, PVAL_MAGIC, sizeof(header->magic));
+	header->byteOrder = PVAL_BYTE_ORDER;
+	header->version = PVAL_VERSION;
+	header->headerSize = sizeof(*header);
+	header->fileSize = fileSize;
+	header->checksum = 0;
+	header->jobnum = state->jobnum;
+	header->numOfBitStreams = state->tp.numOfBitStreams;
+	header->n = state->tp.n;
+	header->blockFrequencyBlockLength = state->tp.blockFrequencyBlockLength;
+	header->nonOverlappingTemplateLength = state->tp.nonOverlappingTemplateLength;
+	header->overlappingTemplateLength = state->tp.overlappingTemplateLength;
+	header->approximateEntropyBlockLength = state->tp.approximateEntropyBlockLength;
+	header->serialBlockLength = state->tp.serialBlockLength;
+	header->linearComplexitySequenceLength = state->tp.linearComplexitySequenceLength;
+	header->alpha = state->tp.alpha;
+	header->bitOrder = PVAL_MSB_FIRST;
+	header->dataFormat = (uint32_t) state->dataFormat;
+	header->testCount = (uint32_t) testCount;
+	header->content = content;
+
+	return;
+}
+
+
+/*
+ * workFilePath - path of the working binary file (.work) of this job
+ *
+ * given:
+ *      state           // run state to test under
+ *
+ * returns:
+ *      malloced path of workDir/sts.__jobnum__.__iterations__.__bitcount__.work
+ */
+static char *
+workFilePath(struct state *state)
+{
+	char *filename;		// name of the work file
+	char *work_filepath;	// path of the work file
+
+	asprintf(&filename, "sts.%04ld.%ld.%ld.work", state->jobnum, state->tp.numOfBitStreams, state->tp.n);
+	work_filepath = filePathName(state->workDir, filename);
+	free(filename);
+
+	return work_filepath;
+}
+
+
+/*
+ * finishWorkFile - rewrite the header of a work file with its checksum, close it and give it its final name
+ *
+ * given:
+ *      state           // run state to test under
+ *      p_val_file      // open work file, with the header and everything after it written
+ *      header          // header written with a 0 checksum
+ *      hash            // hash of the whole file
+ *      work_filepath   // path of the work file
+ *      extension       // extension of the final name: pvalues, sketch or checkpoint
+ *
+ * The work file is renamed to workDir/sts.__jobnum__.__iterations__.__bitcount__.extension
+ */
+static void
+finishWorkFile(struct state *state, FILE *p_val_file, struct pval_header *header, uint64_t hash,
+	       char *work_filepath, char *extension)
+{
+	char *filename, *final_filepath;
+
+	/*
+	 * Rewrite the header with the checksum of the whole file
+	 */
+	header->checksum = hash;
+	errno = 0;		// paranoia
+	if (fseek(p_val_file, 0L, SEEK_SET) != 0) {
+		errp(240, __func__, "cannot rewind p-value file: %s", work_filepath);
+	}
+	if (fwrite(header, sizeof(*header), 1, p_val_file) != 1) {
+		errp(240, __func__, "unable to rewrite the header of p-value file: %s", work_filepath);
+	}
+
+	/*
+	 * Make sure the file is on disk before it is renamed, so that a crash leaves either the old or the new file
+	 */
+	if (fflush(p_val_file) != 0) {
+		errp(240, __func__, "error while flushing p-value file: %s", work_filepath);
+	}
+#ifndef _WIN32
+	if (fsync(fileno(p_val_file)) != 0) {
+		errp(240, __func__, "error while syncing p-value file: %s", work_filepath);
+	}
+#endif /* _WIN32 */
+	if (fclose(p_val_file) != 0) {
+		errp(240, __func__, "error while closing p-value file: %s", work_filepath);
+	}
+	dbg(DBG_MED, "wrote %u tests and %lu octets to p-value file: %s",
+	    header->testCount, (unsigned long) header->fileSize, work_filepath);
+
+	/*
+	 * Compute the final filename
+	 */
+	asprintf(&filename, "sts.%04ld.%ld.%ld.%s", state->jobnum, state->tp.numOfBitStreams, state->tp.n, extension);
+	final_filepath = filePathName(state->workDir, filename);
+
+	/*
+	 * Rename the work file (.work) to have its final filename
+	 */
+	if (rename(work_filepath, final_filepath) < 0) {
+		errp(240, __func__, "error in renaming %s to %s", work_filepath, final_filepath);
+	}
+
+	/*
+	 * Free allocated memory
+	 */
+	free(filename);
+	free(final_filepath);
+
+	return;
+}
+
+
+/*
+ * write_p_val_to_file - write the p_values of each test to a v2 .pvalues file
+ *
+ * given:
+ *      state           // run state to test under
+ *
+ * The file is written as workDir/sts.__jobnum__.__iterations__.__bitcount__.work and renamed to
+ * workDir/sts.__jobnum__.__iterations__.__bitcount__.pvalues once complete.
+ * See struct pval_header in defs.h for the format of the file.
+ */
+void
+write_p_val_to_file(struct state *state)
+{
+	struct pval_header header;		// header of the file
+	struct pval_entry entries[NUMOFTESTS];	// offset table of the file
+	uint64_t hash;				// hash of the octets written so far
+	uint64_t offset;			// offset of the p_values of the next test
+	char *work_filepath;
+	FILE *p_val_file;
+	long int i;
+	int testCount;
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (state == NULL) {
+		err(240, __func__, "state arg was NULL");
+	}
+
+	/*
+	 * Build the offset table
+	 */
+	testCount = 0;
+	for (i = 1; i <= NUMOFTESTS; i++) {
+		if (state->testVector[i] == true && state->p_val[i] != NULL) {
+			entries[testCount].test = i;
+			entries[testCount].partitionCount = state->partitionCount[i];
+			entries[testCount].count = state->p_val[i]->count;
+			++testCount;
+		}
+	}
+	offset = sizeof(header) + (uint64_t) testCount * sizeof(entries[0]);
+	for (i = 0; i < testCount; i++) {
+		entries[i].offset = offset;
+		offset += (uint64_t) entries[i].count * sizeof(double);
+	}
+	initHeader(state, &header, PVAL_CONTENT_P_VALUES, testCount, offset);
+
+	/*
+	 * Create and open the working binary file (.work)
+	 */
+	work_filepath = workFilePath(state);
+	p_val_file = fopen(work_filepath, "wb");
+	if (p_val_file == NULL) {
+		errp(240, __func__, "cannot open p-value file for writing: %s", work_filepath);
+	}
+
+	/*
+	 * Write the header with a 0 checksum, the offset table and the p_values of each test
+	 */
+	hash = FNV_OFFSET_BASIS;
+	writeWords(p_val_file, &hash, &header, sizeof(header), work_filepath);
+	writeWords(p_val_file, &hash, entries, (size_t) testCount * sizeof(entries[0]), work_filepath);
+	for (i = 0; i < testCount; i++) {
+		struct dyn_array *p_val = state->p_val[entries[i].test];
+
+		writeWords(p_val_file, &hash, p_val->data, (size_t) p_val->count * sizeof(double), work_filepath);
+	}
+
+	finishWorkFile(state, p_val_file, &header, hash, work_filepath, "pvalues");
+	free(work_filepath);
+}
+
+
+/*
+ * writeSketch - write the p_value tallies of each test in the .sketch format
+ *
+ * given:
+ *      state           // run state to test under
+ *      p_val_file      // open file to write to
+ *      header          // where to store the header, written with a 0 checksum
+ *      filename        // name of the file, for error messages
+ *
+ * returns:
+ *      hash of the octets written, with the checksum of the header taken as 0
+ *
+ * See struct pval_header and struct pval_sketch in defs.h for the format.
+ *
+ * NOTE: This function tallies the p_values of each test with get_p_val_tally(), so that the metrics
+ *       driver interface must not be called afterwards.
+ */
+static uint64_t
+writeSketch(struct state *state, FILE *p_val_file, struct pval_header *header, char *filename)
+{
+	struct pval_entry entries[NUMOFTESTS];	// offset table of the file
+	struct pval_sketch sketch;		// tally of a test
+	struct p_val_tally *tally;		// p_value tally of a test
+	uint64_t hash;				// hash of the octets written so far
+	uint64_t offset;			// offset of the tally of the next test
+	long int i;
+	int testCount;
+
+	/*
+	 * Build the offset table
+	 */
+	testCount = 0;
+	for (i = 1; i <= NUMOFTESTS; i++) {
+		if (state->testVector[i] == true) {
+			tally = get_p_val_tally(state, (int) i);
+			entries[testCount].test = i;
+			entries[testCount].partitionCount = tally->partitionCount;
+			entries[testCount].count = tally->count;
+			++testCount;
+		}
+	}
+	offset = sizeof(*header) + (uint64_t) testCount * sizeof(entries[0]);
+	for (i = 0; i < testCount; i++) {
+		tally = state->tally[entries[i].test];
+		entries[i].offset = offset;
+		offset += sizeof(sketch) + (uint64_t) tally->partitionCount * (2 + tally->bins) * sizeof(int64_t);
+	}
+	initHeader(state, header, PVAL_CONTENT_SKETCH, testCount, offset);
+
+	/*
+	 * Write the header with a 0 checksum, the offset table and the tally of each test
+	 */
+	hash = FNV_OFFSET_BASIS;
+	writeWords(p_val_file, &hash, header, sizeof(*header), filename);
+	writeWords(p_val_file, &hash, entries, (size_t) testCount * sizeof(entries[0]), filename);
+	for (i = 0; i < testCount; i++) {
+		int test = (int) entries[i].test;
+
+		tally = state->tally[test];
+		sketch.count = state->count[test];
+		sketch.valid = state->valid[test];
+		sketch.success = state->success[test];
+		sketch.failure = state->failure[test];
+		sketch.valid_p_val = state->valid_p_val[test];
+		sketch.tallied = tally->count;
+		sketch.bins = tally->bins;
+		writeWords(p_val_file, &hash, &sketch, sizeof(sketch), filename);
+		writeLongs(p_val_file, &hash, tally->sampleCount, tally->partitionCount, filename);
+		writeLongs(p_val_file, &hash, tally->toolow, tally->partitionCount, filename);
+		writeLongs(p_val_file, &hash, tally->freqPerBin, tally->partitionCount * tally->bins, filename);
+	}
+
+	return hash;
+}
+
+
+/*
+ * write_sketch_to_file - write the p_value tallies of each test to a .sketch file (-K)
+ *
+ * given:
+ *      state           // run state to test under
+ *
+ * The file is written as workDir/sts.__jobnum__.__iterations__.__bitcount__.work and renamed to
+ * workDir/sts.__jobnum__.__iterations__.__bitcount__.sketch once complete.
+ * See struct pval_header and struct pval_sketch in defs.h for the format of the file.
+ *
+ * NOTE: This function tallies the p_values of each test with get_p_val_tally(), so that the metrics
+ *       driver interface must not be called afterwards.
+ */
+void
+write_sketch_to_file(struct state *state)
+{
+	struct pval_header header;		// header of the file
+	uint64_t hash;				// hash of the whole file
+	char *work_filepath;
+	FILE *p_val_file;
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (state == NULL) {
+		err(240, __func__, "state arg was NULL");
+	}
+	if (state->sketchFlag == false) {
+		err(240, __func__, "a sketch file is only written with -K");
+	}
+
+	/*
+	 * Create and open the working binary file (.work)
+	 */
+	work_filepath = workFilePath(state);
+	p_val_file = fopen(work_filepath, "wb");
+	if (p_val_file == NULL) {
+		errp(240, __func__, "cannot open sketch file for writing: %s", work_filepath);
+	}
+
+	hash = writeSketch(state, p_val_file, &header, work_filepath);
+
+	finishWorkFile(state, p_val_file, &header, hash, work_filepath, "sketch");
+	free(work_filepath);
+}
+
+
+/*
+ * build_sketch - build the .sketch image of the p_value tallies of each test in memory
+ *
+ * given:
+ *      state           // run state to test under
+ *      size            // where to store the size of the image in octets
+ *
+ * returns:
+ *      malloced .sketch image, to be merged by merge_sketch()
+ *
+ * NOTE: This function tallies the p_values of each test with get_p_val_tally(), so that the metrics
+ *       driver interface must not be called afterwards.
+ */
+void *
+build_sketch(struct state *state, size_t *size)
+{
+	struct pval_header header;	// header of the image
+	uint64_t hash;			// hash of the whole image
+	char *image;			// the image
+	FILE *stream;			// memory stream writing the image
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (state == NULL) {
+		err(240, __func__, "state arg was NULL");
+	}
+	if (size == NULL) {
+		err(240, __func__, "size arg was NULL");
+	}
+
+	image = NULL;
+	*size = 0;
+	stream = open_memstream(&image, size);
+	if (stream == NULL) {
+		errp(240, __func__, "cannot open a memory stream for a sketch");
+	}
+	hash = writeSketch(state, stream, &header, "sketch image");
+	if (fclose(stream) != 0 || image == NULL || *size != header.fileSize) {
+		errp(240, __func__, "error while writing %lu octets of sketch image", (unsigned long) header.fileSize);
+	}
+
+	/*
+	 * Set the checksum of the whole image
+	 */
+	memcpy(image + offsetof(struct pval_header, checksum), &hash, sizeof(hash));
+
+	return image;
+}
+
+
+/*
+ * merge_sketch - merge the p_value tallies of a .sketch image into the tallies of each test
+ *
+ * given:
+ *      state           // run state to test under
+ *      name            // name of the image, for warnings
+ *      image           // .sketch image, as built by build_sketch()
+ *      size            // size of the image in octets
+ *
+ * returns:
+ *      true ==> the tallies were merged,
+ *      false ==> the image failed a check and nothing was merged (a warning was issued)
+ */
+bool
+merge_sketch(struct state *state, char *name, const void *image, size_t size)
+{
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (state == NULL) {
+		err(240, __func__, "state arg was NULL");
+	}
+	if (image == NULL) {
+		err(240, __func__, "image arg was NULL");
+	}
+	if (state->p_valTally == false) {
+		err(240, __func__, "p_values merged from a sketch must be tallied");
+	}
+
+	return tallyMappedFile(state, name, image, size);
+}
+
+
+/*
+ * mapFile - map a whole file read only in memory
+ *
+ * given:
+ *      path            // path of the file to map
+ *      size            // pointer to where to store the size of the file
+ *
+ * returns:
+ *      address of the mapped file, or NULL (with a warning) if it could not be mapped or is empty
+ */
+static void *
+mapFile(char *path, size_t *size)
+{
+	struct stat buf;	// file status
+	void *base;		// address of the mapped file
+	int fd;			// file descriptor of the file
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		warnp(__func__, "skipping p-value file due to error in opening p-value file: %s", path);
+		return NULL;
+	}
+	if (fstat(fd, &buf) < 0) {
+		warnp(__func__, "skipping p-value file due to error in stat of p-value file: %s", path);
+		close(fd);
+		return NULL;
+	}
+	if (buf.st_size <= 0) {
+		warn(__func__, "skipping empty p-value file: %s", path);
+		close(fd);
+		return NULL;
+	}
+	*size = (size_t) buf.st_size;
+
+#ifndef _WIN32
+	base = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (base == MAP_FAILED) {
+		warnp(__func__, "skipping p-value file due to error in mapping p-value file: %s", path);
+		close(fd);
+		return NULL;
+	}
+	(void) posix_madvise(base, *size, POSIX_MADV_SEQUENTIAL);
+#else /* _WIN32 */
+	base = malloc(*size);
+	if (base == NULL) {
+		errp(241, __func__, "cannot malloc %lu bytes for p-value file: %s", *size, path);
+	}
+	if (read(fd, base, *size) != (ssize_t) *size) {
+		warnp(__func__, "skipping p-value file due to error in reading p-value file: %s", path);
+		free(base);
+		close(fd);
+		return NULL;
+	}
+#endif /* _WIN32 */
+	close(fd);
+
+	return base;
+}
+
+
+/*
+ * unmapFile - unmap a file mapped by mapFile()
+ */
+static void
+unmapFile(void *base, size_t size)
+{
+#ifndef _WIN32
+	if (munmap(base, size) < 0) {
+		warnp(__func__, "error in unmapping %lu octets of p-value file", size);
+	}
+#else /* _WIN32 */
+	free(base);
+#endif /* _WIN32 */
+}
+
+
+/*
+ * checkHeader - check the header and the checksum of a mapped v2 .pvalues file
+ *
+ * given:
+ *      state           // run state to test under
+ *      filename        // name of the file, for warnings
+ *      base            // address of the mapped file
+ *      size            // size of the mapped file
+ *      header          // where to store the header in the byte order of this host
+ *      swap            // where to store true if the file was written by a host of the other byte order
+ *
+ * returns:
+ *      true ==> the p_values of the file may be assessed with the test parameters of state,
+ *      false ==> the file must be skipped (a warning was issued)
+ */
+static bool
+checkHeader(struct state *state, char *filename, const void *base, size_t size,
+	    struct pval_header *header, bool *swap)
+{
+	uint64_t hash;		// hash of the whole file
+	size_t checksum;	// offset of the checksum in the header
+
+	if (size < sizeof(*header)) {
+		warn(__func__, "skipping p-value file, too short for a header: %s", filename);
+		return false;
+	}
+	memcpy(header, base, sizeof(*header));
+
+	/*
+	 * Bring the header to the byte order of this host
+	 */
+	if (header->byteOrder == PVAL_BYTE_ORDER) {
+		*swap = false;
+	} else if (header->byteOrder == swap32(PVAL_BYTE_ORDER)) {
+		*swap = true;
+		header->byteOrder = swap32(header->byteOrder);
+		header->version = swap32(header->version);
+		header->headerSize = swap64(header->headerSize);
+		header->fileSize = swap64(header->fileSize);
+		header->checksum = swap64(header->checksum);
+		header->jobnum = (int64_t) swap64((uint64_t) header->jobnum);
+		header->numOfBitStreams = (int64_t) swap64((uint64_t) header->numOfBitStreams);
+		header->n = (int64_t) swap64((uint64_t) header->n);
+		header->blockFrequencyBlockLength = (int64_t) swap64((uint64_t) header->blockFrequencyBlockLength);
+		header->nonOverlappingTemplateLength = (int64_t) swap64((uint64_t) header->nonOverlappingTemplateLength);
+		header->overlappingTemplateLength = (int64_t) swap64((uint64_t) header->overlappingTemplateLength);
+		header->approximateEntropyBlockLength = (int64_t) swap64((uint64_t) header->approximateEntropyBlockLength);
+		header->serialBlockLength = (int64_t) swap64((uint64_t) header->serialBlockLength);
+		header->linearComplexitySequenceLength = (int64_t) swap64((uint64_t) header->linearComplexitySequenceLength);
+		header->bitOrder = swap32(header->bitOrder);
+		header->dataFormat = swap32(header->dataFormat);
+		header->testCount = swap32(header->testCount);
+		header->content = swap32(header->content);
+	} else {
+		warn(__func__, "skipping p-value file, unknown byte order marker 0x%08x: %s", header->byteOrder, filename);
+		return false;
+	}
+
+	/*
+	 * Check the layout of the file
+	 */
+	if (header->version != PVAL_VERSION &&
+	    (header->version < PVAL_VERSION_P_VALUES || header->version > PVAL_VERSION ||
+	     header->content != PVAL_CONTENT_P_VALUES)) {
+		warn(__func__, "skipping p-value file, version %u is not supported, expected %d: %s",
+		     header->version, PVAL_VERSION, filename);
+		return false;
+	}
+	if (header->content != PVAL_CONTENT_P_VALUES && header->content != PVAL_CONTENT_SKETCH &&
+	    header->content != PVAL_CONTENT_CHECKPOINT) {
+		warn(__func__, "skipping p-value file, unknown content %u: %s", header->content, filename);
+		return false;
+	}
+	if (header->headerSize != sizeof(*header)) {
+		warn(__func__, "skipping p-value file, header size %lu != %lu: %s",
+		     (unsigned long) header->headerSize, sizeof(*header), filename);
+		return false;
+	}
+	if (header->fileSize != size) {
+		warn(__func__, "skipping p-value file, file size %lu != %lu as written, file is truncated or corrupt: %s",
+		     size, (unsigned long) header->fileSize, filename);
+		return false;
+	}
+	if ((size % sizeof(uint64_t)) != 0) {
+		warn(__func__, "skipping p-value file, size %lu is not a multiple of %lu: %s", size, sizeof(uint64_t), filename);
+		return false;
+	}
+
+	/*
+	 * Check the checksum of the whole file, taking the checksum field as 0
+	 */
+	checksum = offsetof(struct pval_header, checksum);
+	hash = hashWords(FNV_OFFSET_BASIS, base, checksum, *swap);
+	hash = hashWords(hash, "\0\0\0\0\0\0\0", sizeof(uint64_t), false);
+	hash = hashWords(hash, (const char *) base + checksum + sizeof(uint64_t), size - checksum - sizeof(uint64_t), *swap);
+	if (hash != header->checksum) {
+		warn(__func__, "skipping p-value file, checksum mismatch, file is corrupt: %s", filename);
+		return false;
+	}
+
+	/*
+	 * The p_values must have been computed with the same test parameters
+	 */
+	if (header->n != state->tp.n) {
+		warn(__func__, "skipping p-value file, bitcount %ld != %ld: %s", (long int) header->n, state->tp.n, filename);
+		return false;
+	}
+	if (header->blockFrequencyBlockLength != state->tp.blockFrequencyBlockLength ||
+	    header->nonOverlappingTemplateLength != state->tp.nonOverlappingTemplateLength ||
+	    header->overlappingTemplateLength != state->tp.overlappingTemplateLength ||
+	    header->approximateEntropyBlockLength != state->tp.approximateEntropyBlockLength ||
+	    header->serialBlockLength != state->tp.serialBlockLength ||
+	    header->linearComplexitySequenceLength != state->tp.linearComplexitySequenceLength) {
+		warn(__func__, "skipping p-value file, written with -P 1=%ld -P 2=%ld -P 3=%ld -P 4=%ld -P 5=%ld -P 6=%ld, "
+		     "which differ from the test parameters of this run: %s",
+		     (long int) header->blockFrequencyBlockLength, (long int) header->nonOverlappingTemplateLength,
+		     (long int) header->overlappingTemplateLength, (long int) header->approximateEntropyBlockLength,
+		     (long int) header->serialBlockLength, (long int) header->linearComplexitySequenceLength, filename);
+		return false;
+	}
+	if (header->alpha != state->tp.alpha) {
+		dbg(DBG_LOW, "p-value file was written with alpha %f, assessing with alpha %f: %s",
+		    header->alpha, state->tp.alpha, filename);
+	}
+	dbg(DBG_HIGH, "p-value file: jobnum %ld, %ld iterations, %s data, bit order %u, %u tests: %s",
+	    (long int) header->jobnum, (long int) header->numOfBitStreams,
+	    header->dataFormat == FORMAT_ASCII_01 ? "ASCII" : "raw binary", header->bitOrder, header->testCount, filename);
+
+	return true;
+}
+
+
+/*
+ * checkEntries - copy and check the offset table of a mapped v2 .pvalues file
+ *
+ * given:
+ *      state           // run state to test under
+ *      filename        // name of the file, for warnings
+ *      base            // address of the mapped file
+ *      size            // size of the mapped file
+ *      header          // checked header of the file, in the byte order of this host
+ *      entries         // where to store the header->testCount entries in the byte order of this host
+ *      swap            // true ==> the file was written by a host of the other byte order
+ *
+ * returns:
+ *      true ==> all the p_values (or struct pval_sketch) of the table are within the file,
+ *      false ==> the file must be skipped (a warning was issued)
+ */
+static bool
+checkEntries(struct state *state, char *filename, const void *base, size_t size,
+	     struct pval_header *header, struct pval_entry *entries, bool swap)
+{
+	uint64_t tableEnd;	// offset of the end of the offset table
+	uint32_t i;
+
+	if (header->testCount > NUMOFTESTS) {
+		warn(__func__, "skipping p-value file, %u tests > %d: %s", header->testCount, NUMOFTESTS, filename);
+		return false;
+	}
+	tableEnd = header->headerSize + (uint64_t) header->testCount * sizeof(entries[0]);
+	if (tableEnd > size) {
+		warn(__func__, "skipping p-value file, offset table ends beyond the end of file: %s", filename);
+		return false;
+	}
+	memcpy(entries, (const char *) base + header->headerSize, (size_t) header->testCount * sizeof(entries[0]));
+
+	for (i = 0; i < header->testCount; i++) {
+		if (swap == true) {
+			entries[i].test = (int64_t) swap64((uint64_t) entries[i].test);
+			entries[i].partitionCount = (int64_t) swap64((uint64_t) entries[i].partitionCount);
+			entries[i].count = (int64_t) swap64((uint64_t) entries[i].count);
+			entries[i].offset = swap64(entries[i].offset);
+		}
+		if (entries[i].test < 1 || entries[i].test > NUMOFTESTS) {
+			warn(__func__, "skipping p-value file, test number %ld must be in [1, %d]: %s",
+			     (long int) entries[i].test, NUMOFTESTS, filename);
+			return false;
+		}
+		if (entries[i].count < 0 || entries[i].partitionCount < 1 ||
+		    (entries[i].count % entries[i].partitionCount) != 0) {
+			warn(__func__, "skipping p-value file, %ld p-values of %s[%ld] are not whole iterations of %ld: %s",
+			     (long int) entries[i].count, state->testNames[entries[i].test], (long int) entries[i].test,
+			     (long int) entries[i].partitionCount, filename);
+			return false;
+		}
+		if (state->testVector[entries[i].test] == true &&
+		    entries[i].partitionCount != state->partitionCount[entries[i].test]) {
+			warn(__func__, "skipping p-value file, %ld p-values per iteration of %s[%ld] != %d: %s",
+			     (long int) entries[i].partitionCount, state->testNames[entries[i].test],
+			     (long int) entries[i].test, state->partitionCount[entries[i].test], filename);
+			return false;
+		}
+		if ((entries[i].offset % sizeof(double)) != 0 || entries[i].offset < tableEnd || entries[i].offset > size ||
+		    (header->content == PVAL_CONTENT_P_VALUES &&
+		     (uint64_t) entries[i].count > (size - entries[i].offset) / sizeof(double)) ||
+		    (header->content == PVAL_CONTENT_SKETCH &&
+		     sizeof(struct pval_sketch) > size - entries[i].offset) ||
+		    (header->content == PVAL_CONTENT_CHECKPOINT &&
+		     sizeof(struct pval_checkpoint) > size - entries[i].offset)) {
+			warn(__func__, "skipping p-value file, p-values of %s[%ld] are not within the file: %s",
+			     state->testNames[entries[i].test], (long int) entries[i].test, filename);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+/*
+ * getWord - read a 64-bit integer of a mapped file
+ *
+ * given:
+ *      words           // address of the first word, need not be aligned
+ *      index           // index of the word to read
+ *      swap            // true ==> the file was written by a host of the other byte order
+ *
+ * returns:
+ *      word index in the byte order of this host
+ */
+static int64_t
+getWord(const void *words, uint64_t index, bool swap)
+{
+	uint64_t word;		// word in the byte order of the file
+
+	memcpy(&word, (const char *) words + index * sizeof(word), sizeof(word));
+	if (swap == true) {
+		word = swap64(word);
+	}
+
+	return (int64_t) word;
+}
+
+
+/*
+ * checkSketch - copy and check the tally of a test in a mapped .sketch file
+ *
+ * given:
+ *      state           // run state to test under
+ *      filename        // name of the file, for warnings
+ *      base            // address of the mapped file
+ *      size            // size of the mapped file
+ *      entry           // checked offset table entry of the test, in the byte order of this host
+ *      sketch          // where to store the tally of the test in the byte order of this host
+ *      swap            // true ==> the file was written by a host of the other byte order
+ *
+ * returns:
+ *      true ==> the tally is within the file and in the -P 8=bins of this run,
+ *      false ==> the file must be skipped (a warning was issued)
+ */
+static bool
+checkSketch(struct state *state, char *filename, const void *base, size_t size,
+	    struct pval_entry *entry, struct pval_sketch *sketch, bool swap)
+{
+	uint64_t words;		// number of 64-bit words after the struct pval_sketch, up to the end of file
+	int test = (int) entry->test;
+
+	sketch->count = getWord(base, entry->offset / sizeof(uint64_t) + 0, swap);
+	sketch->valid = getWord(base, entry->offset / sizeof(uint64_t) + 1, swap);
+	sketch->success = getWord(base, entry->offset / sizeof(uint64_t) + 2, swap);
+	sketch->failure = getWord(base, entry->offset / sizeof(uint64_t) + 3, swap);
+	sketch->valid_p_val = getWord(base, entry->offset / sizeof(uint64_t) + 4, swap);
+	sketch->tallied = getWord(base, entry->offset / sizeof(uint64_t) + 5, swap);
+	sketch->bins = getWord(base, entry->offset / sizeof(uint64_t) + 6, swap);
+
+	/*
+	 * The per partition arrays must be within the file
+	 */
+	words = (size - entry->offset - sizeof(*sketch)) / sizeof(uint64_t);
+	if (sketch->tallied != entry->count || sketch->bins < 1 || (uint64_t) sketch->bins > words ||
+	    words / (uint64_t) entry->partitionCount < (uint64_t) (2 + sketch->bins)) {
+		warn(__func__, "skipping sketch file, tally of %s[%d] is not within the file: %s",
+		     state->testNames[test], test, filename);
+		return false;
+	}
+
+	/*
+	 * The tally must be in the -P 8=bins of this run
+	 */
+	if (state->testVector[test] == true && sketch->bins != state->tp.uniformity_bins) {
+		warn(__func__, "skipping sketch file, %ld bins of %s[%d] cannot be assessed with %ld bins, "
+		     "write it with -P 8=%ld: %s", (long int) sketch->bins, state->testNames[test], test,
+		     state->tp.uniformity_bins, state->tp.uniformity_bins, filename);
+		return false;
+	}
+
+	return true;
+}
+
+
+/*
+ * mergeSketch - merge the tally of a test in a mapped .sketch file into the tally of the test
+ *
+ * given:
+ *      state           // run state to test under
+ *      base            // address of the mapped file
+ *      entry           // checked offset table entry of the test, in the byte order of this host
+ *      sketch          // checked tally of the test, in the byte order of this host
+ *      swap            // true ==> the file was written by a host of the other byte order
+ */
+static void
+mergeSketch(struct state *state, const void *base, struct pval_entry *entry, struct pval_sketch *sketch, bool swap)
+{
+	struct p_val_tally tally;	// tally of the .sketch in the byte order of this host
+	const void *words;		// per partition arrays of the .sketch
+	long int i;
+	int test = (int) entry->test;
+
+	/*
+	 * Copy the tally
+	 */
+	tally.partitionCount = (long int) entry->partitionCount;
+	tally.bins = (long int) sketch->bins;
+	tally.count = (long int) sketch->tallied;
+	tally.sampleCount = calloc((size_t) tally.partitionCount, sizeof(tally.sampleCount[0]));
+	tally.toolow = calloc((size_t) tally.partitionCount, sizeof(tally.toolow[0]));
+	tally.freqPerBin = calloc((size_t) (tally.partitionCount * tally.bins), sizeof(tally.freqPerBin[0]));
+	if (tally.sampleCount == NULL || tally.toolow == NULL || tally.freqPerBin == NULL) {
+		errp(244, __func__, "cannot calloc counters for %ld partitions of %ld bins", tally.partitionCount, tally.bins);
+	}
+
+	words = (const char *) base + entry->offset + sizeof(*sketch);
+	for (i = 0; i < tally.partitionCount; ++i) {
+		tally.sampleCount[i] = (long int) getWord(words, (uint64_t) i, swap);
+		tally.toolow[i] = (long int) getWord(words, (uint64_t) (tally.partitionCount + i), swap);
+	}
+	for (i = 0; i < tally.partitionCount * tally.bins; ++i) {
+		tally.freqPerBin[i] = (long int) getWord(words, (uint64_t) (2 * tally.partitionCount + i), swap);
+	}
+
+	/*
+	 * Merge it with the tallies of the other files
+	 */
+	merge_p_val_tally(state, test, &tally);
+	state->count[test] += (long int) sketch->count;
+	state->valid[test] += (long int) sketch->valid;
+	state->success[test] += (long int) sketch->success;
+	state->failure[test] += (long int) sketch->failure;
+	state->valid_p_val[test] += (long int) sketch->valid_p_val;
+
+	free(tally.sampleCount);
+	free(tally.toolow);
+	free(tally.freqPerBin);
+
+	return;
+}
+
+
+/*
+ * tallyMappedFile - tally the p_values of a mapped v2 .pvalues file, or merge the tallies of a .sketch file
+ *
+ * given:
+ *      state           // run state to test under
+ *      filename        // name of the file, for warnings
+ *      base            // address of the mapped file
+ *      size            // size of the mapped file
+ *
+ * returns:
+ *      true ==> the file was tallied,
+ *      false ==> the file failed a check and nothing was tallied from it (a warning was issued)
+ *
+ * The p_values of the tests in state->testVector are scanned in place and tallied.
+ */
+static bool
+tallyMappedFile(struct state *state, char *filename, const void *base, size_t size)
+{
+	struct pval_header header;		// header in the byte order of this host
+	struct pval_entry entries[NUMOFTESTS];	// offset table in the byte order of this host
+	bool swap;				// true ==> the file was written by a host of the other byte order
+	uint32_t i;
+
+	if (checkHeader(state, filename, base, size, &header, &swap) == false ||
+	    checkEntries(state, filename, base, size, &header, entries, swap) == false) {
+		return false;
+	}
+	if (header.content == PVAL_CONTENT_CHECKPOINT) {
+		warn(__func__, "skipping checkpoint file, resume its run with -r to complete it: %s", filename);
+		return false;
+	}
+
+	/*
+	 * Merge the tallies of a .sketch file
+	 */
+	if (header.content == PVAL_CONTENT_SKETCH) {
+		struct pval_sketch sketches[NUMOFTESTS];	// tallies in the byte order of this host
+
+		if (header.alpha != state->tp.alpha) {
+			warn(__func__, "skipping sketch file, tallied with alpha %f, which differs from alpha %f of this run: %s",
+			     header.alpha, state->tp.alpha, filename);
+			return false;
+		}
+		for (i = 0; i < header.testCount; i++) {
+			if (checkSketch(state, filename, base, size, &entries[i], &sketches[i], swap) == false) {
+				return false;
+			}
+		}
+		for (i = 0; i < header.testCount; i++) {
+			if (state->testVector[entries[i].test] == false) {
+				dbg(DBG_MED, "ignoring tally of %s[%ld], test not selected: %s",
+				    state->testNames[entries[i].test], (long int) entries[i].test, filename);
+				continue;
+			}
+			mergeSketch(state, base, &entries[i], &sketches[i], swap);
+			dbg(DBG_HIGH, "merged tally of %ld p-values of %s[%ld] from sketch file: %s",
+			    (long int) sketches[i].tallied, state->testNames[entries[i].test], (long int) entries[i].test,
+			    filename);
+		}
+		return true;
+	}
+
+	for (i = 0; i < header.testCount; i++) {
+		const double *p_val = (const double *) ((const char *) base + entries[i].offset);
+		int test = (int) entries[i].test;
+		long int partitionCount = (long int) entries[i].partitionCount;
+		long int count = (long int) entries[i].count;
+		long int j;
+
+		if (state->testVector[test] == false) {
+			dbg(DBG_MED, "ignoring %ld p-values of %s[%d], test not selected: %s",
+			    count, state->testNames[test], test, filename);
+			continue;
+		}
+
+		if (swap == false) {
+			for (j = 0; j < count; j++) {
+				tally_p_value(state, test, j % partitionCount, p_val[j]);
+			}
+		} else {
+			for (j = 0; j < count; j++) {
+				uint64_t word;		// p_value in the byte order of the file
+				double p_value;		// p_value in the byte order of this host
+
+				memcpy(&word, &p_val[j], sizeof(word));
+				word = swap64(word);
+				memcpy(&p_value, &word, sizeof(p_value));
+				tally_p_value(state, test, j % partitionCount, p_value);
+			}
+		}
+		dbg(DBG_HIGH, "tallied %ld p-values of %s[%d] from p-value file: %s",
+		    count, state->testNames[test], test, filename);
+	}
+
+	return true;
+}
+
+
+/*
+ * tallyLegacyFile - tally the p_values of a .pvalues file written before the v2 format
+ *
+ * given:
+ *      state           // run state to test under
+ *      filename        // name of the file, for warnings
+ *      path            // path of the file
+ *
+ * A legacy file is a sequence of native long int test number, native long int count of p_values,
+ * followed by count native doubles.
+ */
+static void
+tallyLegacyFile(struct state *state, char *filename, char *path)
+{
+	long int test_num;		// test number for the pvalues that follow in the pvalue file
+	long int p_val_index;		// current pvalue number for a given test number in the pvalue file
+	FILE *p_val_file;		// open pvalues filename
+	size_t ret;			// fread return
+
+	p_val_file = fopen(path, "rb");
+	if (p_val_file == NULL) {
+		warnp(__func__, "skipping p-value file due to error in opening p-value file: %s", filename);
+		return;
+	}
+
+	/*
+	 * Read the content of the file
+	 */
+	do {
+
+		/*
+		 * Read the test number
+		 */
+		ret = fread(&test_num, sizeof(test_num), 1, p_val_file);
+		if (ferror(p_val_file)) {
+			warnp(__func__, "skipping p-value, error while reading test number from p-value file: %s",
+			      filename);
+			break;
+		}
+		if (feof(p_val_file)) {
+			warn(__func__, "skipping p-value file, found EOF while reading test number from p-value file: %s",
+			     filename);
+			break;
+		}
+		if (ret != 1) {
+			warn(__func__, "skipping p-value file, unable to read test number from p-value file: %s",
+			     filename);
+			break;
+		}
+		if (test_num < 1 || test_num > NUMOFTESTS) {
+			warn(__func__, "skipping p-value file, test number %ld must be in [1, %d]: %s",
+			     test_num, NUMOFTESTS, filename);
+			break;
+		}
+
+		/*
+		 * Read number of p-values for the current testnum
+		 */
+		long int number_of_p_vals;	// number of pvalues that follow in the pvalue file
+		ret = fread(&number_of_p_vals, sizeof(number_of_p_vals), 1, p_val_file);
+		if (ferror(p_val_file)) {
+			warnp(__func__, "skipping p-value file, error while reading number_of_p_vals from p-value file: %s",
+					filename);
+			break;
+		}
+		if (feof(p_val_file)) {
+			warn(__func__, "skipping p-value file, found EOF while reading number of pvals in p-value file: %s",
+					filename);
+			break;
+		}
+		if (ret != 1) {
+			warn(__func__, "skipping p-value file, unable to read number_of_p_vals from p-value file: %s",
+			     filename);
+			break;
+		}
+
+		/*
+		 * Read all the p-values for this test
+		 */
+		for (p_val_index = 0; p_val_index < number_of_p_vals; p_val_index++) {
+			double p_val;		// pvalue read from pvalue file
+
+			/*
+			 * Read one p-value
+			 */
+			ret = fread(&p_val, sizeof(p_val), 1, p_val_file);
+			if (ferror(p_val_file)) {
+				warnp(__func__, "error while reading a pvalue[%ld] from file: %s", p_val_index, filename);
+				break;
+			}
+			if (feof(p_val_file)) {
+				warn(__func__, "EOF while reading pvalue[%ld] from file: %s", p_val_index, filename);
+				break;
+			}
+			if (ret != 1) {
+				warn(__func__, "unable to read a pvalue[%ld] from file: %s", p_val_index, filename);
+				break;
+			}
+
+			/*
+			 * Tally each read p-value with the p-values of this test
+			 */
+			if (state->testVector[test_num] == true) {
+				tally_p_value(state, (int) test_num, p_val_index % state->partitionCount[test_num], p_val);
+			}
+		}
+
+	} while (!feof(p_val_file) && !ferror(p_val_file) && ret == 1 && test_num < NUMOFTESTS);
+
+	/*
+	 * Close the file that has been read
+	 */
+	fclose(p_val_file);
+
+	return;
+}
+
+
+/*
+ * readFile - tally the p_values of a .pvalues file
+ *
+ * given:
+ *      state           // run state whose tallies to fill
+ *      filename        // name of the file under -d pvaluesdir
+ *
+ * A v2 .pvalues file is mapped and its p_values are tallied in place.
+ * A file without the v2 magic is read as a legacy .pvalues file.
+ */
+static void
+readFile(struct state *state, char *filename)
+{
+	char *path;		// path of the pvalues file
+	void *base;		// address of the mapped file
+	size_t size;		// size of the mapped file
+
+	dbg(DBG_MED, "parsing p-value file: %s", filename);
+	path = filePathName(state->pvalues_dir, filename);
+
+	base = mapFile(path, &size);
+	if (base != NULL) {
+		if (size >= sizeof(PVAL_MAGIC) && memcmp(base, PVAL_MAGIC, sizeof(PVAL_MAGIC)) == 0) {
+			(void) tallyMappedFile(state, filename, base, size);
+			unmapFile(base, size);
+		} else {
+			unmapFile(base, size);
+			dbg(DBG_MED, "reading legacy p-value file: %s", filename);
+			tallyLegacyFile(state, filename, path);
+		}
+		dbg(DBG_HIGH, "processed all pvalues from pvalue file: %s", filename);
+	}
+	free(path);
+
+	return;
+}
+
+
+/*
+ * readFiles - tally the p_values of the .pvalues files claimed one at a time from a reader
+ *
+ * given:
+ *      arg             // pointer to the struct pval_worker of the thread
+ *
+ * returns:
+ *      NULL
+ */
+static void *
+readFiles(void *arg)
+{
+	struct pval_worker *worker = arg;		// this reading thread
+	struct pval_reader *reader = worker->reader;	// files to read
+	long int i;					// index of the claimed file
+	int ret;					// pthread function return
+
+	for (;;) {
+
+		/*
+		 * Claim the next file
+		 */
+		ret = pthread_mutex_lock(&reader->mutex);
+		if (ret != 0) {
+			errp(243, __func__, "error in pthread_mutex_lock, returned: %d", ret);
+		}
+		i = reader->next;
+		if (i < reader->count) {
+			++reader->next;
+		}
+		ret = pthread_mutex_unlock(&reader->mutex);
+		if (ret != 0) {
+			errp(243, __func__, "error in pthread_mutex_unlock, returned: %d", ret);
+		}
+		if (i >= reader->count) {
+			break;
+		}
+
+		readFile(worker->state, reader->filenames[i]);
+	}
+
+	return NULL;
+}
+
+
+/*
+ * readSketchBins - read the -P 8=bins that a .sketch file was tallied in
+ *
+ * given:
+ *      path            // path of the file
+ *
+ * returns:
+ *      bins of the tally of the first test of the file, or 0 if it is not a readable .sketch file
+ *
+ * Only the header, the first offset table entry and the bins of the first tally are read.  They are not
+ * checked further: readFile() skips the files that fail a check, with a warning.
+ */
+static long int
+readSketchBins(char *path)
+{
+	struct pval_header header;	// header of the file
+	struct pval_entry entry;	// first offset table entry of the file
+	uint64_t offset;		// offset of the bins of the first tally
+	int64_t bins;			// bins of the first tally
+	bool swap;			// true ==> the file was written by a host of the other byte order
+	FILE *file;
+
+	file = fopen(path, "rb");
+	if (file == NULL) {
+		return 0;
+	}
+	if (fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, PVAL_MAGIC, sizeof(PVAL_MAGIC)) != 0 ||
+	    (header.byteOrder != PVAL_BYTE_ORDER && header.byteOrder != swap32(PVAL_BYTE_ORDER))) {
+		fclose(file);
+		return 0;
+	}
+	swap = (header.byteOrder != PVAL_BYTE_ORDER);
+	if ((swap == true ? swap32(header.content) : header.content) != PVAL_CONTENT_SKETCH ||
+	    (swap == true ? swap32(header.testCount) : header.testCount) < 1 ||
+	    fread(&entry, sizeof(entry), 1, file) != 1) {
+		fclose(file);
+		return 0;
+	}
+	offset = (swap == true ? swap64(entry.offset) : entry.offset) + offsetof(struct pval_sketch, bins);
+	if (offset > LONG_MAX || fseek(file, (long int) offset, SEEK_SET) != 0 || fread(&bins, sizeof(bins), 1, file) != 1) {
+		fclose(file);
+		return 0;
+	}
+	fclose(file);
+	if (swap == true) {
+		bins = (int64_t) swap64((uint64_t) bins);
+	}
+
+	return bins < 1 ? 0 : (long int) bins;
+}
+
+
+/*
+ * sketchBins - find the -P 8=bins that the .sketch files under -d pvaluesdir were tallied in
+ *
+ * given:
+ *      state           // run state to test under
+ *
+ * returns:
+ *      bins of the .sketch files, or 0 if there is no readable .sketch file
+ *
+ * All the .sketch files must have been tallied in the same bins, as they cannot be moved to other bins.
+ */
+static long int
+sketchBins(struct state *state)
+{
+	struct Node *current;		// current pvalues filename
+	char *first;			// name of the first readable .sketch file
+	char *path;			// path of the current file
+	size_t length;			// length of the current filename
+	long int bins;			// bins of the first readable .sketch file
+	long int fileBins;		// bins of the current file
+
+	first = NULL;
+	bins = 0;
+	for (current = state->filenames; current != NULL; current = current->next) {
+		length = strlen(current->filename);
+		if (length < sizeof(".sketch") || strcmp(current->filename + length - (sizeof(".sketch") - 1), ".sketch") != 0) {
+			continue;
+		}
+		path = filePathName(state->pvalues_dir, current->filename);
+		fileBins = readSketchBins(path);
+		free(path);
+		if (fileBins == 0) {
+			continue;
+		}
+		if (first == NULL) {
+			first = current->filename;
+			bins = fileBins;
+		} else if (fileBins != bins) {
+			err(242, __func__, "sketch files were tallied in %ld bins (%s) and in %ld bins (%s), "
+			    "write all of them with the same -P 8=bins", bins, first, fileBins, current->filename);
+		}
+	}
+
+	return bins;
+}
+
+
+/*
+ * read_from_p_val_file - tally the p_values of the .pvalues files found under -d pvaluesdir
+ *
+ * given:
+ *      state           // run state to test under
+ *
+ * The files are read by up to state->numberOfThreads threads.  Each thread tallies the files
+ * it reads in a private copy of the run state, whose tallies are merged once all files are read.
+ *
+ * Without -P 8=bins or -O, .sketch files are assessed in the bins they were tallied in.
+ * It is an error when no p_value of the tests of this run could be tallied from the files.
+ */
+void
+read_from_p_val_file(struct state *state)
+{
+	struct pval_reader reader;	// files to read
+	struct pval_worker *workers;	// reading threads
+	struct Node *current;		// current pvalues filename
+	long int threads;		// number of reading threads
+	long int bins;			// bins of the .sketch files, or 0
+	long int tallied;		// number of p_values tallied from all files
+	long int i;
+	int test;
+	int ret;			// pthread function return
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (state == NULL) {
+		err(242, __func__, "state arg was NULL");
+	}
+	if (state->p_valTally == false) {
+		err(242, __func__, "p_values read from .pvalues files must be tallied");
+	}
+	dbg(DBG_LOW, "start of reading pvalue file(s) phase");
+
+	/*
+	 * The p_values of a .sketch file were tallied in the -P 8=bins of the run that wrote it: assess them
+	 * in these bins instead of sqrt(iterations), unless the bins of this run were set
+	 */
+	bins = sketchBins(state);
+	if (bins > 0 && bins != state->tp.uniformity_bins &&
+	    state->uniformityBinsFlag == false && state->legacy_output == false) {
+		warn(__func__, "assessing in the %ld uniformity bins of the sketch files instead of %ld, "
+		     "write them with -P 8=%ld to assess %ld iterations in %ld bins", bins, state->tp.uniformity_bins,
+		     state->tp.uniformity_bins, state->tp.numOfBitStreams, state->tp.uniformity_bins);
+		state->tp.uniformity_bins = bins;
+	}
+
+	/*
+	 * List the files to read
+	 */
+	reader.count = 0;
+	for (current = state->filenames; current != NULL; current = current->next) {
+		if (current->filename == NULL) {
+			err(242, __func__, "current p-value filename is NULL");
+		}
+		++reader.count;
+	}
+	reader.filenames = malloc((size_t) (reader.count + 1) * sizeof(reader.filenames[0]));
+	if (reader.filenames == NULL) {
+		errp(242, __func__, "cannot malloc %ld filenames", reader.count);
+	}
+	for (i = 0, current = state->filenames; current != NULL; ++i, current = current->next) {
+		reader.filenames[i] = current->filename;
+	}
+	reader.next = 0;
+	ret = pthread_mutex_init(&reader.mutex, NULL);
+	if (ret != 0) {
+		errp(242, __func__, "error in pthread_mutex_init, returned: %d", ret);
+	}
+
+	/*
+	 * Use at most one thread per file
+	 */
+	threads = MIN(state->numberOfThreads, reader.count);
+	dbg(DBG_MED, "reading %ld p-value file(s) with %ld thread(s)", reader.count, MAX(threads, 1));
+
+	if (threads <= 1) {
+
+		/*
+		 * Tally the files directly in the run state
+		 */
+		struct pval_worker worker;	// the calling thread
+
+		worker.reader = &reader;
+		worker.state = state;
+		(void) readFiles(&worker);
+
+	} else {
+
+		/*
+		 * Start the reading threads, each with a private copy of the run state without tallies and counts
+		 */
+		workers = calloc((size_t) threads, sizeof(workers[0]));
+		if (workers == NULL) {
+			errp(242, __func__, "cannot calloc %ld reading threads", threads);
+		}
+		for (i = 0; i < threads; i++) {
+			workers[i].reader = &reader;
+			workers[i].state = malloc(sizeof(*workers[i].state));
+			if (workers[i].state == NULL) {
+				errp(242, __func__, "cannot malloc %lu bytes for the state of reading thread %ld",
+				     sizeof(*workers[i].state), i);
+			}
+			*workers[i].state = *state;
+			memset(workers[i].state->tally, 0, sizeof(workers[i].state->tally));
+			memset(workers[i].state->count, 0, sizeof(workers[i].state->count));
+			memset(workers[i].state->valid, 0, sizeof(workers[i].state->valid));
+			memset(workers[i].state->success, 0, sizeof(workers[i].state->success));
+			memset(workers[i].state->failure, 0, sizeof(workers[i].state->failure));
+			memset(workers[i].state->valid_p_val, 0, sizeof(workers[i].state->valid_p_val));
+			ret = pthread_create(&workers[i].thread, NULL, readFiles, &workers[i]);
+			if (ret != 0) {
+				errp(242, __func__, "error in pthread_create of reading thread %ld, returned: %d", i, ret);
+			}
+		}
+
+		/*
+		 * Wait for all files to be read, and merge the tallies and counts of each thread
+		 */
+		for (i = 0; i < threads; i++) {
+			ret = pthread_join(workers[i].thread, NULL);
+			if (ret != 0) {
+				errp(242, __func__, "error in pthread_join of reading thread %ld, returned: %d", i, ret);
+			}
+			for (test = 1; test <= NUMOFTESTS; test++) {
+				state->count[test] += workers[i].state->count[test];
+				state->valid[test] += workers[i].state->valid[test];
+				state->success[test] += workers[i].state->success[test];
+				state->failure[test] += workers[i].state->failure[test];
+				state->valid_p_val[test] += workers[i].state->valid_p_val[test];
+				if (workers[i].state->tally[test] != NULL) {
+					merge_p_val_tally(state, test, workers[i].state->tally[test]);
+					free_p_val_tally(workers[i].state->tally[test]);
+					workers[i].state->tally[test] = NULL;
+				}
+			}
+			free(workers[i].state);
+			workers[i].state = NULL;
+		}
+		free(workers);
+	}
+
+	ret = pthread_mutex_destroy(&reader.mutex);
+	if (ret != 0) {
+		errp(242, __func__, "error in pthread_mutex_destroy, returned: %d", ret);
+	}
+	free(reader.filenames);
+
+	/*
+	 * Assessing no p_value would fail every test
+	 */
+	tallied = 0;
+	for (test = 1; test <= NUMOFTESTS; test++) {
+		if (state->testVector[test] == true && state->tally[test] != NULL) {
+			tallied += state->tally[test]->count;
+		}
+	}
+	if (tallied == 0) {
+		err(242, __func__, "no p-value could be tallied from the p-value and sketch files under: %s",
+		    state->pvalues_dir);
+	}
+
+	dbg(DBG_LOW, "end of reading pvalue file(s) phase\n");
+}
+
+
+/*
+ * checkpointPath - path of the checkpoint file of this job
+ *
+ * given:
+ *      state           // run state to test under
+ *
+ * returns:
+ *      malloced path of workDir/sts.__jobnum__.__iterations__.__bitcount__.checkpoint
+ */
+static char *
+checkpointPath(struct state *state)
+{
+	char *filename;		// name of the checkpoint file
+	char *checkpoint_filepath;	// path of the checkpoint file
+
+	asprintf(&filename, "sts.%04ld.%ld.%ld.checkpoint", state->jobnum, state->tp.numOfBitStreams, state->tp.n);
+	checkpoint_filepath = filePathName(state->workDir, filename);
+	free(filename);
+
+	return checkpoint_filepath;
+}
+
+
+/*
+ * write_checkpoint - write the completed iterations and the results of each test so far to a .checkpoint file (-C)
+ *
+ * given:
+ *      state           // run state to test under
+ *
+ * The file is written as workDir/sts.__jobnum__.__iterations__.__bitcount__.work and renamed to
+ * workDir/sts.__jobnum__.__iterations__.__bitcount__.checkpoint once complete, replacing the previous checkpoint.
+ * See struct pval_progress and struct pval_checkpoint in defs.h for the format of the file.
+ *
+ * NOTE: The caller must make sure that no iteration is being done, so that the results are
+ *       those of exactly the completed iterations.
+ */
+void
+write_checkpoint(struct state *state)
+{
+	struct pval_header header;		// header of the file
+	struct pval_entry entries[NUMOFTESTS];	// offset table of the file
+	struct pval_progress progress;		// completed iterations
+	struct pval_checkpoint checkpoint;	// results of a test
+	struct p_val_tally *tally;		// p_value tally of a test, or NULL if p_values are kept
+	struct dyn_array *p_val;		// p_values of a test, or NULL if tallied
+	struct dyn_array *stats;		// stats of a test, or NULL without -s
+	uint64_t hash;				// hash of the octets written so far
+	uint64_t offset;			// offset of the results of the next test
+	char *work_filepath;
+	FILE *p_val_file;
+	long int i;
+	int testCount;
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (state == NULL) {
+		err(245, __func__, "state arg was NULL");
+	}
+	if (state->checkpoint == NULL) {
+		err(245, __func__, "completed iterations are not tracked, -C was not given");
+	}
+
+	/*
+	 * Build the offset table
+	 */
+	testCount = 0;
+	for (i = 1; i <= NUMOFTESTS; i++) {
+		if (state->testVector[i] == true) {
+			entries[testCount].test = i;
+			entries[testCount].partitionCount = state->partitionCount[i];
+			if (state->p_valTally == true) {
+				entries[testCount].count = get_p_val_tally(state, (int) i)->count;
+			} else {
+				entries[testCount].count = state->p_val[i] == NULL ? 0 : state->p_val[i]->count;
+			}
+			++testCount;
+		}
+	}
+	offset = sizeof(header) + (uint64_t) testCount * sizeof(entries[0]) +
+		 sizeof(progress) + (uint64_t) state->checkpoint->words * sizeof(uint64_t);
+	for (i = 0; i < testCount; i++) {
+		p_val = state->p_valTally == true ? NULL : state->p_val[entries[i].test];
+		stats = state->stats[entries[i].test];
+		tally = state->p_valTally == true ? state->tally[entries[i].test] : NULL;
+		entries[i].offset = offset;
+		offset += sizeof(checkpoint);
+		if (p_val != NULL) {
+			offset += ((uint64_t) p_val->count * p_val->elm_size + sizeof(uint64_t) - 1) / sizeof(uint64_t) *
+				  sizeof(uint64_t);
+		}
+		if (stats != NULL) {
+			offset += ((uint64_t) stats->count * stats->elm_size + sizeof(uint64_t) - 1) / sizeof(uint64_t) *
+				  sizeof(uint64_t);
+		}
+		if (tally != NULL) {
+			offset += (uint64_t) tally->partitionCount * (2 + tally->bins) * sizeof(int64_t);
+		}
+	}
+	initHeader(state, &header, PVAL_CONTENT_CHECKPOINT, testCount, offset);
+
+	/*
+	 * Create and open the working binary file (.work)
+	 */
+	work_filepath = workFilePath(state);
+	p_val_file = fopen(work_filepath, "wb");
+	if (p_val_file == NULL) {
+		errp(245, __func__, "cannot open checkpoint file for writing: %s", work_filepath);
+	}
+
+	/*
+	 * Write the header with a 0 checksum, the offset table, the completed iterations and the results of each test
+	 */
+	hash = FNV_OFFSET_BASIS;
+	writeWords(p_val_file, &hash, &header, sizeof(header), work_filepath);
+	writeWords(p_val_file, &hash, entries, (size_t) testCount * sizeof(entries[0]), work_filepath);
+	progress.completed = state->checkpoint->completed;
+	progress.words = state->checkpoint->words;
+	writeWords(p_val_file, &hash, &progress, sizeof(progress), work_filepath);
+	writeWords(p_val_file, &hash, state->checkpoint->done, (size_t) progress.words * sizeof(uint64_t), work_filepath);
+	for (i = 0; i < testCount; i++) {
+		int test = (int) entries[i].test;
+
+		p_val = state->p_valTally == true ? NULL : state->p_val[test];
+		stats = state->stats[test];
+		tally = state->p_valTally == true ? state->tally[test] : NULL;
+		checkpoint.count = state->count[test];
+		checkpoint.valid = state->valid[test];
+		checkpoint.success = state->success[test];
+		checkpoint.failure = state->failure[test];
+		checkpoint.valid_p_val = state->valid_p_val[test];
+		checkpoint.p_valCount = p_val == NULL ? (state->p_valTally == true ? -1 : 0) : p_val->count;
+		checkpoint.p_valSize = p_val == NULL ? 0 : (int64_t) p_val->elm_size;
+		checkpoint.statsCount = stats == NULL ? -1 : stats->count;
+		checkpoint.statsSize = stats == NULL ? 0 : (int64_t) stats->elm_size;
+		checkpoint.tallied = tally == NULL ? -1 : tally->count;
+		checkpoint.bins = tally == NULL ? 0 : tally->bins;
+		writeWords(p_val_file, &hash, &checkpoint, sizeof(checkpoint), work_filepath);
+		if (p_val != NULL) {
+			writePadded(p_val_file, &hash, p_val->data, (size_t) p_val->count * p_val->elm_size, work_filepath);
+		}
+		if (stats != NULL) {
+			writePadded(p_val_file, &hash, stats->data, (size_t) stats->count * stats->elm_size, work_filepath);
+		}
+		if (tally != NULL) {
+			writeLongs(p_val_file, &hash, tally->sampleCount, tally->partitionCount, work_filepath);
+			writeLongs(p_val_file, &hash, tally->toolow, tally->partitionCount, work_filepath);
+			writeLongs(p_val_file, &hash, tally->freqPerBin, tally->partitionCount * tally->bins, work_filepath);
+		}
+	}
+
+	finishWorkFile(state, p_val_file, &header, hash, work_filepath, "checkpoint");
+	free(work_filepath);
+
+	dbg(DBG_LOW, "wrote checkpoint of %ld completed iterations", state->checkpoint->completed);
+}
+
+
+/*
+ * restoreTest - add the results of a test in a mapped .checkpoint file to the results of the test
+ *
+ * given:
+ *      state           // run state to test under
+ *      filename        // name of the file, for error messages
+ *      base            // address of the mapped file
+ *      size            // size of the mapped file
+ *      entry           // checked offset table entry of the test
+ *
+ * This function does not return if the results of the test cannot be resumed by this run.
+ */
+static void
+restoreTest(struct state *state, char *filename, const void *base, size_t size, struct pval_entry *entry)
+{
+	struct pval_checkpoint checkpoint;	// results of the test
+	struct p_val_tally tally;		// tally of the test in the file
+	struct dyn_array *p_val;		// p_values of the test, or NULL if tallied
+	struct dyn_array *stats;		// stats of the test, or NULL without -s
+	const char *next;			// next array of the test in the file
+	uint64_t p_valOctets;			// padded octets of the p_val array elements
+	uint64_t statsOctets;			// padded octets of the stats array elements
+	uint64_t tallyOctets;			// octets of the tally arrays
+	long int i;
+	int test = (int) entry->test;
+
+	memcpy(&checkpoint, (const char *) base + entry->offset, sizeof(checkpoint));
+	p_val = state->p_valTally == true ? NULL : state->p_val[test];
+	stats = state->stats[test];
+
+	/*
+	 * The results must have been kept as this run keeps them
+	 */
+	if ((checkpoint.p_valCount < 0) != state->p_valTally ||
+	    (p_val != NULL && checkpoint.p_valSize != (int64_t) p_val->elm_size) ||
+	    (p_val == NULL && checkpoint.p_valCount > 0)) {
+		err(247, __func__, "p-values of %s[%d] were %s, resume with the -s and -K flags of the checkpointed run: %s",
+		    state->testNames[test], test, checkpoint.p_valCount < 0 ? "tallied" : "kept", filename);
+	}
+	if ((checkpoint.statsCount < 0) != (stats == NULL) ||
+	    (stats != NULL && checkpoint.statsSize != (int64_t) stats->elm_size)) {
+		err(247, __func__, "stats of %s[%d] were %s, resume with the -s flag of the checkpointed run: %s",
+		    state->testNames[test], test, checkpoint.statsCount < 0 ? "not kept" : "kept", filename);
+	}
+	if (state->p_valTally == true && checkpoint.bins != state->tp.uniformity_bins) {
+		err(247, __func__, "p-values of %s[%d] were tallied in %ld bins, "
+		    "resume with the -P 8=bins of the checkpointed run: %s",
+		    state->testNames[test], test, (long int) checkpoint.bins, filename);
+	}
+
+	/*
+	 * The arrays of the test must be within the file
+	 */
+	p_valOctets = checkpoint.p_valCount <= 0 ? 0 :
+		      ((uint64_t) checkpoint.p_valCount * (uint64_t) checkpoint.p_valSize + sizeof(uint64_t) - 1) /
+		      sizeof(uint64_t) * sizeof(uint64_t);
+	statsOctets = checkpoint.statsCount <= 0 ? 0 :
+		      ((uint64_t) checkpoint.statsCount * (uint64_t) checkpoint.statsSize + sizeof(uint64_t) - 1) /
+		      sizeof(uint64_t) * sizeof(uint64_t);
+	tallyOctets = checkpoint.tallied < 0 ? 0 :
+		      (uint64_t) entry->partitionCount * (uint64_t) (2 + checkpoint.bins) *
+		      sizeof(int64_t);
+	if (checkpoint.p_valCount > (int64_t) size || checkpoint.statsCount > (int64_t) size ||
+	    p_valOctets > size - entry->offset - sizeof(checkpoint) ||
+	    statsOctets > size - entry->offset - sizeof(checkpoint) - p_valOctets ||
+	    tallyOctets > size - entry->offset - sizeof(checkpoint) - p_valOctets - statsOctets) {
+		err(247, __func__, "results of %s[%d] are not within the checkpoint file: %s",
+		    state->testNames[test], test, filename);
+	}
+	next = (const char *) base + entry->offset + sizeof(checkpoint);
+
+	/*
+	 * Restore the kept p_values and stats
+	 */
+	if (checkpoint.p_valCount > 0) {
+		append_array(p_val, (void *) next, (long int) checkpoint.p_valCount);
+	}
+	next += p_valOctets;
+	if (checkpoint.statsCount > 0) {
+		append_array(stats, (void *) next, (long int) checkpoint.statsCount);
+	}
+	next += statsOctets;
+
+	/*
+	 * Restore the tally
+	 */
+	if (checkpoint.tallied >= 0) {
+		tally.partitionCount = (long int) entry->partitionCount;
+		tally.bins = (long int) checkpoint.bins;
+		tally.count = (long int) checkpoint.tallied;
+		tally.sampleCount = calloc((size_t) tally.partitionCount, sizeof(tally.sampleCount[0]));
+		tally.toolow = calloc((size_t) tally.partitionCount, sizeof(tally.toolow[0]));
+		tally.freqPerBin = calloc((size_t) (tally.partitionCount * tally.bins), sizeof(tally.freqPerBin[0]));
+		if (tally.sampleCount == NULL || tally.toolow == NULL || tally.freqPerBin == NULL) {
+			errp(247, __func__, "cannot calloc counters for %ld partitions of %ld bins", tally.partitionCount,
+			     tally.bins);
+		}
+		for (i = 0; i < tally.partitionCount; ++i) {
+			tally.sampleCount[i] = (long int) getWord(next, (uint64_t) i, false);
+			tally.toolow[i] = (long int) getWord(next, (uint64_t) (tally.partitionCount + i), false);
+		}
+		next += 2 * tally.partitionCount * sizeof(int64_t);
+		for (i = 0; i < tally.partitionCount * tally.bins; ++i) {
+			tally.freqPerBin[i] = (long int) getWord(next, (uint64_t) i, false);
+		}
+		merge_p_val_tally(state, test, &tally);
+		free(tally.sampleCount);
+		free(tally.toolow);
+		free(tally.freqPerBin);
+	}
+
+	/*
+	 * Restore the counts
+	 */
+	state->count[test] += (long int) checkpoint.count;
+	state->valid[test] += (long int) checkpoint.valid;
+	state->success[test] += (long int) checkpoint.success;
+	state->failure[test] += (long int) checkpoint.failure;
+	state->valid_p_val[test] += (long int) checkpoint.valid_p_val;
+
+	dbg(DBG_HIGH, "restored %ld iterations of %s[%d] from checkpoint file: %s",
+	    (long int) checkpoint.count, state->testNames[test], test, filename);
+
+	return;
+}
+
+
+/*
+ * read_checkpoint - restore the completed iterations and the results of each test from the .checkpoint file (-r)
+ *
+ * given:
+ *      state           // run state to test under, with no iteration done yet
+ *
+ * returns:
+ *      true ==> the checkpoint was restored,
+ *      false ==> there is no checkpoint file (a warning was issued), all iterations are to be done
+ *
+ * This function does not return if the checkpoint cannot be resumed by this run.
+ */
+bool
+read_checkpoint(struct state *state)
+{
+	struct pval_header header;		// header of the file
+	struct pval_entry entries[NUMOFTESTS];	// offset table of the file
+	struct pval_progress progress;		// completed iterations
+	struct stat buf;			// status of the checkpoint file
+	uint64_t tableEnd;			// offset of the end of the offset table
+	char *checkpoint_filepath;
+	const void *base;			// address of the mapped file
+	size_t size;				// size of the mapped file
+	bool swap;				// true ==> the file was written by a host of the other byte order
+	long int completed;			// number of iterations set in the bitmap
+	long int i;
+	int testCount;
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (state == NULL) {
+		err(246, __func__, "state arg was NULL");
+	}
+	if (state->checkpoint == NULL) {
+		err(246, __func__, "completed iterations are not tracked, -r was not given");
+	}
+
+	/*
+	 * A missing checkpoint means that the run was interrupted before its first checkpoint
+	 */
+	checkpoint_filepath = checkpointPath(state);
+	if (stat(checkpoint_filepath, &buf) < 0 && errno == ENOENT) {
+		warn(__func__, "no checkpoint to resume from, all iterations will be done: %s", checkpoint_filepath);
+		free(checkpoint_filepath);
+		return false;
+	}
+
+	/*
+	 * Map and check the checkpoint file
+	 */
+	base = mapFile(checkpoint_filepath, &size);
+	if (base == NULL) {
+		err(246, __func__, "cannot resume from checkpoint file: %s", checkpoint_filepath);
+	}
+	if (checkHeader(state, checkpoint_filepath, base, size, &header, &swap) == false ||
+	    checkEntries(state, checkpoint_filepath, base, size, &header, entries, swap) == false) {
+		err(246, __func__, "cannot resume from checkpoint file: %s", checkpoint_filepath);
+	}
+	if (header.content != PVAL_CONTENT_CHECKPOINT || swap == true) {
+		err(246, __func__, "not a checkpoint written by this host: %s", checkpoint_filepath);
+	}
+	if (header.jobnum != state->jobnum || header.numOfBitStreams != state->tp.numOfBitStreams ||
+	    header.dataFormat != (uint32_t) state->dataFormat || header.alpha != state->tp.alpha) {
+		err(246, __func__, "checkpoint was written with -j %ld -i %ld -F %c -P 11=%f, "
+		    "which differ from this run: %s", (long int) header.jobnum, (long int) header.numOfBitStreams,
+		    (char) header.dataFormat, header.alpha, checkpoint_filepath);
+	}
+
+	/*
+	 * The checkpointed run must have run the same tests
+	 */
+	testCount = 0;
+	for (i = 1; i <= NUMOFTESTS; i++) {
+		if (state->testVector[i] == true) {
+			++testCount;
+		}
+	}
+	for (i = 0; i < (long int) header.testCount; i++) {
+		if (state->testVector[entries[i].test] == false) {
+			testCount = -1;
+		}
+	}
+	if (testCount != (int) header.testCount) {
+		err(246, __func__, "checkpoint was written for %u tests, resume with the -t flag of the checkpointed run: %s",
+		    header.testCount, checkpoint_filepath);
+	}
+
+	/*
+	 * Restore the completed iterations
+	 */
+	tableEnd = header.headerSize + (uint64_t) header.testCount * sizeof(entries[0]);
+	if (sizeof(progress) > size - tableEnd) {
+		err(246, __func__, "completed iterations are not within the checkpoint file: %s", checkpoint_filepath);
+	}
+	memcpy(&progress, (const char *) base + tableEnd, sizeof(progress));
+	if (progress.words != state->checkpoint->words ||
+	    (uint64_t) progress.words * sizeof(uint64_t) > size - tableEnd - sizeof(progress)) {
+		err(246, __func__, "completed iterations are not within the checkpoint file: %s", checkpoint_filepath);
+	}
+	memcpy(state->checkpoint->done, (const char *) base + tableEnd + sizeof(progress),
+	       (size_t) progress.words * sizeof(uint64_t));
+	completed = 0;
+	for (i = 0; i < state->tp.numOfBitStreams; i++) {
+		if ((state->checkpoint->done[i / 64] & ((uint64_t) 1 << (i % 64))) != 0) {
+			++completed;
+		}
+	}
+	if (completed != progress.completed) {
+		err(246, __func__, "%ld completed iterations are marked, %ld were written in the checkpoint file: %s",
+		    completed, (long int) progress.completed, checkpoint_filepath);
+	}
+	state->checkpoint->completed = completed;
+
+	/*
+	 * Restore the results of each test
+	 */
+	for (i = 0; i < (long int) header.testCount; i++) {
+		restoreTest(state, checkpoint_filepath, base, size, &entries[i]);
+	}
+	unmapFile((void *) base, size);
+
+	msg("Resuming from checkpoint with %ld of %ld iterations completed: %s", completed, state->tp.numOfBitStreams,
+	    checkpoint_filepath);
+	free(checkpoint_filepath);
+
+	return true;
+}
+
+
+/*
+ * remove_checkpoint - remove the .checkpoint file of a run whose results are complete
+ *
+ * given:
+ *      state           // run state to test under
+ */
+void
+remove_checkpoint(struct state *state)
+{
+	char *checkpoint_filepath;
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (state == NULL) {
+		err(245, __func__, "state arg was NULL");
+	}
+
+	checkpoint_filepath = checkpointPath(state);
+	errno = 0;		// paranoia
+	if (unlink(checkpoint_filepath) < 0 && errno != ENOENT) {
+		warnp(__func__, "error in removing checkpoint file: %s", checkpoint_filepath);
+	} else {
+		dbg(DBG_MED, "removed checkpoint file: %s", checkpoint_filepath);
+	}
+	free(checkpoint_filepath);
+}
@@ -0,0 +1,41 @@
+/*****************************************************************************
+ P V A L U E S  F U N C T I O N  P R O T O T Y P E S
+ *****************************************************************************/
+
+
+/*
+ * This code has been heavily modified by the following people:
+ *
+ *      Landon Curt Noll
+ *      Tom Gilgan
+ *      Riccardo Paccagnella
+ *
+ * See the README.md and the initial comment in sts.c for more information.
+ *
+ * WE (THOSE LISTED ABOVE WHO HEAVILY MODIFIED THIS CODE) DISCLAIM ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL WE (THOSE LISTED ABOVE
+ * WHO HEAVILY MODIFIED THIS CODE) BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF
+ * USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ * chongo (Landon Curt Noll, http://www.isthe.com/chongo/index.html) /\oo/\
+ *
+ * Share and enjoy! :-)
+ */
+
+#ifndef PVALUES_H
+#   define PVALUES_H
+
+extern void write_p_val_to_file(struct state *state);
+extern void write_sketch_to_file(struct state *state);
+extern void *build_sketch(struct state *state, size_t *size);
+extern bool merge_sketch(struct state *state, char *name, const void *image, size_t size);
+extern void read_from_p_val_file(struct state *state);
+extern void write_checkpoint(struct state *state);
+extern bool read_checkpoint(struct state *state);
+extern void remove_checkpoint(struct state *state);
+
+#endif				/* PVALUES_H */
@@ -0,0 +1,1042 @@
+// rfft.c
+// Real FFT of power of 2 lengths, for the DFT test when sts is not linked with fftw3 or is in single precision (-D float)
+
+/*
+ * This code has been heavily modified by the following people:
+ *
+ *      Landon Curt Noll
+ *      Tom Gilgan
+ *      Riccardo Paccagnella
+ *
+ * See the README.md and the initial comment in sts.c for more information.
+ *
+ * WE (THOSE LISTED ABOVE WHO HEAVILY MODIFIED THIS CODE) DISCLAIM ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL WE (THOSE LISTED ABOVE
+ * WHO HEAVILY MODIFIED THIS CODE) BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF
+ * USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ * chongo (Landon Curt Noll, http://www.isthe.com/chongo/index.html) /\oo/\
+ *
+ * Share and enjoy! :-)
+ */
+
+
+// Exit codes: 253
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <float.h>
+#include <stdint.h>
+#include "externs.h"
+#include "rfft.h"
+#include "debug.h"
+
+// Use C defined value of PI if available
+#if !defined(M_PI)
+#   define M_PI (3.14159265358979323846264)
+#endif
+
+/*
+ * The squared moduli of rfftf_count_below() that are within RFFTF_NEAR * max_sq of max_sq are computed
+ * again in double precision, by bin_sq() which sums blocks of RFFTF_BYTES times 8 bits.
+ *
+ * On random data, the single precision squared moduli near max_sq differed from the double precision ones
+ * by 1.3 FLT_EPSILON * max_sq rms, and by at most 11.5 FLT_EPSILON * max_sq, at n = 2^24: the band is
+ * more than 5 times wider than the largest difference measured.
+ */
+#define RFFTF_NEAR (64.0 * FLT_EPSILON)
+#define RFFTF_BYTES (8)
+
+
+/*
+ * Forward static function declarations
+ */
+static void first4(long int m, const BitSequence *restrict epsilon, double *restrict yr, double *restrict yi,
+		   const double *restrict tw);
+static void butterflies4(long int s, const double *restrict ar, const double *restrict ai, const double *restrict br,
+			 const double *restrict bi, const double *restrict cr, const double *restrict ci,
+			 const double *restrict dr, const double *restrict di, double *restrict y0r, double *restrict y0i,
+			 double *restrict y1r, double *restrict y1i, double *restrict y2r, double *restrict y2i,
+			 double *restrict y3r, double *restrict y3i, const double w[6]);
+static void radix4(long int m, long int s, const double *xr, const double *xi, double *yr, double *yi,
+		   const double *tw);
+static void radix2(long int s, const double *restrict xr, const double *restrict xi,
+		   double *restrict yr, double *restrict yi);
+static long int split_count_below(long int h, const double *restrict zr, const double *restrict zi,
+				  const double *restrict tr, const double *restrict ti, double max_sq);
+static void first4f(long int m, const BitSequence *restrict epsilon, float *restrict yr, float *restrict yi,
+		    const float *restrict tw);
+static void butterflies4f(long int s, const float *restrict ar, const float *restrict ai, const float *restrict br,
+			  const float *restrict bi, const float *restrict cr, const float *restrict ci,
+			  const float *restrict dr, const float *restrict di, float *restrict y0r, float *restrict y0i,
+			  float *restrict y1r, float *restrict y1i, float *restrict y2r, float *restrict y2i,
+			  float *restrict y3r, float *restrict y3i, const float w[6]);
+static void radix4f(long int m, long int s, const float *xr, const float *xi, float *yr, float *yi, const float *tw);
+static void radix2f(long int s, const float *restrict xr, const float *restrict xi, float *restrict yr, float *restrict yi);
+static float split_sqf(long int h, const float *restrict zr, const float *restrict zi,
+		       const float *restrict tr, const float *restrict ti, long int k);
+static long int split_count_belowf(long int h, const float *restrict zr, const float *restrict zi,
+				   const float *restrict tr, const float *restrict ti, float max_sq, float near_sq,
+				   long int *near);
+static void omega(const struct rfftf_plan *plan, unsigned long int m, double *wr, double *wi);
+static double bin_sq(const struct rfftf_plan *plan, const BitSequence *epsilon, long int k);
+static long int recount_nearf(const struct rfftf_plan *plan, const BitSequence *epsilon, const float *zr,
+			      const float *zi, double max_sq, float max_sqf, float near_sq, long int near);
+
+
+/*
+ * rfft_plan - compute the tables of the real FFT of a power of 2 length
+ *
+ * given:
+ *      n               // length of the real sequences to transform
+ *
+ * returns:
+ *      malloced plan for rfft_count_below(), or NULL if n is not a power of 2 >= 8
+ *
+ * The real sequence of length n is transformed as a complex sequence of length h = n/2, whose real
+ * and imaginary parts are its even and odd terms.  The complex FFT is a Stockham (self-sorting)
+ * FFT of radix 4, with a last radix 2 pass if h is not a power of 4.  Its passes stream over
+ * separate arrays of real and imaginary parts, so that the compiler may vectorize them.
+ */
+struct rfft_plan *
+rfft_plan(long int n)
+{
+	struct rfft_plan *plan;		// plan to return
+	double *tw;			// twiddle factors of the current pass
+	long int len;			// length of the sub-transforms of a pass
+	long int m;			// len / 4
+	long int p;
+	int j;
+
+	/*
+	 * Only power of 2 lengths are transformed
+	 */
+	if (n < 8 || (n & (n - 1)) != 0) {
+		return NULL;
+	}
+
+	/*
+	 * Allocate the plan
+	 */
+	plan = malloc(sizeof(*plan));
+	if (plan == NULL) {
+		errp(253, __func__, "cannot malloc %lu bytes for rfft_plan", sizeof(*plan));
+	}
+	plan->n = n;
+	plan->h = n / 2;
+	plan->tw = malloc((size_t) (2 * plan->h) * sizeof(plan->tw[0]));
+	plan->tr = malloc((size_t) plan->h * sizeof(plan->tr[0]));
+	plan->ti = malloc((size_t) plan->h * sizeof(plan->ti[0]));
+	if (plan->tw == NULL || plan->tr == NULL || plan->ti == NULL) {
+		errp(253, __func__, "cannot malloc 3 tables of %ld doubles", 2 * plan->h);
+	}
+
+	/*
+	 * Compute each twiddle factor directly, so that their errors do not accumulate.
+	 *
+	 * The twiddle factors W^p, W^2p and W^3p of the sub-transforms of each radix 4 pass are
+	 * stored in the order rfft_count_below() reads them: 6 arrays of m = len / 4 doubles per pass.
+	 */
+	tw = plan->tw;
+	for (len = plan->h; len >= 4; len /= 4) {
+		m = len / 4;
+		for (j = 1; j <= 3; j++) {
+			for (p = 0; p < m; p++) {
+				tw[(2 * j - 2) * m + p] = cos(2.0 * M_PI * (double) (j * p) / (double) len);
+				tw[(2 * j - 1) * m + p] = -sin(2.0 * M_PI * (double) (j * p) / (double) len);
+			}
+		}
+		tw += 6 * m;
+	}
+	for (p = 0; p < plan->h; p++) {
+		plan->tr[p] = cos(2.0 * M_PI * (double) p / (double) n);
+		plan->ti[p] = -sin(2.0 * M_PI * (double) p / (double) n);
+	}
+
+	return plan;
+}
+
+
+/*
+ * first4 - first radix 4 pass of the Stockham FFT, which converts the bits of epsilon to +1 and -1
+ *
+ * given:
+ *      m               // h / 4, number of butterflies of the pass
+ *      epsilon         // bitstream, whose even and odd bits are the complex input
+ *      yr, yi          // output of this pass
+ *      tw              // twiddle factors of this pass
+ *
+ * This is radix4() with s == 1, where the loop over the butterflies is the inner one.
+ */
+static void
+first4(long int m, const BitSequence *restrict epsilon, double *restrict yr, double *restrict yi,
+       const double *restrict tw)
+{
+	long int p;
+
+	for (p = 0; p < m; p++) {
+		const double ar = (double) (2 * (int) epsilon[2 * p] - 1);
+		const double ai = (double) (2 * (int) epsilon[2 * p + 1] - 1);
+		const double br = (double) (2 * (int) epsilon[2 * (p + m)] - 1);
+		const double bi = (double) (2 * (int) epsilon[2 * (p + m) + 1] - 1);
+		const double cr = (double) (2 * (int) epsilon[2 * (p + 2 * m)] - 1);
+		const double ci = (double) (2 * (int) epsilon[2 * (p + 2 * m) + 1] - 1);
+		const double dr = (double) (2 * (int) epsilon[2 * (p + 3 * m)] - 1);
+		const double di = (double) (2 * (int) epsilon[2 * (p + 3 * m) + 1] - 1);
+		const double apcr = ar + cr;	// a + c
+		const double apci = ai + ci;
+		const double amcr = ar - cr;	// a - c
+		const double amci = ai - ci;
+		const double bpdr = br + dr;	// b + d
+		const double bpdi = bi + di;
+		const double jbmdr = di - bi;	// i * (b - d)
+		const double jbmdi = br - dr;
+		double tr;
+		double ti;
+
+		yr[4 * p] = apcr + bpdr;
+		yi[4 * p] = apci + bpdi;
+		tr = amcr - jbmdr;
+		ti = amci - jbmdi;
+		yr[4 * p + 1] = tr * tw[p] - ti * tw[m + p];
+		yi[4 * p + 1] = tr * tw[m + p] + ti * tw[p];
+		tr = apcr - bpdr;
+		ti = apci - bpdi;
+		yr[4 * p + 2] = tr * tw[2 * m + p] - ti * tw[3 * m + p];
+		yi[4 * p + 2] = tr * tw[3 * m + p] + ti * tw[2 * m + p];
+		tr = amcr + jbmdr;
+		ti = amci + jbmdi;
+		yr[4 * p + 3] = tr * tw[4 * m + p] - ti * tw[5 * m + p];
+		yi[4 * p + 3] = tr * tw[5 * m + p] + ti * tw[4 * m + p];
+	}
+
+	return;
+}
+
+
+/*
+ * butterflies4 - radix 4 butterflies of the same twiddle factors, over a stride of a pass
+ *
+ * given:
+ *      s               // stride of the sub-transforms of the pass
+ *      ar, ai ... di   // the 4 inputs of the s butterflies
+ *      y0r, y0i ... y3i        // the 4 outputs of the s butterflies
+ *      w               // W^p, W^2p and W^3p as 3 (real, imaginary) pairs
+ *
+ * Each input and output is its own restrict argument, so that the compiler need not check
+ * whether they overlap before it vectorizes the loop.
+ */
+static void
+butterflies4(long int s, const double *restrict ar, const double *restrict ai, const double *restrict br,
+	     const double *restrict bi, const double *restrict cr, const double *restrict ci, const double *restrict dr,
+	     const double *restrict di, double *restrict y0r, double *restrict y0i, double *restrict y1r,
+	     double *restrict y1i, double *restrict y2r, double *restrict y2i, double *restrict y3r, double *restrict y3i,
+	     const double w[6])
+{
+	const double w1r = w[0];	// W^p of the sub-transforms
+	const double w1i = w[1];
+	const double w2r = w[2];	// W^2p
+	const double w2i = w[3];
+	const double w3r = w[4];	// W^3p
+	const double w3i = w[5];
+	long int q;
+
+	for (q = 0; q < s; q++) {
+		const double apcr = ar[q] + cr[q];	// a + c
+		const double apci = ai[q] + ci[q];
+		const double amcr = ar[q] - cr[q];	// a - c
+		const double amci = ai[q] - ci[q];
+		const double bpdr = br[q] + dr[q];	// b + d
+		const double bpdi = bi[q] + di[q];
+		const double jbmdr = di[q] - bi[q];	// i * (b - d)
+		const double jbmdi = br[q] - dr[q];
+		double tr;
+		double ti;
+
+		y0r[q] = apcr + bpdr;
+		y0i[q] = apci + bpdi;
+		tr = amcr - jbmdr;
+		ti = amci - jbmdi;
+		y1r[q] = tr * w1r - ti * w1i;
+		y1i[q] = tr * w1i + ti * w1r;
+		tr = apcr - bpdr;
+		ti = apci - bpdi;
+		y2r[q] = tr * w2r - ti * w2i;
+		y2i[q] = tr * w2i + ti * w2r;
+		tr = amcr + jbmdr;
+		ti = amci + jbmdi;
+		y3r[q] = tr * w3r - ti * w3i;
+		y3i[q] = tr * w3i + ti * w3r;
+	}
+
+	return;
+}
+
+
+/*
+ * radix4 - one radix 4 pass of the Stockham FFT
+ *
+ * given:
+ *      m               // number of butterflies of the sub-transforms of this pass, a quarter of their length
+ *      s               // stride of the sub-transforms of this pass, 4 * m * s == h
+ *      xr, xi          // input of this pass
+ *      yr, yi          // output of this pass
+ *      tw              // twiddle factors of this pass
+ */
+static void
+radix4(long int m, long int s, const double *xr, const double *xi, double *yr, double *yi, const double *tw)
+{
+	double w[6];		// twiddle factors of the butterflies of p
+	long int p;
+
+	for (p = 0; p < m; p++) {
+		w[0] = tw[p];
+		w[1] = tw[m + p];
+		w[2] = tw[2 * m + p];
+		w[3] = tw[3 * m + p];
+		w[4] = tw[4 * m + p];
+		w[5] = tw[5 * m + p];
+		butterflies4(s, xr + s * p, xi + s * p, xr + s * (p + m), xi + s * (p + m),
+			     xr + s * (p + 2 * m), xi + s * (p + 2 * m), xr + s * (p + 3 * m), xi + s * (p + 3 * m),
+			     yr + s * (4 * p), yi + s * (4 * p), yr + s * (4 * p + 1), yi + s * (4 * p + 1),
+			     yr + s * (4 * p + 2), yi + s * (4 * p + 2), yr + s * (4 * p + 3), yi + s * (4 * p + 3), w);
+	}
+
+	return;
+}
+
+
+/*
+ * radix2 - last radix 2 pass of the Stockham FFT, whose sub-transforms have length 2
+ *
+ * given:
+ *      s               // stride of the sub-transforms of this pass, 2 * s == h
+ *      xr, xi          // input of this pass
+ *      yr, yi          // output of this pass
+ */
+static void
+radix2(long int s, const double *restrict xr, const double *restrict xi,
+       double *restrict yr, double *restrict yi)
+{
+	long int q;
+
+	for (q = 0; q < s; q++) {
+		yr[q] = xr[q] + xr[q + s];
+		yi[q] = xi[q] + xi[q + s];
+		yr[q + s] = xr[q] - xr[q + s];
+		yi[q + s] = xi[q] - xi[q + s];
+	}
+
+	return;
+}
+
+
+/*
+ * split_count_below - split the complex FFT into the real FFT, and count its small squared moduli
+ *
+ * given:
+ *      h               // length of the complex FFT
+ *      zr, zi          // complex FFT of the even (real parts) and odd (imaginary parts) terms
+ *      tr, ti          // twiddle factors of length 2*h
+ *      max_sq          // largest squared modulus to count
+ *
+ * returns:
+ *      number of the first h terms of the real FFT whose squared modulus is <= max_sq
+ *
+ * With Z[k] = E[k] + i*O[k], where E and O are the FFTs of the even and odd terms,
+ * X[k] = E[k] + W^k * O[k] for the non-redundant terms of the real FFT.  X[k] is not stored.
+ */
+static long int
+split_count_below(long int h, const double *restrict zr, const double *restrict zi,
+		  const double *restrict tr, const double *restrict ti, double max_sq)
+{
+	long int count = 0;	// squared moduli <= max_sq
+	long int k;
+
+	/*
+	 * The first term is real
+	 */
+	if ((zr[0] + zi[0]) * (zr[0] + zi[0]) <= max_sq) {
+		count++;
+	}
+
+	for (k = 1; k < h; k++) {
+		const double er = 0.5 * (zr[k] + zr[h - k]);	// E[k] = (Z[k] + conj(Z[h-k])) / 2
+		const double ei = 0.5 * (zi[k] - zi[h - k]);
+		const double odr = 0.5 * (zi[k] + zi[h - k]);	// O[k] = (Z[k] - conj(Z[h-k])) / 2i
+		const double odi = -0.5 * (zr[k] - zr[h - k]);
+		const double xr = er + odr * tr[k] - odi * ti[k];
+		const double xi = ei + odr * ti[k] + odi * tr[k];
+
+		if (xr * xr + xi * xi <= max_sq) {
+			count++;
+		}
+	}
+
+	return count;
+}
+
+
+/*
+ * rfft_count_below - count the small moduli of the real FFT of a bitstream
+ *
+ * given:
+ *      plan            // plan of the length of epsilon, from rfft_plan()
+ *      epsilon         // bitstream of plan->n bits, transformed as a sequence of +1 and -1
+ *      work            // work array of 2 * plan->n doubles, private to the calling thread
+ *      max_sq          // largest squared modulus to count
+ *
+ * returns:
+ *      number of the first plan->n / 2 terms of the FFT whose squared modulus is <= max_sq
+ *
+ * The conversion of the bits, the FFT and the count are fused: neither the +1 and -1 sequence nor
+ * its FFT are stored, so that work is the only array of doubles of the calling thread.
+ *
+ * NOTE: The plan is only read, so that threads may share it.
+ */
+long int
+rfft_count_below(struct rfft_plan *plan, const BitSequence *epsilon, double *work, double max_sq)
+{
+	double *xr;		// input of a pass
+	double *xi;
+	double *yr;		// output of a pass
+	double *yi;
+	double *swap;
+	long int h;		// length of the complex FFT
+	long int len;		// length of the sub-transforms of a pass
+	long int s;		// stride of the sub-transforms of a pass
+	const double *tw;	// twiddle factors of a pass
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (plan == NULL) {
+		err(253, __func__, "plan arg is NULL");
+	}
+	if (epsilon == NULL) {
+		err(253, __func__, "epsilon arg is NULL");
+	}
+	if (work == NULL) {
+		err(253, __func__, "work arg is NULL");
+	}
+	h = plan->h;
+	xr = work;
+	xi = work + h;
+	yr = work + 2 * h;
+	yi = work + 3 * h;
+
+	/*
+	 * Transform the even and odd bits, as the real and imaginary parts of a complex sequence,
+	 * with radix 4 passes and a radix 2 pass if needed
+	 */
+	tw = plan->tw;
+	first4(h / 4, epsilon, xr, xi, tw);
+	tw += 6 * (h / 4);
+	for (len = h / 4, s = 4; len >= 4; len /= 4, s *= 4) {
+		radix4(len / 4, s, xr, xi, yr, yi, tw);
+		tw += 6 * (len / 4);
+		swap = xr, xr = yr, yr = swap;
+		swap = xi, xi = yi, yi = swap;
+	}
+	if (len == 2) {
+		radix2(s, xr, xi, yr, yi);
+		swap = xr, xr = yr, yr = swap;
+		swap = xi, xi = yi, yi = swap;
+	}
+
+	/*
+	 * Split it into the real FFT, and count
+	 */
+	return split_count_below(h, xr, xi, plan->tr, plan->ti, max_sq);
+}
+
+
+/*
+ * rfft_destroy - free a plan
+ *
+ * given:
+ *      plan            // plan from rfft_plan(), or NULL
+ */
+void
+rfft_destroy(struct rfft_plan *plan)
+{
+	if (plan == NULL) {
+		return;
+	}
+	free(plan->tw);
+	free(plan->tr);
+	free(plan->ti);
+	free(plan);
+
+	return;
+}
+
+
+/*
+ * rfftf_plan - compute the single precision tables of the real FFT of a power of 2 length
+ *
+ * given:
+ *      n               // length of the bitstreams to transform
+ *
+ * returns:
+ *      malloced plan for rfftf_count_below(), or NULL if n is not a power of 2 >= 8
+ *
+ * The tables are those of rfft_plan(), computed in double precision and rounded to float.  The recount
+ * of the squared moduli near the threshold in double precision has its own tables of W^m = exp(-2*pi*i*m/n),
+ * as products of a coarse and a fine factor, of about 2 * sqrt(n) doubles each.
+ */
+struct rfftf_plan *
+rfftf_plan(long int n)
+{
+	struct rfft_plan *dplan;	// double precision plan to round
+	struct rfftf_plan *plan;	// plan to return
+	long int coarse;		// length of the cr and ci tables
+	long int fine;			// length of the fr and fi tables
+	long int i;
+
+	/*
+	 * Compute the tables in double precision
+	 */
+	dplan = rfft_plan(n);
+	if (dplan == NULL) {
+		return NULL;
+	}
+
+	/*
+	 * Allocate the plan
+	 */
+	plan = malloc(sizeof(*plan));
+	if (plan == NULL) {
+		errp(253, __func__, "cannot malloc %lu bytes for rfftf_plan", sizeof(*plan));
+	}
+	plan->n = n;
+	plan->h = dplan->h;
+	plan->tw = malloc((size_t) (2 * plan->h) * sizeof(plan->tw[0]));
+	plan->tr = malloc((size_t) plan->h * sizeof(plan->tr[0]));
+	plan->ti = malloc((size_t) plan->h * sizeof(plan->ti[0]));
+	if (plan->tw == NULL || plan->tr == NULL || plan->ti == NULL) {
+		errp(253, __func__, "cannot malloc 3 tables of %ld floats", 2 * plan->h);
+	}
+
+	/*
+	 * Round them to float
+	 */
+	for (i = 0; i < 2 * plan->h; i++) {
+		plan->tw[i] = (float) dplan->tw[i];
+	}
+	for (i = 0; i < plan->h; i++) {
+		plan->tr[i] = (float) dplan->tr[i];
+		plan->ti[i] = (float) dplan->ti[i];
+	}
+	rfft_destroy(dplan);
+
+	/*
+	 * Compute the tables of the recount in double precision: W^m = W^(m - f) * W^f, where f is m modulo
+	 * the length of the fine tables, 2^fine_bits with fine_bits = floor(log2(n) / 2)
+	 */
+	plan->near = RFFTF_NEAR;
+	for (plan->fine_bits = 0; (1L << (2 * (plan->fine_bits + 1))) <= n; plan->fine_bits++) {
+	}
+	fine = 1L << plan->fine_bits;
+	coarse = n >> plan->fine_bits;
+	plan->cr = malloc((size_t) coarse * sizeof(plan->cr[0]));
+	plan->ci = malloc((size_t) coarse * sizeof(plan->ci[0]));
+	plan->fr = malloc((size_t) fine * sizeof(plan->fr[0]));
+	plan->fi = malloc((size_t) fine * sizeof(plan->fi[0]));
+	if (plan->cr == NULL || plan->ci == NULL || plan->fr == NULL || plan->fi == NULL) {
+		errp(253, __func__, "cannot malloc 4 tables of %ld doubles", MAX(coarse, fine));
+	}
+	for (i = 0; i < coarse; i++) {
+		plan->cr[i] = cos(2.0 * M_PI * (double) (i * fine) / (double) n);
+		plan->ci[i] = -sin(2.0 * M_PI * (double) (i * fine) / (double) n);
+	}
+	for (i = 0; i < fine; i++) {
+		plan->fr[i] = cos(2.0 * M_PI * (double) i / (double) n);
+		plan->fi[i] = -sin(2.0 * M_PI * (double) i / (double) n);
+	}
+
+	return plan;
+}
+
+
+/*
+ * first4f - first radix 4 pass in single precision, which converts the bits of epsilon to +1 and -1
+ *
+ * given:
+ *      m               // h / 4, number of butterflies of the pass
+ *      epsilon         // bitstream, whose even and odd bits are the complex input
+ *      yr, yi          // output of this pass
+ *      tw              // twiddle factors of this pass
+ */
+static void
+first4f(long int m, const BitSequence *restrict epsilon, float *restrict yr, float *restrict yi,
+	const float *restrict tw)
+{
+	long int p;
+
+	for (p = 0; p < m; p++) {
+		const float ar = (float) (2 * (int) epsilon[2 * p] - 1);
+		const float ai = (float) (2 * (int) epsilon[2 * p + 1] - 1);
+		const float br = (float) (2 * (int) epsilon[2 * (p + m)] - 1);
+		const float bi = (float) (2 * (int) epsilon[2 * (p + m) + 1] - 1);
+		const float cr = (float) (2 * (int) epsilon[2 * (p + 2 * m)] - 1);
+		const float ci = (float) (2 * (int) epsilon[2 * (p + 2 * m) + 1] - 1);
+		const float dr = (float) (2 * (int) epsilon[2 * (p + 3 * m)] - 1);
+		const float di = (float) (2 * (int) epsilon[2 * (p + 3 * m) + 1] - 1);
+		const float apcr = ar + cr;	// a + c
+		const float apci = ai + ci;
+		const float amcr = ar - cr;	// a - c
+		const float amci = ai - ci;
+		const float bpdr = br + dr;	// b + d
+		const float bpdi = bi + di;
+		const float jbmdr = di - bi;	// i * (b - d)
+		const float jbmdi = br - dr;
+		float tr;
+		float ti;
+
+		yr[4 * p] = apcr + bpdr;
+		yi[4 * p] = apci + bpdi;
+		tr = amcr - jbmdr;
+		ti = amci - jbmdi;
+		yr[4 * p + 1] = tr * tw[p] - ti * tw[m + p];
+		yi[4 * p + 1] = tr * tw[m + p] + ti * tw[p];
+		tr = apcr - bpdr;
+		ti = apci - bpdi;
+		yr[4 * p + 2] = tr * tw[2 * m + p] - ti * tw[3 * m + p];
+		yi[4 * p + 2] = tr * tw[3 * m + p] + ti * tw[2 * m + p];
+		tr = amcr + jbmdr;
+		ti = amci + jbmdi;
+		yr[4 * p + 3] = tr * tw[4 * m + p] - ti * tw[5 * m + p];
+		yi[4 * p + 3] = tr * tw[5 * m + p] + ti * tw[4 * m + p];
+	}
+
+	return;
+}
+
+
+/*
+ * butterflies4f - butterflies4() in single precision
+ */
+static void
+butterflies4f(long int s, const float *restrict ar, const float *restrict ai, const float *restrict br,
+	      const float *restrict bi, const float *restrict cr, const float *restrict ci, const float *restrict dr,
+	      const float *restrict di, float *restrict y0r, float *restrict y0i, float *restrict y1r,
+	      float *restrict y1i, float *restrict y2r, float *restrict y2i, float *restrict y3r, float *restrict y3i,
+	      const float w[6])
+{
+	const float w1r = w[0];	// W^p of the sub-transforms
+	const float w1i = w[1];
+	const float w2r = w[2];	// W^2p
+	const float w2i = w[3];
+	const float w3r = w[4];	// W^3p
+	const float w3i = w[5];
+	long int q;
+
+	for (q = 0; q < s; q++) {
+		const float apcr = ar[q] + cr[q];	// a + c
+		const float apci = ai[q] + ci[q];
+		const float amcr = ar[q] - cr[q];	// a - c
+		const float amci = ai[q] - ci[q];
+		const float bpdr = br[q] + dr[q];	// b + d
+		const float bpdi = bi[q] + di[q];
+		const float jbmdr = di[q] - bi[q];	// i * (b - d)
+		const float jbmdi = br[q] - dr[q];
+		float tr;
+		float ti;
+
+		y0r[q] = apcr + bpdr;
+		y0i[q] = apci + bpdi;
+		tr = amcr - jbmdr;
+		ti = amci - jbmdi;
+		y1r[q] = tr * w1r - ti * w1i;
+		y1i[q] = tr * w1i + ti * w1r;
+		tr = apcr - bpdr;
+		ti = apci - bpdi;
+		y2r[q] = tr * w2r - ti * w2i;
+		y2i[q] = tr * w2i + ti * w2r;
+		tr = amcr + jbmdr;
+		ti = amci + jbmdi;
+		y3r[q] = tr * w3r - ti * w3i;
+		y3i[q] = tr * w3i + ti * w3r;
+	}
+
+	return;
+}
+
+
+/*
+ * radix4f - radix4() in single precision
+ */
+static void
+radix4f(long int m, long int s, const float *xr, const float *xi, float *yr, float *yi, const float *tw)
+{
+	float w[6];		// twiddle factors of the butterflies of p
+	long int p;
+
+	for (p = 0; p < m; p++) {
+		w[0] = tw[p];
+		w[1] = tw[m + p];
+		w[2] = tw[2 * m + p];
+		w[3] = tw[3 * m + p];
+		w[4] = tw[4 * m + p];
+		w[5] = tw[5 * m + p];
+		butterflies4f(s, xr + s * p, xi + s * p, xr + s * (p + m), xi + s * (p + m),
+			      xr + s * (p + 2 * m), xi + s * (p + 2 * m), xr + s * (p + 3 * m), xi + s * (p + 3 * m),
+			      yr + s * (4 * p), yi + s * (4 * p), yr + s * (4 * p + 1), yi + s * (4 * p + 1),
+			      yr + s * (4 * p + 2), yi + s * (4 * p + 2), yr + s * (4 * p + 3), yi + s * (4 * p + 3), w);
+	}
+
+	return;
+}
+
+
+/*
+ * radix2f - radix2() in single precision
+ */
+static void
+radix2f(long int s, const float *restrict xr, const float *restrict xi,
+	float *restrict yr, float *restrict yi)
+{
+	long int q;
+
+	for (q = 0; q < s; q++) {
+		yr[q] = xr[q] + xr[q + s];
+		yi[q] = xi[q] + xi[q + s];
+		yr[q + s] = xr[q] - xr[q + s];
+		yi[q + s] = xi[q] - xi[q + s];
+	}
+
+	return;
+}
+
+
+
+/*
+ * split_sqf - squared modulus of a term of the real FFT, split from the complex FFT in single precision
+ *
+ * given:
+ *      h               // length of the complex FFT
+ *      zr, zi          // complex FFT of the even and odd terms
+ *      tr, ti          // twiddle factors that split it
+ *      k               // index of the term, 0 < k < h
+ *
+ * returns:
+ *      squared modulus of the term k of the real FFT, as split_count_below() computes it
+ */
+static float
+split_sqf(long int h, const float *restrict zr, const float *restrict zi,
+	  const float *restrict tr, const float *restrict ti, long int k)
+{
+	const float er = 0.5f * (zr[k] + zr[h - k]);	// E[k] = (Z[k] + conj(Z[h-k])) / 2
+	const float ei = 0.5f * (zi[k] - zi[h - k]);
+	const float odr = 0.5f * (zi[k] + zi[h - k]);	// O[k] = (Z[k] - conj(Z[h-k])) / 2i
+	const float odi = -0.5f * (zr[k] - zr[h - k]);
+	const float xr = er + odr * tr[k] - odi * ti[k];
+	const float xi = ei + odr * ti[k] + odi * tr[k];
+
+	return xr * xr + xi * xi;
+}
+
+
+/*
+ * split_count_belowf - split_count_below() in single precision, which also counts the squared moduli near max_sq
+ *
+ * given:
+ *      h               // length of the complex FFT
+ *      zr, zi          // complex FFT of the even and odd terms
+ *      tr, ti          // twiddle factors that split it
+ *      max_sq          // largest squared modulus to count
+ *      near_sq         // half width of the band around max_sq of the squared moduli to count in *near
+ *      near            // where to return the number of squared moduli within near_sq of max_sq
+ *
+ * returns:
+ *      number of the first h terms of the real FFT whose squared modulus is <= max_sq
+ */
+static long int
+split_count_belowf(long int h, const float *restrict zr, const float *restrict zi,
+		   const float *restrict tr, const float *restrict ti, float max_sq, float near_sq, long int *near)
+{
+	long int count;		// squared moduli <= max_sq
+	long int close;		// squared moduli within near_sq of max_sq
+	float sq;		// squared modulus of a term
+	long int k;
+
+	/*
+	 * The first term is real
+	 */
+	sq = (zr[0] + zi[0]) * (zr[0] + zi[0]);
+	count = (sq <= max_sq);
+	close = (fabsf(sq - max_sq) <= near_sq);
+
+	for (k = 1; k < h; k++) {
+		sq = split_sqf(h, zr, zi, tr, ti, k);
+		count += (sq <= max_sq);
+		close += (fabsf(sq - max_sq) <= near_sq);
+	}
+
+	*near = close;
+	return count;
+}
+
+
+/*
+ * omega - W^m = exp(-2*pi*i*m/n) in double precision, from the tables of the recount
+ *
+ * given:
+ *      plan            // plan from rfftf_plan()
+ *      m               // exponent, < plan->n
+ *      wr, wi          // where to return the real and imaginary parts of W^m
+ */
+static void
+omega(const struct rfftf_plan *plan, unsigned long int m, double *wr, double *wi)
+{
+	const unsigned long int c = m >> plan->fine_bits;	// index of the coarse factor
+	const unsigned long int f = m & ((1UL << plan->fine_bits) - 1);	// index of the fine factor
+
+	*wr = plan->cr[c] * plan->fr[f] - plan->ci[c] * plan->fi[f];
+	*wi = plan->cr[c] * plan->fi[f] + plan->ci[c] * plan->fr[f];
+
+	return;
+}
+
+
+/*
+ * bin_sq - squared modulus of a term of the real FFT of a bitstream, in double precision
+ *
+ * given:
+ *      plan            // plan of the length of epsilon, from rfftf_plan()
+ *      epsilon         // bitstream of plan->n bits, transformed as a sequence of +1 and -1
+ *      k               // index of the term, < plan->n
+ *
+ * returns:
+ *      squared modulus of X[k], the sum of (2 * epsilon[j] - 1) * W^(j*k)
+ *
+ * The term is summed directly, in O(n): W^(j*k) is W^(b*k) for the first bit b of the block of
+ * j, times W^(r*k) for r = j - b, which is the same for all the blocks.  The sum of the
+ * (2 * epsilon[b + r] - 1) * W^(r*k) of each 8 bits of a block is looked up in a table of 256 sums,
+ * indexed by those 8 bits, so that a block of RFFTF_BYTES times 8 bits takes RFFTF_BYTES lookups.
+ */
+static double
+bin_sq(const struct rfftf_plan *plan, const BitSequence *epsilon, long int k)
+{
+	double sumr[RFFTF_BYTES][256];	// sums of +-W^(r*k) of the 8 bits of each byte of a block
+	double sumi[RFFTF_BYTES][256];
+	const unsigned long int mask = (unsigned long int) plan->n - 1;	// exponents of W are modulo n
+	const long int bytes = MIN(plan->n / 8, RFFTF_BYTES);	// bytes of 8 bits per block
+	double xr = 0.0;		// X[k]
+	double xi = 0.0;
+	double sr;			// sum of the current block, to multiply by W^(b*k)
+	double si;
+	double wr;			// W^(r*k) or W^(b*k)
+	double wi;
+	uint64_t bits;			// 8 bits of epsilon, one per octet
+	unsigned int v;			// the same 8 bits, as an index of the tables
+	long int b;
+	long int q;
+	long int r;
+
+	/*
+	 * Sum the +-W^(r*k) of each value of the 8 bits of each byte of a block: starting with all
+	 * the bits 0, setting bit r adds 2 * W^(r*k) to the sum
+	 */
+	for (q = 0; q < bytes; q++) {
+		sumr[q][0] = 0.0;
+		sumi[q][0] = 0.0;
+		for (r = 0; r < 8; r++) {
+			omega(plan, ((unsigned long int) (8 * q + r) * (unsigned long int) k) & mask, &wr, &wi);
+			sumr[q][0] -= wr;
+			sumi[q][0] -= wi;
+		}
+		for (r = 0; r < 8; r++) {
+			omega(plan, ((unsigned long int) (8 * q + r) * (unsigned long int) k) & mask, &wr, &wi);
+			for (v = 0; v < (1U << r); v++) {
+				sumr[q][v | (1U << r)] = sumr[q][v] + 2.0 * wr;
+				sumi[q][v | (1U << r)] = sumi[q][v] + 2.0 * wi;
+			}
+		}
+	}
+
+	/*
+	 * Sum the blocks
+	 */
+	for (b = 0; b < plan->n; b += 8 * bytes) {
+		sr = 0.0;
+		si = 0.0;
+		for (q = 0; q < bytes; q++) {
+			const BitSequence *e = epsilon + b + 8 * q;
+
+			/*
+			 * Gather the bit of each octet into bit r of v: the product puts e[r] in bit 56 + r
+			 */
+			bits = (uint64_t) e[0] | (uint64_t) e[1] << 8 | (uint64_t) e[2] << 16 | (uint64_t) e[3] << 24 |
+			       (uint64_t) e[4] << 32 | (uint64_t) e[5] << 40 | (uint64_t) e[6] << 48 | (uint64_t) e[7] << 56;
+			v = (unsigned int) ((bits * UINT64_C(0x0102040810204080)) >> 56);
+			sr += sumr[q][v];
+			si += sumi[q][v];
+		}
+		omega(plan, ((unsigned long int) b * (unsigned long int) k) & mask, &wr, &wi);
+		xr += sr * wr - si * wi;
+		xi += sr * wi + si * wr;
+	}
+
+	return xr * xr + xi * xi;
+}
+
+
+/*
+ * recount_nearf - recount in double precision the squared moduli near the threshold
+ *
+ * given:
+ *      plan            // plan of the length of epsilon, from rfftf_plan()
+ *      epsilon         // bitstream of plan->n bits, transformed as a sequence of +1 and -1
+ *      zr, zi          // complex FFT of the even and odd bits, in single precision
+ *      max_sq          // largest squared modulus to count
+ *      max_sqf         // max_sq rounded to float, as counted by split_count_belowf()
+ *      near_sq         // half width of the band around max_sqf to recount
+ *      near            // number of squared moduli in that band, from split_count_belowf()
+ *
+ * returns:
+ *      the change of the count of split_count_belowf() when the squared moduli of the band are
+ *      computed, and compared to max_sq, in double precision
+ */
+static long int
+recount_nearf(const struct rfftf_plan *plan, const BitSequence *epsilon, const float *zr,
+	      const float *zi, double max_sq, float max_sqf, float near_sq, long int near)
+{
+	long int change = 0;	// change of the count
+	float sq;		// squared modulus of a term, in single precision
+	long int k;
+
+	for (k = 0; near > 0 && k < plan->h; k++) {
+		if (k == 0) {
+			sq = (zr[0] + zi[0]) * (zr[0] + zi[0]);
+		} else {
+			sq = split_sqf(plan->h, zr, zi, plan->tr, plan->ti, k);
+		}
+		if (fabsf(sq - max_sqf) <= near_sq) {
+			change += (bin_sq(plan, epsilon, k) <= max_sq) - (sq <= max_sqf);
+			near--;
+		}
+	}
+
+	return change;
+}
+
+
+/*
+ * rfftf_count_below - count the small moduli of the real FFT of a bitstream, in single precision
+ *
+ * given:
+ *      plan            // plan of the length of epsilon, from rfftf_plan()
+ *      epsilon         // bitstream of plan->n bits, transformed as a sequence of +1 and -1
+ *      work            // work array of 2 * plan->n floats, private to the calling thread
+ *      max_sq          // largest squared modulus to count, in double precision
+ *
+ * returns:
+ *      number of the first plan->n / 2 terms of the FFT whose squared modulus is <= max_sq
+ *
+ * The conversion of the bits, the FFT and the count are fused: neither the +1 and -1 sequence nor
+ * its FFT are stored.
+ *
+ * The squared moduli within plan->near * max_sq of max_sq, which single precision may put on the
+ * wrong side of it, are computed again in double precision by bin_sq(), so that the count is the
+ * one of the double precision FFT.
+ *
+ * NOTE: The plan is only read, so that threads may share it.
+ */
+long int
+rfftf_count_below(struct rfftf_plan *plan, const BitSequence *epsilon, float *work, double max_sq)
+{
+	float *xr;		// input of a pass
+	float *xi;
+	float *yr;		// output of a pass
+	float *yi;
+	float *swap;
+	long int h;		// length of the complex FFT
+	long int len;		// length of the sub-transforms of a pass
+	long int s;		// stride of the sub-transforms of a pass
+	const float *tw;	// twiddle factors of a pass
+	float max_sqf;		// max_sq in single precision
+	float near_sq;		// half width of the band around max_sqf that is recounted in double precision
+	long int count;		// squared moduli <= max_sq
+	long int near;		// squared moduli within near_sq of max_sqf
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (plan == NULL) {
+		err(253, __func__, "plan arg is NULL");
+	}
+	if (epsilon == NULL) {
+		err(253, __func__, "epsilon arg is NULL");
+	}
+	if (work == NULL) {
+		err(253, __func__, "work arg is NULL");
+	}
+	h = plan->h;
+	max_sqf = (float) max_sq;
+	near_sq = (float) (plan->near * max_sq);
+	xr = work;
+	xi = work + h;
+	yr = work + 2 * h;
+	yi = work + 3 * h;
+
+	/*
+	 * Transform the even and odd bits, as the real and imaginary parts of a complex sequence,
+	 * with radix 4 passes and a radix 2 pass if needed
+	 */
+	tw = plan->tw;
+	first4f(h / 4, epsilon, xr, xi, tw);
+	tw += 6 * (h / 4);
+	for (len = h / 4, s = 4; len >= 4; len /= 4, s *= 4) {
+		radix4f(len / 4, s, xr, xi, yr, yi, tw);
+		tw += 6 * (len / 4);
+		swap = xr, xr = yr, yr = swap;
+		swap = xi, xi = yi, yi = swap;
+	}
+	if (len == 2) {
+		radix2f(s, xr, xi, yr, yi);
+		swap = xr, xr = yr, yr = swap;
+		swap = xi, xi = yi, yi = swap;
+	}
+
+	/*
+	 * Split it into the real FFT, and count, in double precision near max_sq
+	 */
+	count = split_count_belowf(h, xr, xi, plan->tr, plan->ti, max_sqf, near_sq, &near);
+	if (near > 0) {
+		count += recount_nearf(plan, epsilon, xr, xi, max_sq, max_sqf, near_sq, near);
+	}
+
+	return count;
+}
+
+
+/*
+ * rfftf_destroy - free a single precision plan
+ *
+ * given:
+ *      plan            // plan from rfftf_plan(), or NULL
+ */
+void
+rfftf_destroy(struct rfftf_plan *plan)
+{
+	if (plan == NULL) {
+		return;
+	}
+	free(plan->tw);
+	free(plan->tr);
+	free(plan->ti);
+	free(plan->cr);
+	free(plan->ci);
+	free(plan->fr);
+	free(plan->fi);
+	free(plan);
+
+	return;
+}
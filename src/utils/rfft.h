@@ -0,0 +1,69 @@
+/*
+ * In-tree real FFT of power of 2 lengths used by sts instead of the OggSQUISH functions, and in single precision
+ */
+
+/*
+ * This code has been heavily modified by the following people:
+ *
+ *      Landon Curt Noll
+ *      Tom Gilgan
+ *      Riccardo Paccagnella
+ *
+ * See the README.md and the initial comment in sts.c for more information.
+ *
+ * WE (THOSE LISTED ABOVE WHO HEAVILY MODIFIED THIS CODE) DISCLAIM ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL WE (THOSE LISTED ABOVE
+ * WHO HEAVILY MODIFIED THIS CODE) BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF
+ * USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ * chongo (Landon Curt Noll, http://www.isthe.com/chongo/index.html) /\oo/\
+ *
+ * Share and enjoy! :-)
+ */
+
+#ifndef RFFT_H
+#   define RFFT_H
+
+#include "../utils/defs.h"
+
+/*
+ * Tables of a power of 2 real FFT, shared read-only by the threads that transform
+ */
+struct rfft_plan {
+	long int n;		// Length of the real sequences, a power of 2 >= 8
+	long int h;		// n / 2, length of the complex FFT of the even and odd terms
+	double *tw;		// Twiddle factors of the radix 4 passes of the complex FFT, < 2*h doubles
+	double *tr;		// cos(2*pi*k/n) for k < h: twiddle factors that split the complex FFT
+	double *ti;		// -sin(2*pi*k/n) for k < h
+};
+
+/*
+ * Single precision tables of a power of 2 real FFT, and the double precision ones of its recount,
+ * see rfftf_count_below()
+ */
+struct rfftf_plan {
+	long int n;		// Length of the bitstreams, a power of 2 >= 8
+	long int h;		// n / 2, length of the complex FFT of the even and odd terms
+	float *tw;		// Twiddle factors of the radix 4 passes of the complex FFT, < 2*h floats
+	float *tr;		// cos(2*pi*k/n) for k < h: twiddle factors that split the complex FFT
+	float *ti;		// -sin(2*pi*k/n) for k < h
+	double near;		// Half width of the band of squared moduli recounted in double, relative to max_sq
+	int fine_bits;		// log2 of the length of fr and fi
+	double *cr;		// cos(2*pi*m/n) for the multiples m of 2^fine_bits: coarse factors of the recount
+	double *ci;		// -sin(2*pi*m/n) for those m
+	double *fr;		// cos(2*pi*m/n) for m < 2^fine_bits: fine factors of the recount
+	double *fi;		// -sin(2*pi*m/n) for m < 2^fine_bits
+};
+
+extern struct rfft_plan *rfft_plan(long int n);
+extern long int rfft_count_below(struct rfft_plan *plan, const BitSequence *epsilon, double *work, double max_sq);
+extern void rfft_destroy(struct rfft_plan *plan);
+extern struct rfftf_plan *rfftf_plan(long int n);
+extern long int rfftf_count_below(struct rfftf_plan *plan, const BitSequence *epsilon, float *work, double max_sq);
+extern void rfftf_destroy(struct rfftf_plan *plan);
+
+#endif				/* RFFT_H */
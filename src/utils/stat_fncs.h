@@ -66,6 +66,24 @@ extern void RandomExcursionsVariant_iterate(struct thread_state *thread_state);
 extern void LinearComplexity_iterate(struct thread_state *thread_state);
 extern void Serial_iterate(struct thread_state *thread_state);
 
+/*
+ * stream functions, the Discrete Fourier Transform test cannot be streamed
+ */
+extern void Frequency_stream(struct thread_state *thread_state, long int first, long int count);
+extern void BlockFrequency_stream(struct thread_state *thread_state, long int first, long int count);
+extern void CumulativeSums_stream(struct thread_state *thread_state, long int first, long int count);
+extern void Runs_stream(struct thread_state *thread_state, long int first, long int count);
+extern void LongestRunOfOnes_stream(struct thread_state *thread_state, long int first, long int count);
+extern void Rank_stream(struct thread_state *thread_state, long int first, long int count);
+extern void NonOverlappingTemplateMatchings_stream(struct thread_state *thread_state, long int first, long int count);
+extern void OverlappingTemplateMatchings_stream(struct thread_state *thread_state, long int first, long int count);
+extern void Universal_stream(struct thread_state *thread_state, long int first, long int count);
+extern void ApproximateEntropy_stream(struct thread_state *thread_state, long int first, long int count);
+extern void RandomExcursions_stream(struct thread_state *thread_state, long int first, long int count);
+extern void RandomExcursionsVariant_stream(struct thread_state *thread_state, long int first, long int count);
+extern void LinearComplexity_stream(struct thread_state *thread_state, long int first, long int count);
+extern void Serial_stream(struct thread_state *thread_state, long int first, long int count);
+
 /*
  * Print functions
  */
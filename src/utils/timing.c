@@ -0,0 +1,567 @@
+// timing.c
+// Account for the time spent by each test, phase and thread
+
+/*
+ * This code has been heavily modified by the following people:
+ *
+ *      Landon Curt Noll
+ *      Tom Gilgan
+ *      Riccardo Paccagnella
+ *
+ * See the README.md and the initial comment in sts.c for more information.
+ *
+ * WE (THOSE LISTED ABOVE WHO HEAVILY MODIFIED THIS CODE) DISCLAIM ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL WE (THOSE LISTED ABOVE
+ * WHO HEAVILY MODIFIED THIS CODE) BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF
+ * USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ * chongo (Landon Curt Noll, http://www.isthe.com/chongo/index.html) /\oo/\
+ *
+ * Share and enjoy! :-)
+ */
+
+
+// Exit codes: 85 thru 89
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include "externs.h"
+#include "utilities.h"
+#include "timing.h"
+#include "debug.h"
+
+
+/*
+ * Names of each enum timing_phase
+ */
+static const char *const phaseName[NUMOFPHASES] = {
+	"init",
+	"iterate",
+	"print",
+	"metrics",
+};
+
+
+/*
+ * Forward static function declarations
+ */
+static double elapsed(struct timespec *start, struct timespec *end);
+static void sumIterate(struct state *state, long int test, struct phase_time *sum);
+static void sumThread(struct state *state, long int thread, struct phase_time *sum);
+static void printRow(char const *name, char const *phase, struct phase_time *phase_time);
+static void writeJSON(struct state *state, double runWall, double runCPU);
+static void writePhaseJSON(FILE *stream, char const *key, struct phase_time *phase_time, char const *end);
+
+
+/*
+ * initTiming - start accounting for time spent, if -R timing was given
+ *
+ * given:
+ *      state           // run state to test under
+ *
+ * This function must be called before any test is initialized, and after the number of threads is known.
+ */
+void
+initTiming(struct state *state)
+{
+	struct timing *timing;	// Time accounted to each test, phase and thread
+	long int i;
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (state == NULL) {
+		err(85, __func__, "state arg is NULL");
+	}
+	if (state->timingFormat == TIMING_NONE) {
+		return;
+	}
+
+	/*
+	 * Allocate zeroized timing
+	 */
+	timing = calloc(1, sizeof(*timing));
+	if (timing == NULL) {
+		errp(85, __func__, "cannot calloc timing of %lu bytes", sizeof(*timing));
+	}
+	timing->numberOfThreads = MAX(1, state->numberOfThreads);
+	timing->iterate = malloc(timing->numberOfThreads * sizeof(timing->iterate[0]));
+	if (timing->iterate == NULL) {
+		errp(85, __func__, "cannot malloc for iterate: %ld elements of %lu bytes each", timing->numberOfThreads,
+		     sizeof(timing->iterate[0]));
+	}
+	for (i = 0; i < timing->numberOfThreads; i++) {
+		timing->iterate[i] = calloc(NUMOFTESTS + 1, sizeof(timing->iterate[i][0]));
+		if (timing->iterate[i] == NULL) {
+			errp(85, __func__, "cannot calloc of %d elements of %lu bytes each for iterate[%ld]",
+			     NUMOFTESTS + 1, sizeof(timing->iterate[i][0]), i);
+		}
+	}
+	timing->read = calloc((size_t) timing->numberOfThreads, sizeof(timing->read[0]));
+	if (timing->read == NULL) {
+		errp(85, __func__, "cannot calloc of %ld elements of %lu bytes each for read",
+		     timing->numberOfThreads, sizeof(timing->read[0]));
+	}
+	timing->parse = calloc((size_t) timing->numberOfThreads, sizeof(timing->parse[0]));
+	if (timing->parse == NULL) {
+		errp(85, __func__, "cannot calloc of %ld elements of %lu bytes each for parse",
+		     timing->numberOfThreads, sizeof(timing->parse[0]));
+	}
+
+	/*
+	 * Note when the run started
+	 */
+	clock_gettime(CLOCK_MONOTONIC, &timing->runWall);
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &timing->runCPU);
+	state->timing = timing;
+	return;
+}
+
+
+/*
+ * startTimer - note the start of a timed section of code
+ *
+ * given:
+ *      start           // where to note the wall clock and CPU time of the calling thread
+ */
+void
+startTimer(struct timestamp *start)
+{
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (start == NULL) {
+		err(86, __func__, "start arg is NULL");
+	}
+
+	/*
+	 * Read the clocks
+	 */
+	clock_gettime(CLOCK_MONOTONIC, &start->wall);
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &start->cpu);
+	return;
+}
+
+
+/*
+ * stopTimer - account for the time spent since startTimer()
+ *
+ * given:
+ *      start           // as noted by startTimer() in the same thread
+ *      phase_time      // where to add the time spent
+ *      bits            // number of bits processed since startTimer()
+ *
+ * NOTE: phase_time must not be updated by any other thread at the same time.
+ */
+void
+stopTimer(struct timestamp *start, struct phase_time *phase_time, long int bits)
+{
+	struct timestamp now;	// Clocks at the end of the timed section
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (start == NULL) {
+		err(86, __func__, "start arg is NULL");
+	}
+	if (phase_time == NULL) {
+		err(86, __func__, "phase_time arg is NULL");
+	}
+
+	/*
+	 * Account for the time spent
+	 */
+	startTimer(&now);
+	phase_time->wall += elapsed(&start->wall, &now.wall);
+	phase_time->cpu += elapsed(&start->cpu, &now.cpu);
+	phase_time->calls++;
+	phase_time->bits += bits;
+	return;
+}
+
+
+/*
+ * elapsed - seconds between two times
+ */
+static double
+elapsed(struct timespec *start, struct timespec *end)
+{
+	return (double) (end->tv_sec - start->tv_sec) + (double) (end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+
+/*
+ * sumIterate - sum the iterate time of a test over all threads
+ *
+ * given:
+ *      state           // run state to test under
+ *      test            // test number
+ *      sum             // where to store the sum
+ */
+static void
+sumIterate(struct state *state, long int test, struct phase_time *sum)
+{
+	long int i;
+
+	memset(sum, 0, sizeof(*sum));
+	for (i = 0; i < state->timing->numberOfThreads; i++) {
+		sum->wall += state->timing->iterate[i][test].wall;
+		sum->cpu += state->timing->iterate[i][test].cpu;
+		sum->calls += state->timing->iterate[i][test].calls;
+		sum->bits += state->timing->iterate[i][test].bits;
+	}
+	return;
+}
+
+
+/*
+ * sumThread - sum the iterate time of all tests done by a thread
+ *
+ * given:
+ *      state           // run state to test under
+ *      thread          // thread number
+ *      sum             // where to store the sum
+ *
+ * The calls of the sum are the iterations done by the thread.
+ */
+static void
+sumThread(struct state *state, long int thread, struct phase_time *sum)
+{
+	long int i;
+
+	memset(sum, 0, sizeof(*sum));
+	for (i = 1; i <= NUMOFTESTS; i++) {
+		sum->wall += state->timing->iterate[thread][i].wall;
+		sum->cpu += state->timing->iterate[thread][i].cpu;
+	}
+	sum->calls = state->timing->parse[thread].calls;
+	sum->bits = sum->calls * state->tp.n;
+	return;
+}
+
+
+/*
+ * printRow - print the time accounted to one phase on stderr
+ */
+static void
+printRow(char const *name, char const *phase, struct phase_time *phase_time)
+{
+	if (phase_time->bits > 0 && phase_time->wall > 0.0) {
+		msg("    %-24s %-8s %10ld %14.6f %14.6f %16.1f", name, phase, phase_time->calls, phase_time->wall,
+		    phase_time->cpu, (double) phase_time->bits / phase_time->wall);
+	} else {
+		msg("    %-24s %-8s %10ld %14.6f %14.6f %16s", name, phase, phase_time->calls, phase_time->wall,
+		    phase_time->cpu, "-");
+	}
+	return;
+}
+
+
+/*
+ * reportTiming - report the time spent by each test, phase and thread
+ *
+ * given:
+ *      state           // run state to test under
+ *
+ * The report is printed on stderr.  Under -R json, it is also written to workDir/timing.json.
+ *
+ * Iterate time of a test is summed over all threads.  The bits/second of a phase are the
+ * bits it processed divided by its wall clock time: for iterate, this is the rate at which
+ * a single thread running only that test would go.
+ */
+void
+reportTiming(struct state *state)
+{
+	struct timing *timing;		// Time accounted to each test, phase and thread
+	struct timespec now;		// Wall clock or CPU time at the end of the run
+	struct phase_time sum;		// Time summed over threads or tests
+	struct phase_time readSum;	// Read time summed over all threads
+	struct phase_time parseSum;	// Parse time summed over all threads
+	char name[BUFSIZ + 1];		// Thread name
+	double runWall;			// Wall clock seconds of the whole run
+	double runCPU;			// Process CPU seconds of the whole run
+	long int runBits;		// Bits tested by the whole run
+	long int i;
+	int j;
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (state == NULL) {
+		err(87, __func__, "state arg is NULL");
+	}
+	timing = state->timing;
+	if (timing == NULL) {
+		return;
+	}
+
+	/*
+	 * Fold the iterate time of each test over all threads
+	 */
+	for (i = 1; i <= NUMOFTESTS; i++) {
+		sumIterate(state, i, &timing->phase[i][PHASE_ITERATE]);
+	}
+
+	/*
+	 * Report the whole run
+	 */
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	runWall = elapsed(&timing->runWall, &now);
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+	runCPU = elapsed(&timing->runCPU, &now);
+	runBits = (state->runMode == MODE_ASSESS_ONLY) ? 0 : state->tp.numOfBitStreams * state->tp.n;
+	msg("Timing of %ld iterations of %ld bits with %ld threads: wall %.6f s, cpu %.6f s", state->tp.numOfBitStreams,
+	    state->tp.n, state->numberOfThreads, runWall, runCPU);
+	if (runBits > 0 && runWall > 0.0) {
+		msg("    overall throughput: %.1f bits/second", (double) runBits / runWall);
+	}
+
+	/*
+	 * Report each test and phase
+	 */
+	msg("    %-24s %-8s %10s %14s %14s %16s", "test", "phase", "calls", "wall s", "cpu s", "bits/s");
+	for (i = 1; i <= NUMOFTESTS; i++) {
+		if (state->testVector[i] != true) {
+			continue;
+		}
+		for (j = 0; j < NUMOFPHASES; j++) {
+			if (timing->phase[i][j].calls > 0) {
+				printRow(state->testNames[i], phaseName[j], &timing->phase[i][j]);
+			}
+		}
+	}
+
+	/*
+	 * Report input parsing and each thread
+	 */
+	memset(&readSum, 0, sizeof(readSum));
+	memset(&parseSum, 0, sizeof(parseSum));
+	for (i = 0; i < timing->numberOfThreads; i++) {
+		readSum.wall += timing->read[i].wall;
+		readSum.cpu += timing->read[i].cpu;
+		readSum.calls += timing->read[i].calls;
+		readSum.bits += timing->read[i].bits;
+		parseSum.wall += timing->parse[i].wall;
+		parseSum.cpu += timing->parse[i].cpu;
+		parseSum.calls += timing->parse[i].calls;
+		parseSum.bits += timing->parse[i].bits;
+	}
+	if (readSum.calls > 0) {
+		printRow("input", "read", &readSum);
+		printRow("input", "parse", &parseSum);
+		for (i = 0; i < timing->numberOfThreads; i++) {
+			snprintf(name, BUFSIZ, "thread %ld", i);
+			name[BUFSIZ] = '\0';	// paranoia
+			printRow(name, "read", &timing->read[i]);
+			printRow(name, "parse", &timing->parse[i]);
+			sumThread(state, i, &sum);
+			printRow(name, "iterate", &sum);
+		}
+	}
+
+	/*
+	 * Also write the report as JSON if requested
+	 */
+	if (state->timingFormat == TIMING_JSON) {
+		writeJSON(state, runWall, runCPU);
+	}
+	return;
+}
+
+
+/*
+ * writePhaseJSON - write the time accounted to one phase as a JSON member
+ */
+static void
+writePhaseJSON(FILE *stream, char const *key, struct phase_time *phase_time, char const *end)
+{
+	int io_ret;		// I/O return status
+
+	if (phase_time->bits > 0 && phase_time->wall > 0.0) {
+		io_ret = fprintf(stream, "\"%s\": {\"calls\": %ld, \"wall\": %.9f, \"cpu\": %.9f, \"bits\": %ld, "
+				 "\"bits_per_second\": %.1f}%s", key, phase_time->calls, phase_time->wall, phase_time->cpu,
+				 phase_time->bits, (double) phase_time->bits / phase_time->wall, end);
+	} else {
+		io_ret = fprintf(stream, "\"%s\": {\"calls\": %ld, \"wall\": %.9f, \"cpu\": %.9f, \"bits\": %ld, "
+				 "\"bits_per_second\": null}%s", key, phase_time->calls, phase_time->wall, phase_time->cpu,
+				 phase_time->bits, end);
+	}
+	if (io_ret <= 0) {
+		errp(88, __func__, "error in writing timing JSON");
+	}
+	return;
+}
+
+
+/*
+ * writeJSON - write the timing report to workDir/timing.json
+ *
+ * given:
+ *      state           // run state to test under
+ *      runWall         // wall clock seconds of the whole run
+ *      runCPU          // process CPU seconds of the whole run
+ */
+static void
+writeJSON(struct state *state, double runWall, double runCPU)
+{
+	struct timing *timing;	// Time accounted to each test, phase and thread
+	char *path;		// Path of timing.json
+	FILE *stream;		// Open timing.json
+	bool first = true;	// true ==> no test written yet
+	int io_ret;		// I/O return status
+	long int i;
+	long int t;
+	int j;
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (state == NULL) {
+		err(88, __func__, "state arg is NULL");
+	}
+	timing = state->timing;
+	if (timing == NULL) {
+		err(88, __func__, "state->timing is NULL");
+	}
+
+	/*
+	 * Open timing.json
+	 */
+	path = filePathName(state->workDir, "timing.json");
+	dbg(DBG_MED, "Will write timing report to: %s", path);
+	errno = 0;		// paranoia
+	stream = fopen(path, "w");
+	if (stream == NULL) {
+		errp(88, __func__, "cannot open for writing: %s", path);
+	}
+
+	/*
+	 * Write the run
+	 */
+	io_ret = fprintf(stream, "{\n  \"version\": \"%s\",\n  \"bitcount\": %ld,\n  \"iterations\": %ld,\n"
+			 "  \"threads\": %ld,\n  \"wall\": %.9f,\n  \"cpu\": %.9f,\n  \"tests\": [",
+			 version, state->tp.n, state->tp.numOfBitStreams, state->numberOfThreads, runWall, runCPU);
+	if (io_ret <= 0) {
+		errp(88, __func__, "error in writing to %s", path);
+	}
+
+	/*
+	 * Write each test, with the iterate time of each thread
+	 */
+	for (i = 1; i <= NUMOFTESTS; i++) {
+		if (state->testVector[i] != true) {
+			continue;
+		}
+		io_ret = fprintf(stream, "%s\n    {\"test\": %ld, \"name\": \"%s\",\n      ", first ? "" : ",", i,
+				 state->testNames[i]);
+		if (io_ret <= 0) {
+			errp(88, __func__, "error in writing to %s", path);
+		}
+		first = false;
+		for (j = 0; j < NUMOFPHASES; j++) {
+			writePhaseJSON(stream, phaseName[j], &timing->phase[i][j], ",\n      ");
+		}
+		io_ret = fprintf(stream, "\"threads\": [");
+		if (io_ret <= 0) {
+			errp(88, __func__, "error in writing to %s", path);
+		}
+		for (t = 0; t < timing->numberOfThreads; t++) {
+			io_ret = fprintf(stream, "%s{", (t > 0) ? ", " : "");
+			if (io_ret <= 0) {
+				errp(88, __func__, "error in writing to %s", path);
+			}
+			writePhaseJSON(stream, "iterate", &timing->iterate[t][i], "}");
+		}
+		io_ret = fprintf(stream, "]}");
+		if (io_ret <= 0) {
+			errp(88, __func__, "error in writing to %s", path);
+		}
+	}
+
+	/*
+	 * Write input reading and parsing of each thread
+	 */
+	io_ret = fprintf(stream, "\n  ],\n  \"input\": [");
+	if (io_ret <= 0) {
+		errp(88, __func__, "error in writing to %s", path);
+	}
+	for (t = 0; t < timing->numberOfThreads; t++) {
+		io_ret = fprintf(stream, "%s\n    {\"thread\": %ld, ", (t > 0) ? "," : "", t);
+		if (io_ret <= 0) {
+			errp(88, __func__, "error in writing to %s", path);
+		}
+		writePhaseJSON(stream, "read", &timing->read[t], ", ");
+		writePhaseJSON(stream, "parse", &timing->parse[t], "}");
+	}
+	io_ret = fprintf(stream, "\n  ]\n}\n");
+	if (io_ret <= 0) {
+		errp(88, __func__, "error in writing to %s", path);
+	}
+
+	/*
+	 * Close timing.json
+	 */
+	errno = 0;		// paranoia
+	io_ret = fclose(stream);
+	if (io_ret != 0) {
+		errp(88, __func__, "error closing: %s", path);
+	}
+	free(path);
+	return;
+}
+
+
+/*
+ * destroyTiming - free the time accounted to each test, phase and thread
+ *
+ * given:
+ *      state           // run state to test under
+ */
+void
+destroyTiming(struct state *state)
+{
+	long int i;
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (state == NULL) {
+		err(89, __func__, "state arg is NULL");
+	}
+	if (state->timing == NULL) {
+		return;
+	}
+
+	/*
+	 * Free timing storage
+	 */
+	if (state->timing->iterate != NULL) {
+		for (i = 0; i < state->timing->numberOfThreads; i++) {
+			if (state->timing->iterate[i] != NULL) {
+				free(state->timing->iterate[i]);
+				state->timing->iterate[i] = NULL;
+			}
+		}
+		free(state->timing->iterate);
+		state->timing->iterate = NULL;
+	}
+	if (state->timing->read != NULL) {
+		free(state->timing->read);
+		state->timing->read = NULL;
+	}
+	if (state->timing->parse != NULL) {
+		free(state->timing->parse);
+		state->timing->parse = NULL;
+	}
+	free(state->timing);
+	state->timing = NULL;
+	return;
+}
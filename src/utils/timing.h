@@ -0,0 +1,45 @@
+/*****************************************************************************
+ T I M I N G  F U N C T I O N  P R O T O T Y P E S
+ *****************************************************************************/
+
+/*
+ * This code has been heavily modified by the following people:
+ *
+ *      Landon Curt Noll
+ *      Tom Gilgan
+ *      Riccardo Paccagnella
+ *
+ * See the README.md and the initial comment in sts.c for more information.
+ *
+ * WE (THOSE LISTED ABOVE WHO HEAVILY MODIFIED THIS CODE) DISCLAIM ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL WE (THOSE LISTED ABOVE
+ * WHO HEAVILY MODIFIED THIS CODE) BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF
+ * USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ * chongo (Landon Curt Noll, http://www.isthe.com/chongo/index.html) /\oo/\
+ *
+ * Share and enjoy! :-)
+ */
+
+#ifndef TIMING_H
+#   define TIMING_H
+
+/*
+ * Start of a timed section of code
+ */
+struct timestamp {
+	struct timespec wall;		// Wall clock time at the start of the section
+	struct timespec cpu;		// CPU time of the calling thread at the start of the section
+};
+
+extern void initTiming(struct state *state);
+extern void startTimer(struct timestamp *start);
+extern void stopTimer(struct timestamp *start, struct phase_time *phase_time, long int bits);
+extern void reportTiming(struct state *state);
+extern void destroyTiming(struct state *state);
+
+#endif				/* TIMING_H */
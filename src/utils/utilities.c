@@ -52,6 +52,10 @@
 // sts includes
 #include "../utils/externs.h"
 #include "utilities.h"
+#include "placement.h"
+#include "arena.h"
+#include "timing.h"
+#include "pvalues.h"
 #include "debug.h"
 
 #ifdef _WIN32
@@ -135,8 +139,18 @@ static char * getString(FILE * stream);
 static bool checkReadPermissions(char *path);
 static void handleFileBasedBitStreams(struct state *state);
 static void *testBits(void *thread_args);
-static void parseBitsASCIIInput(struct thread_state *thread_state);
-static void parseBitsBinaryInput(struct thread_state *thread_state);
+static long int claimBatchSize(struct state *state, long int maxBatch);
+static void trackIterations(struct state *state);
+static void skipInput(struct state *state, long int count);
+static bool startIteration(struct state *state, long int iteration);
+static void endIteration(struct state *state, long int iteration);
+static void streamIteration(struct thread_state *thread_state, BitSequence *chunk, long int iteration);
+static void readChunk(struct thread_state *thread_state, BitSequence *chunk, long int iteration, long int first,
+		      long int count);
+static void writeFreqCounts(struct thread_state *thread_state, long int bitsRead, long int num_0s, long int num_1s);
+static struct p_val_tally *create_p_val_tally(struct state *state, int test);
+static void tallyRange(struct state *state, int test, struct dyn_array *p_val, long int first, long int last);
+static void *tallyRanges(void *arg);
 
 
 /*
@@ -479,6 +493,160 @@ openTruncate(char *filename)
 }
 
 
+/*
+ * openPrintFile - open a stats.txt, results.txt or data*.txt file for a print driver interface
+ *
+ * given:
+ *      state           // run state to test under
+ *      filename        // the filename to open for writing
+ *
+ * return
+ *      non-NULL --> open FILE descriptor, truncated unless state->printedIterations > 0
+ *      NULL --> could not be created, or was not writable
+ *
+ * With -W, the print driver interface of a test is called by the writer thread for each
+ * chunk of iterations: the first chunk truncates the file and the next chunks are appended to it.
+ */
+FILE *
+openPrintFile(struct state *state, char *filename)
+{
+	FILE *stream;		// open file or NULL
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (state == NULL) {
+		err(233, __func__, "state arg is NULL");
+	}
+	if (state->printedIterations <= 0) {
+		return openTruncate(filename);
+	}
+	if (filename == NULL) {
+		warn(__func__, "filename arg was NULL");
+		return NULL;
+	}
+
+	/*
+	 * Attempt to append to file
+	 */
+	errno = 0;		// paranoia
+	stream = fopen(filename, "a");
+	if (stream == NULL) {
+		warnp(__func__, "could not create/open for appending: %s", filename);
+		return NULL;
+	}
+	dbg(DBG_HIGH, "created/opened for appending: %s", filename);
+	return stream;
+}
+
+
+/*
+ * retainedIterations - number of iterations of a test whose stats and p_values are kept at once
+ *
+ * given:
+ *      state           // run state to test under
+ *
+ * returns:
+ *      number of iterations to size the stats and p_val dynamic arrays of a test for
+ *
+ * With -W, at most WRITER_CHUNK iterations are kept before they are handed to the writer thread.
+ */
+long int
+retainedIterations(struct state *state)
+{
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (state == NULL) {
+		err(233, __func__, "state arg is NULL");
+	}
+
+	if (state->writerFlag == true && state->tp.numOfBitStreams > WRITER_CHUNK) {
+		return WRITER_CHUNK;
+	}
+	return state->tp.numOfBitStreams;
+}
+
+
+/*
+ * epsilonLength - number of bits of a bitstream held by the epsilon array of each thread
+ *
+ * given:
+ *      state           // run state to test under
+ *
+ * returns:
+ *      bitcount(n), or the -X chunk size when streaming bitstreams in chunks
+ */
+long int
+epsilonLength(struct state *state)
+{
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (state == NULL) {
+		err(233, __func__, "state arg is NULL");
+	}
+
+	if (state->streamChunk > 0 && state->streamChunk < state->tp.n) {
+		return state->streamChunk;
+	}
+	return state->tp.n;
+}
+
+
+/*
+ * iterationBytes - number of bytes of the batch buffer holding the input data of one iteration
+ *
+ * given:
+ *      state           // run state to test under
+ *
+ * returns:
+ *      bytes of epsilonLength() bits of input: one 0/1 value per bit for ASCII input,
+ *      8 bits per byte for raw binary input
+ */
+long int
+iterationBytes(struct state *state)
+{
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (state == NULL) {
+		err(233, __func__, "state arg is NULL");
+	}
+
+	if (state->dataFormat == FORMAT_ASCII_01) {
+		return epsilonLength(state);
+	}
+	return (epsilonLength(state) + BITS_N_BYTE - 1) / BITS_N_BYTE;
+}
+
+
+/*
+ * batchIterations - maximum number of iterations whose input data a thread reads at once
+ *
+ * given:
+ *      state           // run state to test under
+ *
+ * returns:
+ *      iterations that fit in BATCH_INPUT_BYTES, at least 1, or 1 when streaming (-X)
+ */
+long int
+batchIterations(struct state *state)
+{
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (state == NULL) {
+		err(233, __func__, "state arg is NULL");
+	}
+
+	if (state->streamChunk > 0) {
+		return 1;
+	}
+	return MAX(1, BATCH_INPUT_BYTES / iterationBytes(state));
+}
+
+
 /*
  * filePathName - malloc a file pathname given a two parts of the path
  *
@@ -566,7 +734,7 @@ data_filename_format(int partitionCount)
 	if (partitionCount < 2) {
 		digits = 0;	// no partitions, just use data.txt
 	} else {
-		for (digits = MAX_DATA_DIGITS; digits > 0; --digits) {
+		for (digits = MAX_DATA_DIGITS; digits > 1; --digits) {
 			if (pow(10.0, digits) < (double) partitionCount) {
 				break;
 			}
@@ -1598,6 +1766,13 @@ handleFileBasedBitStreams(struct state *state)
 		state->base_seek = ((state->jobnum * state->tp.n * state->tp.numOfBitStreams) + BITS_N_BYTE - 1) / BITS_N_BYTE;
 	}
 
+	/*
+	 * Track the completed iterations (if -C or -r), skipping those of the checkpoint to resume from (if -r)
+	 */
+	if (state->checkpointCycle > 0 || state->resumeFlag == true) {
+		trackIterations(state);
+	}
+
 	/*
 	 * Initialize and set thread detached attribute
 	 */
@@ -1636,6 +1811,17 @@ handleFileBasedBitStreams(struct state *state)
 
 	dbg(DBG_LOW, "End of iterate phase\n");
 
+	/*
+	 * Free the completed iterations tracking
+	 */
+	if (state->checkpoint != NULL) {
+		pthread_mutex_destroy(&state->checkpoint->mutex);
+		pthread_cond_destroy(&state->checkpoint->cond);
+		free(state->checkpoint->done);
+		free(state->checkpoint);
+		state->checkpoint = NULL;
+	}
+
 	/*
 	 * Close the input file
 	 */
@@ -1650,11 +1836,35 @@ handleFileBasedBitStreams(struct state *state)
 }
 
 
+/*
+ * testBits - worker thread: claim batches of iterations, read their data and test them
+ *
+ * given:
+ *      thread_args     // pointer to the struct thread_state of this thread
+ *
+ * Each time the mutex is taken, a thread claims a batch of consecutive iterations and
+ * reads the input data of the whole batch into its contiguous batch buffer.  Converting
+ * that data into epsilon and testing it is then done without holding the mutex.
+ *
+ * The batch size adapts to the work left (see claimBatchSize()), so that short bitstreams
+ * do not pay one mutex round trip per iteration, while the last iterations are still
+ * spread evenly across threads.
+ *
+ * When streaming (-X), a thread claims a single iteration at a time, and the batch buffer
+ * only holds one chunk of its input (see streamIteration()).
+ */
 static void
 *testBits(void *thread_args)
 {
 	struct thread_state *thread_state = (struct thread_state *) thread_args;
 	char buf[BUFSIZ + 1];	// time string buffer
+	BitSequence *batch;	// Input data of the iterations claimed by this thread
+	long int iterBytes;	// Number of batch bytes holding the input data of one iteration
+	long int maxBatch;	// Maximum number of iterations claimed at once
+	long int first;		// First iteration of the claimed batch
+	long int count;		// Number of iterations in the claimed batch
+	struct timestamp start;	// Start of reading or parsing input, if timing
+	long int j;
 
 	/*
 	 * Check preconditions (firewall)
@@ -1669,6 +1879,24 @@ static void
 
 	dbg(DBG_HIGH, "Thread %ld started.", thread_state->thread_id);
 
+	/*
+	 * Pin this thread (if requested by -N placement) and make its buffers local to where it runs
+	 */
+	if (state->placement != PLACEMENT_NONE) {
+		placeThread(thread_state);
+		touchArena(thread_state);
+	}
+
+	/*
+	 * Find the batch buffer, carved out of the arena of this thread by init
+	 *
+	 * ASCII input is stored as one 0/1 value per bit, raw binary input is stored as read: 8 bits per byte.
+	 */
+	iterBytes = iterationBytes(state);
+	maxBatch = batchIterations(state);
+	batch = state->batch[thread_state->thread_id];
+	dbg(DBG_HIGH, "Thread %ld will claim up to %ld iterations at once", thread_state->thread_id, maxBatch);
+
 	while (1) {
 		pthread_mutex_lock(thread_state->mutex);
 
@@ -1677,33 +1905,79 @@ static void
 			break;
 		}
 
-		thread_state->iteration_being_done = state->tp.numOfBitStreams - state->iterationsMissing;
-		state->iterationsMissing -= 1;
+		/*
+		 * Claim a batch of iterations
+		 */
+		count = claimBatchSize(state, maxBatch);
+		first = state->tp.numOfBitStreams - state->iterationsMissing;
+		state->iterationsMissing -= count;
 
 		/*
-		 * Parse and data for this iteration
+		 * Read the data for the iterations of this batch, unless it is read in chunks (if -X)
 		 */
-		if (state->dataFormat == FORMAT_ASCII_01) {
-			parseBitsASCIIInput(thread_state);
-		} else {
-			parseBitsBinaryInput(thread_state);
+		if (state->streamChunk == 0) {
+			if (state->timing != NULL) {
+				startTimer(&start);
+			}
+			if (state->dataFormat == FORMAT_ASCII_01) {
+				parseBitsASCIIInput(thread_state, batch, first, count);
+			} else {
+				parseBitsBinaryInput(thread_state, batch, first, count);
+			}
+			if (state->timing != NULL) {
+				stopTimer(&start, &state->timing->read[thread_state->thread_id], count * state->tp.n);
+			}
 		}
 
 		pthread_mutex_unlock(thread_state->mutex);
 
-		/*
-		 * Perform one iteration on the bitstreams read from the streamFile
-		 */
-		iterate(thread_state);
+		for (j = 0; j < count; j++) {
+			thread_state->iteration_being_done = first + j;
 
-		/*
-		 * Report iteration done (if requested)
-		 */
-		if (state->reportCycle > 0 && (((thread_state->iteration_being_done % state->reportCycle) == 0) ||
-					       (thread_state->iteration_being_done == state->tp.numOfBitStreams))) {
-			getTimestamp(buf, BUFSIZ);
-			msg("Completed iteration %ld of %ld at %s", thread_state->iteration_being_done + 1,
-			    state->tp.numOfBitStreams, buf);
+			/*
+			 * Skip the iteration if it was completed before the checkpoint resumed from (if -r)
+			 */
+			if (state->checkpoint != NULL && startIteration(state, first + j) == false) {
+				continue;
+			}
+
+			/*
+			 * Read and test the bitstream of this iteration one chunk at a time, if -X
+			 */
+			if (state->streamChunk > 0) {
+				streamIteration(thread_state, batch, first + j);
+			}
+
+			/*
+			 * Otherwise, load epsilon with the data of this iteration and perform one iteration on it
+			 */
+			else {
+				if (state->timing != NULL) {
+					startTimer(&start);
+					loadEpsilonFromBatch(thread_state, batch + j * iterBytes);
+					stopTimer(&start, &state->timing->parse[thread_state->thread_id], state->tp.n);
+				} else {
+					loadEpsilonFromBatch(thread_state, batch + j * iterBytes);
+				}
+				iterate(thread_state);
+			}
+
+			/*
+			 * Mark the iteration as completed, and write a checkpoint every checkpointCycle iterations (if -C)
+			 */
+			if (state->checkpoint != NULL) {
+				endIteration(state, first + j);
+			}
+
+			/*
+			 * Report iteration done (if requested)
+			 */
+			if (state->reportCycle > 0 && (((thread_state->iteration_being_done % state->reportCycle) == 0) ||
+						       (thread_state->iteration_being_done == state->tp.numOfBitStreams))) {
+				getTimestamp(buf, BUFSIZ);
+				msg("Completed iteration %ld of %ld at %s", thread_state->iteration_being_done + 1,
+				    state->tp.numOfBitStreams, buf);
+			}
 		}
 	}
 
@@ -1712,178 +1986,950 @@ static void
 
 
 /*
- * parseBitsASCIIInput - read bits from the streamFile and save them into epsilon bit array
+ * claimBatchSize - determine how many iterations a thread should claim at once
  *
  * given:
  *      state           // pointer to run state
+ *      maxBatch        // maximum number of iterations that fit into a batch buffer
  *
- * Given the open steam streamFile, from file state->randomDataPath, convert its ASCII characters
- * into 'bits' for the epsilon bit array.
+ * returns:
+ *      number of iterations to claim, between 1 and MIN(maxBatch, state->iterationsMissing)
+ *
+ * A thread claims 1/(BATCH_SHARE * numberOfThreads) of the iterations still missing:
+ * large batches while there is plenty of work left, down to single iterations at the end
+ * so that all threads finish at about the same time.
+ *
+ * NOTE: The caller must hold the mutex.
  */
-static void
-parseBitsASCIIInput(struct thread_state *thread_state)
+static long int
+claimBatchSize(struct state *state, long int maxBatch)
 {
-	long int i;
-	long int num_0s;
-	long int num_1s;
-	long int bitsRead;
-	int bit;
-	int io_ret;		// I/O return status
+	long int share;		// Number of thread shares the missing iterations are split into
+	long int count;		// Number of iterations to claim
 
 	/*
 	 * Check preconditions (firewall)
 	 */
-	if (thread_state == NULL) {
-		err(225, __func__, "thread_state arg is NULL");
-	}
-	struct state *state = thread_state->global_state;
 	if (state == NULL) {
 		err(225, __func__, "state arg is NULL");
 	}
-	if (state->streamFile == NULL) {
-		err(225, __func__, "streamFile arg is NULL");
-	}
-	if (state->epsilon[thread_state->thread_id] == NULL) {
-		err(227, __func__, "state->epsilon[%ld] is NULL", thread_state->thread_id);
+	if (state->iterationsMissing <= 0) {
+		err(225, __func__, "no iterations left to claim: %ld", state->iterationsMissing);
 	}
 
+	share = BATCH_SHARE * MAX(1, state->numberOfThreads);
+	count = (state->iterationsMissing + share - 1) / share;
+	count = MIN(count, maxBatch);
+	count = MIN(count, state->iterationsMissing);
+	return MAX(1, count);
+}
+
+
+/*
+ * trackIterations - start tracking the completed iterations, and restore those of the checkpoint to resume from
+ *
+ * given:
+ *      state           // pointer to run state
+ *
+ * When resuming (-r), iterations up to the first one that was not completed are not claimed at all,
+ * so that their input is seeked over.  The other completed iterations are skipped by startIteration().
+ */
+static void
+trackIterations(struct state *state)
+{
+	long int prefix;	// Number of leading completed iterations
+	int ret;		// pthread function return
+
 	/*
-	 * If not reading randdata from stdin,
-	 * Seek to the position of the first bit which has not been copied into the stream yet
+	 * Check preconditions (firewall)
 	 */
-	if (state->stdinData == false &&
-	    fseek(state->streamFile, state->base_seek + thread_state->iteration_being_done * state->tp.n, SEEK_SET) != 0) {
-		errp(226, __func__, "could not seek %ld further into file: %s",
-		     (thread_state->iteration_being_done * state->tp.n), state->randomDataPath);
+	if (state == NULL) {
+		err(224, __func__, "state arg is NULL");
 	}
 
 	/*
-	 * Copy the next n bits from the streamFile to epsilon
+	 * Allocate the bitmap of completed iterations
 	 */
-	num_0s = 0;
-	num_1s = 0;
-	bitsRead = 0;
-	clearerr(state->streamFile);
-	for (i = 0; i < state->tp.n; i++) {
-		io_ret = fscanf(state->streamFile, "%1d", &bit);
-		if (io_ret == EOF) {
-			warn(__func__, "Insufficient data in file %s: %ld bits were read", state->randomDataPath,
-			     bitsRead);
-			return;
-		} else {
-			bitsRead++;
-			if (bit == 0) {
-				num_0s++;
-			} else {
-				num_1s++;
-			}
-			state->epsilon[thread_state->thread_id][i] = (BitSequence) bit;
-		}
+	state->checkpoint = malloc(sizeof(*state->checkpoint));
+	if (state->checkpoint == NULL) {
+		errp(224, __func__, "cannot malloc %lu bytes for the completed iterations", sizeof(*state->checkpoint));
+	}
+	state->checkpoint->words = (state->tp.numOfBitStreams + 63) / 64;
+	state->checkpoint->done = calloc((size_t) MAX(1, state->checkpoint->words), sizeof(state->checkpoint->done[0]));
+	if (state->checkpoint->done == NULL) {
+		errp(224, __func__, "cannot calloc %ld words for the completed iterations", state->checkpoint->words);
+	}
+	state->checkpoint->completed = 0;
+	state->checkpoint->active = 0;
+	state->checkpoint->pending = false;
+	ret = pthread_mutex_init(&state->checkpoint->mutex, NULL);
+	if (ret != 0) {
+		errp(224, __func__, "error in pthread_mutex_init, returned: %d", ret);
+	}
+	ret = pthread_cond_init(&state->checkpoint->cond, NULL);
+	if (ret != 0) {
+		errp(224, __func__, "error in pthread_cond_init, returned: %d", ret);
 	}
 
 	/*
-	 * Write stats to freq.txt if in legacy_output mode
+	 * Restore the checkpoint and skip the leading completed iterations (if -r)
 	 */
-	if (state->legacy_output == true) {
-		io_ret = fprintf(state->freqFile, "\t\tBITSREAD = %ld 0s = %ld 1s = %ld\n", bitsRead, num_0s, num_1s);
-		if (io_ret <= 0) {
-			errp(225, __func__, "error in writing to %s", state->freqFilePath);
+	if (state->resumeFlag == true && read_checkpoint(state) == true) {
+		for (prefix = 0; prefix < state->tp.numOfBitStreams; prefix++) {
+			if ((state->checkpoint->done[prefix / 64] & ((uint64_t) 1 << (prefix % 64))) == 0) {
+				break;
+			}
 		}
-		io_ret = fflush(state->freqFile);
-		if (io_ret != 0) {
-			errp(225, __func__, "error flushing to %s", state->freqFilePath);
+		state->iterationsMissing = state->tp.numOfBitStreams - prefix;
+		if (state->stdinData == true) {
+			skipInput(state, prefix);
 		}
+		dbg(DBG_LOW, "Skipping the input of the first %ld completed iterations", prefix);
 	}
+	state->checkpoint->next = state->checkpoint->completed + state->checkpointCycle;
 
 	return;
 }
 
 
 /*
- * parseBitsBinaryInput - read bits from the streamFile and convert them into epsilon bit array
+ * skipInput - read past the input of iterations when reading randdata from stdin
  *
  * given:
  *      state           // pointer to run state
+ *      count           // number of iterations whose input is to be skipped
  *
- * Given the open steam streamFile, from file state->randomDataPath, convert its bytes into 'bits'
- * found in the epsilon bit array.
+ * As stdin cannot be seeked, the input of the leading iterations completed before a checkpoint
+ * is read and dropped.
  */
 static void
-parseBitsBinaryInput(struct thread_state *thread_state)
+skipInput(struct state *state, long int count)
 {
-	long int num_0s;	// Count of 0 bits processed
-	long int num_1s;	// Count of 1 bits processed
-	long int bitsRead;	// Number of bits to read and process
-	bool done;		// true ==> we have converted enough data
-	BYTE byte;		// single bite
-	int io_ret;		// I/O return status
+	char buf[BUFSIZ];	// Dropped input
+	size_t wanted;		// Number of bytes to read at once
+	long int left;		// Number of bits or bytes left to skip
+	int bit;
 
 	/*
 	 * Check preconditions (firewall)
 	 */
-	if (thread_state == NULL) {
-		err(225, __func__, "thread_state arg is NULL");
-	}
-	struct state *state = thread_state->global_state;
 	if (state == NULL) {
-		err(226, __func__, "state arg is NULL");
+		err(224, __func__, "state arg is NULL");
 	}
 	if (state->streamFile == NULL) {
-		err(226, __func__, "streamFile arg is NULL");
+		err(224, __func__, "streamFile arg is NULL");
 	}
 
-	/*
-	 * If not reading randdata from stdin,
-	 * Seek to the position of the first bit which has not been copied into the stream yet
-	 */
-	if (state->stdinData == false &&
-	    fseek(state->streamFile, state->base_seek + thread_state->iteration_being_done * state->tp.n /
-							BITS_N_BYTE, SEEK_SET) != 0) {
-
-		errp(226, __func__, "could not seek %ld further into file: %s",
-		     thread_state->iteration_being_done * state->tp.n / BITS_N_BYTE, state->randomDataPath);
+	if (state->dataFormat == FORMAT_ASCII_01) {
+		for (left = count * state->tp.n; left > 0; left--) {
+			if (fscanf(state->streamFile, "%1d", &bit) == EOF) {
+				err(224, __func__, "encountered EOF while skipping the input of %ld completed iterations: %s",
+				    count, state->randomDataPath);
+			}
+		}
+	} else {
+		for (left = count * ((state->tp.n + BITS_N_BYTE - 1) / BITS_N_BYTE); left > 0; left -= (long int) wanted) {
+			wanted = (size_t) MIN(left, (long int) sizeof(buf));
+			if (fread(buf, 1, wanted, state->streamFile) != wanted) {
+				errp(224, __func__, "cannot read while skipping the input of %ld completed iterations: %s",
+				     count, state->randomDataPath);
+			}
+		}
 	}
 
-	/*
-	 * Copy the next n bits from the streamFile to epsilon
-	 */
-	num_0s = 0;
-	num_1s = 0;
-	bitsRead = 0;
-	clearerr(state->streamFile);
-	do {
-		/*
-		 * Read the next binary octet
-		 */
-		io_ret = fgetc(state->streamFile);
+	return;
+}
+
+
+/*
+ * startIteration - wait for any checkpoint being written, then count an iteration as being done
+ *
+ * given:
+ *      state           // pointer to run state
+ *      iteration       // iteration about to be done
+ *
+ * returns:
+ *      true ==> the iteration is to be done, and endIteration() must be called once it is
+ *      false ==> the iteration was completed before the checkpoint resumed from
+ */
+static bool
+startIteration(struct state *state, long int iteration)
+{
+	struct checkpoint *checkpoint = state->checkpoint;
+
+	pthread_mutex_lock(&checkpoint->mutex);
+	if ((checkpoint->done[iteration / 64] & ((uint64_t) 1 << (iteration % 64))) != 0) {
+		pthread_mutex_unlock(&checkpoint->mutex);
+		return false;
+	}
+	while (checkpoint->pending == true) {
+		pthread_cond_wait(&checkpoint->cond, &checkpoint->mutex);
+	}
+	checkpoint->active++;
+	pthread_mutex_unlock(&checkpoint->mutex);
+
+	return true;
+}
+
+
+/*
+ * endIteration - mark an iteration as completed, and write a checkpoint every checkpointCycle iterations
+ *
+ * given:
+ *      state           // pointer to run state
+ *      iteration       // iteration just completed
+ *
+ * The checkpoint is written once the iterations being done by other threads have ended,
+ * and no iteration is started until it is written, so that it holds the results of
+ * exactly the completed iterations.
+ */
+static void
+endIteration(struct state *state, long int iteration)
+{
+	struct checkpoint *checkpoint = state->checkpoint;
+
+	pthread_mutex_lock(&checkpoint->mutex);
+	checkpoint->done[iteration / 64] |= (uint64_t) 1 << (iteration % 64);
+	checkpoint->completed++;
+	checkpoint->active--;
+
+	if (checkpoint->pending == true) {
+		if (checkpoint->active == 0) {
+			pthread_cond_broadcast(&checkpoint->cond);
+		}
+	} else if (state->checkpointCycle > 0 && checkpoint->completed >= checkpoint->next &&
+		   checkpoint->completed < state->tp.numOfBitStreams) {
+		checkpoint->pending = true;
+		while (checkpoint->active > 0) {
+			pthread_cond_wait(&checkpoint->cond, &checkpoint->mutex);
+		}
+		write_checkpoint(state);
+		checkpoint->next = checkpoint->completed + state->checkpointCycle;
+		checkpoint->pending = false;
+		pthread_cond_broadcast(&checkpoint->cond);
+	}
+	pthread_mutex_unlock(&checkpoint->mutex);
+
+	return;
+}
+
+
+/*
+ * parseBitsASCIIInput - read ASCII bits of a batch of iterations from the streamFile
+ *
+ * given:
+ *      thread_state    // pointer to thread state
+ *      batch           // where to store count * n bits, one 0/1 value per byte
+ *      first           // first iteration of the batch
+ *      count           // number of iterations in the batch
+ *
+ * Given the open steam streamFile, from file state->randomDataPath, convert its ASCII characters
+ * into 'bits' for the batch buffer.
+ *
+ * NOTE: The caller must hold the mutex.
+ */
+void
+parseBitsASCIIInput(struct thread_state *thread_state, BitSequence *batch, long int first, long int count)
+{
+	long int i;
+	long int bitsWanted;
+	long int bitsRead;
+	int bit;
+	int io_ret;		// I/O return status
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (thread_state == NULL) {
+		err(225, __func__, "thread_state arg is NULL");
+	}
+	struct state *state = thread_state->global_state;
+	if (state == NULL) {
+		err(225, __func__, "state arg is NULL");
+	}
+	if (state->streamFile == NULL) {
+		err(225, __func__, "streamFile arg is NULL");
+	}
+	if (batch == NULL) {
+		err(227, __func__, "batch arg is NULL");
+	}
+
+	/*
+	 * If not reading randdata from stdin,
+	 * Seek to the position of the first bit which has not been copied into the stream yet
+	 */
+	if (state->stdinData == false &&
+	    fseek(state->streamFile, state->base_seek + first * state->tp.n, SEEK_SET) != 0) {
+		errp(226, __func__, "could not seek %ld further into file: %s",
+		     (first * state->tp.n), state->randomDataPath);
+	}
+
+	/*
+	 * Copy the next count * n bits from the streamFile to the batch
+	 */
+	bitsWanted = count * state->tp.n;
+	bitsRead = 0;
+	clearerr(state->streamFile);
+	for (i = 0; i < bitsWanted; i++) {
+		io_ret = fscanf(state->streamFile, "%1d", &bit);
+		if (io_ret == EOF) {
+			warn(__func__, "Insufficient data in file %s: %ld bits were read", state->randomDataPath,
+			     bitsRead);
+			memset(batch + i, 0, (bitsWanted - i) * sizeof(batch[0]));
+			return;
+		} else {
+			bitsRead++;
+			batch[i] = (BitSequence) bit;
+		}
+	}
+
+	return;
+}
+
+
+/*
+ * parseBitsBinaryInput - read raw binary bytes of a batch of iterations from the streamFile
+ *
+ * given:
+ *      thread_state    // pointer to thread state
+ *      batch           // where to store count * n bits, 8 bits per byte
+ *      first           // first iteration of the batch
+ *      count           // number of iterations in the batch
+ *
+ * Given the open steam streamFile, from file state->randomDataPath, read the bytes holding
+ * the bits of count iterations in a single read.
+ *
+ * NOTE: The caller must hold the mutex.
+ */
+void
+parseBitsBinaryInput(struct thread_state *thread_state, BitSequence *batch, long int first, long int count)
+{
+	size_t bytesWanted;	// Number of bytes to read
+	size_t bytesRead;	// Number of bytes read
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (thread_state == NULL) {
+		err(225, __func__, "thread_state arg is NULL");
+	}
+	struct state *state = thread_state->global_state;
+	if (state == NULL) {
+		err(226, __func__, "state arg is NULL");
+	}
+	if (state->streamFile == NULL) {
+		err(226, __func__, "streamFile arg is NULL");
+	}
+	if (batch == NULL) {
+		err(226, __func__, "batch arg is NULL");
+	}
+
+	/*
+	 * If not reading randdata from stdin,
+	 * Seek to the position of the first bit which has not been copied into the stream yet
+	 */
+	if (state->stdinData == false &&
+	    fseek(state->streamFile, state->base_seek + first * state->tp.n / BITS_N_BYTE, SEEK_SET) != 0) {
+
+		errp(226, __func__, "could not seek %ld further into file: %s",
+		     first * state->tp.n / BITS_N_BYTE, state->randomDataPath);
+	}
+
+	/*
+	 * Read the bytes of all the iterations of the batch
+	 */
+	bytesWanted = (size_t) (count * ((state->tp.n + BITS_N_BYTE - 1) / BITS_N_BYTE));
+	clearerr(state->streamFile);
+	errno = 0;		// paranoia
+	bytesRead = fread(batch, sizeof(batch[0]), bytesWanted, state->streamFile);
+	if (bytesRead != bytesWanted) {
 		if (ferror(state->streamFile)) {
 			errp(226, __func__, "read error while reading file: %s", state->randomDataPath);
-		} else if (feof(state->streamFile) || io_ret == EOF) {
+		} else {
 			err(226, __func__, "encounted EOF (end of file) while reading file: %s: %ld bits were read before EOF",
-			    state->randomDataPath, bitsRead);
-		} else if (io_ret < 0) {
-			errp(226, __func__, "unexpected fgetc return while reading file: %s", state->randomDataPath);
+			    state->randomDataPath, (long int) (bytesRead % (bytesWanted / count)) * BITS_N_BYTE);
+		}
+	}
+
+	return;
+}
+
+
+/*
+ * streamIteration - read and test the bitstream of one iteration in chunks of -X chunk bits
+ *
+ * given:
+ *      thread_state    // pointer to thread state
+ *      chunk           // buffer for the input data of a chunk
+ *      iteration       // iteration whose bitstream is to be tested
+ *
+ * Each chunk is read under the mutex from its position in randdata, then converted into
+ * epsilon and handed to the tests (see iterateChunk()) without holding the mutex.  Only one
+ * chunk of the bitstream is in memory at a time.
+ */
+static void
+streamIteration(struct thread_state *thread_state, BitSequence *chunk, long int iteration)
+{
+	long int num_0s;	// Count of 0 bits processed
+	long int num_1s;	// Count of 1 bits processed
+	long int bitsRead;	// Number of bits of the chunk processed
+	long int first;		// Index in the bitstream of the first bit of the chunk
+	long int count;		// Number of bits in the chunk
+	struct timestamp start;	// Start of reading or parsing input, if timing
+	long int i;
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (thread_state == NULL) {
+		err(230, __func__, "thread_state arg is NULL");
+	}
+	struct state *state = thread_state->global_state;
+	if (state == NULL) {
+		err(230, __func__, "state arg is NULL");
+	}
+	if (chunk == NULL) {
+		err(230, __func__, "chunk arg is NULL");
+	}
+	if (state->streamChunk <= 0) {
+		err(230, __func__, "-X chunk: %ld must be > 0", state->streamChunk);
+	}
+
+	num_0s = 0;
+	num_1s = 0;
+	for (first = 0; first < state->tp.n; first += count) {
+		count = MIN(state->streamChunk, state->tp.n - first);
+
+		/*
+		 * Read the data of this chunk
+		 */
+		pthread_mutex_lock(thread_state->mutex);
+		if (state->timing != NULL) {
+			startTimer(&start);
+			readChunk(thread_state, chunk, iteration, first, count);
+			stopTimer(&start, &state->timing->read[thread_state->thread_id], count);
+		} else {
+			readChunk(thread_state, chunk, iteration, first, count);
+		}
+		pthread_mutex_unlock(thread_state->mutex);
+
+		/*
+		 * Load epsilon with the bits of this chunk
+		 */
+		if (state->timing != NULL) {
+			startTimer(&start);
+		}
+		if (state->dataFormat == FORMAT_ASCII_01) {
+			for (i = 0; i < count; i++) {
+				if (chunk[i] == 0) {
+					num_0s++;
+				} else {
+					num_1s++;
+				}
+			}
+			memcpy(state->epsilon[thread_state->thread_id], chunk, count * sizeof(chunk[0]));
+		} else {
+			bitsRead = 0;
+			(void) copyBitsToEpsilon(state, thread_state->thread_id, chunk, count, &num_0s, &num_1s, &bitsRead);
+		}
+		if (state->timing != NULL) {
+			stopTimer(&start, &state->timing->parse[thread_state->thread_id], count);
 		}
-		byte = (BYTE) io_ret;
 
 		/*
-		 * Add bits of the octet to the epsilon bit stream
+		 * Stream this chunk to the tests
 		 */
-		done = copyBitsToEpsilon(state, thread_state->thread_id, &byte, BITS_N_BYTE, &num_0s, &num_1s, &bitsRead);
-	} while (done == false);
+		iterateChunk(thread_state, first, count);
+	}
+
+	/*
+	 * Write stats to freq.txt if in legacy_output mode
+	 */
+	if (state->legacy_output == true) {
+		writeFreqCounts(thread_state, state->tp.n, num_0s, num_1s);
+	}
+
+	return;
+}
+
+
+/*
+ * readChunk - read the input data of a chunk of the bitstream of an iteration from the streamFile
+ *
+ * given:
+ *      thread_state    // pointer to thread state
+ *      chunk           // where to store the chunk, one 0/1 value per byte if ASCII, else 8 bits per byte
+ *      iteration       // iteration whose bitstream the chunk is part of
+ *      first           // index in the bitstream of the first bit of the chunk, a multiple of 8
+ *      count           // number of bits in the chunk
+ *
+ * Unless reading randdata from stdin, where the chunks are read in order, the chunk is seeked to.
+ *
+ * NOTE: The caller must hold the mutex.
+ */
+static void
+readChunk(struct thread_state *thread_state, BitSequence *chunk, long int iteration, long int first, long int count)
+{
+	long int offset;	// Position of the chunk in randdata, from base_seek
+	size_t bytesWanted;	// Number of bytes to read
+	size_t bytesRead;	// Number of bytes read
+	long int i;
+	int bit;
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (thread_state == NULL) {
+		err(230, __func__, "thread_state arg is NULL");
+	}
+	struct state *state = thread_state->global_state;
+	if (state == NULL) {
+		err(230, __func__, "state arg is NULL");
+	}
+	if (state->streamFile == NULL) {
+		err(230, __func__, "streamFile arg is NULL");
+	}
+	if (chunk == NULL) {
+		err(230, __func__, "chunk arg is NULL");
+	}
+
+	/*
+	 * If not reading randdata from stdin, seek to the first bit of the chunk
+	 */
+	if (state->dataFormat == FORMAT_ASCII_01) {
+		offset = iteration * state->tp.n + first;
+	} else {
+		offset = (iteration * state->tp.n + first) / BITS_N_BYTE;
+	}
+	if (state->stdinData == false && fseek(state->streamFile, state->base_seek + offset, SEEK_SET) != 0) {
+		errp(230, __func__, "could not seek %ld further into file: %s", offset, state->randomDataPath);
+	}
+
+	/*
+	 * Read the chunk
+	 */
+	clearerr(state->streamFile);
+	if (state->dataFormat == FORMAT_ASCII_01) {
+		for (i = 0; i < count; i++) {
+			if (fscanf(state->streamFile, "%1d", &bit) == EOF) {
+				warn(__func__, "Insufficient data in file %s: %ld bits were read", state->randomDataPath,
+				     iteration * state->tp.n + first + i);
+				memset(chunk + i, 0, (count - i) * sizeof(chunk[0]));
+				return;
+			}
+			chunk[i] = (BitSequence) bit;
+		}
+	} else {
+		bytesWanted = (size_t) ((count + BITS_N_BYTE - 1) / BITS_N_BYTE);
+		errno = 0;	// paranoia
+		bytesRead = fread(chunk, sizeof(chunk[0]), bytesWanted, state->streamFile);
+		if (bytesRead != bytesWanted) {
+			if (ferror(state->streamFile)) {
+				errp(230, __func__, "read error while reading file: %s", state->randomDataPath);
+			} else {
+				err(230, __func__, "encounted EOF (end of file) while reading file: %s: %ld bits were read before EOF",
+				    state->randomDataPath, first + (long int) bytesRead * BITS_N_BYTE);
+			}
+		}
+	}
+
+	return;
+}
+
+
+/*
+ * loadEpsilonFromBatch - convert the batch data of one iteration into the epsilon bit array
+ *
+ * given:
+ *      thread_state    // pointer to thread state
+ *      data            // batch data of the iteration, as stored by parseBitsASCIIInput or parseBitsBinaryInput
+ *
+ * The mutex is only taken, in legacy_output mode, to write the bit counts to freq.txt.
+ */
+void
+loadEpsilonFromBatch(struct thread_state *thread_state, BitSequence *data)
+{
+	long int num_0s;	// Count of 0 bits processed
+	long int num_1s;	// Count of 1 bits processed
+	long int bitsRead;	// Number of bits processed
+	long int i;
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (thread_state == NULL) {
+		err(227, __func__, "thread_state arg is NULL");
+	}
+	struct state *state = thread_state->global_state;
+	if (state == NULL) {
+		err(227, __func__, "state arg is NULL");
+	}
+	if (data == NULL) {
+		err(227, __func__, "data arg is NULL");
+	}
+	if (state->epsilon[thread_state->thread_id] == NULL) {
+		err(227, __func__, "state->epsilon[%ld] is NULL", thread_state->thread_id);
+	}
+
+	/*
+	 * Copy the n bits of this iteration to epsilon
+	 */
+	num_0s = 0;
+	num_1s = 0;
+	bitsRead = 0;
+	if (state->dataFormat == FORMAT_ASCII_01) {
+		for (i = 0; i < state->tp.n; i++) {
+			if (data[i] == 0) {
+				num_0s++;
+			} else {
+				num_1s++;
+			}
+		}
+		bitsRead = state->tp.n;
+		memcpy(state->epsilon[thread_state->thread_id], data, state->tp.n * sizeof(data[0]));
+	} else {
+		(void) copyBitsToEpsilon(state, thread_state->thread_id, data, state->tp.n, &num_0s, &num_1s, &bitsRead);
+	}
+
+	/*
+	 * Write stats to freq.txt if in legacy_output mode
+	 */
+	if (state->legacy_output == true) {
+		writeFreqCounts(thread_state, bitsRead, num_0s, num_1s);
+	}
+
+	return;
+}
+
+
+/*
+ * writeFreqCounts - write the bit counts of an iteration to freq.txt
+ *
+ * given:
+ *      thread_state    // pointer to thread state
+ *      bitsRead        // number of bits of the iteration
+ *      num_0s          // number of 0 bits of the iteration
+ *      num_1s          // number of 1 bits of the iteration
+ *
+ * The mutex is taken to write the bit counts.
+ */
+static void
+writeFreqCounts(struct thread_state *thread_state, long int bitsRead, long int num_0s, long int num_1s)
+{
+	struct state *state = thread_state->global_state;
+	int io_ret;		// I/O return status
+
+	pthread_mutex_lock(thread_state->mutex);
+	io_ret = fprintf(state->freqFile, "\t\tBITSREAD = %ld 0s = %ld 1s = %ld\n", bitsRead, num_0s, num_1s);
+	if (io_ret <= 0) {
+		errp(227, __func__, "error in writing to %s", state->freqFilePath);
+	}
+	io_ret = fflush(state->freqFile);
+	if (io_ret != 0) {
+		errp(227, __func__, "error flushing to %s", state->freqFilePath);
+	}
+	pthread_mutex_unlock(thread_state->mutex);
+
+	return;
+}
+
+
+/*
+ * copyBitsToEpsilon - convert binary bytes into the end of an epsilon bit array
+ *
+ * given:
+ *      state           // pointer to run state
+ *      x               // pointer to an array (even just 1) binary bytes
+ *      xBitLength      // Number of bits to convert
+ *      bitsNeeded      // Total number of bits we want to convert this run
+ *      num_0s          // pointer to number of 0 bits converted so far
+ *      num_1s          // pointer to number of 1 bits converted so far
+ *      bitsRead        // pointer to number of bits converted so far
+ *
+ * returns:
+ *      true ==> we have converted enough bits
+ *      false ==> we have NOT converted enough bits, yet
+ */
+bool
+copyBitsToEpsilon(struct state *state, long int thread_id, BYTE *x, long int xBitLength, long int *num_0s, long int *num_1s,
+		  long int *bitsRead)
+{
+	long int i;
+	long int j;
+	long int count;
+	int bit;
+	BYTE mask;
+	long int bitsNeeded;
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (state == NULL) {
+		err(227, __func__, "state arg is NULL");
+	}
+	if (state->epsilon[thread_id] == NULL) {
+		err(227, __func__, "state->epsilon[%ld] is NULL", thread_id);
+	}
+
+	bitsNeeded = state->tp.n;
+
+	count = 0;
+	for (i = 0; i < (xBitLength + BITS_N_BYTE - 1) / BITS_N_BYTE; i++) {
+		mask = 0x80;
+		for (j = 0; j < 8; j++) {
+			if (*(x + i) & mask) {
+				bit = 1;
+				(*num_1s)++;
+			} else {
+				bit = 0;
+				(*num_0s)++;
+			}
+			mask >>= 1;
+			state->epsilon[thread_id][*bitsRead] = (BitSequence) bit;
+			(*bitsRead)++;
+			if (*bitsRead == bitsNeeded) {
+				return true;
+			}
+			if (++count == xBitLength) {
+				return false;
+			}
+		}
+	}
+
+	return false;
+}
+
+
+/*
+ * getTimestamp - get the time and write it as a string into a buffer
+ *
+ * given:
+ *      buf             // fixed length buffer
+ *      len             // length of the buffer in bytes
+ *
+ * Determine the time as of "now" and format it as follows:
+ *
+ *      yyyy-mm-dd hh:mm:ss
+ *
+ * This function does not retun on error.
+ */
+void
+getTimestamp(char *buf, size_t len)
+{
+	time_t seconds;		// seconds since the epoch
+	struct tm *loc_ret;	// return value form localtime_r()
+	struct tm now;		// the time now
+	size_t time_len;	// Length of string produced by strftime() or 0
+
+	// firewall
+	if (buf == NULL) {
+		err(229, __func__, "bug arg is NULL");
+	}
+	if (len <= 0) {
+		err(229, __func__, "len must be > 0: %lu", len);
+	}
+
+	/*
+	 * Determine the time for now
+	 */
+	errno = 0;		// paranoia
+	seconds = time(NULL);
+	if (seconds < 0) {
+		errp(229, __func__, "time returned < 0: %ld", seconds);
+	}
+#ifdef _WIN32
+	localtime_s(&now, &seconds);
+#else
+	loc_ret = localtime_r(&seconds, &now);
+	if (loc_ret == NULL) {
+		errp(229, __func__, "localtime_r returned NULL");
+	}
+#endif
+	errno = 0;		// paranoia
+	time_len = strftime(buf, len - 1, "%F %T", &now);
+	if (time_len == 0) {
+		errp(229, __func__, "strftime failed");
+	}
+	buf[len] = '\0';	// paranoia
+	return;
+}
+
+
+/*
+ * create_p_val_tally - allocate an empty p_value tally for a test
+ *
+ * given:
+ *      state           // run state to test under
+ *      test            // test number whose p_values will be tallied
+ *
+ * returns:
+ *      malloced p_val_tally with state->partitionCount[test] partitions of uniformity_bins bins each
+ */
+static struct p_val_tally *
+create_p_val_tally(struct state *state, int test)
+{
+	struct p_val_tally *tally;	// p_value tally to return
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (state == NULL) {
+		err(233, __func__, "state arg is NULL");
+	}
+	if (test <= 0 || test > NUMOFTESTS) {
+		err(233, __func__, "test: %d must be in [1, %d]", test, NUMOFTESTS);
+	}
+	if (state->partitionCount[test] < 1) {
+		err(233, __func__, "partitionCount for %s[%d]: %d must be >= 1",
+		    state->testNames[test], test, state->partitionCount[test]);
+	}
+	if (state->tp.uniformity_bins < 1) {
+		err(233, __func__, "uniformity_bins: %ld must be >= 1", state->tp.uniformity_bins);
+	}
+
+	/*
+	 * Allocate the zeroed counters
+	 */
+	tally = malloc(sizeof(*tally));
+	if (tally == NULL) {
+		errp(233, __func__, "cannot malloc %lu bytes for p_val_tally", sizeof(*tally));
+	}
+	tally->partitionCount = state->partitionCount[test];
+	tally->bins = state->tp.uniformity_bins;
+	tally->count = 0;
+	tally->sampleCount = calloc((size_t) tally->partitionCount, sizeof(tally->sampleCount[0]));
+	tally->toolow = calloc((size_t) tally->partitionCount, sizeof(tally->toolow[0]));
+	tally->freqPerBin = calloc((size_t) (tally->partitionCount * tally->bins), sizeof(tally->freqPerBin[0]));
+	if (tally->sampleCount == NULL || tally->toolow == NULL || tally->freqPerBin == NULL) {
+		errp(233, __func__, "cannot calloc counters for %ld partitions of %ld bins", tally->partitionCount, tally->bins);
+	}
+
+	return tally;
+}
+
+
+/*
+ * tally_p_value - count a p_value of a test in the uniformity and proportion counts of its partition
+ *
+ * given:
+ *      state           // run state to test under
+ *      test            // test number that produced p_value
+ *      partition       // index of p_value among the p_values of its iteration
+ *      p_value         // p_value to tally, or NON_P_VALUE if the test was not possible
+ *
+ * NOTE: The caller must hold the mutex that protects the shared state, if any.
+ */
+void
+tally_p_value(struct state *state, int test, long int partition, double p_value)
+{
+	struct p_val_tally *tally;	// p_value tally of the test
+	long int *freqPerBin;		// Uniformity frequency bins of the partition
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (state == NULL) {
+		err(233, __func__, "state arg is NULL");
+	}
+	if (test <= 0 || test > NUMOFTESTS) {
+		err(233, __func__, "test: %d must be in [1, %d]", test, NUMOFTESTS);
+	}
+
+	/*
+	 * Allocate the tally on first use
+	 */
+	if (state->tally[test] == NULL) {
+		state->tally[test] = create_p_val_tally(state, test);
+	}
+	tally = state->tally[test];
+	if (partition < 0 || partition >= tally->partitionCount) {
+		err(233, __func__, "partition: %ld of %s[%d] must be in [0, %ld)",
+		    partition, state->testNames[test], test, tally->partitionCount);
+	}
+	tally->count++;
+
+	/*
+	 * Sample the p_value
+	 */
+	if (p_value == NON_P_VALUE) {
+		return;		// the test was not possible for this iteration
+	}
+	if (state->is_excursion[test] == true && p_value <= 0.0) {
+		return;		// Ignore p_value of 0 for random excursion tests
+	}
+	tally->sampleCount[partition]++;
+
+	// Count the number of p_values below alpha
+	if (p_value < state->tp.alpha) {
+		tally->toolow[partition]++;
+	}
+	// Tally the p_value in a uniformity bin
+	freqPerBin = &tally->freqPerBin[partition * tally->bins];
+	if (p_value >= 1.0) {
+		++freqPerBin[tally->bins - 1];
+	} else if (p_value >= 0.0) {
+		++freqPerBin[(int) floor(p_value * (double) tally->bins)];
+	} else {
+		++freqPerBin[0];
+	}
+
+	return;
+}
+
+
+/*
+ * record_p_value - keep a p_value of an iteration, or only tally it if p_values are not kept
+ *
+ * given:
+ *      state           // run state to test under
+ *      test            // test number that produced p_value
+ *      partition       // index of p_value among the p_values of its iteration
+ *      p_value         // p_value to record, or NON_P_VALUE if the test was not possible
+ *
+ * NOTE: The caller must hold the mutex that protects the shared state, if any.
+ */
+void
+record_p_value(struct state *state, int test, long int partition, double p_value)
+{
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (state == NULL) {
+		err(233, __func__, "state arg is NULL");
+	}
+
+	if (state->p_valTally == true) {
+		tally_p_value(state, test, partition, p_value);
+	} else {
+		append_value(state->p_val[test], &p_value);
+	}
+
+	return;
+}
+
+
+/*
+ * tallyRange - tally a range of the p_values of a test kept in a dynamic array
+ *
+ * given:
+ *      state           // run state to test under
+ *      test            // test number that produced the p_values
+ *      p_val           // p_values of whole iterations
+ *      first           // index of the first p_value to tally, at the start of an iteration
+ *      last            // index of the last p_value to tally + 1
+ *
+ * NOTE: The caller must hold the mutex that protects the shared state, if any.
+ */
+static void
+tallyRange(struct state *state, int test, struct dyn_array *p_val, long int first, long int last)
+{
+	long int i;
 
 	/*
-	 * Write stats to freq.txt if in legacy_output mode
+	 * Tally each p_value in the partition of its position in the iteration
 	 */
-	if (state->legacy_output == true) {
-		io_ret = fprintf(state->freqFile, "\t\tBITSREAD = %ld 0s = %ld 1s = %ld\n", bitsRead, num_0s, num_1s);
-		if (io_ret <= 0) {
-			errp(226, __func__, "error in writing to %s", state->freqFilePath);
-		}
-		io_ret = fflush(state->freqFile);
-		if (io_ret != 0) {
-			errp(226, __func__, "error flushing to %s", state->freqFilePath);
-		}
+	for (i = first; i < last; ++i) {
+		tally_p_value(state, test, i % state->partitionCount[test], get_value(p_val, double, i));
 	}
 
 	return;
@@ -1891,368 +2937,364 @@ parseBitsBinaryInput(struct thread_state *thread_state)
 
 
 /*
- * copyBitsToEpsilon - convert binary bytes into the end of an epsilon bit array
+ * tally_p_val_array - tally p_values of a test kept in a dynamic array
  *
  * given:
- *      state           // pointer to run state
- *      x               // pointer to an array (even just 1) binary bytes
- *      xBitLength      // Number of bits to convert
- *      bitsNeeded      // Total number of bits we want to convert this run
- *      num_0s          // pointer to number of 0 bits converted so far
- *      num_1s          // pointer to number of 1 bits converted so far
- *      bitsRead        // pointer to number of bits converted so far
+ *      state           // run state to test under
+ *      test            // test number that produced the p_values
+ *      p_val           // p_values of whole iterations
  *
- * returns:
- *      true ==> we have converted enough bits
- *      false ==> we have NOT converted enough bits, yet
+ * NOTE: The caller must hold the mutex that protects the shared state, if any.
  */
-bool
-copyBitsToEpsilon(struct state *state, long int thread_id, BYTE *x, long int xBitLength, long int *num_0s, long int *num_1s,
-		  long int *bitsRead)
+void
+tally_p_val_array(struct state *state, int test, struct dyn_array *p_val)
 {
-	long int i;
-	long int j;
-	long int count;
-	int bit;
-	BYTE mask;
-	long int bitsNeeded;
-
 	/*
 	 * Check preconditions (firewall)
 	 */
 	if (state == NULL) {
-		err(227, __func__, "state arg is NULL");
+		err(233, __func__, "state arg is NULL");
 	}
-	if (state->epsilon[thread_id] == NULL) {
-		err(227, __func__, "state->epsilon[%ld] is NULL", thread_id);
+	if (p_val == NULL) {
+		err(233, __func__, "p_val arg is NULL");
 	}
-
-	bitsNeeded = state->tp.n;
-
-	count = 0;
-	for (i = 0; i < (xBitLength + BITS_N_BYTE - 1) / BITS_N_BYTE; i++) {
-		mask = 0x80;
-		for (j = 0; j < 8; j++) {
-			if (*(x + i) & mask) {
-				bit = 1;
-				(*num_1s)++;
-			} else {
-				bit = 0;
-				(*num_0s)++;
-			}
-			mask >>= 1;
-			state->epsilon[thread_id][*bitsRead] = (BitSequence) bit;
-			(*bitsRead)++;
-			if (*bitsRead == bitsNeeded) {
-				return true;
-			}
-			if (++count == xBitLength) {
-				return false;
-			}
-		}
+	if (test <= 0 || test > NUMOFTESTS) {
+		err(233, __func__, "test: %d must be in [1, %d]", test, NUMOFTESTS);
 	}
 
-	return false;
+	tallyRange(state, test, p_val, 0, p_val->count);
+
+	return;
 }
 
 
 /*
- * getTimestamp - get the time and write it as a string into a buffer
+ * tallyRanges - tally the next unclaimed range of kept p_values until none is left
  *
  * given:
- *      buf             // fixed length buffer
- *      len             // length of the buffer in bytes
- *
- * Determine the time as of "now" and format it as follows:
- *
- *      yyyy-mm-dd hh:mm:ss
+ *      arg             // pointer to the struct tally_worker of the thread
  *
- * This function does not retun on error.
+ * returns:
+ *      NULL
  */
-void
-getTimestamp(char *buf, size_t len)
+static void *
+tallyRanges(void *arg)
 {
-	time_t seconds;		// seconds since the epoch
-	struct tm *loc_ret;	// return value form localtime_r()
-	struct tm now;		// the time now
-	size_t time_len;	// Length of string produced by strftime() or 0
+	struct tally_worker *worker = arg;		// this tallying thread
+	struct tally_pool *pool = worker->pool;	// ranges to tally
+	struct tally_range *range;			// claimed range
+	long int i;					// index of the claimed range
+	int ret;					// pthread function return
 
-	// firewall
-	if (buf == NULL) {
-		err(229, __func__, "bug arg is NULL");
-	}
-	if (len <= 0) {
-		err(229, __func__, "len must be > 0: %lu", len);
-	}
+	for (;;) {
 
-	/*
-	 * Determine the time for now
-	 */
-	errno = 0;		// paranoia
-	seconds = time(NULL);
-	if (seconds < 0) {
-		errp(229, __func__, "time returned < 0: %ld", seconds);
-	}
-#ifdef _WIN32
-	localtime_s(&now, &seconds);
-#else
-	loc_ret = localtime_r(&seconds, &now);
-	if (loc_ret == NULL) {
-		errp(229, __func__, "localtime_r returned NULL");
-	}
-#endif
-	errno = 0;		// paranoia
-	time_len = strftime(buf, len - 1, "%F %T", &now);
-	if (time_len == 0) {
-		errp(229, __func__, "strftime failed");
+		/*
+		 * Claim the next range
+		 */
+		ret = pthread_mutex_lock(&pool->mutex);
+		if (ret != 0) {
+			errp(233, __func__, "error in pthread_mutex_lock, returned: %d", ret);
+		}
+		i = pool->next;
+		if (i < pool->count) {
+			++pool->next;
+		}
+		ret = pthread_mutex_unlock(&pool->mutex);
+		if (ret != 0) {
+			errp(233, __func__, "error in pthread_mutex_unlock, returned: %d", ret);
+		}
+		if (i >= pool->count) {
+			break;
+		}
+
+		range = &pool->ranges[i];
+		tallyRange(worker->state, range->test, worker->state->p_val[range->test], range->first, range->last);
 	}
-	buf[len] = '\0';	// paranoia
-	return;
+
+	return NULL;
 }
 
 
-void write_p_val_to_file(struct state *state)
+/*
+ * tally_kept_p_values - tally the kept p_values of all tests before their metrics
+ *
+ * given:
+ *      state           // run state to test under
+ *
+ * When p_values are kept in state->p_val[test] (-s), the metrics tally all of them at once.
+ * The p_values of each enabled test are cut into ranges of whole iterations, and the ranges
+ * of all tests are tallied by up to state->numberOfThreads threads, each in a private copy of
+ * the run state whose tallies are merged once all ranges are tallied.  The metrics of each test
+ * then only assess its tally, in test order, so that the output files are written as before.
+ */
+void
+tally_kept_p_values(struct state *state)
 {
-	long int i, j;
-	char *filename, *work_filepath, *final_filepath;
+	struct tally_pool pool;		// ranges to tally
+	struct tally_worker *workers;	// tallying threads
+	long int threads;		// number of tallying threads
+	long int iterations;		// number of iterations kept by a test
+	long int span;			// number of iterations in a range
+	long int i;
+	int test;
+	int ret;			// pthread function return
 
 	/*
 	 * Check preconditions (firewall)
 	 */
 	if (state == NULL) {
-		err(232, __func__, "state arg was NULL");
+		err(233, __func__, "state arg is NULL");
 	}
 
 	/*
-	 * Compute the filename of the working file (.work)
+	 * Nothing to do if p_values were tallied as iterations completed
 	 */
-	asprintf(&filename, "sts.%04ld.%ld.%ld.work", state->jobnum, state->tp.numOfBitStreams, state->tp.n);
-	work_filepath = filePathName(state->workDir, filename);
-	free(filename);
+	if (state->p_valTally == true) {
+		return;
+	}
 
 	/*
-	 * Create and open the working binary file
+	 * Cut the kept p_values of each test into about as many ranges of whole iterations as threads
 	 */
-	FILE *p_val_file;
-	p_val_file = fopen(work_filepath, "wb");
-	size_t ret;		// fwrite return
+	threads = MAX(1, state->numberOfThreads);
+	pool.count = 0;
+	for (test = 1; test <= NUMOFTESTS; test++) {
+		if (state->testVector[test] == true && state->tally[test] == NULL &&
+		    state->p_val[test] != NULL && state->p_val[test]->count > 0) {
+			pool.count += MIN(threads, state->p_val[test]->count);
+		}
+	}
+	if (pool.count == 0) {
+		return;
+	}
+	pool.ranges = malloc((size_t) pool.count * sizeof(pool.ranges[0]));
+	if (pool.ranges == NULL) {
+		errp(233, __func__, "cannot malloc %ld ranges of p_values", pool.count);
+	}
+	pool.count = 0;
+	for (test = 1; test <= NUMOFTESTS; test++) {
+		if (state->testVector[test] == true && state->tally[test] == NULL &&
+		    state->p_val[test] != NULL && state->p_val[test]->count > 0) {
+			iterations = (state->p_val[test]->count + state->partitionCount[test] - 1) / state->partitionCount[test];
+			span = (iterations + threads - 1) / threads;
+			for (i = 0; i < iterations; i += span) {
+				pool.ranges[pool.count].test = test;
+				pool.ranges[pool.count].first = i * state->partitionCount[test];
+				pool.ranges[pool.count].last = MIN((i + span) * state->partitionCount[test],
+								   state->p_val[test]->count);
+				++pool.count;
+			}
+			// Create the tally even if every range is tallied in a private copy of the run state
+			state->tally[test] = create_p_val_tally(state, test);
+		}
+	}
+	pool.next = 0;
+	ret = pthread_mutex_init(&pool.mutex, NULL);
+	if (ret != 0) {
+		errp(233, __func__, "error in pthread_mutex_init, returned: %d", ret);
+	}
 
 	/*
-	 * Write the p-values of each test in the working file
+	 * Use at most one thread per range
 	 */
-	for (i = 1; i <= NUMOFTESTS; i++) {
-		if (state->testVector[i] == true) {
+	threads = MIN(threads, pool.count);
+	dbg(DBG_MED, "tallying %ld range(s) of kept p-values with %ld thread(s)", pool.count, threads);
 
-			/*
-			 * Write the number of the test
-			 */
-			ret = fwrite(&i, sizeof(i), 1, p_val_file);
-			if (ferror(p_val_file)) {
-				warnp(__func__, "error while writing test number to p-value file: %s", filename);
-				break;
-			}
-			if (ret != 1) {
-				warn(__func__, "unable to write test number to p-value file: %s", filename);
-				break;
-			}
+	if (threads <= 1) {
 
-			/*
-			 * Write the number of p-values for this test
-			 */
-			ret = fwrite(&(state->p_val[i]->count), sizeof(state->p_val[i]->count), 1, p_val_file);
-			if (ferror(p_val_file)) {
-				warnp(__func__, "error while writing test p-value count to p-value file: %s", filename);
-				break;
-			}
-			if (ret != 1) {
-				warn(__func__, "unable to write p-value count to p-value file: %s", filename);
-				break;
-			}
+		/*
+		 * Tally the ranges directly in the run state
+		 */
+		struct tally_worker worker;	// the calling thread
 
-			/*
-			 * Write the p-values
-			 */
-			for (j = 0; j < state->p_val[i]->count; j++) {
+		worker.pool = &pool;
+		worker.state = state;
+		(void) tallyRanges(&worker);
 
-				double p_val;
+	} else {
 
-				/*
-				 * Also when the test is NON_OVERLAPPING, take the p-value only.
-				 */
-				if (i != TEST_NON_OVERLAPPING) {
-					p_val = get_value(state->p_val[i], double, j);
-				} else {
-					struct nonover_stats *nonov = addr_value(state->p_val[i], struct nonover_stats, j);
-					p_val = nonov->p_value;
-				}
+		/*
+		 * Start the tallying threads, each with a private copy of the run state without tallies
+		 */
+		workers = calloc((size_t) threads, sizeof(workers[0]));
+		if (workers == NULL) {
+			errp(233, __func__, "cannot calloc %ld tallying threads", threads);
+		}
+		for (i = 0; i < threads; i++) {
+			workers[i].pool = &pool;
+			workers[i].state = malloc(sizeof(*workers[i].state));
+			if (workers[i].state == NULL) {
+				errp(233, __func__, "cannot malloc %lu bytes for the state of tallying thread %ld",
+				     sizeof(*workers[i].state), i);
+			}
+			*workers[i].state = *state;
+			memset(workers[i].state->tally, 0, sizeof(workers[i].state->tally));
+			ret = pthread_create(&workers[i].thread, NULL, tallyRanges, &workers[i]);
+			if (ret != 0) {
+				errp(233, __func__, "error in pthread_create of tallying thread %ld, returned: %d", i, ret);
+			}
+		}
 
-				ret = fwrite(&p_val, sizeof(p_val), 1, p_val_file);
-				if (ferror(p_val_file)) {
-					warnp(__func__, "error while writing p-value[%ld] to p-value file: %s", j, filename);
-					break;
-				}
-				if (ret != 1) {
-					warn(__func__, "unable to write p-value[%ld] to p-value file: %s", j, filename);
-					break;
+		/*
+		 * Wait for all ranges to be tallied, and merge the tallies of each thread
+		 */
+		for (i = 0; i < threads; i++) {
+			ret = pthread_join(workers[i].thread, NULL);
+			if (ret != 0) {
+				errp(233, __func__, "error in pthread_join of tallying thread %ld, returned: %d", i, ret);
+			}
+			for (test = 1; test <= NUMOFTESTS; test++) {
+				if (workers[i].state->tally[test] != NULL) {
+					merge_p_val_tally(state, test, workers[i].state->tally[test]);
+					free_p_val_tally(workers[i].state->tally[test]);
+					workers[i].state->tally[test] = NULL;
 				}
 			}
+			free(workers[i].state);
+			workers[i].state = NULL;
 		}
+		free(workers);
 	}
 
-	/*
-	 * Close the "working" file
-	 */
-	fclose(p_val_file);
+	ret = pthread_mutex_destroy(&pool.mutex);
+	if (ret != 0) {
+		errp(233, __func__, "error in pthread_mutex_destroy, returned: %d", ret);
+	}
+	free(pool.ranges);
+
+	return;
+}
+
 
+/*
+ * get_p_val_tally - return the p_value tally of a test for its metrics
+ *
+ * given:
+ *      state           // run state to test under
+ *      test            // test number whose p_values are assessed
+ *
+ * returns:
+ *      the tally of the p_values of test
+ *
+ * When p_values are kept in state->p_val[test], they are tallied here, unless tally_kept_p_values()
+ * already tallied them.  Otherwise they were tallied as iterations completed, or as -W handed them
+ * to the writer thread.
+ *
+ * NOTE: This function must be called only once per test, by its metrics driver interface.
+ */
+struct p_val_tally *
+get_p_val_tally(struct state *state, int test)
+{
 	/*
-	 * Compute the final filename
+	 * Check preconditions (firewall)
 	 */
-	asprintf(&filename, "sts.%04ld.%ld.%ld.pvalues", state->jobnum, state->tp.numOfBitStreams, state->tp.n);
-	final_filepath = filePathName(state->workDir, filename);
+	if (state == NULL) {
+		err(233, __func__, "state arg is NULL");
+	}
+	if (test <= 0 || test > NUMOFTESTS) {
+		err(233, __func__, "test: %d must be in [1, %d]", test, NUMOFTESTS);
+	}
 
 	/*
-	 * Rename the work file (.work) to have its final filename (.pvalues)
+	 * Tally the kept p_values
 	 */
-	if (rename(work_filepath, final_filepath) < 0) {
-		errp(232, __func__, "error in renaming %s to %s", work_filepath, final_filepath);
+	if (state->p_valTally == false && state->tally[test] == NULL && state->p_val[test] != NULL) {
+		tally_p_val_array(state, test, state->p_val[test]);
 	}
 
 	/*
-	 * Free allocated memory
+	 * No iteration may have been tallied
 	 */
-	free(filename);
-	free(work_filepath);
-	free(final_filepath);
+	if (state->tally[test] == NULL) {
+		state->tally[test] = create_p_val_tally(state, test);
+	}
+
+	return state->tally[test];
 }
 
 
-void read_from_p_val_file(struct state *state)
+/*
+ * merge_p_val_tally - add the counts of a p_value tally to the tally of a test
+ *
+ * given:
+ *      state           // run state to test under
+ *      test            // test number whose p_values were tallied
+ *      from            // tally of other p_values of test, such as the tally of another thread
+ *
+ * NOTE: The caller must hold the mutex that protects the shared state, if any.
+ */
+void
+merge_p_val_tally(struct state *state, int test, struct p_val_tally *from)
 {
-	long int test_num;		// test number for the pvalues that follow in the pvalue file
-	long int p_val_index;		// current pvalue number for a given test number in the pvalue file
+	struct p_val_tally *tally;	// p_value tally of the test
+	long int i;
 
 	/*
 	 * Check preconditions (firewall)
 	 */
 	if (state == NULL) {
-		err(232, __func__, "state arg was NULL");
+		err(233, __func__, "state arg is NULL");
+	}
+	if (from == NULL) {
+		err(233, __func__, "from arg is NULL");
+	}
+	if (test <= 0 || test > NUMOFTESTS) {
+		err(233, __func__, "test: %d must be in [1, %d]", test, NUMOFTESTS);
 	}
-	dbg(DBG_LOW, "start of reading pvalue file(s) phase");
-
-	struct Node *current = state->filenames;
-	while (current != NULL) {
-		char *filename;		// current pvalues filename
-		FILE *p_val_file;	// open pvalues filename
-		size_t ret;		// fread return
-
-		/*
-		 * Open the file
-		 */
-		filename = current->filename;
-		if (filename == NULL) {
-		    err(232, __func__, "current p-value filename is NULL");
-		}
-
-		dbg(DBG_MED, "parsing p-value file: %s", filename);
-		p_val_file = fopen(filePathName(state->pvalues_dir, filename), "rb");
-		if (p_val_file == NULL) {
-			warnp(__func__, "skipping p-value file due to error in opening p-value file: %s", filename);
-			current = current->next;
-			continue;
-		}
-
-		/*
-		 * Read the content of the file
-		 */
-		do {
-
-			/*
-			 * Read the test number
-			 */
-			ret = fread(&test_num, sizeof(test_num), 1, p_val_file);
-			if (ferror(p_val_file)) {
-				warnp(__func__, "skipping p-value, error while reading test number from p-value file: %s",
-				      filename);
-				break;
-			}
-			if (feof(p_val_file)) {
-				warn(__func__, "skipping p-value file, found EOF while reading test number from p-value file: %s",
-				     filename);
-				break;
-			}
-			if (ret != 1) {
-				warn(__func__, "skipping p-value file, unable to read test number from p-value file: %s",
-				     filename);
-				break;
-			}
 
-			/*
-			 * Read number of p-values for the current testnum
-			 */
-			long int number_of_p_vals;	// number of pvalues that follow in the pvalue file
-			ret = fread(&number_of_p_vals, sizeof(number_of_p_vals), 1, p_val_file);
-			if (ferror(p_val_file)) {
-				warnp(__func__, "skipping p-value file, error while reading number_of_p_vals from p-value file: %s",
-						filename);
-				break;
-			}
-			if (feof(p_val_file)) {
-				warn(__func__, "skipping p-value file, found EOF while reading number of pvals in p-value file: %s",
-						filename);
-				break;
-			}
-			if (ret != 1) {
-				warn(__func__, "skipping p-value file, unable to read number_of_p_vals from p-value file: %s",
-				     filename);
-				break;
-			}
+	/*
+	 * Allocate the tally on first use
+	 */
+	if (state->tally[test] == NULL) {
+		state->tally[test] = create_p_val_tally(state, test);
+	}
+	tally = state->tally[test];
+	if (from->partitionCount != tally->partitionCount || from->bins != tally->bins) {
+		err(233, __func__, "cannot merge a tally of %ld partitions of %ld bins into one of %ld partitions of %ld bins",
+		    from->partitionCount, from->bins, tally->partitionCount, tally->bins);
+	}
 
-			/*
-			 * Read all the p-values for this test
-			 */
-			for (p_val_index = 0; p_val_index < number_of_p_vals; p_val_index++) {
-				double p_val;		// pvalue read from pvalue file
-
-				/*
-				 * Read one p-value
-				 */
-				ret = fread(&p_val, sizeof(p_val), 1, p_val_file);
-				if (ferror(p_val_file)) {
-					warnp(__func__, "error while reading a pvalue[%d] from file: %s", p_val_index, filename);
-					break;
-				}
-				if (feof(p_val_file)) {
-					warn(__func__, "EOF while reading pvalue[%ld] from file: %s", p_val_index, filename);
-					break;
-				}
-				if (ret != 1) {
-					warn(__func__, "unable to read a pvalue[%d] from file: %s", p_val_index, filename);
-					break;
-				}
+	/*
+	 * Add the counts
+	 */
+	tally->count += from->count;
+	for (i = 0; i < tally->partitionCount; ++i) {
+		tally->sampleCount[i] += from->sampleCount[i];
+		tally->toolow[i] += from->toolow[i];
+	}
+	for (i = 0; i < tally->partitionCount * tally->bins; ++i) {
+		tally->freqPerBin[i] += from->freqPerBin[i];
+	}
 
-				/*
-				 * Append each read p-value to the p-values of this test
-				 */
-				if (test_num != TEST_NON_OVERLAPPING) {
-					append_value(state->p_val[test_num], &p_val);
-				} else {
-					struct nonover_stats nonov;
-					nonov.p_value = p_val;
-					append_value(state->p_val[test_num], &nonov);
-				}
-			}
+	return;
+}
 
-		} while (!feof(p_val_file) && !ferror(p_val_file) && ret == 1 && test_num < NUMOFTESTS);
 
-		/*
-		 * Close the file that has been read
-		 */
-		fclose(p_val_file);
-		dbg(DBG_HIGH, "processed all pvalues from pvalue file: %s", filename);
-		current = current->next;
+/*
+ * free_p_val_tally - free a p_value tally
+ *
+ * given:
+ *      tally           // p_value tally to free
+ */
+void
+free_p_val_tally(struct p_val_tally *tally)
+{
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (tally == NULL) {
+		err(233, __func__, "tally arg is NULL");
 	}
 
-	dbg(DBG_LOW, "end of reading pvalue file(s) phase\n");
+	free(tally->sampleCount);
+	tally->sampleCount = NULL;
+	free(tally->toolow);
+	tally->toolow = NULL;
+	free(tally->freqPerBin);
+	tally->freqPerBin = NULL;
+	free(tally);
+
+	return;
 }
 
 
@@ -32,6 +32,11 @@ extern long int getNumber(FILE * input, FILE * output);
 extern void makePath(char *dir);
 extern bool checkWritePermissions(char *dir);
 extern FILE *openTruncate(char *filename);
+extern FILE *openPrintFile(struct state *state, char *filename);
+extern long int retainedIterations(struct state *state);
+extern long int epsilonLength(struct state *state);
+extern long int iterationBytes(struct state *state);
+extern long int batchIterations(struct state *state);
 extern char *filePathName(char *head, char *tail);
 extern char *data_filename_format(int partitionCount);
 extern void precheckPath(struct state *state, char *dir);
@@ -43,8 +48,16 @@ extern void fixParameters(struct state *state);
 extern bool copyBitsToEpsilon(struct state *state, long int thread_id, BYTE *x, long int xBitLength, long int *num_0s,
 			      long int *num_1s, long int *bitsRead);
 extern void invokeTestSuite(struct state *state);
-extern void read_from_p_val_file(struct state *state);
-extern void write_p_val_to_file(struct state *state);
+extern void parseBitsASCIIInput(struct thread_state *thread_state, BitSequence *batch, long int first, long int count);
+extern void parseBitsBinaryInput(struct thread_state *thread_state, BitSequence *batch, long int first, long int count);
+extern void loadEpsilonFromBatch(struct thread_state *thread_state, BitSequence *data);
+extern void tally_p_value(struct state *state, int test, long int partition, double p_value);
+extern void record_p_value(struct state *state, int test, long int partition, double p_value);
+extern void tally_p_val_array(struct state *state, int test, struct dyn_array *p_val);
+extern void tally_kept_p_values(struct state *state);
+extern struct p_val_tally *get_p_val_tally(struct state *state, int test);
+extern void merge_p_val_tally(struct state *state, int test, struct p_val_tally *from);
+extern void free_p_val_tally(struct p_val_tally *tally);
 extern void print_option_summary(struct state *state, char *where);
 extern int sum_will_overflow_long(long int si_a, long int si_b);
 extern int multiplication_will_overflow_long(long int si_a, long int si_b);
@@ -0,0 +1,432 @@
+// writer.c
+// Write stats.txt, results.txt and data*.txt from a background thread while iterating (-W)
+
+/*
+ * This code has been heavily modified by the following people:
+ *
+ *      Landon Curt Noll
+ *      Tom Gilgan
+ *      Riccardo Paccagnella
+ *
+ * See the README.md and the initial comment in sts.c for more information.
+ *
+ * WE (THOSE LISTED ABOVE WHO HEAVILY MODIFIED THIS CODE) DISCLAIM ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL WE (THOSE LISTED ABOVE
+ * WHO HEAVILY MODIFIED THIS CODE) BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF
+ * USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+ * OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ * chongo (Landon Curt Noll, http://www.isthe.com/chongo/index.html) /\oo/\
+ *
+ * Share and enjoy! :-)
+ */
+
+
+// Exit codes: 235 thru 239
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include "externs.h"
+#include "utilities.h"
+#include "writer.h"
+#include "debug.h"
+
+
+/*
+ * Forward static function declarations
+ */
+static void queueChunk(struct state *state, int test, bool last);
+static void *writeChunks(void *arg);
+static void writeChunk(struct writer *writer, struct write_chunk *chunk);
+
+
+/*
+ * startWriter - start the background writer thread, if -W was given
+ *
+ * given:
+ *      state           // run state to test under
+ *
+ * This function must be called after all tests are initialized, and before any iteration is performed.
+ */
+void
+startWriter(struct state *state)
+{
+	struct writer *writer;	// Background writer
+	int ret;		// pthread function return
+	int i;
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (state == NULL) {
+		err(235, __func__, "state arg is NULL");
+	}
+	if (state->writerFlag == false) {
+		return;
+	}
+	if (state->writer != NULL) {
+		err(235, __func__, "writer was already started");
+	}
+
+	/*
+	 * Allocate the writer and its private copy of the run state
+	 *
+	 * The print driver interface of a test only reads the per test settings of the state
+	 * (which do not change while iterating) and its stats and p_val arrays.  The copy
+	 * lets the writer thread point those arrays to the chunk being written.
+	 */
+	writer = calloc(1, sizeof(*writer));
+	if (writer == NULL) {
+		errp(235, __func__, "cannot calloc %lu bytes for writer", sizeof(*writer));
+	}
+	writer->state = malloc(sizeof(*writer->state));
+	if (writer->state == NULL) {
+		errp(235, __func__, "cannot malloc %lu bytes for the writer state", sizeof(*writer->state));
+	}
+	*writer->state = *state;
+	for (i = 0; i <= NUMOFTESTS; i++) {
+		writer->state->stats[i] = NULL;
+		writer->state->p_val[i] = NULL;
+	}
+	writer->head = NULL;
+	writer->tail = NULL;
+	writer->queued = 0;
+	writer->stop = false;
+
+	/*
+	 * Start the writer thread
+	 */
+	ret = pthread_mutex_init(&writer->mutex, NULL);
+	if (ret != 0) {
+		errno = ret;
+		errp(235, __func__, "error on pthread_mutex_init()");
+	}
+	ret = pthread_cond_init(&writer->cond, NULL);
+	if (ret != 0) {
+		errno = ret;
+		errp(235, __func__, "error on pthread_cond_init()");
+	}
+	ret = pthread_create(&writer->thread, NULL, writeChunks, writer);
+	if (ret != 0) {
+		errno = ret;
+		errp(235, __func__, "error on pthread_create()");
+	}
+	state->writer = writer;
+	dbg(DBG_MED, "started the writer thread, handing it %d iterations of a test at once", WRITER_CHUNK);
+
+	return;
+}
+
+
+/*
+ * queueFullChunks - hand each test that kept WRITER_CHUNK iterations to the writer thread
+ *
+ * given:
+ *      thread_state    // state of the worker thread that just performed an iteration
+ *
+ * This function is called by worker threads after each iteration.  It takes the mutex that
+ * protects the shared state, so that the chunks of a test are queued in the order their
+ * iterations were recorded.
+ */
+void
+queueFullChunks(struct thread_state *thread_state)
+{
+	struct state *state;	// run state to test under
+	int i;
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (thread_state == NULL) {
+		err(236, __func__, "thread_state arg is NULL");
+	}
+	state = thread_state->global_state;
+	if (state == NULL) {
+		err(236, __func__, "state is NULL");
+	}
+	if (state->writer == NULL) {
+		err(236, __func__, "writer was not started");
+	}
+
+	/*
+	 * Lock mutex before making changes to the shared state
+	 */
+	if (thread_state->mutex != NULL) {
+		pthread_mutex_lock(thread_state->mutex);
+	}
+
+	for (i = 1; i <= NUMOFTESTS; i++) {
+		if (state->testVector[i] == true && state->stats[i] != NULL && state->stats[i]->count >= WRITER_CHUNK) {
+			queueChunk(state, i, false);
+		}
+	}
+
+	/*
+	 * Unlock mutex after making changes to the shared state
+	 */
+	if (thread_state->mutex != NULL) {
+		pthread_mutex_unlock(thread_state->mutex);
+	}
+
+	return;
+}
+
+
+/*
+ * stopWriter - hand the remaining iterations to the writer thread and wait for it to write everything
+ *
+ * given:
+ *      state           // run state to test under
+ *
+ * This function must be called after all iterations are done.  On return, the stats and p_val
+ * arrays of each test are freed and its p_values are tallied for the metrics driver interface.
+ */
+void
+stopWriter(struct state *state)
+{
+	struct writer *writer;	// Background writer
+	int ret;		// pthread function return
+	int i;
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (state == NULL) {
+		err(237, __func__, "state arg is NULL");
+	}
+	writer = state->writer;
+	if (writer == NULL) {
+		err(237, __func__, "writer was not started");
+	}
+
+	/*
+	 * Queue the last chunk of each test
+	 *
+	 * The chunk may be empty when the number of iterations is a multiple of WRITER_CHUNK.
+	 * It is still queued so that the files of a test are always created.
+	 */
+	for (i = 1; i <= NUMOFTESTS; i++) {
+		if (state->testVector[i] == true && state->stats[i] != NULL && state->p_val[i] != NULL) {
+			queueChunk(state, i, true);
+		}
+	}
+
+	/*
+	 * Tell the writer thread to exit once all chunks are written, and wait for it
+	 */
+	pthread_mutex_lock(&writer->mutex);
+	writer->stop = true;
+	pthread_cond_broadcast(&writer->cond);
+	pthread_mutex_unlock(&writer->mutex);
+	ret = pthread_join(writer->thread, NULL);
+	if (ret != 0) {
+		errno = ret;
+		errp(237, __func__, "error on pthread_join()");
+	}
+	dbg(DBG_MED, "the writer thread wrote all chunks and exited");
+
+	/*
+	 * Free the writer
+	 */
+	pthread_cond_destroy(&writer->cond);
+	pthread_mutex_destroy(&writer->mutex);
+	free(writer->state);
+	writer->state = NULL;
+	free(writer);
+	state->writer = NULL;
+
+	return;
+}
+
+
+/*
+ * queueChunk - hand the iterations kept by a test to the writer thread
+ *
+ * given:
+ *      state           // run state to test under
+ *      test            // test whose stats and p_val arrays are handed to the writer thread
+ *      last            // true ==> this is the last chunk of the test, do not replace its arrays
+ *
+ * The p_values of the chunk are tallied for the metrics driver interface, and the test
+ * continues with empty arrays.  If WRITER_QUEUE chunks are already waiting, wait for
+ * the writer thread to catch up.
+ *
+ * NOTE: The caller must hold the mutex that protects the shared state, if any.
+ */
+static void
+queueChunk(struct state *state, int test, bool last)
+{
+	struct writer *writer;		// Background writer
+	struct write_chunk *chunk;	// Chunk of iterations to queue
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (state == NULL) {
+		err(238, __func__, "state arg is NULL");
+	}
+	writer = state->writer;
+	if (writer == NULL) {
+		err(238, __func__, "writer was not started");
+	}
+	if (state->stats[test] == NULL || state->p_val[test] == NULL) {
+		err(238, __func__, "stats or p_val of %s[%d] is NULL", state->testNames[test], test);
+	}
+
+	/*
+	 * Take the arrays of the test, and tally their p_values
+	 */
+	chunk = malloc(sizeof(*chunk));
+	if (chunk == NULL) {
+		errp(238, __func__, "cannot malloc %lu bytes for write_chunk", sizeof(*chunk));
+	}
+	chunk->test = test;
+	chunk->stats = state->stats[test];
+	chunk->p_val = state->p_val[test];
+	chunk->next = NULL;
+	tally_p_val_array(state, test, chunk->p_val);
+
+	/*
+	 * Give the test new arrays for its next iterations
+	 */
+	if (last == true) {
+		state->stats[test] = NULL;
+		state->p_val[test] = NULL;
+	} else {
+		state->stats[test] = create_dyn_array(chunk->stats->elm_size, DEFAULT_CHUNK, WRITER_CHUNK, false);
+		state->p_val[test] = create_dyn_array(chunk->p_val->elm_size, DEFAULT_CHUNK,
+						      WRITER_CHUNK * state->partitionCount[test], false);
+	}
+
+	/*
+	 * Queue the chunk, once the writer thread has room for it
+	 */
+	dbg(DBG_HIGH, "queuing a chunk of %ld iterations of %s[%d]", chunk->stats->count, state->testNames[test], test);
+	pthread_mutex_lock(&writer->mutex);
+	while (writer->queued >= WRITER_QUEUE) {
+		pthread_cond_wait(&writer->cond, &writer->mutex);
+	}
+	if (writer->tail == NULL) {
+		writer->head = chunk;
+	} else {
+		writer->tail->next = chunk;
+	}
+	writer->tail = chunk;
+	writer->queued++;
+	pthread_cond_broadcast(&writer->cond);
+	pthread_mutex_unlock(&writer->mutex);
+
+	return;
+}
+
+
+/*
+ * writeChunks - writer thread: write queued chunks in order until told to stop
+ *
+ * given:
+ *      arg             // pointer to the struct writer
+ */
+static void *
+writeChunks(void *arg)
+{
+	struct writer *writer = (struct writer *) arg;
+	struct write_chunk *chunk;	// Oldest queued chunk
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (writer == NULL) {
+		err(239, __func__, "arg is NULL");
+	}
+
+	pthread_mutex_lock(&writer->mutex);
+	while (1) {
+
+		/*
+		 * Wait for a chunk, or for the order to stop once the queue is empty
+		 */
+		while (writer->head == NULL && writer->stop == false) {
+			pthread_cond_wait(&writer->cond, &writer->mutex);
+		}
+		if (writer->head == NULL) {
+			break;
+		}
+		chunk = writer->head;
+		writer->head = chunk->next;
+		if (writer->head == NULL) {
+			writer->tail = NULL;
+		}
+
+		/*
+		 * Write the chunk without holding the writer mutex
+		 */
+		pthread_mutex_unlock(&writer->mutex);
+		writeChunk(writer, chunk);
+		pthread_mutex_lock(&writer->mutex);
+
+		/*
+		 * Make room for another chunk
+		 */
+		writer->queued--;
+		pthread_cond_broadcast(&writer->cond);
+	}
+	pthread_mutex_unlock(&writer->mutex);
+
+	return NULL;
+}
+
+
+/*
+ * writeChunk - append a chunk of iterations to the stats.txt, results.txt and data*.txt files of its test
+ *
+ * given:
+ *      writer          // background writer
+ *      chunk           // chunk to write, freed on return
+ */
+static void
+writeChunk(struct writer *writer, struct write_chunk *chunk)
+{
+	struct state *state;	// Private copy of the run state
+	int test;		// Test of the chunk
+
+	/*
+	 * Check preconditions (firewall)
+	 */
+	if (writer == NULL) {
+		err(239, __func__, "writer arg is NULL");
+	}
+	if (chunk == NULL) {
+		err(239, __func__, "chunk arg is NULL");
+	}
+	state = writer->state;
+	test = chunk->test;
+
+	/*
+	 * Print the chunk as if its iterations were all the iterations of the run
+	 */
+	state->stats[test] = chunk->stats;
+	state->p_val[test] = chunk->p_val;
+	state->tp.numOfBitStreams = chunk->stats->count;
+	state->printedIterations = writer->printed[test];
+	printTest(state, test);
+	writer->printed[test] += chunk->stats->count;
+	state->stats[test] = NULL;
+	state->p_val[test] = NULL;
+
+	/*
+	 * Free the chunk
+	 */
+	free_dyn_array(chunk->stats);
+	free(chunk->stats);
+	free_dyn_array(chunk->p_val);
+	free(chunk->p_val);
+	free(chunk);
+
+	return;
+}